@@ -7,6 +7,9 @@
 #include "glhelper/ShaderProgram.hpp"
 #include "glhelper/RotateViewer.hpp"
 #include "glhelper/Mesh.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
 
 /*
 * Exercise generating and applying some transformation matrices to a 3D cube.
@@ -19,8 +22,13 @@ const int winWidth = 1024, winHeight = 720;
 
 const Uint64 desiredFrametime = 33;
 
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -130,15 +138,18 @@ int main()
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			benchmark.beginFrame(viewer);
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 			}
@@ -151,19 +162,19 @@ int main()
 			transformedCubeMesh.render();
 			glDisable(GL_CULL_FACE);
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		benchmark.finish();
 	}
 
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
 
@@ -7,6 +7,9 @@
 #include "glhelper/ShaderProgram.hpp"
 #include "glhelper/RotateViewer.hpp"
 #include "glhelper/Mesh.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/mesh.h"
@@ -67,8 +70,13 @@ Eigen::Matrix4f findNormalTransformationMatrix(const Eigen::Matrix4f& modelToWor
 	return modelToWorldMatrix;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -109,15 +117,18 @@ int main()
 
 		glEnable(GL_DEPTH_TEST);
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			benchmark.beginFrame(viewer);
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 				if (event.type == SDL_KEYDOWN &&
@@ -168,22 +179,22 @@ int main()
 			mesh.drawMode(GL_POINTS);
 			mesh.render();
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 
 			theta += 0.01f;
 			if (theta > 2 * M_PI) theta -= 2 * M_PI;
 		}
+		benchmark.finish();
 	}
 
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
 
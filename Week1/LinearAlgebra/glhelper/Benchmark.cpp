@@ -0,0 +1,368 @@
+#include "Benchmark.hpp"
+#include "RenderStats.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+// Minimum spacing of keyframes when recording a camera path.
+const double recordIntervalSeconds = 0.1;
+// How often GL_TIMESTAMP is realigned with the trace clock while tracing.
+const double traceCalibrateIntervalSeconds = 1.0;
+
+std::string nextArg(int argc, char *argv[], int &i)
+{
+	if (i + 1 >= argc) {
+		throw std::runtime_error(std::string("Benchmark: ") + argv[i] + " needs a value.");
+	}
+	return argv[++i];
+}
+
+double numberArg(int argc, char *argv[], int &i)
+{
+	std::string name = argv[i];
+	std::string value = nextArg(argc, argv, i);
+	char *end = nullptr;
+	double d = std::strtod(value.c_str(), &end);
+	if (end == value.c_str() || *end != '\0' || d < 0.0) {
+		throw std::runtime_error("Benchmark: " + name + " expects a non-negative number, not \"" + value + "\".");
+	}
+	return d;
+}
+
+BenchmarkSettings parseArgs(int argc, char *argv[])
+{
+	BenchmarkSettings s;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--camera-path") {
+			s.cameraPath = nextArg(argc, argv, i);
+		} else if (arg == "--record-path") {
+			s.recordPath = nextArg(argc, argv, i);
+		} else if (arg == "--frames") {
+			s.frames = size_t(numberArg(argc, argv, i));
+		} else if (arg == "--timestep") {
+			s.timestep = numberArg(argc, argv, i) * 1e-3;
+		} else if (arg == "--warmup") {
+			s.warmupFrames = size_t(numberArg(argc, argv, i));
+		} else if (arg == "--csv") {
+			s.csvPath = nextArg(argc, argv, i);
+		} else if (arg == "--baseline") {
+			s.baselinePath = nextArg(argc, argv, i);
+		} else if (arg == "--tolerance") {
+			s.tolerance = numberArg(argc, argv, i) * 1e-2;
+		} else if (arg == "--trace") {
+			s.tracePath = nextArg(argc, argv, i);
+		} else if (arg == "--compare") {
+			s.baselinePath = nextArg(argc, argv, i);
+			s.csvPath = nextArg(argc, argv, i);
+			s.compareOnly = true;
+		}
+		// Anything else belongs to the program itself.
+	}
+	return s;
+}
+
+//!\brief Columns of a benchmark CSV, by header name.
+std::map<std::string, std::vector<double>> readCsv(const std::string &filename)
+{
+	std::ifstream file(filename);
+	if (!file) {
+		throw std::runtime_error("Benchmark: couldn't open " + filename);
+	}
+	std::string line, cell;
+	std::vector<std::string> names;
+	if (std::getline(file, line)) {
+		std::istringstream header(line);
+		while (std::getline(header, cell, ',')) {
+			names.push_back(cell);
+		}
+	}
+	std::map<std::string, std::vector<double>> columns;
+	while (std::getline(file, line)) {
+		std::istringstream row(line);
+		for (size_t c = 0; c < names.size() && std::getline(row, cell, ','); ++c) {
+			columns[names[c]].push_back(std::atof(cell.c_str()));
+		}
+	}
+	return columns;
+}
+
+double percentile(std::vector<double> values, double p)
+{
+	if (values.empty()) {
+		return 0.0;
+	}
+	size_t rank = std::min(values.size() - 1, size_t(p * double(values.size())));
+	std::nth_element(values.begin(), values.begin() + rank, values.end());
+	return values[rank];
+}
+
+double mean(const std::vector<double> &values)
+{
+	double sum = 0.0;
+	for (double v : values) {
+		sum += v;
+	}
+	return values.empty() ? 0.0 : sum / double(values.size());
+}
+
+}
+
+Benchmark::Benchmark(int argc, char *argv[])
+	:Benchmark(parseArgs(argc, argv))
+{}
+
+Benchmark::Benchmark(const BenchmarkSettings &settings)
+	:settings_(settings),
+	frame_(0), totalFrames_(0),
+	started_(false), finished_(false), failed_(false),
+	recordingFrame_(false), tracing_(false), traceFrameStart_(0)
+{
+	start();
+}
+
+Benchmark::~Benchmark() throw()
+{
+	// Left running, the trace's flusher thread would abort the program at exit.
+	if (tracing_) {
+		try {
+			Trace::stop();
+		} catch (...) {
+		}
+	}
+}
+
+void Benchmark::start()
+{
+	if (settings_.compareOnly) {
+		failed_ = !compare(settings_.baselinePath, settings_.csvPath, settings_.tolerance, std::cout);
+		finished_ = true;
+		return;
+	}
+	if (!settings_.tracePath.empty()) {
+		Trace::start(settings_.tracePath);
+		Trace::setThreadName("Main thread");
+		tracing_ = true;
+	}
+	if (settings_.cameraPath.empty()) {
+		return;
+	}
+	if (settings_.timestep <= 0.0) {
+		throw std::runtime_error("Benchmark: --timestep must be greater than zero.");
+	}
+	path_ = CameraPath(settings_.cameraPath);
+	size_t pathFrames = size_t(std::floor(double(path_.duration()) / settings_.timestep)) + 1;
+	totalFrames_ = settings_.warmupFrames + (settings_.frames ? settings_.frames : pathFrames);
+	records_.reserve(totalFrames_ - settings_.warmupFrames);
+	std::cout << "Benchmarking " << totalFrames_ - settings_.warmupFrames << " frames along "
+		<< settings_.cameraPath << std::endl;
+}
+
+bool Benchmark::active() const
+{
+	return !path_.empty();
+}
+
+bool Benchmark::finished() const
+{
+	return finished_;
+}
+
+bool Benchmark::compareOnly() const
+{
+	return settings_.compareOnly;
+}
+
+double Benchmark::seconds() const
+{
+	if (active()) {
+		size_t recorded = frame_ < settings_.warmupFrames ? 0 : frame_ - settings_.warmupFrames;
+		return double(recorded) * settings_.timestep;
+	}
+	if (!started_) {
+		return 0.0;
+	}
+	return std::chrono::duration<double>(Clock::now() - startTime_).count();
+}
+
+void Benchmark::beginFrame(RotateViewer &viewer)
+{
+	if (!started_) {
+		startTime_ = Clock::now();
+		started_ = true;
+	}
+	RenderStats::beginFrame();
+	if (tracing_) {
+		Clock::time_point now = Clock::now();
+		if (std::chrono::duration<double>(now - traceCalibrated_).count() >= traceCalibrateIntervalSeconds) {
+			Trace::calibrateGpu();
+			traceCalibrated_ = now;
+		}
+		traceFrameStart_ = Trace::now();
+	}
+
+	if (!active()) {
+		if (!settings_.recordPath.empty()) {
+			float t = float(seconds());
+			if (recorded_.empty() || t - recorded_.duration() >= float(recordIntervalSeconds)) {
+				recorded_.add(t, viewer.pose());
+			}
+		}
+		return;
+	}
+
+	frameStart_ = Clock::now();
+	viewer.pose(path_.evaluate(float(seconds())));
+	recordingFrame_ = frame_ >= settings_.warmupFrames;
+	if (recordingFrame_) {
+		FrameRecord r = { 0.0, 0, 0, 0, 0 };
+		glGenQueries(1, &r.startQuery);
+		glGenQueries(1, &r.endQuery);
+		glGenQueries(1, &r.primitivesQuery);
+		glQueryCounter(r.startQuery, GL_TIMESTAMP);
+		glBeginQuery(GL_PRIMITIVES_GENERATED, r.primitivesQuery);
+		records_.push_back(r);
+	}
+}
+
+void Benchmark::endFrame()
+{
+	RenderStats::endFrame();
+	if (tracing_) {
+		Trace::cpuEvent("frame", traceFrameStart_, Trace::now());
+	}
+	if (!active() || finished_) {
+		return;
+	}
+	if (recordingFrame_) {
+		FrameRecord &r = records_.back();
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+		glQueryCounter(r.endQuery, GL_TIMESTAMP);
+		r.cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart_).count();
+		r.drawCalls = RenderStats::frame().drawCalls;
+		recordingFrame_ = false;
+	}
+	if (++frame_ >= totalFrames_) {
+		finished_ = true;
+	}
+}
+
+void Benchmark::finish()
+{
+	RenderStats::release();
+	if (tracing_) {
+		Trace::stop();
+		tracing_ = false;
+		std::cout << "Wrote a trace to " << settings_.tracePath << std::endl;
+	}
+	if (!recorded_.empty()) {
+		recorded_.save(settings_.recordPath);
+		std::cout << "Recorded " << recorded_.keyframes().size() << " camera keyframes to "
+			<< settings_.recordPath << std::endl;
+		recorded_ = CameraPath();
+	}
+	if (records_.empty()) {
+		return;
+	}
+	if (recordingFrame_) {
+		// Quit part way through a frame; its queries were never ended.
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+		glQueryCounter(records_.back().endQuery, GL_TIMESTAMP);
+		recordingFrame_ = false;
+	}
+
+	std::ofstream csv(settings_.csvPath);
+	if (!csv) {
+		throw std::runtime_error("Benchmark: couldn't open " + settings_.csvPath + " for writing.");
+	}
+	csv << "frame,time_s,cpu_ms,gpu_ms,draw_calls,primitives\n";
+	char line[160];
+	for (size_t i = 0; i < records_.size(); ++i) {
+		FrameRecord &r = records_[i];
+		// The last frames may still be in flight; these wait for them.
+		GLuint64 start = 0, end = 0, primitives = 0;
+		glGetQueryObjectui64v(r.startQuery, GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(r.endQuery, GL_QUERY_RESULT, &end);
+		glGetQueryObjectui64v(r.primitivesQuery, GL_QUERY_RESULT, &primitives);
+		glDeleteQueries(1, &r.startQuery);
+		glDeleteQueries(1, &r.endQuery);
+		glDeleteQueries(1, &r.primitivesQuery);
+		snprintf(line, sizeof(line), "%zu,%.4f,%.4f,%.4f,%zu,%llu\n", i, double(i) * settings_.timestep,
+			r.cpuMs, double(end - start) * 1e-6, r.drawCalls, (unsigned long long)primitives);
+		csv << line;
+	}
+	csv.close();
+	std::cout << "Wrote " << records_.size() << " frames to " << settings_.csvPath << std::endl;
+	records_.clear();
+	finished_ = true;
+
+	if (!settings_.baselinePath.empty()) {
+		failed_ = !compare(settings_.baselinePath, settings_.csvPath, settings_.tolerance, std::cout);
+	}
+}
+
+int Benchmark::exitCode() const
+{
+	return failed_ ? 1 : 0;
+}
+
+bool Benchmark::compare(const std::string &baselineCsv, const std::string &currentCsv,
+	double tolerance, std::ostream &out)
+{
+	std::map<std::string, std::vector<double>> baseline = readCsv(baselineCsv), current = readCsv(currentCsv);
+	char line[160];
+	snprintf(line, sizeof(line), "Comparing %s against baseline %s (tolerance %.1f%%)\n",
+		currentCsv.c_str(), baselineCsv.c_str(), tolerance * 100.0);
+	out << line;
+	if (baseline["frame"].size() != current["frame"].size()) {
+		out << "  Warning: frame counts differ (" << baseline["frame"].size() << " vs "
+			<< current["frame"].size() << "), so the runs may not be comparable.\n";
+	}
+	snprintf(line, sizeof(line), "  %-16s %10s %10s %9s\n", "", "baseline", "current", "change");
+	out << line;
+
+	struct Metric {
+		const char *name, *column;
+		double p;
+		bool timing;
+	};
+	const Metric metrics[] = {
+		{ "CPU median ms", "cpu_ms", 0.5, true },
+		{ "CPU p95 ms", "cpu_ms", 0.95, true },
+		{ "GPU median ms", "gpu_ms", 0.5, true },
+		{ "GPU p95 ms", "gpu_ms", 0.95, true },
+		{ "Draw calls", "draw_calls", -1.0, false },
+		{ "Primitives", "primitives", -1.0, false },
+	};
+	bool passed = true;
+	for (const Metric &m : metrics) {
+		double b = m.p < 0.0 ? mean(baseline[m.column]) : percentile(baseline[m.column], m.p);
+		double c = m.p < 0.0 ? mean(current[m.column]) : percentile(current[m.column], m.p);
+		double change = b > 0.0 ? c / b - 1.0 : 0.0;
+		const char *flag = "";
+		if (m.timing && change > tolerance) {
+			flag = "  SLOWER";
+			passed = false;
+		} else if (!m.timing && std::abs(change) > 1e-6) {
+			// The same path should always draw the same things.
+			flag = "  workload changed";
+		}
+		snprintf(line, sizeof(line), "  %-16s %10.3f %10.3f %+8.1f%%%s\n", m.name, b, c, change * 100.0, flag);
+		out << line;
+	}
+	out << (passed ? "  No regressions.\n" : "  Regression detected.\n");
+	return passed;
+}
+
+}
@@ -0,0 +1,241 @@
+#include "FramePacer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+namespace glhelper {
+
+namespace {
+
+// Sleeps can overshoot by around a scheduler tick, so the end of each wait is spun.
+const double spinMs = 2.0;
+// Frames of GPU timestamp queries in flight before one has to be skipped.
+const size_t gpuLatencyFrames = 4;
+
+double millisecondsBetween(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b)
+{
+	return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+}
+
+FrameTimeHistogram::FrameTimeHistogram(double binWidthMs, double rangeMs)
+	:binWidthMs_(binWidthMs),
+	bins_(size_t(std::ceil(rangeMs / binWidthMs)), 0),
+	overflow_(0), count_(0),
+	sum_(0.0), max_(0.0)
+{}
+
+void FrameTimeHistogram::add(double ms)
+{
+	ms = std::max(ms, 0.0);
+	size_t bin = size_t(ms / binWidthMs_);
+	if (bin < bins_.size()) {
+		++bins_[bin];
+	} else {
+		++overflow_;
+	}
+	++count_;
+	sum_ += ms;
+	max_ = std::max(max_, ms);
+}
+
+size_t FrameTimeHistogram::count() const
+{
+	return count_;
+}
+
+double FrameTimeHistogram::mean() const
+{
+	return count_ ? sum_ / double(count_) : 0.0;
+}
+
+double FrameTimeHistogram::max() const
+{
+	return max_;
+}
+
+double FrameTimeHistogram::percentile(double p) const
+{
+	if (count_ == 0) {
+		return 0.0;
+	}
+	size_t rank = size_t(std::ceil(p * double(count_)));
+	rank = std::clamp<size_t>(rank, 1, count_);
+	size_t seen = 0;
+	for (size_t i = 0; i < bins_.size(); ++i) {
+		seen += bins_[i];
+		if (seen >= rank) {
+			return (double(i) + 0.5) * binWidthMs_;
+		}
+	}
+	return max_;
+}
+
+size_t FrameTimeHistogram::countAbove(double ms) const
+{
+	size_t first = size_t(std::max(ms, 0.0) / binWidthMs_) + 1;
+	size_t n = overflow_;
+	for (size_t i = first; i < bins_.size(); ++i) {
+		n += bins_[i];
+	}
+	return n;
+}
+
+FramePacer::FramePacer(double targetFrameMs, bool measureGpu)
+	:targetFrameMs_(targetFrameMs),
+	measureGpu_(measureGpu),
+	started_(false),
+	currentGpuFrame_(0),
+	gpuFrameOpen_(false)
+{
+	if (measureGpu_) {
+		gpuFrames_.resize(gpuLatencyFrames);
+		for (GpuFrame &f : gpuFrames_) {
+			glGenQueries(1, &f.startQuery);
+			glGenQueries(1, &f.endQuery);
+			f.pending = false;
+		}
+	}
+}
+
+FramePacer::~FramePacer() throw()
+{
+	for (GpuFrame &f : gpuFrames_) {
+		glDeleteQueries(1, &f.startQuery);
+		glDeleteQueries(1, &f.endQuery);
+	}
+	if (cpu_.count() > 0) {
+		report(std::cout);
+	}
+}
+
+void FramePacer::collectGpuTimes()
+{
+	// Oldest first; queries complete in order, so stop at the first that isn't ready.
+	for (size_t i = 1; i <= gpuFrames_.size(); ++i) {
+		GpuFrame &f = gpuFrames_[(currentGpuFrame_ + i) % gpuFrames_.size()];
+		if (!f.pending) {
+			continue;
+		}
+		GLint available = 0;
+		glGetQueryObjectiv(f.endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			break;
+		}
+		GLuint64 start, end;
+		glGetQueryObjectui64v(f.startQuery, GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(f.endQuery, GL_QUERY_RESULT, &end);
+		gpu_.add(double(end - start) * 1e-6);
+		f.pending = false;
+	}
+}
+
+void FramePacer::beginFrame()
+{
+	frameStart_ = Clock::now();
+	if (!started_) {
+		deadline_ = frameStart_;
+		lastPresent_ = frameStart_;
+		started_ = true;
+	}
+	if (measureGpu_) {
+		collectGpuTimes();
+		GpuFrame &f = gpuFrames_[currentGpuFrame_];
+		// If the GPU is this far behind, don't wait for it - just skip timing this frame.
+		gpuFrameOpen_ = !f.pending;
+		if (gpuFrameOpen_) {
+			glQueryCounter(f.startQuery, GL_TIMESTAMP);
+		}
+	}
+}
+
+void FramePacer::waitUntil(Clock::time_point deadline)
+{
+	auto spin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(spinMs));
+	for (Clock::time_point now = Clock::now(); now < deadline; now = Clock::now()) {
+		if (deadline - now > spin) {
+			std::this_thread::sleep_for(deadline - now - spin);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void FramePacer::endFrame()
+{
+	Clock::time_point frameEnd = Clock::now();
+	cpu_.add(millisecondsBetween(frameStart_, frameEnd));
+	if (measureGpu_ && gpuFrameOpen_) {
+		GpuFrame &f = gpuFrames_[currentGpuFrame_];
+		glQueryCounter(f.endQuery, GL_TIMESTAMP);
+		f.pending = true;
+		currentGpuFrame_ = (currentGpuFrame_ + 1) % gpuFrames_.size();
+		gpuFrameOpen_ = false;
+	}
+
+	if (targetFrameMs_ > 0.0) {
+		auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(targetFrameMs_));
+		deadline_ += period;
+		// After a long hitch, start pacing again from now rather than rushing to catch up.
+		if (frameEnd > deadline_ + period) {
+			deadline_ = frameEnd;
+		}
+		waitUntil(deadline_);
+	}
+
+	Clock::time_point present = Clock::now();
+	if (cpu_.count() > 1) {
+		present_.add(millisecondsBetween(lastPresent_, present));
+	}
+	lastPresent_ = present;
+}
+
+const FrameTimeHistogram &FramePacer::cpuFrameTimes() const
+{
+	return cpu_;
+}
+
+const FrameTimeHistogram &FramePacer::gpuFrameTimes() const
+{
+	return gpu_;
+}
+
+const FrameTimeHistogram &FramePacer::presentIntervals() const
+{
+	return present_;
+}
+
+size_t FramePacer::stutters() const
+{
+	double reference = targetFrameMs_ > 0.0 ? targetFrameMs_ : present_.percentile(0.5);
+	return present_.countAbove(1.5 * reference);
+}
+
+void FramePacer::report(std::ostream &out) const
+{
+	char line[160];
+	snprintf(line, sizeof(line), "Frame timing over %zu frames (target %.2f ms):\n", cpu_.count(), targetFrameMs_);
+	out << line;
+	struct Row {
+		const char *name;
+		const FrameTimeHistogram *h;
+	};
+	for (const Row &r : { Row{ "CPU frame", &cpu_ }, Row{ "GPU frame", &gpu_ }, Row{ "Present interval", &present_ } }) {
+		if (r.h->count() == 0) {
+			continue;
+		}
+		snprintf(line, sizeof(line), "  %-17s mean %7.2f  p50 %7.2f  p95 %7.2f  p99 %7.2f  max %7.2f ms\n",
+			r.name, r.h->mean(), r.h->percentile(0.5), r.h->percentile(0.95), r.h->percentile(0.99), r.h->max());
+		out << line;
+	}
+	size_t n = stutters();
+	snprintf(line, sizeof(line), "  Stutters (present > 1.5x %s): %zu (%.2f%%)\n",
+		targetFrameMs_ > 0.0 ? "target" : "median", n,
+		present_.count() ? 100.0 * double(n) / double(present_.count()) : 0.0);
+	out << line;
+}
+
+}
@@ -1,4 +1,6 @@
 #include "GLBuffer.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
 
 namespace glhelper {
 
@@ -8,6 +10,10 @@ BufferObject::BufferObject(size_t sizeBytes, GLenum usage, const void * data)
 	glGenBuffers(1, &buf_);
 	glBindBuffer(GL_ARRAY_BUFFER, buf_);
 	glBufferData(GL_ARRAY_BUFFER, sizeBytes, data, usage);
+	GpuMemory::track(GpuResourceType::BUFFER, buf_, sizeBytes, "buffer");
+	if (data != nullptr) {
+		RenderStats::recordUpload(sizeBytes);
+	}
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
@@ -15,12 +21,14 @@ BufferObject::BufferObject(BufferObject && tmp)
 {
 	buf_ = tmp.buf_;
 	sizeBytes_ = tmp.sizeBytes_;
+	tmp.buf_ = 0;
 	tmp.sizeBytes_ = 0;
 }
 
 BufferObject::~BufferObject() throw()
 {
-	if (sizeBytes_ != 0) {
+	if (buf_ != 0) {
+		GpuMemory::untrack(GpuResourceType::BUFFER, buf_);
 		glDeleteBuffers(1, &buf_);
 	}
 }
@@ -34,6 +42,7 @@ void BufferObject::update(const void * data, size_t sizeBytes)
 {
 	glBindBuffer(GL_ARRAY_BUFFER, buf_);
 	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeBytes, data);
+	RenderStats::recordUpload(sizeBytes);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
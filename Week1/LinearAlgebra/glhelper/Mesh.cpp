@@ -1,6 +1,8 @@
 #include "Mesh.hpp"
 #include "Constants.hpp"
 #include "Exception.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
 
 namespace glhelper {
 
@@ -11,10 +13,12 @@ Mesh::Mesh(const Eigen::Matrix4f &modelToWorld)
 	drawMode_(GL_TRIANGLES)
 {
 	glGenVertexArrays(1, &vao_);
+	GpuMemory::track(GpuResourceType::VERTEX_ARRAY, vao_, 0, "Mesh");
 }
 
 Mesh::~Mesh() throw()
 {
+	GpuMemory::untrack(GpuResourceType::VERTEX_ARRAY, vao_);
 	glDeleteVertexArrays(1, &vao_);
 }
 
@@ -101,10 +105,12 @@ void Mesh::render()
 		throw std::runtime_error("Attempted to render mesh without supplying shader program.");
 	}
 	glBindVertexArray(vao_);
+	RenderStats::recordStateChange();
 	shaderProgram_->use();
 	glProgramUniformMatrix4fv(shaderProgram_->get(), shaderProgram_->uniformLoc("modelToWorld"), 1, GL_FALSE, modelToWorld().data());
 	glProgramUniformMatrix3fv(shaderProgram_->get(), shaderProgram_->uniformLoc("normToWorld"), 1, GL_FALSE, normToWorld().data());
 	shaderProgram_->setupCameraBlock();
+	RenderStats::recordDraw(drawMode_, nElems_ != 0 ? nElems_ : nVerts_);
 	if(nElems_ != 0) {
     	glDrawElements(drawMode_, GLsizei(nElems_), GL_UNSIGNED_INT, 0);
 	} else {
@@ -115,7 +115,8 @@ void RotateViewer::resize(size_t width, size_t height)
 
 void RotateViewer::updateRotation()
 {
-	auto rotMat3 =
+	// Not auto: the product expression would refer to the AngleAxis temporaries after they're gone.
+	Eigen::Matrix3f rotMat3 =
 		Eigen::AngleAxisf(phi_, Eigen::Vector3f(1.f, 0.f, 0.f)).matrix() *
 		Eigen::AngleAxisf(theta_, Eigen::Vector3f(0.f, 1.f, 0.f)).matrix();
 	rotate_ = Eigen::Matrix4f::Identity();
@@ -145,6 +146,21 @@ Eigen::Matrix4f RotateViewer::worldToCam() const
 	return translate_ * rotate_;
 }
 
+CameraPose RotateViewer::pose() const
+{
+	return CameraPose{ position(), theta_, phi_ };
+}
+
+void RotateViewer::pose(const CameraPose &p)
+{
+	theta_ = p.theta;
+	phi_ = p.phi;
+	delta_ = -p.position.norm();
+	updateRotation();
+	updateTranslation();
+	updateBuffer();
+}
+
 void RotateViewer::bindCameraBlock()
 {
 	buffer_.bindRange(UniformBlock::CAMERA);
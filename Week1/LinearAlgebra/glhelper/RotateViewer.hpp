@@ -3,6 +3,7 @@
 #include <Eigen/Dense>
 #include <SDL.h>
 #include "GLBuffer.hpp"
+#include "CameraPath.hpp"
 
 namespace glhelper {
 
@@ -18,6 +19,9 @@ public:
 	void distance(float dist);
 	void resize(size_t width, size_t height);
 	Eigen::Matrix4f worldToCam() const;
+	CameraPose pose() const;
+	//!\brief Sets the rotation, and the distance from the origin to that of p.position.
+	void pose(const CameraPose &p);
 	void bindCameraBlock();
 private:
 	float theta_, phi_, thetaSpeed_, phiSpeed_;
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#include <stdexcept>
+
+// Shared by the headless tools: ring_sweep and the *_bench programs. Needs EGL, so isn't part of glhelper.
+
+//!\brief A GL context with no window, made current on construction.
+class HeadlessContext final
+{
+public:
+	HeadlessContext()
+		:display_(EGL_NO_DISPLAY), context_(EGL_NO_CONTEXT)
+	{
+		auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+		if (getPlatformDisplay && extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+			display_ = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		} else {
+			display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+		if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_API)) {
+			throw std::runtime_error("Couldn't initialise EGL.");
+		}
+		for (EGLint minor : { 6, 5, 3 }) {
+			const EGLint attribs[] = {
+				EGL_CONTEXT_MAJOR_VERSION, 4,
+				EGL_CONTEXT_MINOR_VERSION, minor,
+				EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+				EGL_NONE
+			};
+			context_ = eglCreateContext(display_, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+			if (context_ != EGL_NO_CONTEXT) {
+				break;
+			}
+		}
+		if (context_ == EGL_NO_CONTEXT || !eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, context_)) {
+			throw std::runtime_error("Couldn't create a headless OpenGL 4.3 context.");
+		}
+		GLenum result = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+		// A GLX build of GLEW can't find a GLX display here, but still loads the entry points.
+		if (result == GLEW_ERROR_NO_GLX_DISPLAY) {
+			result = GLEW_OK;
+		}
+#endif
+		if (result != GLEW_OK) {
+			throw std::runtime_error("GLEW couldn't initialize.");
+		}
+	}
+
+	~HeadlessContext() throw()
+	{
+		if (context_ != EGL_NO_CONTEXT) {
+			eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			eglDestroyContext(display_, context_);
+		}
+		if (display_ != EGL_NO_DISPLAY) {
+			eglTerminate(display_);
+		}
+	}
+
+private:
+	HeadlessContext(const HeadlessContext&);
+	HeadlessContext &operator=(const HeadlessContext&);
+
+	EGLDisplay display_;
+	EGLContext context_;
+};
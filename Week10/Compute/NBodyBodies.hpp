@@ -0,0 +1,111 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "glhelper/JobSystem.hpp"
+
+// Shared by nbody_bench and barnes_hut_bench: the bodies, their energy, and the CPU reference.
+
+//!\brief Laid out like Body in NBody.comp.
+struct Body {
+	//!\brief xyz position, w mass.
+	Eigen::Vector4f positionMass;
+	Eigen::Vector4f velocity;
+};
+
+// Bodies per parallelFor job in the CPU reference; each one's inner loop covers every body.
+const size_t cpuGrain = 64;
+
+//!\brief State of every body in double precision, for the CPU reference.
+struct BodiesD {
+	std::vector<Eigen::Vector3d> position, velocity;
+	std::vector<double> mass;
+};
+
+inline BodiesD toDouble(const std::vector<Body> &bodies)
+{
+	BodiesD d;
+	for (const Body &b : bodies) {
+		d.position.push_back(b.positionMass.head<3>().cast<double>());
+		d.velocity.push_back(b.velocity.head<3>().cast<double>());
+		d.mass.push_back(double(b.positionMass.w()));
+	}
+	return d;
+}
+
+//!\brief Potential energy, summed in parallel over each body's pairs.
+inline double potentialEnergy(glhelper::JobSystem &jobs, const BodiesD &b, double softening)
+{
+	size_t n = b.mass.size();
+	std::vector<double> perBody(n, 0.0);
+	jobs.parallelFor(0, n, cpuGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			double u = 0.0;
+			for (size_t j = i + 1; j < n; ++j) {
+				double r2 = (b.position[j] - b.position[i]).squaredNorm() + softening * softening;
+				u -= b.mass[i] * b.mass[j] / std::sqrt(r2);
+			}
+			perBody[i] = u;
+		}
+	});
+	double u = 0.0;
+	for (double e : perBody) {
+		u += e;
+	}
+	return u;
+}
+
+inline double kineticEnergy(const BodiesD &b)
+{
+	double k = 0.0;
+	for (size_t i = 0; i < b.mass.size(); ++i) {
+		k += 0.5 * b.mass[i] * b.velocity[i].squaredNorm();
+	}
+	return k;
+}
+
+//!\brief The same semi-implicit Euler step as NBody.comp, in double precision.
+inline void cpuStep(glhelper::JobSystem &jobs, BodiesD &b, double softening, double timeStep)
+{
+	size_t n = b.mass.size();
+	jobs.parallelFor(0, n, cpuGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			Eigen::Vector3d acc = Eigen::Vector3d::Zero();
+			for (size_t j = 0; j < n; ++j) {
+				Eigen::Vector3d d = b.position[j] - b.position[i];
+				double invR = 1.0 / std::sqrt(d.squaredNorm() + softening * softening);
+				acc += d * (b.mass[j] * invR * invR * invR);
+			}
+			b.velocity[i] += acc * timeStep;
+		}
+	});
+	// Positions move only once every velocity has been updated from the old ones.
+	for (size_t i = 0; i < n; ++i) {
+		b.position[i] += b.velocity[i] * timeStep;
+	}
+}
+
+//!\brief n bodies of mass 1 / n in a unit sphere, in virial equilibrium.
+inline std::vector<Body> makeBodies(glhelper::JobSystem &jobs, size_t n, double softening)
+{
+	std::default_random_engine eng(12345);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	std::normal_distribution<float> normal(0.f, 1.f);
+	std::vector<Body> bodies(n);
+	for (Body &b : bodies) {
+		Eigen::Vector3f p;
+		do {
+			p = Eigen::Vector3f(unit(eng), unit(eng), unit(eng));
+		} while (p.squaredNorm() > 1.f);
+		b.positionMass << p, 1.f / float(n);
+		b.velocity << normal(eng), normal(eng), normal(eng), 0.f;
+	}
+	BodiesD d = toDouble(bodies);
+	double scale = std::sqrt(-0.5 * potentialEnergy(jobs, d, softening) / kineticEnergy(d));
+	for (Body &b : bodies) {
+		b.velocity *= float(scale);
+	}
+	return bodies;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "glhelper/GravityIntegrator.hpp"
+#include "glhelper/JobSystem.hpp"
+
+// Shared by ex_00_saturn_rings, ring_sweep and ring_cpu_bench.
+
+//!\brief One ring particle, laid out like Particle in ParticlePhysics.comp.
+struct RingParticle {
+	Eigen::Vector4f position;
+	Eigen::Vector4f velocity;
+};
+
+// Particles set up by each initialisation job.
+const size_t ringInitGrain = 4096;
+
+//!\brief Scatters particles between minRadius and maxRadius around the y axis, each
+//!       moving at speed on a circular path.
+//!       Each chunk seeds its own generator from its first particle, so the rings come
+//!       out the same however many workers there are.
+inline void initRingParticles(glhelper::JobSystem &jobs, std::vector<RingParticle> &particles,
+	float minRadius, float maxRadius, float speed)
+{
+	jobs.parallelFor(0, particles.size(), ringInitGrain, [&](size_t begin, size_t end) {
+		std::default_random_engine eng(static_cast<unsigned>(begin));
+		std::uniform_real_distribution<float> radDist(minRadius, maxRadius), angleDist(0.0f, 2.0f * float(EIGEN_PI));
+
+		for (size_t i = begin; i < end; ++i) {
+			float angle = angleDist(eng);
+			float radius = radDist(eng);
+
+			RingParticle &p = particles[i];
+			p.position = radius * Eigen::Vector4f(sinf(angle), 0.f, cosf(angle), 1.0f);
+			p.velocity = Eigen::Vector4f::Zero();
+			p.velocity.head<3>() = -p.position.head<3>().normalized().cross(Eigen::Vector3f(0.f, 1.f, 0.f)) * speed;
+		}
+	});
+}
+
+//!\brief Saturn at the origin, as in the exercise, then count - 1 moons of mass 1 on circles
+//!       beyond the rings, for timing the physics with more attractors.
+inline std::vector<glhelper::PointMass> benchmarkAttractors(size_t count)
+{
+	std::vector<glhelper::PointMass> masses;
+	masses.push_back({ Eigen::Vector3f::Zero(), 100.f });
+	for (size_t i = 1; i < count; ++i) {
+		float angle = float(i) * 2.4f, radius = 8.f + 2.f * float(i);
+		masses.push_back({ Eigen::Vector3f(radius * std::sin(angle), 0.f, radius * std::cos(angle)), 1.f });
+	}
+	return masses;
+}
+
+//!\brief How far apart two sets of ring particles are.
+struct RingDifference {
+	//!\brief Particles whose position or velocity differ in any bit.
+	size_t differing;
+	//!\brief Largest and RMS difference of a component, in units in the last place of the
+	//!       length of its vector, so components near zero don't count for more.
+	double maxUlps, rmsUlps;
+};
+
+//!\brief Compares the xyz of each position and velocity of a and b, which are the same size.
+inline RingDifference compareRingParticles(const std::vector<RingParticle> &a, const std::vector<RingParticle> &b)
+{
+	RingDifference d = { 0, 0.0, 0.0 };
+	double sumSq = 0.0;
+	for (size_t i = 0; i < a.size(); ++i) {
+		bool same = true;
+		for (int v = 0; v < 2; ++v) {
+			const Eigen::Vector4f &x = v == 0 ? a[i].position : a[i].velocity;
+			const Eigen::Vector4f &y = v == 0 ? b[i].position : b[i].velocity;
+			same = same && std::memcmp(x.data(), y.data(), 3 * sizeof(float)) == 0;
+			float length = x.head<3>().norm();
+			double ulp = double(std::nextafter(length, INFINITY) - length);
+			for (int c = 0; c < 3; ++c) {
+				double ulps = std::abs(double(x[c]) - double(y[c])) / ulp;
+				d.maxUlps = std::max(d.maxUlps, ulps);
+				sumSq += ulps * ulps;
+			}
+		}
+		d.differing += same ? 0 : 1;
+	}
+	d.rmsUlps = a.empty() ? 0.0 : std::sqrt(sumSq / double(6 * a.size()));
+	return d;
+}
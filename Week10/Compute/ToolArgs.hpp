@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Command line options for the headless tools, which take "--name value" pairs in any order.
+// Missing options give the fallback; unrecognised ones are ignored.
+
+//!\brief The comma separated counts after name, e.g. --particles 1000,10000.
+inline std::vector<size_t> listArg(int argc, char *argv[], const std::string &name, const std::vector<size_t> &fallback)
+{
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (name == argv[i]) {
+			std::vector<size_t> values;
+			std::istringstream list(argv[i + 1]);
+			std::string value;
+			while (std::getline(list, value, ',')) {
+				values.push_back(size_t(std::strtoull(value.c_str(), nullptr, 10)));
+			}
+			return values;
+		}
+	}
+	return fallback;
+}
+
+//!\brief The comma separated numbers after name, e.g. --theta 0.3,0.5.
+inline std::vector<double> numberListArg(int argc, char *argv[], const std::string &name, const std::vector<double> &fallback)
+{
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (name == argv[i]) {
+			std::vector<double> values;
+			std::istringstream list(argv[i + 1]);
+			std::string value;
+			while (std::getline(list, value, ',')) {
+				values.push_back(std::strtod(value.c_str(), nullptr));
+			}
+			return values;
+		}
+	}
+	return fallback;
+}
+
+inline double numberArg(int argc, char *argv[], const std::string &name, double fallback)
+{
+	return numberListArg(argc, argv, name, { fallback })[0];
+}
+
+inline std::string stringArg(int argc, char *argv[], const std::string &name, const std::string &fallback)
+{
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (name == argv[i]) {
+			return argv[i + 1];
+		}
+	}
+	return fallback;
+}
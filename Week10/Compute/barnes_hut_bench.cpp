@@ -0,0 +1,176 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "glhelper/BarnesHut.hpp"
+#include "glhelper/ComputeDispatch.hpp"
+#include "glhelper/JobSystem.hpp"
+#include "glhelper/ParticleSystem.hpp"
+#include "glhelper/ShaderProgram.hpp"
+#include "HeadlessContext.hpp"
+#include "ToolArgs.hpp"
+#include "NBodyBodies.hpp"
+
+/* Compares the Barnes-Hut gravity solver (glhelper::BarnesHut with BarnesHutStep.comp) with the all-pairs one
+* (NBody.comp): how much faster it is, and how far its forces are from the exact ones, for each opening angle.
+*
+* The error is measured on a single step from rest with a time step of 1, after which each body's velocity is
+* its acceleration. It's given as the RMS and the largest, over the bodies, of each body's error relative to its
+* exact acceleration. An opening angle of 0 opens every node, so should agree with the all-pairs shader to
+* rounding, and is a check of the tree.
+*
+* Times are of whole steps on the GPU, with GL_TIMESTAMP queries as in nbody_bench, and for Barnes-Hut include
+* building the tree, which is also timed on its own. The bodies are those of nbody_bench.
+*
+* Usage:
+*     barnes_hut_bench [--bodies N,N,...] [--theta T,T,...] [--steps N] [--softening E] [--csv FILE]
+* Results also go to barnes_hut_bench.csv. Run from the build directory so the ../shaders path resolves.
+*/
+
+const size_t warmupSteps = 2;
+const float timeStep = 1e-3f;
+
+void setUniforms(glhelper::ShaderProgram &program, float softening, float step)
+{
+	glProgramUniform1f(program.get(), program.uniformLoc("gravitationalConstant"), 1.f);
+	glProgramUniform1f(program.get(), program.uniformLoc("timeStep"), step);
+	glProgramUniform1f(program.get(), program.uniformLoc("softening"), softening);
+}
+
+//!\brief GPU time in milliseconds of the work run does, averaged over steps runs.
+template<typename Run>
+double gpuTime(glhelper::ParticleSystem &bodies, size_t steps, Run run)
+{
+	run(warmupSteps);
+	bodies.barrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	GLuint queries[2];
+	glGenQueries(2, queries);
+	glQueryCounter(queries[0], GL_TIMESTAMP);
+	run(steps);
+	bodies.barrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	glQueryCounter(queries[1], GL_TIMESTAMP);
+	GLuint64 start = 0, end = 0;
+	glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+	glDeleteQueries(2, queries);
+	return double(end - start) * 1e-6 / double(steps);
+}
+
+//!\brief Each body's acceleration, from one step of system from rest with a time step of 1.
+std::vector<Eigen::Vector3f> accelerations(glhelper::ParticleSystem &system, const std::vector<Body> &atRest,
+	const glhelper::ParticleSystem::StepPrepare &prepare)
+{
+	system.upload(atRest);
+	system.step(1, prepare);
+	system.barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	std::vector<Body> after(atRest.size());
+	system.front().getData(after.data(), after.size() * sizeof(Body));
+	std::vector<Eigen::Vector3f> acc;
+	for (const Body &b : after) {
+		acc.push_back(b.velocity.head<3>());
+	}
+	return acc;
+}
+
+int main(int argc, char *argv[])
+{
+	try {
+		HeadlessContext context;
+		std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+
+		std::vector<double> counts = numberListArg(argc, argv, "--bodies", { 4096, 16384, 65536 });
+		std::vector<double> thetas = numberListArg(argc, argv, "--theta", { 0.0, 0.3, 0.5, 0.7, 1.0 });
+		size_t steps = size_t(numberArg(argc, argv, "--steps", 5));
+		float softening = float(numberArg(argc, argv, "--softening", 0.05));
+		std::string csvPath = "barnes_hut_bench.csv";
+		for (int i = 1; i + 1 < argc; ++i) {
+			if (std::string(argv[i]) == "--csv") {
+				csvPath = argv[i + 1];
+			}
+		}
+		if (!(softening > 0.f)) {
+			throw std::runtime_error("The softening length must be above zero.");
+		}
+
+		glhelper::ComputeDispatch dispatch;
+		glhelper::ShaderProgram allPairs({ "../shaders/NBody.comp" }, dispatch.defines());
+		glhelper::ShaderProgram barnesHut({ "../shaders/BarnesHutStep.comp" }, dispatch.defines());
+
+		std::ofstream csv(csvPath);
+		if (!csv) {
+			throw std::runtime_error("Couldn't open " + csvPath + " for writing.");
+		}
+		csv << "bodies,theta,build_ms,step_ms,all_pairs_ms,speedup,rms_error,max_error\n";
+
+		char line[320];
+		snprintf(line, sizeof(line), "%8s %6s %9s %9s %12s %8s %10s %10s\n",
+			"bodies", "theta", "build ms", "step ms", "all-pairs ms", "speedup", "RMS error", "max error");
+		std::cout << line;
+		glhelper::JobSystem jobs;
+		for (double count : counts) {
+			size_t n = size_t(count);
+			if (n < 2) {
+				throw std::runtime_error("Barnes-Hut needs at least two bodies.");
+			}
+			std::vector<Body> bodies = makeBodies(jobs, n, softening), atRest = bodies;
+			for (Body &b : atRest) {
+				b.velocity.setZero();
+			}
+			glhelper::BarnesHut tree(n, dispatch);
+			glhelper::ParticleSystem::StepPrepare buildTree = [&](glhelper::ShaderStorageBuffer &latest) {
+				tree.build(latest);
+			};
+
+			glhelper::ParticleSystem exact(n, sizeof(Body), allPairs, dispatch);
+			setUniforms(allPairs, softening, 1.f);
+			std::vector<Eigen::Vector3f> reference = accelerations(exact, atRest, nullptr);
+			setUniforms(allPairs, softening, timeStep);
+			exact.upload(bodies);
+			double allPairsMs = gpuTime(exact, steps, [&](size_t s) { exact.step(s); });
+
+			glhelper::ParticleSystem approximate(n, sizeof(Body), barnesHut, dispatch);
+			for (double theta : thetas) {
+				glProgramUniform1f(barnesHut.get(), barnesHut.uniformLoc("openingAngle"), float(theta));
+				setUniforms(barnesHut, softening, 1.f);
+				std::vector<Eigen::Vector3f> acc = accelerations(approximate, atRest, buildTree);
+				double sumSq = 0.0, worst = 0.0;
+				for (size_t i = 0; i < n; ++i) {
+					double error = double((acc[i] - reference[i]).norm() / reference[i].norm());
+					sumSq += error * error;
+					worst = std::max(worst, error);
+				}
+				double rms = std::sqrt(sumSq / double(n));
+
+				setUniforms(barnesHut, softening, timeStep);
+				approximate.upload(bodies);
+				double stepMs = gpuTime(approximate, steps, [&](size_t s) { approximate.step(s, buildTree); });
+				double buildMs = gpuTime(approximate, steps, [&](size_t s) {
+					for (size_t i = 0; i < s; ++i) {
+						tree.build(approximate.front());
+					}
+				});
+				double speedup = stepMs > 0.0 ? allPairsMs / stepMs : 0.0;
+
+				snprintf(line, sizeof(line), "%8zu %6.2f %9.3f %9.3f %12.3f %8.2f %10.2e %10.2e\n",
+					n, theta, buildMs, stepMs, allPairsMs, speedup, rms, worst);
+				std::cout << line;
+				snprintf(line, sizeof(line), "%zu,%.3f,%.5f,%.5f,%.5f,%.4f,%.4e,%.4e\n",
+					n, theta, buildMs, stepMs, allPairsMs, speedup, rms, worst);
+				csv << line;
+			}
+		}
+		std::cout << "Wrote " << csvPath << "\n";
+		return 0;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,193 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "glhelper/BillboardQuads.hpp"
+#include "glhelper/ComputeDispatch.hpp"
+#include "glhelper/JobSystem.hpp"
+#include "glhelper/ParticleSystem.hpp"
+#include "glhelper/RotateViewer.hpp"
+#include "glhelper/ShaderProgram.hpp"
+#include "HeadlessContext.hpp"
+#include "ToolArgs.hpp"
+#include "RingParticles.hpp"
+
+/* Times drawing the ring particles as billboards three ways: expanded from points in a geometry shader
+* (BillboardParticle.geom, as in the exercise), and in the vertex shader from the particle buffer
+* (BillboardQuad.vert, with glhelper::BillboardQuads) with an instance per particle or a batch of indexed quads
+* per instance.
+*
+* Each way draws the same rings, seen from above at an angle as in the exercise, into an offscreen framebuffer
+* with the exercise's blending, and is timed from one glFinish to another (see timeFrames). The images are compared with
+* the geometry shader's: all three build the same corners with the same arithmetic and draw them in the same
+* order, but the shader compiler may round a corner differently in each stage (e.g. by fusing a multiply-add),
+* which moves the odd edge by a pixel. So the run only fails (exit code 1) if more than --differing percent
+* (default 0.1) of the pixels differ.
+*
+* Usage:
+*     billboard_bench [--particles N,N,...] [--frames N] [--size WxH] [--differing P] [--csv FILE]
+* By default it draws 10k, 100k and 1M particles, 20 frames each, at 1280x720. Results also go to
+* billboard_bench.csv. Run from the build directory so the ../shaders path resolves.
+*/
+
+// Same scene as the exercise.
+const float ringMinRadius = 5.f, ringMaxRadius = 6.f, particleInitialVelocity = 0.5f, ringParticleSize = 0.03f;
+const size_t warmupFrames = 2;
+
+void setUniforms(glhelper::ShaderProgram &program)
+{
+	glProgramUniform1f(program.get(), program.uniformLoc("particleSize"), ringParticleSize);
+	glProgramUniform3f(program.get(), program.uniformLoc("particleColor"), 0.6f, 0.2f, 0.1f);
+}
+
+//!\brief Time of one frame drawn by draw, in milliseconds, averaged over frames. Timed on the CPU from the end of
+//!       the warmup frames to the end of the last frame, rather than with GL_TIMESTAMP queries as in ring_sweep:
+//!       llvmpipe stamps the time before it has rasterised the draws, so its queries only count work which
+//!       flushes them early, such as BillboardQuads' compute dispatch, and would flatter the geometry shader.
+template<typename Draw>
+double timeFrames(size_t frames, Draw draw)
+{
+	auto frame = [&] {
+		glClear(GL_COLOR_BUFFER_BIT);
+		draw();
+	};
+	for (size_t i = 0; i < warmupFrames; ++i) {
+		frame();
+	}
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < frames; ++i) {
+		frame();
+	}
+	glFinish();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / double(frames);
+}
+
+int main(int argc, char *argv[])
+{
+	try {
+		HeadlessContext context;
+		std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+
+		std::vector<size_t> counts = listArg(argc, argv, "--particles", { 10000, 100000, 1000000 });
+		size_t frames = std::max(listArg(argc, argv, "--frames", { 20 })[0], size_t(1));
+		double maxDiffering = std::strtod(stringArg(argc, argv, "--differing", "0.1").c_str(), nullptr);
+		std::string size = stringArg(argc, argv, "--size", "1280x720");
+		std::string csvPath = stringArg(argc, argv, "--csv", "billboard_bench.csv");
+		int width = 0, height = 0;
+		if (std::sscanf(size.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+			throw std::runtime_error("--size should be like 1280x720.");
+		}
+
+		GLuint colour = 0, framebuffer = 0;
+		glGenRenderbuffers(1, &colour);
+		glBindRenderbuffer(GL_RENDERBUFFER, colour);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			throw std::runtime_error("Couldn't make the offscreen framebuffer.");
+		}
+
+		// Looking down on the rings, so they cover a good part of the frame.
+		glhelper::RotateViewer viewer(width, height);
+		viewer.pose(glhelper::CameraPose{ Eigen::Vector3f(0.f, 0.f, 15.f), 0.f, 0.6f });
+		viewer.resize(size_t(width), size_t(height));
+		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		glhelper::ComputeDispatch dispatch;
+		// Only needed to make the ParticleSystems: the particles are never stepped.
+		glhelper::ShaderProgram stepShader({ "../shaders/ParticlePhysics.comp" }, dispatch.defines());
+		glhelper::ShaderProgram geometryShader({ "../shaders/BillboardParticle.vert", "../shaders/BillboardParticle.geom",
+			"../shaders/BillboardParticle.frag" });
+		setUniforms(geometryShader);
+
+		std::ofstream csv(csvPath);
+		if (!csv) {
+			throw std::runtime_error("Couldn't open " + csvPath + " for writing.");
+		}
+		csv << "particles,path,frame_ms,particles_per_s,speedup,differing_pixels,max_difference\n";
+
+		char line[320];
+		snprintf(line, sizeof(line), "%10s %10s %10s %12s %8s %10s %8s\n",
+			"particles", "path", "frame ms", "Mparticles/s", "speedup", "differing", "max diff");
+		std::cout << line;
+		glhelper::JobSystem jobs;
+		bool passed = true;
+		std::vector<unsigned char> reference(size_t(width) * size_t(height) * 4), image(reference.size());
+		for (size_t n : counts) {
+			std::vector<RingParticle> particles(n);
+			initRingParticles(jobs, particles, ringMinRadius, ringMaxRadius, particleInitialVelocity);
+			glhelper::ParticleSystem rings(std::max(n, size_t(1)), sizeof(RingParticle), stepShader, dispatch);
+			rings.upload(particles);
+			rings.vertexAttribute(0, 4, offsetof(RingParticle, position));
+			glhelper::BillboardQuads quads(rings, offsetof(RingParticle, position));
+			glhelper::ShaderProgram quadShader({ "../shaders/BillboardQuad.vert", "../shaders/BillboardParticle.frag" },
+				quads.defines());
+			setUniforms(quadShader);
+
+			const char *paths[3] = { "geometry",
+				glhelper::BillboardQuads::name(glhelper::BillboardQuads::Mode::INSTANCED),
+				glhelper::BillboardQuads::name(glhelper::BillboardQuads::Mode::INDEXED) };
+			double geometryMs = 0.0;
+			for (size_t path = 0; path < 3; ++path) {
+				double ms = timeFrames(frames, [&] {
+					if (path == 0) {
+						rings.bindForDraw();
+						geometryShader.use();
+						rings.draw(GL_POINTS);
+						geometryShader.unuse();
+						rings.unbindForDraw();
+					} else {
+						quads.draw(quadShader, path == 1 ? glhelper::BillboardQuads::Mode::INSTANCED
+							: glhelper::BillboardQuads::Mode::INDEXED);
+					}
+				});
+				glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, path == 0 ? reference.data() : image.data());
+				size_t differing = 0;
+				int maxDifference = 0;
+				if (path == 0) {
+					geometryMs = ms;
+				} else {
+					for (size_t p = 0; p < image.size(); p += 4) {
+						int pixelDifference = 0;
+						for (size_t c = 0; c < 4; ++c) {
+							pixelDifference = std::max(pixelDifference, std::abs(int(image[p + c]) - int(reference[p + c])));
+						}
+						differing += pixelDifference > 0 ? 1 : 0;
+						maxDifference = std::max(maxDifference, pixelDifference);
+					}
+					passed = passed && double(differing) <= maxDiffering * 1e-2 * double(width) * double(height);
+				}
+				double perSecond = ms > 0.0 ? double(n) / (ms * 1e-3) : 0.0;
+				double speedup = ms > 0.0 ? geometryMs / ms : 0.0;
+				snprintf(line, sizeof(line), "%10zu %10s %10.3f %12.1f %8.2f %10zu %8d\n",
+					n, paths[path], ms, perSecond * 1e-6, speedup, differing, maxDifference);
+				std::cout << line;
+				snprintf(line, sizeof(line), "%zu,%s,%.5f,%.0f,%.4f,%zu,%d\n",
+					n, paths[path], ms, perSecond, speedup, differing, maxDifference);
+				csv << line;
+			}
+		}
+		std::cout << "Wrote " << csvPath << "\n" << (passed ? "Images match." : "Images DIFFER.") << "\n";
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colour);
+		return passed ? 0 : 1;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -3,7 +3,11 @@
 #include <SDL.h>
 #include <iostream>
 #include <exception>
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <random>
 #include "glhelper/ShaderProgram.hpp"
 #include "glhelper/RotateViewer.hpp"
@@ -11,6 +15,24 @@
 #include "glhelper/Mesh.hpp"
 #include "glhelper/Texture.hpp"
 #include "glhelper/Matrices.hpp"
+#include "glhelper/AsyncReadback.hpp"
+#include "glhelper/FrameCapture.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/HudText.hpp"
+#include "glhelper/RenderStats.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
+#include "glhelper/JobSystem.hpp"
+#include "glhelper/MappedStorageBuffer.hpp"
+#include "glhelper/OrbitIntegrator.hpp"
+#include "glhelper/BillboardQuads.hpp"
+#include "glhelper/ComputeDispatch.hpp"
+#include "glhelper/ParticleDepthSort.hpp"
+#include "glhelper/ParticleSystem.hpp"
+#include "glhelper/WeightedBlendedOit.hpp"
+#include "RingParticles.hpp"
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/mesh.h"
@@ -28,21 +50,47 @@
 * work out forces on each particle based on the gravitational formula G m_1 m_2 r^-2. Use semi-implicit Euler to find
 * the positions and normals (look back at the Physics notes if you need to).
 * 
-* Finally you'll need to add the compute shader call to the code below, and also add synchronisation to ensure the 
-* compute shader is finished before the draw call to show the particles.
+* The compute shader call and the synchronisation that makes sure it has finished before the particles are drawn are
+* handled by glhelper::ParticleSystem (see ParticleSystem::step and ParticleSystem::bindForDraw) - read through them
+* to see which barriers are needed, and where.
 * 
 * Extra Tasks
 * ===========
 * 
 * If you finish early, consider these extra tasks:
 * 1. Add collision to your physics engine. To do this you'll probably want to pass in the radii of the planets, as well
-* as their masses and positions. On collision you could delete the particle, by marking it as inactive in some way and 
-* changing BillboardParticle.geom to discard inactive particles.
-* 2. Add more masses to the simulation (more moons/planets). The current system can handle up to 10, but you can of course
-* change this. 
-* 3. Also consider simulating the motion of the planets using a similar physics system. You could do this on the CPU and 
-* pass the results to the compute shader. You can assume the mass of the rings is insignificant compared to the planets 
-* and moons, so doesn't affect their orbits.
+* as their masses and positions. On collision you can delete the particle just by not writing it to target (see the
+* alive flag in ParticlePhysics.comp); the pool stays packed, and the draw only covers the survivors.
+* 2. The planet and moons move under each other's gravity on the CPU (glhelper::OrbitIntegrator), and reach the
+* shader through a glhelper::MappedStorageBuffer, which only copies them when they change. There can be any number:
+* try --moons 1000 and see how the frame time changes. ParticlePhysics.comp loads them a tile at a time into shared
+* memory; try other ways of reading them and compare.
+* 3. Give the ring particles gravity of their own. Summing over every other particle is O(N^2), so load them a block at
+* a time into shared memory, as NBody.comp does; nbody_bench measures that shader's throughput and energy conservation.
+* For millions of particles, glhelper::BarnesHut builds a tree each step so BarnesHutStep.comp only sums over
+* O(log N) groups of particles; barnes_hut_bench compares its speed and accuracy with NBody.comp.
+* 
+* The number of particles and the compute workgroup size can be set with --particles N and --workgroup N, the
+* number of physics substeps per frame with --substeps N, and the number of small moons with --moons N.
+* ring_sweep times the compute shader on its own for a range of both, without a window.
+* Once the physics is written, ring_sweep also checks it against glhelper::GravityIntegrator, the same step on the
+* CPU, which ring_cpu_bench times.
+* 
+* Press B to switch how the particles are drawn: as points expanded into quads by a geometry shader
+* (BillboardParticle.geom), or as quads built in the vertex shader straight from the particle buffer
+* (BillboardQuad.vert, see glhelper::BillboardQuads), either instanced or indexed. Start with one of them with
+* --billboards geometry|instanced|indexed. billboard_bench times the three without a window.
+* 
+* Press T to switch how the particles are blended: in the order they're stored, back to front after a GPU depth sort
+* (glhelper::ParticleDepthSort), or order-independently (glhelper::WeightedBlendedOit). The last two draw quads, indexed
+* if the geometry shader is selected. With one colour for every particle the three look alike; transparency_bench
+* colours them apart, and compares the cost and the error of each against the sorted image.
+* 
+* Press E to scatter a burst of new particles over the rings (RingEmit.comp). Particles are spawned, killed and counted
+* for drawing entirely on the GPU, so the pool can hold up to twice the starting number.
+* 
+* Press C to start/stop capturing frames to ../capture/frame_XXXXX.png, and P to read back the particle positions
+* (without stalling the GPU) and print the mean ring radius. Both use glhelper::AsyncReadback.
 */
 
 const int winWidth = 1280, winHeight = 720;
@@ -58,15 +106,34 @@ float gravitationalConstant = 1e-2f;
 
 float ringParticleSize = 0.03f;
 
-int nParticles = 5000;
+// All can be changed on the command line, e.g. --particles 1000000 --workgroup 128 --substeps 8.
+size_t nParticles = 5000;
+// 0 picks a size to suit the device.
+GLuint ringWorkgroupSize = 0;
+// Each frame's time step is split into this many compute steps.
+size_t ringSubsteps = 4;
 
-const int MAX_N_MASSES = 10;
+// Small moons, orbiting beyond the rings.
+size_t nMoons = 0;
+float moonMass = 0.01f;
+float moonSize = 0.03f;
 
 bool ceresActive = false;
 
+// How the ring particles are drawn: by the geometry shader, or as BillboardQuads.
+const char *billboardPaths[] = { "geometry", "instanced", "indexed" };
+size_t billboardPath = 0;
+
+// How the ring particles are blended: unsorted, sorted by depth, or with WeightedBlendedOit.
+const char *blendModes[] = { "unsorted", "sorted", "OIT" };
+size_t blendMode = 0;
+// Distances are quantised over this range for the depth sort: RotateViewer's far plane.
+const float sortDistance = 50.f;
+
 
 void loadMesh(glhelper::Mesh* mesh, const std::string& filename)
 {
+	glhelper::TraceZone zone("loadMesh");
 	Assimp::Importer importer;
 	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
 	const aiScene* aiscene = importer.GetScene();
@@ -94,8 +161,42 @@ void loadMesh(glhelper::Mesh* mesh, const std::string& filename)
 	mesh->tex(uvs);
 }
 
-int main()
+size_t billboardArg(int argc, char *argv[], size_t fallback)
 {
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (std::string(argv[i]) == "--billboards") {
+			for (size_t path = 0; path < 3; ++path) {
+				if (billboardPaths[path] == std::string(argv[i + 1])) {
+					return path;
+				}
+			}
+		}
+	}
+	return fallback;
+}
+
+size_t countArg(int argc, char *argv[], const std::string &name, size_t fallback)
+{
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (name == argv[i]) {
+			return size_t(std::strtoull(argv[i + 1], nullptr, 10));
+		}
+	}
+	return fallback;
+}
+
+int main(int argc, char *argv[])
+{
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+	nParticles = countArg(argc, argv, "--particles", nParticles);
+	ringWorkgroupSize = GLuint(countArg(argc, argv, "--workgroup", ringWorkgroupSize));
+	ringSubsteps = std::max(countArg(argc, argv, "--substeps", ringSubsteps), size_t(1));
+	nMoons = countArg(argc, argv, "--moons", nMoons);
+	billboardPath = billboardArg(argc, argv, billboardPath);
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
@@ -119,65 +220,69 @@ int main()
 	}
 
 	gltInit();
-	GLTtext* text = gltCreateText();
-	gltSetText(text, (std::string("Animation demo")).c_str());
+	// Per-frame work, including compute shader invocations once the dispatch is in.
+	glhelper::RenderStats::enablePipelineStatistics(true);
 	glEnable(GL_MULTISAMPLE);
 
 	{
+		// Line 0 is the animation time, line 1 the RenderStats table, line 2 the GpuProfiler report.
+		glhelper::HudText hud(3, 512);
+		hud.line(1, glhelper::RenderStats::table().c_str());
+
+		// Decode the planet textures on the workers while the shaders compile and the
+		// rings are set up; they're uploaded further down, on this thread.
+		glhelper::JobSystem jobs;
+		cv::Mat saturnTextureImage, ceresTextureImage;
+		glhelper::Job saturnLoad = jobs.submit([&] { glhelper::TraceZone zone("loadTexture"); saturnTextureImage = cv::imread("../images/2k_saturn.jpg"); });
+		glhelper::Job ceresLoad = jobs.submit([&] { glhelper::TraceZone zone("loadTexture"); ceresTextureImage = cv::imread("../images/2k_ceres_fictional.jpg"); });
+
 		glhelper::ShaderProgram texturedMeshShader({ "../shaders/TexturedMesh.vert", "../shaders/TexturedMesh.frag" });
 		glhelper::ShaderProgram billboardParticleShader({ "../shaders/BillboardParticle.vert", "../shaders/BillboardParticle.geom", "../shaders/BillboardParticle.frag" });
-		glhelper::ShaderProgram particlePhysicsShader({ "../shaders/ParticlePhysics.comp" });
+		glhelper::ComputeDispatch ringDispatch(ringWorkgroupSize);
+		glhelper::ShaderProgram particlePhysicsShader({ "../shaders/ParticlePhysics.comp" }, ringDispatch.defines());
+		glhelper::ShaderProgram ringEmitShader({ "../shaders/RingEmit.comp" }, ringDispatch.defines());
 		glhelper::RotateViewer viewer(winWidth, winHeight);
 		viewer.distance(20.f);
 
 		glhelper::Mesh sphereMesh;
 		loadMesh(&sphereMesh, "../models/sphere.obj");
 
-		GLuint ringVao;
-		glGenVertexArrays(1, &ringVao);
-		glhelper::ShaderStorageBuffer particleBuffer(nParticles * 4 * sizeof(float)),
-			velocityBuffer(nParticles * 4 * sizeof(float));
+		// The particles live in two buffers: each compute step reads one and writes the other.
+		// Room is left for particles emitted later.
+		glhelper::ParticleSystem rings(2 * nParticles, sizeof(RingParticle), particlePhysicsShader, ringDispatch);
+		// Each burst of new particles, from pressing E.
+		const size_t ringBurst = std::max(nParticles / 10, size_t(1));
 
-		// Initialise ring particle positions and velocities		
+		// Initialise ring particle positions and velocities
+		{
+			std::vector<RingParticle> particles(nParticles);
+			initRingParticles(jobs, particles, ringMinRadius, ringMaxRadius, particleInitialVelocity);
+			rings.upload(particles);
+		}
+		rings.vertexAttribute(0, 4, offsetof(RingParticle, position));
+		glhelper::BillboardQuads ringQuads(rings, offsetof(RingParticle, position));
+		glhelper::ShaderProgram billboardQuadShader({ "../shaders/BillboardQuad.vert", "../shaders/BillboardParticle.frag" }, ringQuads.defines());
+		glhelper::ParticleDepthSort ringDepthSort(rings, offsetof(RingParticle, position), ringDispatch);
+		glhelper::ShaderProgram sortedQuadShader({ "../shaders/BillboardQuad.vert", "../shaders/BillboardParticle.frag" }, ringQuads.defines(true));
+		glhelper::ShaderProgram oitQuadShader({ "../shaders/BillboardQuad.vert", "../shaders/BillboardParticleOit.frag" }, ringQuads.defines());
+		// Copies the depth of the planets from the window, so they hide the rings behind them.
+		glhelper::WeightedBlendedOit oit(winWidth, winHeight);
+
+		// Saturn, then the moons, then Ceres once it's dropped in.
+		glhelper::OrbitIntegrator orbits(jobs, gravitationalConstant);
+		const size_t saturn = orbits.add(Eigen::Vector3f::Zero(), Eigen::Vector3f::Zero(), 100.f);
+		size_t ceres = 0;
 		{
-			std::vector<Eigen::Vector4f> particlePositions(nParticles), particleVelocities(nParticles);
-			std::default_random_engine eng;
-			std::uniform_real_distribution<> radDist(ringMinRadius, ringMaxRadius), angleDist(0.0f, 2.0f * (float)M_PI);
-
-			for (size_t i = 0; i < nParticles; ++i) {
-				float angle = angleDist(eng);
-				float radius = radDist(eng);
-
-				particlePositions[i] = radius * Eigen::Vector4f(sinf(angle), 0.f, cosf(angle), 1.0f);
-				particleVelocities[i] = particleInitialVelocity * Eigen::Vector4f(1.f, 0.f, 0.f, 0.f);
-				Eigen::Vector3f vel = -particlePositions[i].block<3,1>(0,0).normalized().cross(Eigen::Vector3f(0.f, 1.f, 0.f)) * particleInitialVelocity;
-				particleVelocities[i].block<3, 1>(0, 0) = vel;
+			std::mt19937 rng(7);
+			std::uniform_real_distribution<float> radius(7.f, 14.f), angle(0.f, 6.2831853f);
+			for (size_t i = 0; i < nMoons; ++i) {
+				float r = radius(rng), a = angle(rng);
+				orbits.addOrbiting(saturn, Eigen::Vector3f(r * std::cos(a), 0.f, r * std::sin(a)), moonMass);
 			}
-
-			particleBuffer.update(particlePositions);
-			velocityBuffer.update(particleVelocities);
 		}
+		// Room for every attractor after the 16 byte count. The contents are only copied when they change.
+		glhelper::MappedStorageBuffer attractorBuffer(4 * sizeof(GLuint) + (orbits.size() + 1) * sizeof(glhelper::PointMass));
 
-		glBindVertexArray(ringVao);
-		glBindBuffer(GL_ARRAY_BUFFER, particleBuffer.get());
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
-
-		std::array<Eigen::Vector3f, MAX_N_MASSES> massLocations;
-		std::array<float, MAX_N_MASSES> masses;
-		int nMasses = 1;
-
-		massLocations[0] = Eigen::Vector3f::Zero();
-		masses[0] = 100.f;
-		
-		Eigen::Matrix4f saturnModelToWorld = Eigen::Matrix4f::Identity();
-		Eigen::Matrix4f ceresModelToWorld = makeTranslationMatrix(Eigen::Vector3f(8.f, 0.f, 0.f)) * makeScaleMatrix(Eigen::Vector3f::Ones() * 0.1f);
-
-		massLocations[1] = Eigen::Vector3f(8.f, 0.f, 0.f);
-		masses[1] = 20.f;
-		
 
 		// Note we draw in GL_POINTS mode this time, as the input to our geometry shader will be 
 		// a point cloud.
@@ -187,61 +292,108 @@ int main()
 
 		glProgramUniform1f(billboardParticleShader.get(), billboardParticleShader.uniformLoc("particleSize"), ringParticleSize);
 		glProgramUniform3f(billboardParticleShader.get(), billboardParticleShader.uniformLoc("particleColor"), 0.6f, 0.2f, 0.1f);
+		glProgramUniform1f(billboardQuadShader.get(), billboardQuadShader.uniformLoc("particleSize"), ringParticleSize);
+		glProgramUniform3f(billboardQuadShader.get(), billboardQuadShader.uniformLoc("particleColor"), 0.6f, 0.2f, 0.1f);
+		for (glhelper::ShaderProgram *quadShader : { &sortedQuadShader, &oitQuadShader }) {
+			glProgramUniform1f(quadShader->get(), quadShader->uniformLoc("particleSize"), ringParticleSize);
+			glProgramUniform3f(quadShader->get(), quadShader->uniformLoc("particleColor"), 0.6f, 0.2f, 0.1f);
+		}
 
-		glProgramUniform3fv(particlePhysicsShader.get(), particlePhysicsShader.uniformLoc("massPositions"), MAX_N_MASSES, massLocations[0].data());
-		glProgramUniform1fv(particlePhysicsShader.get(), particlePhysicsShader.uniformLoc("masses"), MAX_N_MASSES, &(masses[0]));
-		glProgramUniform1i(particlePhysicsShader.get(), particlePhysicsShader.uniformLoc("nMasses"), nMasses);
 		glProgramUniform1f(particlePhysicsShader.get(), particlePhysicsShader.uniformLoc("gravitationalConstant"), gravitationalConstant);
-		glProgramUniform1f(particlePhysicsShader.get(), particlePhysicsShader.uniformLoc("timeStep"), 1.f / 33.3f);
+		glProgramUniform1f(particlePhysicsShader.get(), particlePhysicsShader.uniformLoc("timeStep"), 1.f / 33.3f / float(ringSubsteps));
 		glProgramUniform1f(particlePhysicsShader.get(), particlePhysicsShader.uniformLoc("particleMass"), particleMass);
 
+		glProgramUniform1f(ringEmitShader.get(), ringEmitShader.uniformLoc("ringMinRadius"), ringMinRadius);
+		glProgramUniform1f(ringEmitShader.get(), ringEmitShader.uniformLoc("ringMaxRadius"), ringMaxRadius);
+		glProgramUniform1f(ringEmitShader.get(), ringEmitShader.uniformLoc("particleInitialVelocity"), particleInitialVelocity);
+
 
 		glProgramUniform1i(texturedMeshShader.get(), texturedMeshShader.uniformLoc("tex"), 0);
 
 		GLuint saturnTexture, ceresTexture;
 
-		{
-			cv::Mat saturnTextureImage = cv::imread("../images/2k_saturn.jpg");
+		glhelper::Job saturnUpload = jobs.onMainThread([&] {
 			glGenTextures(1, &saturnTexture);
 			glBindTexture(GL_TEXTURE_2D, saturnTexture);
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, saturnTextureImage.cols, saturnTextureImage.rows, 0, GL_BGR, GL_UNSIGNED_BYTE, saturnTextureImage.data);
 			glGenerateMipmap(GL_TEXTURE_2D);
 			glBindTexture(GL_TEXTURE_2D, 0);
-
-			cv::Mat ceresTextureImage = cv::imread("../images/2k_ceres_fictional.jpg");
+			saturnTextureImage.release();
+		}, { saturnLoad });
+		glhelper::Job ceresUpload = jobs.onMainThread([&] {
 			glGenTextures(1, &ceresTexture);
 			glBindTexture(GL_TEXTURE_2D, ceresTexture);
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, ceresTextureImage.cols, ceresTextureImage.rows, 0, GL_BGR, GL_UNSIGNED_BYTE, ceresTextureImage.data);
 			glGenerateMipmap(GL_TEXTURE_2D);
 			glBindTexture(GL_TEXTURE_2D, 0);
-		}
+			ceresTextureImage.release();
+		}, { ceresLoad });
+		jobs.wait(saturnUpload);
+		jobs.wait(ceresUpload);
+
+		glhelper::AsyncReadback readback;
+		std::unique_ptr<glhelper::FrameCapture> frameCapture;
+		std::future<glhelper::AsyncReadback::Data> particleReadback, countReadback;
+		// Live particles as of a few frames ago, read back without stalling.
+		GLuint liveParticles = GLuint(nParticles);
+		bool emitBurst = false;
 
 		bool shouldQuit = false;
 		SDL_Event event;
 
 		glEnable(GL_DEPTH_TEST);
 
-		auto startTime = std::chrono::steady_clock::now();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-			float animTimeSeconds = 1e-6f * (float)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+			jobs.runMainThreadJobs();
+			float animTimeSeconds = float(benchmark.seconds());
 
-			viewer.update();
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 
 				if (event.type == SDL_KEYDOWN) {
-					if (event.key.keysym.sym == SDLK_SPACE) {
+					if (event.key.keysym.sym == SDLK_SPACE && !ceresActive) {
 						ceresActive = true;
-						nMasses = 2;
+						ceres = orbits.addOrbiting(saturn, orbits.position(saturn) + Eigen::Vector3f(8.f, 0.f, 0.f), 20.f);
+					}
+					if (event.key.keysym.sym == SDLK_c) {
+						if (frameCapture) {
+							std::cout << "Captured " << frameCapture->framesWritten() << " frames." << std::endl;
+							frameCapture.reset();
+						} else {
+							frameCapture = std::make_unique<glhelper::FrameCapture>(readback, "../capture/frame_");
+						}
+					}
+					if (event.key.keysym.sym == SDLK_p && !particleReadback.valid()) {
+						rings.barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+						countReadback = readback.readBuffer(rings.frontCount(), 0, sizeof(GLuint));
+						particleReadback = readback.readBuffer(rings.front(), 0, rings.front().sizeBytes());
+					}
+					if (event.key.keysym.sym == SDLK_e) {
+						emitBurst = true;
+					}
+					if (event.key.keysym.sym == SDLK_b) {
+						billboardPath = (billboardPath + 1) % 3;
+					}
+					if (event.key.keysym.sym == SDLK_t) {
+						blendMode = (blendMode + 1) % 3;
 					}
 
 				}
@@ -249,71 +401,121 @@ int main()
 			}
 			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
 
-			// Your code here
-			// Set up and dispatch your compute call here.
-			// You should bind your particle position and velocity buffers
-			// Normally you'd use glBindBufferBase for this, but the buffer class has
-			// a bindBase method that does this. 
-			// Use the compute shader (again, normally glUseProgram, but the class has use() 
-			// and unuse() methods).
-			// Dispatch with glDispatchCompute (set dimensions appropriately).
-
-			// Your code here
-			// Handle synchronisation. Add a glMemoryBarrier somewhere below here.
-			// Pick an appropriate barrier to use (we're dealing with vertex attribute data).
-			// Insert the barrier call in an appropriate place (really as late as possible, but make sure to do it
-			// before the particle draw call)
 			glDisable(GL_BLEND);
 			glActiveTexture(GL_TEXTURE0);
 			glBindTexture(GL_TEXTURE_2D, saturnTexture);
-			sphereMesh.modelToWorld(saturnModelToWorld);
+			sphereMesh.modelToWorld(makeTranslationMatrix(orbits.position(saturn)));
 			sphereMesh.render();
 			glBindTexture(GL_TEXTURE_2D, 0);
 
-			if (ceresActive) {
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, ceresTexture);
-				sphereMesh.modelToWorld(ceresModelToWorld);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, ceresTexture);
+			for (size_t i = saturn + 1; i < orbits.size(); ++i) {
+				float scale = ceresActive && i == ceres ? 0.1f : moonSize;
+				sphereMesh.modelToWorld(makeTranslationMatrix(orbits.position(i)) * makeScaleMatrix(Eigen::Vector3f::Ones() * scale));
 				sphereMesh.render();
-				glBindTexture(GL_TEXTURE_2D, 0);
 			}
+			glBindTexture(GL_TEXTURE_2D, 0);
 
 			glEnable(GL_BLEND);
 			glDepthMask(GL_FALSE);
 			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-			glBindVertexArray(ringVao);
-			billboardParticleShader.use();
-			glDrawArrays(GL_POINTS, 0, nParticles);
-			billboardParticleShader.unuse();
+			// Sorting and OIT need the quads, which read the particles straight from the buffer.
+			glhelper::BillboardQuads::Mode quadMode = billboardPath == 1 ? glhelper::BillboardQuads::Mode::INSTANCED
+				: glhelper::BillboardQuads::Mode::INDEXED;
+			if (blendMode == 1) {
+				ringDepthSort.sort(viewer.position(), sortDistance);
+				ringQuads.draw(sortedQuadShader, quadMode, &ringDepthSort.order());
+			} else if (blendMode == 2) {
+				oit.begin(0);
+				ringQuads.draw(oitQuadShader, quadMode);
+				oit.end(0);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			} else if (billboardPath == 0) {
+				// Issues the GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT barrier for last frame's steps, as late as possible.
+				rings.bindForDraw();
+				billboardParticleShader.use();
+				// The GPU supplies the number of live particles.
+				rings.draw(GL_POINTS);
+				billboardParticleShader.unuse();
+				rings.unbindForDraw();
+			} else {
+				ringQuads.draw(billboardQuadShader, quadMode);
+			}
 			glDepthMask(GL_TRUE);
 
-			glProgramUniform3fv(particlePhysicsShader.get(), particlePhysicsShader.uniformLoc("massPositions"), MAX_N_MASSES, massLocations[0].data());
-			glProgramUniform1fv(particlePhysicsShader.get(), particlePhysicsShader.uniformLoc("masses"), MAX_N_MASSES, &(masses[0]));
-			glProgramUniform1i(particlePhysicsShader.get(), particlePhysicsShader.uniformLoc("nMasses"), nMasses);
+			// The attractors where the frame starts; ParticlePhysics.comp reads them from binding 2.
+			attractorBuffer.updateArray(orbits.attractors());
+			attractorBuffer.bindBase(2);
+
+			// Your code here
+			// ParticleSystem::step binds the particle buffers (glBindBufferBase, binding 0 to read and 1 to
+			// write), uses the compute shader and dispatches it with ringDispatch.dispatch once per substep,
+			// with a GL_SHADER_STORAGE_BARRIER_BIT barrier between them. Read through it, then make
+			// ParticlePhysics.comp read from source and write to target.
+			// Stepping after the draw gives the GPU the rest of this frame to finish before the next draw.
+			rings.step(ringSubsteps);
+			// The CPU moves the planets on while the GPU steps the rings.
+			orbits.step(1.0 / 33.3 / double(ringSubsteps), ringSubsteps);
+			if (emitBurst) {
+				glProgramUniform1ui(ringEmitShader.get(), ringEmitShader.uniformLoc("seed"), GLuint(rings.steps()));
+				rings.emit(ringEmitShader, ringBurst);
+				emitBurst = false;
+			}
+			readback.readBuffer(rings.frontCount(), 0, sizeof(GLuint), [&liveParticles](glhelper::AsyncReadback::Data &&data) {
+				memcpy(&liveParticles, data.data(), sizeof(GLuint));
+			});
+
+			profiler.end("scene");
+
+			// Only regenerates the text when the displayed time or the stats change.
+			hud.format(0, "Animation Time: %.1f seconds. %u of %zu particles, workgroups of %u, %zu substeps, %s billboards, %s blending.",
+				animTimeSeconds, liveParticles, rings.capacity(), ringDispatch.workgroupSize(), ringSubsteps,
+				billboardPaths[billboardPath], blendModes[blendMode]);
+			if (glhelper::RenderStats::tableUpdated()) {
+				hud.line(1, glhelper::RenderStats::table().c_str());
+			}
+			if (profiler.reportUpdated()) {
+				hud.line(2, profiler.report().c_str());
+			}
+			hud.draw(10.f, 10.f);
 
-			std::string textStr = std::string("Animation Time: ") + std::to_string(animTimeSeconds) + std::string(" seconds.");
-			gltSetText(text, textStr.c_str());
-			gltBeginDraw();
-			gltColor(1.f, 1.f, 1.f, 1.f);
-			gltDrawText2D(text, 10.f, 10.f, 1.f);
-			gltEndDraw();
+			if (frameCapture) {
+				frameCapture->capture(winWidth, winHeight);
+			}
+			readback.poll();
+			if (particleReadback.valid() && particleReadback.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				// Requested together, so the count is ready too.
+				glhelper::AsyncReadback::Data count = countReadback.get();
+				glhelper::AsyncReadback::Data data = particleReadback.get();
+				GLuint live = 0;
+				memcpy(&live, count.data(), sizeof(GLuint));
+				const RingParticle* particles = reinterpret_cast<const RingParticle*>(data.data());
+				float meanRadius = 0.f;
+				for (size_t i = 0; i < live; ++i) {
+					meanRadius += particles[i].position.head<3>().norm();
+				}
+				std::cout << "Mean ring particle radius: " << meanRadius / std::max(live, 1u) << " over " << live << " particles" << std::endl;
+			}
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		benchmark.finish();
+		jobs.report(std::cout);
 
 		glDeleteTextures(1, &saturnTexture);
+		glDeleteTextures(1, &ceresTexture);
 	}
 
-	gltDeleteText(text);
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
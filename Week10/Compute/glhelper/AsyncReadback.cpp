@@ -0,0 +1,274 @@
+#include "AsyncReadback.hpp"
+#include "GLBuffer.hpp"
+#include "Texture.hpp"
+#include "Exception.hpp"
+#include "GpuMemory.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+size_t componentsInFormat(GLenum format)
+{
+	switch (format) {
+	case GL_RED:
+	case GL_RED_INTEGER:
+	case GL_DEPTH_COMPONENT:
+	case GL_STENCIL_INDEX:
+		return 1;
+	case GL_RG:
+	case GL_RG_INTEGER:
+		return 2;
+	case GL_RGB:
+	case GL_BGR:
+	case GL_RGB_INTEGER:
+		return 3;
+	case GL_RGBA:
+	case GL_BGRA:
+	case GL_RGBA_INTEGER:
+		return 4;
+	default:
+		throw std::runtime_error("AsyncReadback: unsupported pixel format.");
+	}
+}
+
+size_t bytesInType(GLenum type)
+{
+	switch (type) {
+	case GL_UNSIGNED_BYTE:
+	case GL_BYTE:
+		return 1;
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:
+	case GL_HALF_FLOAT:
+		return 2;
+	case GL_UNSIGNED_INT:
+	case GL_INT:
+	case GL_FLOAT:
+		return 4;
+	default:
+		throw std::runtime_error("AsyncReadback: unsupported pixel type.");
+	}
+}
+
+}
+
+AsyncReadback::AsyncReadback()
+	:nextTicket_(0)
+{}
+
+AsyncReadback::~AsyncReadback() throw()
+{
+	for (Request &r : requests_) {
+		glDeleteSync(r.fence);
+		GpuMemory::untrack(GpuResourceType::BUFFER, r.pbo.buf);
+		glDeleteBuffers(1, &r.pbo.buf);
+	}
+	for (Pbo &p : freePbos_) {
+		GpuMemory::untrack(GpuResourceType::BUFFER, p.buf);
+		glDeleteBuffers(1, &p.buf);
+	}
+}
+
+AsyncReadback::Pbo AsyncReadback::acquirePbo(size_t sizeBytes)
+{
+	// Reuse the smallest free buffer that is big enough.
+	auto best = freePbos_.end();
+	for (auto it = freePbos_.begin(); it != freePbos_.end(); ++it) {
+		if (it->sizeBytes >= sizeBytes && (best == freePbos_.end() || it->sizeBytes < best->sizeBytes)) {
+			best = it;
+		}
+	}
+	if (best != freePbos_.end()) {
+		Pbo p = *best;
+		freePbos_.erase(best);
+		return p;
+	}
+	Pbo p;
+	p.sizeBytes = sizeBytes;
+	glGenBuffers(1, &p.buf);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, p.buf);
+	glBufferData(GL_PIXEL_PACK_BUFFER, sizeBytes, nullptr, GL_STREAM_READ);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	GpuMemory::track(GpuResourceType::BUFFER, p.buf, sizeBytes, "readback buffer");
+	return p;
+}
+
+AsyncReadback::Ticket AsyncReadback::submit(Pbo pbo, size_t sizeBytes, Callback callback)
+{
+	Request r;
+	r.ticket = nextTicket_++;
+	r.pbo = pbo;
+	r.sizeBytes = sizeBytes;
+	r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	r.callback = std::move(callback);
+	// Make sure the fence actually reaches the GPU, so later non-blocking polls can see it signal.
+	glFlush();
+	requests_.push_back(std::move(r));
+	throwOnGlError();
+	return requests_.back().ticket;
+}
+
+std::future<AsyncReadback::Data> AsyncReadback::readBuffer(BufferObject &buffer, size_t offset, size_t bytesToGet)
+{
+	std::promise<Data> promise;
+	std::future<Data> future = promise.get_future();
+	readBuffer(buffer, offset, bytesToGet, Callback());
+	// The request was queued without a promise, attach it now.
+	requests_.back().promise = std::move(promise);
+	return future;
+}
+
+AsyncReadback::Ticket AsyncReadback::readBuffer(BufferObject &buffer, size_t offset, size_t bytesToGet, Callback callback)
+{
+	if (offset + bytesToGet > buffer.sizeBytes()) {
+		throw std::runtime_error("AsyncReadback::readBuffer: range exceeds buffer size.");
+	}
+	// Shader storage writes must be visible to the copy below.
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	Pbo pbo = acquirePbo(bytesToGet);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer.get());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pbo.buf);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, bytesToGet);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return submit(pbo, bytesToGet, std::move(callback));
+}
+
+std::future<AsyncReadback::Data> AsyncReadback::readTexture(Texture &texture, size_t mipmapLevel)
+{
+	std::promise<Data> promise;
+	std::future<Data> future = promise.get_future();
+	readTexture(texture, mipmapLevel, Callback());
+	requests_.back().promise = std::move(promise);
+	return future;
+}
+
+AsyncReadback::Ticket AsyncReadback::readTexture(Texture &texture, size_t mipmapLevel, Callback callback)
+{
+	size_t width = std::max<size_t>(1, texture.width() >> mipmapLevel);
+	size_t height = std::max<size_t>(1, texture.height() >> mipmapLevel);
+	size_t bytes = width * height * componentsInFormat(texture.format()) * bytesInType(texture.type());
+
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+	Pbo pbo = acquirePbo(bytes);
+	GLint prevAlignment;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &prevAlignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo.buf);
+	#ifdef __APPLE__
+	glBindTexture(GL_TEXTURE_2D, texture.tex());
+	glGetTexImage(GL_TEXTURE_2D, GLint(mipmapLevel), texture.format(), texture.type(), nullptr);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	#else
+	glGetTextureImage(texture.tex(), GLint(mipmapLevel), texture.format(), texture.type(), GLsizei(bytes), nullptr);
+	#endif
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, prevAlignment);
+	return submit(pbo, bytes, std::move(callback));
+}
+
+std::future<AsyncReadback::Data> AsyncReadback::readFramebuffer(GLint x, GLint y, GLsizei width, GLsizei height,
+	GLenum format, GLenum type)
+{
+	std::promise<Data> promise;
+	std::future<Data> future = promise.get_future();
+	readFramebuffer(x, y, width, height, format, type, Callback());
+	requests_.back().promise = std::move(promise);
+	return future;
+}
+
+AsyncReadback::Ticket AsyncReadback::readFramebuffer(GLint x, GLint y, GLsizei width, GLsizei height,
+	GLenum format, GLenum type, Callback callback)
+{
+	size_t bytes = size_t(width) * size_t(height) * componentsInFormat(format) * bytesInType(type);
+	Pbo pbo = acquirePbo(bytes);
+	GLint prevAlignment;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &prevAlignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo.buf);
+	glReadPixels(x, y, width, height, format, type, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, prevAlignment);
+	return submit(pbo, bytes, std::move(callback));
+}
+
+void AsyncReadback::complete(Request &request)
+{
+	Data data(request.sizeBytes);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, request.pbo.buf);
+	void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, request.sizeBytes, GL_MAP_READ_BIT);
+	if (mapped) {
+		memcpy(data.data(), mapped, request.sizeBytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glDeleteSync(request.fence);
+	freePbos_.push_back(request.pbo);
+
+	if (!mapped) {
+		request.promise.set_exception(std::make_exception_ptr(
+			std::runtime_error("AsyncReadback: couldn't map readback buffer.")));
+		return;
+	}
+	if (request.callback) {
+		request.callback(std::move(data));
+		// Nobody holds a future for callback requests, but settle the promise anyway.
+		request.promise.set_value(Data());
+	} else {
+		request.promise.set_value(std::move(data));
+	}
+}
+
+void AsyncReadback::poll()
+{
+	// Fences signal in submission order, so stop at the first one that isn't ready.
+	while (!requests_.empty()) {
+		GLenum status = glClientWaitSync(requests_.front().fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		Request r = std::move(requests_.front());
+		requests_.pop_front();
+		complete(r);
+	}
+}
+
+void AsyncReadback::finish()
+{
+	while (!requests_.empty()) {
+		finishFront();
+	}
+}
+
+void AsyncReadback::finish(Ticket ticket)
+{
+	// Tickets are handed out in submission order, so everything up to this one goes.
+	while (!requests_.empty() && requests_.front().ticket <= ticket) {
+		finishFront();
+	}
+}
+
+void AsyncReadback::finishFront()
+{
+	GLenum status = GL_TIMEOUT_EXPIRED;
+	while (status == GL_TIMEOUT_EXPIRED) {
+		status = glClientWaitSync(requests_.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+	}
+	if (status == GL_WAIT_FAILED) {
+		throw std::runtime_error("AsyncReadback: glClientWaitSync failed.");
+	}
+	Request r = std::move(requests_.front());
+	requests_.pop_front();
+	complete(r);
+}
+
+size_t AsyncReadback::pending() const
+{
+	return requests_.size();
+}
+
+}
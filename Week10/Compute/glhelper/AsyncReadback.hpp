@@ -0,0 +1,88 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <vector>
+
+namespace glhelper {
+
+class BufferObject;
+class Texture;
+
+//!\brief Reads data back from the GPU without stalling the pipeline.
+//!
+//!       Each request copies into a pixel buffer object and inserts a fence.
+//!       poll() checks those fences without blocking, and completes any
+//!       finished requests by fulfilling their future or calling their callback.
+//!\note Must be created, polled and destroyed on the thread owning the GL context.
+//!      Futures are only fulfilled from poll() or finish(), so don't wait on one
+//!      from the GL thread without polling.
+class AsyncReadback final
+{
+public:
+	typedef std::vector<unsigned char> Data;
+	typedef std::function<void(Data &&)> Callback;
+	//!\brief Identifies a callback request, for finish(Ticket).
+	typedef uint64_t Ticket;
+
+	AsyncReadback();
+	~AsyncReadback() throw();
+
+	//!\brief Read bytesToGet bytes from a buffer, starting at offset.
+	std::future<Data> readBuffer(BufferObject &buffer, size_t offset, size_t bytesToGet);
+	Ticket readBuffer(BufferObject &buffer, size_t offset, size_t bytesToGet, Callback callback);
+
+	//!\brief Read one mip level of a texture, in the texture's own format and type.
+	std::future<Data> readTexture(Texture &texture, size_t mipmapLevel = 0);
+	Ticket readTexture(Texture &texture, size_t mipmapLevel, Callback callback);
+
+	//!\brief Read a region of the currently bound read framebuffer (rows are tightly packed,
+	//!       bottom row first, as with glReadPixels).
+	std::future<Data> readFramebuffer(GLint x, GLint y, GLsizei width, GLsizei height,
+		GLenum format = GL_BGR, GLenum type = GL_UNSIGNED_BYTE);
+	Ticket readFramebuffer(GLint x, GLint y, GLsizei width, GLsizei height,
+		GLenum format, GLenum type, Callback callback);
+
+	//!\brief Completes any requests whose fences have signalled. Never blocks.
+	//!       Call once per frame.
+	void poll();
+	//!\brief Blocks until every outstanding request has completed.
+	void finish();
+	//!\brief Blocks until the request given ticket has completed. Requests made before it
+	//!       complete too, as the GPU has finished them first; later ones are left pending.
+	void finish(Ticket ticket);
+
+	size_t pending() const;
+
+private:
+	AsyncReadback(const AsyncReadback&);
+	AsyncReadback &operator=(const AsyncReadback&);
+
+	struct Pbo {
+		GLuint buf;
+		size_t sizeBytes;
+	};
+	struct Request {
+		Ticket ticket;
+		Pbo pbo;
+		size_t sizeBytes;
+		GLsync fence;
+		std::promise<Data> promise;
+		Callback callback;
+	};
+
+	Pbo acquirePbo(size_t sizeBytes);
+	Ticket submit(Pbo pbo, size_t sizeBytes, Callback callback);
+	void complete(Request &request);
+	//!\brief Waits for the oldest request and completes it.
+	void finishFront();
+
+	std::deque<Request> requests_;
+	Ticket nextTicket_;
+	std::vector<Pbo> freePbos_;
+};
+
+}
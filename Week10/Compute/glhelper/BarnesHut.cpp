@@ -0,0 +1,109 @@
+#include "BarnesHut.hpp"
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+// Morton codes use 10 bits per axis.
+const unsigned mortonBits = 30;
+
+size_t checkBodies(size_t bodies)
+{
+	if (bodies < 2) {
+		throw std::runtime_error("BarnesHut: needs at least two bodies.");
+	}
+	return bodies;
+}
+
+}
+
+BarnesHut::BarnesHut(size_t bodies, const ComputeDispatch &dispatch, const std::string &shaderDir)
+	:bodies_(checkBodies(bodies)),
+	dispatch_(dispatch),
+	boundsShader_({ shaderDir + "BarnesHutBounds.comp" }, dispatch.defines()),
+	mortonShader_({ shaderDir + "BarnesHutMorton.comp" }, dispatch.defines()),
+	treeShader_({ shaderDir + "BarnesHutTree.comp" }, dispatch.defines()),
+	summariseShader_({ shaderDir + "BarnesHutSummarise.comp" }, dispatch.defines()),
+	sorter_(bodies, shaderDir),
+	bounds_(8 * sizeof(GLuint)),
+	keys_(bodies * sizeof(GLuint)),
+	order_(bodies * sizeof(GLuint)),
+	children_((bodies - 1) * 2 * sizeof(GLuint)),
+	parents_((2 * bodies - 1) * sizeof(GLuint)),
+	visits_((bodies - 1) * sizeof(GLuint)),
+	nodeMass_((2 * bodies - 1) * 4 * sizeof(GLfloat)),
+	nodeBounds_((2 * bodies - 1) * 8 * sizeof(GLfloat))
+{
+	for (ShaderProgram *program : { &boundsShader_, &mortonShader_, &treeShader_, &summariseShader_ }) {
+		glProgramUniform1ui(program->get(), program->uniformLoc("bodyCount"), GLuint(bodies_));
+	}
+}
+
+size_t BarnesHut::bodies() const
+{
+	return bodies_;
+}
+
+void BarnesHut::build(ShaderStorageBuffer &bodies)
+{
+	// Empty bounds, as ordered uints (see BarnesHut.glsl): the low corner starts at the
+	// largest value and the high corner at the smallest.
+	const GLuint emptyBounds[8] = { ~0u, ~0u, ~0u, ~0u, 0, 0, 0, 0 };
+	bounds_.update(emptyBounds);
+	const GLuint zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, visits_.get());
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	boundsShader_.use();
+	bodies.bindBase(0);
+	bounds_.bindBase(6);
+	dispatch_.dispatch(bodies_);
+	boundsShader_.unuse();
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	mortonShader_.use();
+	bodies.bindBase(0);
+	order_.bindBase(2);
+	bounds_.bindBase(6);
+	keys_.bindBase(7);
+	dispatch_.dispatch(bodies_);
+	mortonShader_.unuse();
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	sorter_.sort(keys_, order_, bodies_, mortonBits);
+
+	treeShader_.use();
+	children_.bindBase(3);
+	parents_.bindBase(6);
+	keys_.bindBase(7);
+	dispatch_.dispatch(bodies_ - 1);
+	treeShader_.unuse();
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	summariseShader_.use();
+	bodies.bindBase(0);
+	order_.bindBase(2);
+	children_.bindBase(3);
+	nodeMass_.bindBase(4);
+	nodeBounds_.bindBase(5);
+	parents_.bindBase(6);
+	visits_.bindBase(7);
+	dispatch_.dispatch(bodies_);
+	summariseShader_.unuse();
+	// The next build resets bounds_ and visits_ from the CPU side.
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	bindTree();
+}
+
+void BarnesHut::bindTree()
+{
+	order_.bindBase(2);
+	children_.bindBase(3);
+	nodeMass_.bindBase(4);
+	nodeBounds_.bindBase(5);
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <string>
+#include "ComputeDispatch.hpp"
+#include "GLBuffer.hpp"
+#include "RadixSort.hpp"
+#include "ShaderProgram.hpp"
+
+namespace glhelper {
+
+//!\brief Builds a Barnes-Hut tree over a buffer of bodies on the GPU, so each body's
+//!       gravity can be summed over O(log n) groups of bodies rather than all n of them
+//!       (see shaders/BarnesHutStep.comp).
+//!
+//!       Bodies are laid out as in shaders/NBody.comp: a vec4 of position and mass,
+//!       then a vec4 of velocity. The tree is rebuilt from scratch each step, without
+//!       the CPU reading anything back:
+//!       1. the bounds of the bodies (BarnesHutBounds.comp);
+//!       2. a Morton code for each body, sorted with a RadixSort (BarnesHutMorton.comp);
+//!       3. a binary radix tree over the sorted codes, every node at once (BarnesHutTree.comp);
+//!       4. each node's mass, centre of mass and bounds, from the leaves up (BarnesHutSummarise.comp).
+//!       A binary radix tree rather than an octree, as it can be built in one parallel
+//!       pass; each of its nodes is part of an octree node, so it's just a little deeper.
+//!
+//!       Usage, with a ParticleSystem running BarnesHutStep.comp:
+//!           BarnesHut tree(bodies, dispatch);
+//!           particles.step(substeps, [&](ShaderStorageBuffer &latest) { tree.build(latest); });
+//!\note Must be used on the thread owning the GL context.
+class BarnesHut final
+{
+public:
+	//!\param bodies How many bodies the trees are built over, at least 2. It's fixed, so
+	//!       bodies can't be killed or spawned.
+	BarnesHut(size_t bodies, const ComputeDispatch &dispatch, const std::string &shaderDir = "../shaders/");
+
+	size_t bodies() const;
+
+	//!\brief Builds the tree over the first bodies() bodies in bodies, then binds it as
+	//!       bindTree does. bodies must have been written before any barrier this needs.
+	void build(ShaderStorageBuffer &bodies);
+	//!\brief Binds the latest tree where BarnesHutStep.comp reads it: the sorted body
+	//!       indices at 2, children at 3, node masses at 4 and node bounds at 5.
+	void bindTree();
+
+private:
+	BarnesHut(const BarnesHut&);
+	BarnesHut &operator=(const BarnesHut&);
+
+	size_t bodies_;
+	ComputeDispatch dispatch_;
+	ShaderProgram boundsShader_, mortonShader_, treeShader_, summariseShader_;
+	RadixSort sorter_;
+	ShaderStorageBuffer bounds_, keys_, order_, children_, parents_, visits_, nodeMass_, nodeBounds_;
+};
+
+}
@@ -0,0 +1,133 @@
+#include "BillboardQuads.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
+#include <stdexcept>
+#include <vector>
+
+namespace glhelper {
+
+namespace {
+
+// Quads in each instance of an INDEXED draw: 256 vertices, a few wavefronts' worth.
+const GLuint quadsPerBatch = 64;
+
+// Must match BillboardQuadCommand.comp: a DrawArraysIndirectCommand, then a DrawElementsIndirectCommand.
+const size_t arraysCommandWords = 4, elementsCommandWords = 5;
+
+std::vector<GLuint> makeBatchIndices()
+{
+	// Two triangles per quad, wound as the strip 0, 1, 2, 3 would be.
+	const GLuint corners[6] = { 0, 1, 2, 2, 1, 3 };
+	std::vector<GLuint> indices;
+	for (GLuint quad = 0; quad < quadsPerBatch; ++quad) {
+		for (GLuint corner : corners) {
+			indices.push_back(quad * 4 + corner);
+		}
+	}
+	return indices;
+}
+
+}
+
+BillboardQuads::BillboardQuads(ParticleSystem &particles, size_t positionOffset, const std::string &shaderDir)
+	:particles_(&particles),
+	positionOffset_(positionOffset),
+	commandShader_({ shaderDir + "BillboardQuadCommand.comp" }),
+	commands_((arraysCommandWords + elementsCommandWords) * sizeof(GLuint)),
+	batchIndices_(makeBatchIndices(), GL_STATIC_DRAW),
+	vao_(0)
+{
+	if (particles.particleBytes() % 16 != 0 || positionOffset % 16 != 0) {
+		throw std::runtime_error("BillboardQuads: particles must be made of vec4s, with the position one of them.");
+	}
+	glProgramUniform1ui(commandShader_.get(), commandShader_.uniformLoc("quadsPerBatch"), quadsPerBatch);
+	// No attributes: the vertex array only holds the index buffer.
+	glGenVertexArrays(1, &vao_);
+	glBindVertexArray(vao_);
+	batchIndices_.bind();
+	glBindVertexArray(0);
+	GpuMemory::track(GpuResourceType::VERTEX_ARRAY, vao_, 0, "BillboardQuads");
+}
+
+BillboardQuads::BillboardQuads(BillboardQuads &&tmp)
+	:particles_(tmp.particles_),
+	positionOffset_(tmp.positionOffset_),
+	commandShader_(std::move(tmp.commandShader_)),
+	commands_(std::move(tmp.commands_)),
+	batchIndices_(std::move(tmp.batchIndices_)),
+	vao_(tmp.vao_)
+{
+	tmp.vao_ = 0;
+}
+
+BillboardQuads::~BillboardQuads() throw()
+{
+	if (vao_ != 0) {
+		GpuMemory::untrack(GpuResourceType::VERTEX_ARRAY, vao_);
+		glDeleteVertexArrays(1, &vao_);
+	}
+}
+
+const char *BillboardQuads::name(Mode mode)
+{
+	switch (mode) {
+	case Mode::INSTANCED:
+		return "instanced";
+	case Mode::INDEXED:
+		return "indexed";
+	}
+	return "unknown";
+}
+
+ShaderDefines BillboardQuads::defines(bool ordered) const
+{
+	ShaderDefines defines{
+		{ "PARTICLE_VEC4S", std::to_string(particles_->particleBytes() / 16) },
+		{ "POSITION_VEC4", std::to_string(positionOffset_ / 16) }
+	};
+	if (ordered) {
+		defines["PARTICLE_ORDER"] = "1";
+	}
+	return defines;
+}
+
+void BillboardQuads::draw(ShaderProgram &quadShader, Mode mode, ShaderStorageBuffer *order)
+{
+	// Both shaders read what the last step wrote as storage buffers, the live count included.
+	particles_->barrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	GLuint count = particles_->frontCount().get();
+
+	commandShader_.use();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, count);
+	commands_.bindBase(2);
+	glDispatchCompute(1, 1, 1);
+	commandShader_.unuse();
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+	GLuint quadsPerInstance = mode == Mode::INDEXED ? quadsPerBatch : 1;
+	glProgramUniform1ui(quadShader.get(), quadShader.uniformLoc("quadsPerInstance"), quadsPerInstance);
+	quadShader.use();
+	particles_->front().bindBase(0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, count);
+	if (order != nullptr) {
+		order->bindBase(3);
+	}
+	glBindVertexArray(vao_);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands_.get());
+	RenderStats::recordStateChange();
+	// Only the GPU knows the count, so these record the most it could be.
+	size_t instances = (particles_->capacity() + quadsPerInstance - 1) / quadsPerInstance;
+	if (mode == Mode::INDEXED) {
+		glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+			reinterpret_cast<const void*>(arraysCommandWords * sizeof(GLuint)));
+		RenderStats::recordDraw(GL_TRIANGLES, 6 * quadsPerBatch, instances);
+	} else {
+		glDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr);
+		RenderStats::recordDraw(GL_TRIANGLE_STRIP, 4, instances);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+	quadShader.unuse();
+}
+
+}
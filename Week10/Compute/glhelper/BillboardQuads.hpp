@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <string>
+#include "GLBuffer.hpp"
+#include "ParticleSystem.hpp"
+#include "ShaderProgram.hpp"
+
+namespace glhelper {
+
+//!\brief Draws each live particle of a ParticleSystem as a camera-facing quad built in the
+//!       vertex shader (shaders/BillboardQuad.vert), with no geometry shader and no vertex
+//!       attributes: each vertex works out its particle and corner from gl_InstanceID and
+//!       gl_VertexID, and reads the particle's position straight from the storage buffer.
+//!
+//!       Geometry shaders that amplify a point into a strip are slow on many GPUs (and
+//!       on llvmpipe), as their outputs go through extra buffering. Two ways of issuing
+//!       the quads are offered, which do the same work in the fragment shader:
+//!       - INSTANCED: a 4 vertex strip, one instance per particle. Simple, but instances
+//!         of 4 vertices fill little of a GPU's wavefront on some hardware.
+//!       - INDEXED: a short index buffer of two triangles for each of a batch of quads,
+//!         one instance per batch, so each instance is hundreds of vertices and each quad
+//!         only shades its 4 corners once. Vertices past the last live particle are
+//!         collapsed to a point, so nothing is drawn for them.
+//!       As the CPU doesn't know how many particles are alive, a one invocation compute
+//!       shader (BillboardQuadCommand.comp) writes both draw commands from the live count.
+//!
+//!       The particles are drawn in the order they're stored, unless given an order to
+//!       draw them in, such as a ParticleDepthSort's.
+//!
+//!       Usage:
+//!           BillboardQuads quads(particles, offsetof(Particle, position));
+//!           ShaderProgram quadShader({ "BillboardQuad.vert", "BillboardParticle.frag" }, quads.defines());
+//!           quads.draw(quadShader, BillboardQuads::Mode::INDEXED);
+//!\note Must be used on the thread owning the GL context.
+class BillboardQuads final
+{
+public:
+	enum class Mode {
+		INSTANCED,
+		INDEXED
+	};
+
+	//!\param positionOffset Byte offset of each particle's vec4 position, a multiple of 16,
+	//!       as is the particle size.
+	BillboardQuads(ParticleSystem &particles, size_t positionOffset, const std::string &shaderDir = "../shaders/");
+	BillboardQuads(BillboardQuads &&tmp);
+	~BillboardQuads() throw();
+
+	static const char *name(Mode mode);
+
+	//!\brief Defines for BillboardQuad.vert describing the particle layout, and whether
+	//!       it's drawn with an order.
+	ShaderDefines defines(bool ordered = false) const;
+
+	//!\brief Draws the particles' latest state with quadShader, a BillboardQuad.vert
+	//!       program compiled with defines(order != nullptr).
+	//!\param order If given, the indices of the particles to draw, in the order to draw them.
+	void draw(ShaderProgram &quadShader, Mode mode, ShaderStorageBuffer *order = nullptr);
+
+private:
+	BillboardQuads(const BillboardQuads&);
+	BillboardQuads &operator=(const BillboardQuads&);
+
+	ParticleSystem *particles_;
+	size_t positionOffset_;
+	ShaderProgram commandShader_;
+	ShaderStorageBuffer commands_;
+	ElementBuffer batchIndices_;
+	GLuint vao_;
+};
+
+}
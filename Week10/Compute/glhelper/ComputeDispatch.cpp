@@ -0,0 +1,67 @@
+#include "ComputeDispatch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace glhelper {
+
+ComputeDispatch::ComputeDispatch(GLuint workgroupSize)
+	:workgroupSize_(workgroupSize ? workgroupSize : preferredWorkgroupSize())
+{
+	if (workgroupSize_ > maxWorkgroupSize()) {
+		throw std::runtime_error("ComputeDispatch: workgroups of " + std::to_string(workgroupSize_) +
+			" invocations are too big for this device (at most " + std::to_string(maxWorkgroupSize()) + ").");
+	}
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxCount_[0]);
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 1, &maxCount_[1]);
+}
+
+GLuint ComputeDispatch::workgroupSize() const
+{
+	return workgroupSize_;
+}
+
+ShaderDefines ComputeDispatch::defines() const
+{
+	return ShaderDefines{ { "WORKGROUP_SIZE", std::to_string(workgroupSize_) } };
+}
+
+size_t ComputeDispatch::workgroups(size_t items) const
+{
+	return (items + workgroupSize_ - 1) / workgroupSize_;
+}
+
+void ComputeDispatch::dispatch(size_t items) const
+{
+	size_t groups = workgroups(items);
+	if (groups == 0) {
+		return;
+	}
+	size_t x = std::min(groups, size_t(maxCount_[0]));
+	size_t y = (groups + x - 1) / x;
+	if (y > size_t(maxCount_[1])) {
+		throw std::runtime_error("ComputeDispatch: too many items (" + std::to_string(items) + ") for one dispatch.");
+	}
+	glDispatchCompute(GLuint(x), GLuint(y), 1);
+}
+
+GLuint ComputeDispatch::preferredWorkgroupSize()
+{
+	const char *vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+	GLuint size = 256;
+	if (vendor && (strstr(vendor, "Intel") || strstr(vendor, "Mesa") || strstr(vendor, "VMware"))) {
+		// Intel runs 8-32 wide, and software renderers gain nothing from bigger groups.
+		size = 64;
+	}
+	return std::min(size, maxWorkgroupSize());
+}
+
+GLuint ComputeDispatch::maxWorkgroupSize()
+{
+	GLint maxSize = 0, maxInvocations = 0;
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxSize);
+	glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+	return GLuint(std::min(maxSize, maxInvocations));
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <string>
+#include "ShaderProgram.hpp"
+
+namespace glhelper {
+
+//!\brief Runs a one dimensional compute shader over any number of items.
+//!
+//!       The workgroup size is fixed when the shader is compiled, so it's passed in
+//!       as the WORKGROUP_SIZE define (see defines()):
+//!           #ifndef WORKGROUP_SIZE
+//!           #define WORKGROUP_SIZE 256
+//!           #endif
+//!           layout(local_size_x = WORKGROUP_SIZE) in;
+//!
+//!       dispatch rounds the number of workgroups up, so the last one usually runs
+//!       past the end, and the shader must skip invocations beyond the item count.
+//!       Past GL_MAX_COMPUTE_WORK_GROUP_COUNT workgroups (at least 65535, so from
+//!       about 16 million items with 256 per group) the workgroups are spread over y
+//!       as well, so the shader should find its item with:
+//!           uint i = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x + gl_GlobalInvocationID.x;
+//!\note Must be used on the thread owning the GL context.
+class ComputeDispatch final
+{
+public:
+	//!\param workgroupSize Invocations per workgroup, or 0 for preferredWorkgroupSize().
+	//!       Throws std::runtime_error if the device can't run workgroups that big.
+	explicit ComputeDispatch(GLuint workgroupSize = 0);
+
+	GLuint workgroupSize() const;
+	//!\brief Defines to compile the shader with, to match workgroupSize().
+	ShaderDefines defines() const;
+	//!\brief Workgroups needed for items, before any are moved to y.
+	size_t workgroups(size_t items) const;
+
+	//!\brief Dispatches the current program over items.
+	void dispatch(size_t items) const;
+
+	//!\brief A workgroup size suiting the device: a multiple of the SIMD width of the
+	//!       vendor's hardware (32 on NVIDIA, 64 on AMD), with enough invocations to
+	//!       hide memory latency, within the device's limits.
+	static GLuint preferredWorkgroupSize();
+	static GLuint maxWorkgroupSize();
+
+private:
+	GLuint workgroupSize_;
+	GLint maxCount_[2];
+};
+
+}
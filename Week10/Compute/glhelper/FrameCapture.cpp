@@ -0,0 +1,101 @@
+#include "FrameCapture.hpp"
+#include <opencv2/opencv.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace glhelper {
+
+FrameCapture::FrameCapture(AsyncReadback &readback, const std::string &pathPrefix, size_t maxQueuedFrames)
+	:readback_(readback),
+	pathPrefix_(pathPrefix),
+	maxQueuedFrames_(maxQueuedFrames),
+	nextFrame_(0),
+	capturing_(false),
+	lastReadback_(0),
+	stopping_(false),
+	written_(0),
+	dropped_(0)
+{
+	std::filesystem::path dir = std::filesystem::path(pathPrefix).parent_path();
+	if (!dir.empty()) {
+		std::filesystem::create_directories(dir);
+	}
+	encoder_ = std::thread(&FrameCapture::encoderLoop, this);
+}
+
+FrameCapture::~FrameCapture() throw()
+{
+	// Pending readbacks hold callbacks referring to this object.
+	if (capturing_) {
+		try {
+			readback_.finish(lastReadback_);
+		} catch (...) {
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	frameReady_.notify_one();
+	encoder_.join();
+}
+
+void FrameCapture::capture(GLsizei width, GLsizei height)
+{
+	size_t index = nextFrame_++;
+	capturing_ = true;
+	lastReadback_ = readback_.readFramebuffer(0, 0, width, height, GL_BGR, GL_UNSIGNED_BYTE,
+		[this, index, width, height](AsyncReadback::Data &&pixels) {
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (queue_.size() >= maxQueuedFrames_) {
+					++dropped_;
+					return;
+				}
+				queue_.push_back(Frame{ index, width, height, std::move(pixels) });
+			}
+			frameReady_.notify_one();
+		});
+}
+
+size_t FrameCapture::framesWritten() const
+{
+	return written_;
+}
+
+size_t FrameCapture::framesDropped() const
+{
+	return dropped_;
+}
+
+void FrameCapture::encoderLoop()
+{
+	while (true) {
+		Frame frame;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			frameReady_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+			if (queue_.empty()) {
+				return;
+			}
+			frame = std::move(queue_.front());
+			queue_.pop_front();
+		}
+		// OpenGL returns the bottom row first.
+		cv::Mat image(frame.height, frame.width, CV_8UC3, frame.pixels.data());
+		cv::Mat flipped;
+		cv::flip(image, flipped, 0);
+
+		char number[16];
+		snprintf(number, sizeof(number), "%05zu", frame.index);
+		std::string path = pathPrefix_ + number + ".png";
+		if (cv::imwrite(path, flipped)) {
+			++written_;
+		} else {
+			std::cout << "Warning: couldn't write captured frame to \"" << path << "\"." << std::endl;
+		}
+	}
+}
+
+}
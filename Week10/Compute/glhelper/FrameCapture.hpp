@@ -0,0 +1,63 @@
+#pragma once
+
+#include "AsyncReadback.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace glhelper {
+
+//!\brief Captures a sequence of rendered frames to numbered image files.
+//!
+//!       Frames are read back through an AsyncReadback, so capturing doesn't
+//!       stall rendering, and are encoded and written on a background thread.
+//!       If the encoder falls behind, frames are dropped rather than blocking
+//!       the render loop.
+class FrameCapture final
+{
+public:
+	//!\param pathPrefix Files are written as pathPrefix00000.png, pathPrefix00001.png, ...
+	FrameCapture(AsyncReadback &readback, const std::string &pathPrefix, size_t maxQueuedFrames = 8);
+	//!\brief Waits for this capture's outstanding readbacks and for all queued frames to be
+	//!       written. Other requests on the AsyncReadback are left pending.
+	~FrameCapture() throw();
+
+	//!\brief Queue a capture of the current read framebuffer. Call after rendering
+	//!       and before swapping buffers.
+	void capture(GLsizei width, GLsizei height);
+
+	size_t framesWritten() const;
+	size_t framesDropped() const;
+
+private:
+	FrameCapture(const FrameCapture&);
+	FrameCapture &operator=(const FrameCapture&);
+
+	struct Frame {
+		size_t index;
+		GLsizei width, height;
+		AsyncReadback::Data pixels;
+	};
+
+	void encoderLoop();
+
+	AsyncReadback &readback_;
+	std::string pathPrefix_;
+	size_t maxQueuedFrames_;
+	size_t nextFrame_;
+	//!\brief The last capture's readback, if there has been one.
+	bool capturing_;
+	AsyncReadback::Ticket lastReadback_;
+
+	std::mutex mutex_;
+	std::condition_variable frameReady_;
+	std::deque<Frame> queue_;
+	bool stopping_;
+	std::atomic<size_t> written_, dropped_;
+	std::thread encoder_;
+};
+
+}
@@ -1,4 +1,6 @@
 #include "GLBuffer.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
 
 namespace glhelper {
 
@@ -8,6 +10,10 @@ BufferObject::BufferObject(size_t sizeBytes, GLenum usage, const void * data)
 	glGenBuffers(1, &buf_);
 	glBindBuffer(GL_ARRAY_BUFFER, buf_);
 	glBufferData(GL_ARRAY_BUFFER, sizeBytes, data, usage);
+	GpuMemory::track(GpuResourceType::BUFFER, buf_, sizeBytes, "buffer");
+	if (data != nullptr) {
+		RenderStats::recordUpload(sizeBytes);
+	}
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
@@ -15,12 +21,14 @@ BufferObject::BufferObject(BufferObject && tmp)
 {
 	buf_ = tmp.buf_;
 	sizeBytes_ = tmp.sizeBytes_;
+	tmp.buf_ = 0;
 	tmp.sizeBytes_ = 0;
 }
 
 BufferObject::~BufferObject() throw()
 {
-	if (sizeBytes_ != 0) {
+	if (buf_ != 0) {
+		GpuMemory::untrack(GpuResourceType::BUFFER, buf_);
 		glDeleteBuffers(1, &buf_);
 	}
 }
@@ -34,6 +42,7 @@ void BufferObject::update(const void * data, size_t sizeBytes)
 {
 	glBindBuffer(GL_ARRAY_BUFFER, buf_);
 	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeBytes, data);
+	RenderStats::recordUpload(sizeBytes);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
@@ -56,6 +65,15 @@ void BufferObject::getData(void * data, size_t offset, size_t bytesToGet)
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+void BufferObject::copyFrom(BufferObject &source, size_t sizeBytes)
+{
+	glBindBuffer(GL_COPY_READ_BUFFER, source.buf_);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buf_);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeBytes);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
 size_t BufferObject::sizeBytes() const
 {
 	return sizeBytes_;
@@ -201,8 +219,8 @@ void ShaderStorageBuffer::bindBase(GLuint index)
 
 
 
-AtomicCounterBuffer::AtomicCounterBuffer(GLenum usage)
-	:BufferObject(sizeof(GLuint), usage)
+AtomicCounterBuffer::AtomicCounterBuffer(size_t counters, GLenum usage)
+	:BufferObject(counters * sizeof(GLuint), usage)
 {}
 
 AtomicCounterBuffer::AtomicCounterBuffer(AtomicCounterBuffer && tmp)
@@ -219,4 +237,12 @@ void AtomicCounterBuffer::bindBase(GLuint index)
 	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
 }
 
+void AtomicCounterBuffer::clear(size_t counter, GLuint value)
+{
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, get());
+	glClearBufferSubData(GL_ATOMIC_COUNTER_BUFFER, GL_R32UI, counter * sizeof(GLuint), sizeof(GLuint),
+		GL_RED_INTEGER, GL_UNSIGNED_INT, &value);
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+}
+
 }
@@ -3,6 +3,7 @@
 #include <GL/glew.h>
 #include <vector>
 #include <Eigen/Dense>
+#include "RenderStats.hpp"
 
 namespace glhelper {
 
@@ -19,6 +20,7 @@ public:
 	{
     	glBindBuffer(GL_ARRAY_BUFFER, buf_);
     	glBufferSubData(GL_ARRAY_BUFFER, 0, v.size() * sizeof(T), v.data());
+		RenderStats::recordUpload(v.size() * sizeof(T));
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
@@ -27,6 +29,7 @@ public:
 	{
     	glBindBuffer(GL_ARRAY_BUFFER, buf_);
     	glBufferSubData(GL_ARRAY_BUFFER, offset*sizeof(T), v.size() * sizeof(T), v.data());
+		RenderStats::recordUpload(v.size() * sizeof(T));
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
@@ -34,6 +37,9 @@ public:
 	void getData(void *data, size_t bytesToGet);
 	void getData(void *data, size_t offset, size_t bytesToGet);
 
+	//!\brief Copies the first sizeBytes of source to the start of this buffer, on the GPU.
+	void copyFrom(BufferObject &source, size_t sizeBytes);
+
 	GLuint get() { return buf_; }
 
 	size_t sizeBytes() const;
@@ -146,14 +152,17 @@ private:
 	ShaderStorageBuffer &operator=(const ShaderStorageBuffer&);
 };
 
+//!\brief Buffer of counters GLSL atomic_uints are bound to.
 class AtomicCounterBuffer final : public BufferObject
 {
 public:
-	AtomicCounterBuffer(GLenum usage = GL_DYNAMIC_DRAW);
+	explicit AtomicCounterBuffer(size_t counters = 1, GLenum usage = GL_DYNAMIC_DRAW);
 	AtomicCounterBuffer(AtomicCounterBuffer &&tmp);
 	virtual ~AtomicCounterBuffer() throw();
 
 	void bindBase(GLuint index);
+	//!\brief Sets a counter on the GPU, in order with other commands, without waiting for them.
+	void clear(size_t counter = 0, GLuint value = 0);
 private:
 	AtomicCounterBuffer(const AtomicCounterBuffer&);
 	AtomicCounterBuffer &operator=(const AtomicCounterBuffer&);
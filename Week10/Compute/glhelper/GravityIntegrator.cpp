@@ -0,0 +1,302 @@
+#include "GravityIntegrator.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GRAVITY_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define GRAVITY_X86 0
+#endif
+
+// GCC and Clang only allow intrinsics in functions built for their instruction set;
+// MSVC allows them anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define GRAVITY_TARGET(isa) __attribute__((target(isa)))
+#else
+#define GRAVITY_TARGET(isa)
+#endif
+
+namespace glhelper {
+
+namespace {
+
+// Particles stepped by each job: a multiple of every SIMD width, so only the last
+// chunk has a scalar tail, and small enough for its arrays to stay in L2 over the substeps.
+const size_t particlesPerJob = 4096;
+
+//!\brief The particles of one chunk, and the masses pulling on them.
+struct Chunk {
+	float *x, *y, *z, *vx, *vy, *vz;
+	size_t begin, end;
+
+	// Per mass: position, and G m_1 m_2 worked out once.
+	const float *massX, *massY, *massZ, *massPull;
+	size_t masses;
+	float particleMass, timeStep;
+	size_t substeps;
+};
+
+void stepScalar(const Chunk &c, size_t begin)
+{
+	for (size_t i = begin; i < c.end; ++i) {
+		float x = c.x[i], y = c.y[i], z = c.z[i];
+		float vx = c.vx[i], vy = c.vy[i], vz = c.vz[i];
+		for (size_t s = 0; s < c.substeps; ++s) {
+			float fx = 0.f, fy = 0.f, fz = 0.f;
+			for (size_t m = 0; m < c.masses; ++m) {
+				float dx = c.massX[m] - x, dy = c.massY[m] - y, dz = c.massZ[m] - z;
+				float r2 = dx * dx + dy * dy + dz * dz;
+				// G m_1 m_2 r^-2, along d / r.
+				float pull = c.massPull[m] / r2 / std::sqrt(r2);
+				fx += pull * dx;
+				fy += pull * dy;
+				fz += pull * dz;
+			}
+			vx += fx / c.particleMass * c.timeStep;
+			vy += fy / c.particleMass * c.timeStep;
+			vz += fz / c.particleMass * c.timeStep;
+			x += vx * c.timeStep;
+			y += vy * c.timeStep;
+			z += vz * c.timeStep;
+		}
+		c.x[i] = x;
+		c.y[i] = y;
+		c.z[i] = z;
+		c.vx[i] = vx;
+		c.vy[i] = vy;
+		c.vz[i] = vz;
+	}
+}
+
+#if GRAVITY_X86
+
+// As stepScalar, 8 particles at a time.
+GRAVITY_TARGET("avx2")
+void stepAvx2(const Chunk &c)
+{
+	const __m256 particleMass = _mm256_set1_ps(c.particleMass), timeStep = _mm256_set1_ps(c.timeStep);
+	size_t i = c.begin;
+	for (; i + 8 <= c.end; i += 8) {
+		__m256 x = _mm256_loadu_ps(c.x + i), y = _mm256_loadu_ps(c.y + i), z = _mm256_loadu_ps(c.z + i);
+		__m256 vx = _mm256_loadu_ps(c.vx + i), vy = _mm256_loadu_ps(c.vy + i), vz = _mm256_loadu_ps(c.vz + i);
+		for (size_t s = 0; s < c.substeps; ++s) {
+			__m256 fx = _mm256_setzero_ps(), fy = _mm256_setzero_ps(), fz = _mm256_setzero_ps();
+			for (size_t m = 0; m < c.masses; ++m) {
+				__m256 dx = _mm256_sub_ps(_mm256_set1_ps(c.massX[m]), x);
+				__m256 dy = _mm256_sub_ps(_mm256_set1_ps(c.massY[m]), y);
+				__m256 dz = _mm256_sub_ps(_mm256_set1_ps(c.massZ[m]), z);
+				__m256 r2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+				__m256 pull = _mm256_div_ps(_mm256_div_ps(_mm256_set1_ps(c.massPull[m]), r2), _mm256_sqrt_ps(r2));
+				fx = _mm256_add_ps(fx, _mm256_mul_ps(pull, dx));
+				fy = _mm256_add_ps(fy, _mm256_mul_ps(pull, dy));
+				fz = _mm256_add_ps(fz, _mm256_mul_ps(pull, dz));
+			}
+			vx = _mm256_add_ps(vx, _mm256_mul_ps(_mm256_div_ps(fx, particleMass), timeStep));
+			vy = _mm256_add_ps(vy, _mm256_mul_ps(_mm256_div_ps(fy, particleMass), timeStep));
+			vz = _mm256_add_ps(vz, _mm256_mul_ps(_mm256_div_ps(fz, particleMass), timeStep));
+			x = _mm256_add_ps(x, _mm256_mul_ps(vx, timeStep));
+			y = _mm256_add_ps(y, _mm256_mul_ps(vy, timeStep));
+			z = _mm256_add_ps(z, _mm256_mul_ps(vz, timeStep));
+		}
+		_mm256_storeu_ps(c.x + i, x);
+		_mm256_storeu_ps(c.y + i, y);
+		_mm256_storeu_ps(c.z + i, z);
+		_mm256_storeu_ps(c.vx + i, vx);
+		_mm256_storeu_ps(c.vy + i, vy);
+		_mm256_storeu_ps(c.vz + i, vz);
+	}
+	stepScalar(c, i);
+}
+
+// As stepScalar, 16 particles at a time.
+GRAVITY_TARGET("avx512f")
+void stepAvx512(const Chunk &c)
+{
+	const __m512 particleMass = _mm512_set1_ps(c.particleMass), timeStep = _mm512_set1_ps(c.timeStep);
+	size_t i = c.begin;
+	for (; i + 16 <= c.end; i += 16) {
+		__m512 x = _mm512_loadu_ps(c.x + i), y = _mm512_loadu_ps(c.y + i), z = _mm512_loadu_ps(c.z + i);
+		__m512 vx = _mm512_loadu_ps(c.vx + i), vy = _mm512_loadu_ps(c.vy + i), vz = _mm512_loadu_ps(c.vz + i);
+		for (size_t s = 0; s < c.substeps; ++s) {
+			__m512 fx = _mm512_setzero_ps(), fy = _mm512_setzero_ps(), fz = _mm512_setzero_ps();
+			for (size_t m = 0; m < c.masses; ++m) {
+				__m512 dx = _mm512_sub_ps(_mm512_set1_ps(c.massX[m]), x);
+				__m512 dy = _mm512_sub_ps(_mm512_set1_ps(c.massY[m]), y);
+				__m512 dz = _mm512_sub_ps(_mm512_set1_ps(c.massZ[m]), z);
+				__m512 r2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz));
+				__m512 pull = _mm512_div_ps(_mm512_div_ps(_mm512_set1_ps(c.massPull[m]), r2), _mm512_sqrt_ps(r2));
+				fx = _mm512_add_ps(fx, _mm512_mul_ps(pull, dx));
+				fy = _mm512_add_ps(fy, _mm512_mul_ps(pull, dy));
+				fz = _mm512_add_ps(fz, _mm512_mul_ps(pull, dz));
+			}
+			vx = _mm512_add_ps(vx, _mm512_mul_ps(_mm512_div_ps(fx, particleMass), timeStep));
+			vy = _mm512_add_ps(vy, _mm512_mul_ps(_mm512_div_ps(fy, particleMass), timeStep));
+			vz = _mm512_add_ps(vz, _mm512_mul_ps(_mm512_div_ps(fz, particleMass), timeStep));
+			x = _mm512_add_ps(x, _mm512_mul_ps(vx, timeStep));
+			y = _mm512_add_ps(y, _mm512_mul_ps(vy, timeStep));
+			z = _mm512_add_ps(z, _mm512_mul_ps(vz, timeStep));
+		}
+		_mm512_storeu_ps(c.x + i, x);
+		_mm512_storeu_ps(c.y + i, y);
+		_mm512_storeu_ps(c.z + i, z);
+		_mm512_storeu_ps(c.vx + i, vx);
+		_mm512_storeu_ps(c.vy + i, vy);
+		_mm512_storeu_ps(c.vz + i, vz);
+	}
+	stepScalar(c, i);
+}
+
+#endif
+
+bool cpuSupports(GravityIntegrator::SimdLevel level)
+{
+	if (level == GravityIntegrator::SimdLevel::SCALAR) {
+		return true;
+	}
+#if !GRAVITY_X86
+	return false;
+#elif defined(_MSC_VER)
+	// The CPU must have the instructions, and the OS must save the registers they use
+	// (XCR0 bits 1-2 for AVX, and 5-7 as well for AVX-512).
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	if (maxLeaf < 7 || (info[2] & (1 << 27)) == 0) {
+		return false;
+	}
+	unsigned long long xcr0 = _xgetbv(0);
+	__cpuidex(info, 7, 0);
+	if (level == GravityIntegrator::SimdLevel::AVX2) {
+		return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+	}
+	return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+#else
+	// These also check the OS saves the registers.
+	__builtin_cpu_init();
+	if (level == GravityIntegrator::SimdLevel::AVX2) {
+		return __builtin_cpu_supports("avx2");
+	}
+	return __builtin_cpu_supports("avx512f");
+#endif
+}
+
+}
+
+GravityIntegrator::GravityIntegrator(JobSystem &jobs)
+	:jobs_(&jobs), level_(bestSimdLevel())
+{}
+
+bool GravityIntegrator::supported(SimdLevel level)
+{
+	static const bool avx2 = cpuSupports(SimdLevel::AVX2), avx512 = cpuSupports(SimdLevel::AVX512);
+	switch (level) {
+	case SimdLevel::AVX2:
+		return avx2;
+	case SimdLevel::AVX512:
+		return avx512;
+	default:
+		return true;
+	}
+}
+
+GravityIntegrator::SimdLevel GravityIntegrator::bestSimdLevel()
+{
+	if (supported(SimdLevel::AVX512)) {
+		return SimdLevel::AVX512;
+	}
+	return supported(SimdLevel::AVX2) ? SimdLevel::AVX2 : SimdLevel::SCALAR;
+}
+
+const char *GravityIntegrator::name(SimdLevel level)
+{
+	switch (level) {
+	case SimdLevel::AVX2:
+		return "AVX2";
+	case SimdLevel::AVX512:
+		return "AVX-512";
+	default:
+		return "scalar";
+	}
+}
+
+void GravityIntegrator::setSimdLevel(SimdLevel level)
+{
+	if (!supported(level)) {
+		throw std::runtime_error(std::string("GravityIntegrator: ") + name(level) + " isn't supported by this CPU or build.");
+	}
+	level_ = level;
+}
+
+GravityIntegrator::SimdLevel GravityIntegrator::simdLevel() const
+{
+	return level_;
+}
+
+size_t GravityIntegrator::size() const
+{
+	return x_.size();
+}
+
+Eigen::Vector3f GravityIntegrator::position(size_t i) const
+{
+	return Eigen::Vector3f(x_[i], y_[i], z_[i]);
+}
+
+Eigen::Vector3f GravityIntegrator::velocity(size_t i) const
+{
+	return Eigen::Vector3f(vx_[i], vy_[i], vz_[i]);
+}
+
+void GravityIntegrator::step(const std::vector<PointMass> &masses, float particleMass, float gravitationalConstant,
+	float timeStep, size_t substeps)
+{
+	std::vector<float> massX, massY, massZ, massPull;
+	for (const PointMass &m : masses) {
+		massX.push_back(m.position.x());
+		massY.push_back(m.position.y());
+		massZ.push_back(m.position.z());
+		// In the order the shader multiplies them.
+		massPull.push_back(gravitationalConstant * m.mass * particleMass);
+	}
+	SimdLevel level = level_;
+	jobs_->parallelFor(0, size(), particlesPerJob, [&](size_t begin, size_t end) {
+		Chunk c = { x_.data(), y_.data(), z_.data(), vx_.data(), vy_.data(), vz_.data(), begin, end,
+			massX.data(), massY.data(), massZ.data(), massPull.data(), masses.size(), particleMass, timeStep, substeps };
+#if GRAVITY_X86
+		if (level == SimdLevel::AVX512) {
+			stepAvx512(c);
+			return;
+		}
+		if (level == SimdLevel::AVX2) {
+			stepAvx2(c);
+			return;
+		}
+#endif
+		stepScalar(c, begin);
+	});
+}
+
+void GravityIntegrator::resize(size_t count)
+{
+	for (std::vector<float> *v : { &x_, &y_, &z_, &vx_, &vy_, &vz_ }) {
+		v->resize(count);
+	}
+}
+
+void GravityIntegrator::set(size_t i, const Eigen::Vector3f &position, const Eigen::Vector3f &velocity)
+{
+	x_[i] = position.x();
+	y_[i] = position.y();
+	z_[i] = position.z();
+	vx_[i] = velocity.x();
+	vy_[i] = velocity.y();
+	vz_[i] = velocity.z();
+}
+
+}
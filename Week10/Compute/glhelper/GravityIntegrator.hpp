@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <vector>
+#include "JobSystem.hpp"
+
+namespace glhelper {
+
+//!\brief A body the particles of a GravityIntegrator are pulled towards. Laid out as a
+//!       vec4 of position and mass, so an array of them can go straight into a shader
+//!       storage buffer (see OrbitIntegrator::attractors).
+struct PointMass {
+	Eigen::Vector3f position;
+	float mass;
+};
+static_assert(sizeof(PointMass) == 4 * sizeof(float), "PointMass must be laid out like a vec4.");
+
+//!\brief Moves particles under the gravity of a few point masses on the CPU, with the
+//!       same semi-implicit Euler step as shaders/ParticlePhysics.comp: each substep
+//!       adds G m_1 m_2 r^-2 towards every mass to the force, then updates velocity from
+//!       it and position from the new velocity. ring_sweep checks the compute shader
+//!       against it, and ring_cpu_bench times it; saturn_rings itself always steps the
+//!       rings with the shader.
+//!
+//!       The particles are stored as separate arrays of x, y, z and so on rather than as
+//!       an array of particles, so one SIMD register holds the same component of 8 (AVX2)
+//!       or 16 (AVX-512) particles and the force loop needs no shuffling. The widest
+//!       instruction set this CPU has is picked at run time, with a scalar fallback
+//!       (and only that off x86). Every lane does the same operations in the same order
+//!       as the scalar code, without fused multiply-adds, so all of them give bitwise
+//!       identical results. Chunks of particles are stepped in parallel on a JobSystem,
+//!       all substeps of a chunk at once while it's in cache.
+//!
+//!       Particles are never removed: unlike the shader, there's no rule for when one
+//!       hits a planet.
+class GravityIntegrator final
+{
+public:
+	enum class SimdLevel {
+		SCALAR,
+		AVX2,
+		AVX512
+	};
+
+	//!\brief Starts empty, at bestSimdLevel().
+	explicit GravityIntegrator(JobSystem &jobs);
+
+	//!\brief Whether both this build and this CPU can run level.
+	static bool supported(SimdLevel level);
+	//!\brief The widest supported level.
+	static SimdLevel bestSimdLevel();
+	static const char *name(SimdLevel level);
+
+	//!\brief Throws std::runtime_error if level isn't supported.
+	void setSimdLevel(SimdLevel level);
+	SimdLevel simdLevel() const;
+
+	size_t size() const;
+
+	//!\brief Replaces the particles with copies of particles, which have Eigen::Vector4f
+	//!       position and velocity members like RingParticle.
+	template<typename Particle>
+	void upload(const std::vector<Particle> &particles)
+	{
+		resize(particles.size());
+		for (size_t i = 0; i < particles.size(); ++i) {
+			set(i, particles[i].position.template head<3>(), particles[i].velocity.template head<3>());
+		}
+	}
+
+	//!\brief Copies the particles out, with position w set to 1 and velocity w to 0.
+	template<typename Particle>
+	void download(std::vector<Particle> &particles) const
+	{
+		particles.resize(size());
+		for (size_t i = 0; i < particles.size(); ++i) {
+			particles[i].position << position(i), 1.f;
+			particles[i].velocity << velocity(i), 0.f;
+		}
+	}
+
+	Eigen::Vector3f position(size_t i) const;
+	Eigen::Vector3f velocity(size_t i) const;
+
+	//!\brief Runs substeps steps of timeStep, as the shader does with the same uniforms.
+	void step(const std::vector<PointMass> &masses, float particleMass, float gravitationalConstant,
+		float timeStep, size_t substeps = 1);
+
+private:
+	GravityIntegrator(const GravityIntegrator&);
+	GravityIntegrator &operator=(const GravityIntegrator&);
+
+	void resize(size_t count);
+	void set(size_t i, const Eigen::Vector3f &position, const Eigen::Vector3f &velocity);
+
+	JobSystem *jobs_;
+	SimdLevel level_;
+	std::vector<float> x_, y_, z_, vx_, vy_, vz_;
+};
+
+}
@@ -0,0 +1,359 @@
+#include "JobSystem.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+
+namespace glhelper {
+
+struct JobState {
+	std::function<void()> fn;
+	bool mainThread;
+	// Dependencies still running, plus one while the job is being set up.
+	std::atomic<int> waitingFor;
+	std::atomic<bool> done;
+
+	// Guards continuations, error and, with done, the hand-over of continuations.
+	std::mutex mutex;
+	std::vector<std::shared_ptr<JobState>> continuations;
+	std::exception_ptr error;
+};
+
+namespace {
+
+// The JobSystem and worker the calling thread belongs to, if any.
+thread_local const JobSystem *threadSystem = nullptr;
+thread_local size_t threadWorker = 0;
+
+long long nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+Job::Job()
+{}
+
+Job::Job(std::shared_ptr<JobState> state)
+	:state_(state)
+{}
+
+bool Job::valid() const
+{
+	return bool(state_);
+}
+
+bool Job::done() const
+{
+	return !state_ || state_->done;
+}
+
+JobSystem::JobSystem(size_t workers)
+	:mainThread_(std::this_thread::get_id()),
+	nextWorker_(0), queued_(0), stopping_(false),
+	statsStartNs_(nowNs())
+{
+	if (workers == 0) {
+		unsigned cores = std::thread::hardware_concurrency();
+		workers = cores > 1 ? cores - 1 : 1;
+	}
+	// The extra entry only holds the main thread's stats.
+	for (size_t i = 0; i <= workers; ++i) {
+		workers_.push_back(std::make_unique<Worker>());
+		Worker &w = *workers_.back();
+		w.jobs = 0;
+		w.steals = 0;
+		w.busyNs = 0;
+	}
+	for (size_t i = 0; i < workers; ++i) {
+		workers_[i]->thread = std::thread(&JobSystem::run, this, i);
+	}
+}
+
+JobSystem::~JobSystem() throw()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	for (std::unique_ptr<Worker> &w : workers_) {
+		if (w->thread.joinable()) {
+			w->thread.join();
+		}
+	}
+}
+
+size_t JobSystem::workers() const
+{
+	return workers_.size() - 1;
+}
+
+Job JobSystem::submit(std::function<void()> fn, const std::vector<Job> &dependencies)
+{
+	return create(std::move(fn), dependencies, false);
+}
+
+Job JobSystem::onMainThread(std::function<void()> fn, const std::vector<Job> &dependencies)
+{
+	return create(std::move(fn), dependencies, true);
+}
+
+Job JobSystem::parallelForAsync(size_t begin, size_t end, size_t grain,
+	std::function<void(size_t, size_t)> body, const std::vector<Job> &dependencies)
+{
+	if (grain == 0) {
+		throw std::runtime_error("JobSystem: parallelFor needs a grain of at least one element.");
+	}
+	std::shared_ptr<std::function<void(size_t, size_t)>> shared =
+		std::make_shared<std::function<void(size_t, size_t)>>(std::move(body));
+	std::vector<Job> chunks;
+	chunks.reserve(end > begin ? (end - begin + grain - 1) / grain : 0);
+	for (size_t b = begin; b < end; b += std::min(grain, end - b)) {
+		size_t e = b + std::min(grain, end - b);
+		chunks.push_back(submit([shared, b, e] { (*shared)(b, e); }, dependencies));
+	}
+	return submit([] {}, chunks);
+}
+
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain, std::function<void(size_t, size_t)> body)
+{
+	wait(parallelForAsync(begin, end, grain, std::move(body)));
+}
+
+Job JobSystem::create(std::function<void()> fn, const std::vector<Job> &dependencies, bool mainThread)
+{
+	std::shared_ptr<JobState> job = std::make_shared<JobState>();
+	job->fn = std::move(fn);
+	job->mainThread = mainThread;
+	job->waitingFor = 1;
+	job->done = false;
+	for (const Job &d : dependencies) {
+		if (!d.state_) {
+			continue;
+		}
+		std::exception_ptr error;
+		{
+			std::lock_guard<std::mutex> lock(d.state_->mutex);
+			if (!d.state_->done) {
+				++job->waitingFor;
+				d.state_->continuations.push_back(job);
+			} else {
+				error = d.state_->error;
+			}
+		}
+		if (error) {
+			std::lock_guard<std::mutex> lock(job->mutex);
+			if (!job->error) {
+				job->error = error;
+			}
+		}
+	}
+	release(job);
+	return Job(job);
+}
+
+void JobSystem::release(const std::shared_ptr<JobState> &job)
+{
+	if (--job->waitingFor == 0) {
+		enqueue(job);
+	}
+}
+
+void JobSystem::enqueue(const std::shared_ptr<JobState> &job)
+{
+	if (job->mainThread) {
+		std::lock_guard<std::mutex> lock(mainMutex_);
+		mainQueue_.push_back(job);
+		return;
+	}
+	// Workers push to their own queue; anyone else spreads jobs round the workers.
+	size_t w = threadSystem == this ? threadWorker : nextWorker_++ % workers();
+	{
+		std::lock_guard<std::mutex> lock(workers_[w]->mutex);
+		workers_[w]->queue.push_back(job);
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+		++queued_;
+	}
+	wake_.notify_one();
+}
+
+std::shared_ptr<JobState> JobSystem::take(size_t worker)
+{
+	std::shared_ptr<JobState> job;
+	size_t n = workers();
+	if (worker < n) {
+		Worker &own = *workers_[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.queue.empty()) {
+			job = std::move(own.queue.back());
+			own.queue.pop_back();
+		}
+	}
+	// Workers only steal from the others; the main thread has no queue, so tries them all.
+	size_t victims = worker < n ? n - 1 : n;
+	for (size_t i = 1; !job && i <= victims; ++i) {
+		Worker &victim = *workers_[(worker + i) % n];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.queue.empty()) {
+			job = std::move(victim.queue.front());
+			victim.queue.pop_front();
+			++workers_[worker]->steals;
+		}
+	}
+	if (job) {
+		--queued_;
+	}
+	return job;
+}
+
+void JobSystem::execute(const std::shared_ptr<JobState> &job, size_t worker)
+{
+	long long start = nowNs();
+	if (!job->error) {
+		try {
+			TraceZone zone("job");
+			job->fn();
+		} catch (...) {
+			job->error = std::current_exception();
+		}
+	}
+	job->fn = nullptr;
+	Worker &w = *workers_[worker];
+	w.busyNs += nowNs() - start;
+	++w.jobs;
+
+	std::vector<std::shared_ptr<JobState>> continuations;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->done = true;
+		continuations.swap(job->continuations);
+	}
+	for (const std::shared_ptr<JobState> &c : continuations) {
+		if (job->error) {
+			std::lock_guard<std::mutex> lock(c->mutex);
+			if (!c->error) {
+				c->error = job->error;
+			}
+		}
+		release(c);
+	}
+}
+
+void JobSystem::run(size_t worker)
+{
+	threadSystem = this;
+	threadWorker = worker;
+	// Only while tracing, since naming the thread gives it a trace buffer.
+	if (Trace::active()) {
+		Trace::setThreadName("Job worker " + std::to_string(worker));
+	}
+	for (;;) {
+		std::shared_ptr<JobState> job = take(worker);
+		if (job) {
+			execute(job, worker);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex_);
+		wake_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+		if (stopping_ && queued_ == 0) {
+			return;
+		}
+	}
+}
+
+size_t JobSystem::currentWorker() const
+{
+	return threadSystem == this ? threadWorker : workers();
+}
+
+void JobSystem::wait(const Job &job)
+{
+	if (!job.state_) {
+		return;
+	}
+	bool isMain = std::this_thread::get_id() == mainThread_;
+	size_t worker = currentWorker();
+	while (!job.state_->done) {
+		if (isMain && runMainThreadJobs() > 0) {
+			continue;
+		}
+		std::shared_ptr<JobState> other = take(worker);
+		if (other) {
+			execute(other, worker);
+		} else {
+			// Whatever is left is already running on another thread.
+			std::this_thread::yield();
+		}
+	}
+	std::lock_guard<std::mutex> lock(job.state_->mutex);
+	if (job.state_->error) {
+		std::rethrow_exception(job.state_->error);
+	}
+}
+
+size_t JobSystem::runMainThreadJobs()
+{
+	if (std::this_thread::get_id() != mainThread_) {
+		throw std::runtime_error("JobSystem: main thread jobs can only be run on the main thread.");
+	}
+	{
+		std::lock_guard<std::mutex> lock(mainMutex_);
+		mainRunning_.swap(mainQueue_);
+	}
+	size_t n = mainRunning_.size();
+	for (const std::shared_ptr<JobState> &job : mainRunning_) {
+		execute(job, workers());
+	}
+	mainRunning_.clear();
+	return n;
+}
+
+std::vector<WorkerStats> JobSystem::stats() const
+{
+	double elapsedMs = double(nowNs() - statsStartNs_) * 1e-6;
+	std::vector<WorkerStats> s;
+	for (const std::unique_ptr<Worker> &w : workers_) {
+		double busyMs = double(w->busyNs) * 1e-6;
+		s.push_back(WorkerStats{ w->jobs, w->steals, busyMs, elapsedMs > 0.0 ? std::min(busyMs / elapsedMs, 1.0) : 0.0 });
+	}
+	return s;
+}
+
+void JobSystem::resetStats()
+{
+	for (std::unique_ptr<Worker> &w : workers_) {
+		w->jobs = 0;
+		w->steals = 0;
+		w->busyNs = 0;
+	}
+	statsStartNs_ = nowNs();
+}
+
+void JobSystem::report(std::ostream &out) const
+{
+	std::vector<WorkerStats> s = stats();
+	char line[120];
+	snprintf(line, sizeof(line), "Job system: %zu workers\n  %-8s %8s %8s %10s %6s\n",
+		workers(), "thread", "jobs", "steals", "busy ms", "busy");
+	out << line;
+	for (size_t i = 0; i < s.size(); ++i) {
+		// Room for any size_t.
+		char name[24];
+		if (i < workers()) {
+			snprintf(name, sizeof(name), "%zu", i);
+		} else {
+			snprintf(name, sizeof(name), "main");
+		}
+		snprintf(line, sizeof(line), "  %-8s %8zu %8zu %10.2f %5.1f%%\n",
+			name, s[i].jobs, s[i].steals, s[i].busyMs, s[i].utilisation * 100.0);
+		out << line;
+	}
+}
+
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace glhelper {
+
+struct JobState;
+
+//!\brief Handle to a job submitted to a JobSystem, for waiting on it or making
+//!       other jobs depend on it. Cheap to copy.
+class Job final
+{
+public:
+	//!\brief An empty handle, which counts as already done.
+	Job();
+
+	bool valid() const;
+	bool done() const;
+
+private:
+	friend class JobSystem;
+	explicit Job(std::shared_ptr<JobState> state);
+
+	std::shared_ptr<JobState> state_;
+};
+
+//!\brief Work done by one thread of a JobSystem since it started or stats were reset.
+struct WorkerStats {
+	size_t jobs;
+	//!\brief Jobs this thread took from another thread's queue.
+	size_t steals;
+	double busyMs;
+	//!\brief Fraction of the elapsed time spent running jobs, 0 to 1.
+	double utilisation;
+};
+
+//!\brief Runs small jobs on a pool of worker threads, one per core.
+//!
+//!       Each worker has its own queue. A worker runs its newest job first (it is
+//!       most likely still in cache), and when its queue is empty it steals the
+//!       oldest job from another worker, so the load balances itself without a
+//!       single shared queue for every thread to fight over. The queues are
+//!       short mutex-guarded deques rather than lock-free ones; each lock is held
+//!       only for a push or pop.
+//!
+//!       A job can depend on other jobs, and then only starts once they've all
+//!       finished. If a job throws, the exception is passed on to the jobs that
+//!       depend on it (which are then skipped) and rethrown by wait.
+//!
+//!       GL calls must be made on the thread owning the context, so onMainThread
+//!       queues a job there instead. These run when the main thread calls
+//!       runMainThreadJobs (e.g. once a frame), or while it's in wait.
+//!
+//!       Usage:
+//!           JobSystem jobs;
+//!           cv::Mat image;
+//!           Job load = jobs.submit([&] { image = cv::imread(filename); });
+//!           Job upload = jobs.onMainThread([&] { texture.update(image); }, { load });
+//!           jobs.parallelFor(0, n, 1024, [&](size_t begin, size_t end) { ... });
+//!           jobs.wait(upload);
+//!\note Must be created and destroyed on the main thread, which is the thread
+//!      onMainThread jobs run on. Any thread may submit and wait.
+class JobSystem final
+{
+public:
+	//!\param workers Worker threads, or 0 for one fewer than the number of cores,
+	//!       as the main thread also runs jobs while it waits.
+	explicit JobSystem(size_t workers = 0);
+	//!\brief Finishes any jobs already queued for the workers, then stops them.
+	~JobSystem() throw();
+
+	size_t workers() const;
+
+	//!\brief Queues fn to run on a worker once all of dependencies have finished.
+	Job submit(std::function<void()> fn, const std::vector<Job> &dependencies = std::vector<Job>());
+	//!\brief Queues fn to run on the main thread once all of dependencies have finished.
+	Job onMainThread(std::function<void()> fn, const std::vector<Job> &dependencies = std::vector<Job>());
+
+	//!\brief Calls body(chunkBegin, chunkEnd) for consecutive chunks of [begin, end)
+	//!       in parallel, each of grain elements (the last may be shorter).
+	//!       The chunks are the same whatever the number of workers, so per-chunk
+	//!       state (e.g. a random seed from chunkBegin) gives repeatable results.
+	//!\return A job that finishes when every chunk has.
+	Job parallelForAsync(size_t begin, size_t end, size_t grain,
+		std::function<void(size_t, size_t)> body, const std::vector<Job> &dependencies = std::vector<Job>());
+	//!\brief parallelForAsync, then waits for it.
+	void parallelFor(size_t begin, size_t end, size_t grain, std::function<void(size_t, size_t)> body);
+
+	//!\brief Runs other jobs until job has finished, then rethrows any exception it threw.
+	//!       On the main thread this also runs main thread jobs.
+	void wait(const Job &job);
+	//!\brief Runs the main thread jobs queued so far.
+	//!\return The number run.
+	size_t runMainThreadJobs();
+
+	//!\brief One entry per worker, then one for the main thread.
+	std::vector<WorkerStats> stats() const;
+	void resetStats();
+	//!\brief Prints stats() as a table, e.g. before exiting to see how well the load balanced.
+	void report(std::ostream &out) const;
+
+private:
+	JobSystem(const JobSystem&);
+	JobSystem &operator=(const JobSystem&);
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct Worker {
+		std::mutex mutex;
+		std::deque<std::shared_ptr<JobState>> queue;
+		std::thread thread;
+		std::atomic<size_t> jobs, steals;
+		std::atomic<long long> busyNs;
+	};
+
+	Job create(std::function<void()> fn, const std::vector<Job> &dependencies, bool mainThread);
+	void release(const std::shared_ptr<JobState> &job);
+	void enqueue(const std::shared_ptr<JobState> &job);
+	std::shared_ptr<JobState> take(size_t worker);
+	void execute(const std::shared_ptr<JobState> &job, size_t worker);
+	void run(size_t worker);
+	//!\brief Index of the calling thread's Worker, with the main thread (and any other) last.
+	size_t currentWorker() const;
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::thread::id mainThread_;
+	std::atomic<size_t> nextWorker_;
+
+	// Jobs waiting in the worker queues, for idle workers to sleep on.
+	std::atomic<size_t> queued_;
+	std::mutex sleepMutex_;
+	std::condition_variable wake_;
+	std::atomic<bool> stopping_;
+
+	std::mutex mainMutex_;
+	std::vector<std::shared_ptr<JobState>> mainQueue_, mainRunning_;
+
+	std::atomic<long long> statsStartNs_;
+};
+
+}
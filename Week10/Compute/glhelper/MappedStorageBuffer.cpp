@@ -0,0 +1,130 @@
+#include "MappedStorageBuffer.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+const GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+// How long each wait for a fence blocks before checking again.
+const GLuint64 fenceWaitNs = 1000000;
+
+}
+
+MappedStorageBuffer::MappedStorageBuffer(size_t sizeBytes, size_t regions)
+	:buf_(0), sizeBytes_(sizeBytes), stride_(sizeBytes), mapped_(nullptr),
+	fences_(std::max(regions, size_t(1)), nullptr), current_(0)
+{
+	// Each region is bound with glBindBufferRange, so must start on an allowed offset.
+	GLint alignment = 1;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	stride_ = (sizeBytes_ + size_t(alignment) - 1) / size_t(alignment) * size_t(alignment);
+
+	glGenBuffers(1, &buf_);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf_);
+	glBufferStorage(GL_SHADER_STORAGE_BUFFER, stride_ * fences_.size(), nullptr, mapFlags);
+	mapped_ = static_cast<unsigned char*>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, stride_ * fences_.size(), mapFlags));
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	if (mapped_ == nullptr) {
+		glDeleteBuffers(1, &buf_);
+		throw std::runtime_error("MappedStorageBuffer: couldn't map the buffer persistently (needs GL 4.4).");
+	}
+	// Until the first update, the latest region is empty, so any count in it reads as 0.
+	std::memset(mapped_, 0, stride_);
+	GpuMemory::track(GpuResourceType::BUFFER, buf_, stride_ * fences_.size(), "mapped storage buffer");
+}
+
+MappedStorageBuffer::MappedStorageBuffer(MappedStorageBuffer &&tmp)
+	:buf_(tmp.buf_), sizeBytes_(tmp.sizeBytes_), stride_(tmp.stride_), mapped_(tmp.mapped_),
+	fences_(std::move(tmp.fences_)), current_(tmp.current_), latest_(std::move(tmp.latest_))
+{
+	tmp.buf_ = 0;
+	tmp.mapped_ = nullptr;
+}
+
+MappedStorageBuffer::~MappedStorageBuffer() throw()
+{
+	for (GLsync fence : fences_) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+		}
+	}
+	if (buf_ != 0) {
+		GpuMemory::untrack(GpuResourceType::BUFFER, buf_);
+		// Deleting a buffer unmaps it.
+		glDeleteBuffers(1, &buf_);
+	}
+}
+
+size_t MappedStorageBuffer::sizeBytes() const
+{
+	return sizeBytes_;
+}
+
+bool MappedStorageBuffer::update(const void *data, size_t sizeBytes)
+{
+	return write(nullptr, 0, data, sizeBytes);
+}
+
+void MappedStorageBuffer::bindBase(GLuint index)
+{
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, buf_, current_ * stride_, stride_);
+}
+
+bool MappedStorageBuffer::write(const void *header, size_t headerBytes, const void *data, size_t dataBytes)
+{
+	size_t bytes = headerBytes + dataBytes;
+	if (bytes > sizeBytes_) {
+		throw std::runtime_error("MappedStorageBuffer: update is bigger than the buffer.");
+	}
+	// Compared with a copy, as reading the mapping itself would be slow (it's often write-combined) and isn't allowed.
+	if (bytes == latest_.size() && (headerBytes == 0 || std::memcmp(latest_.data(), header, headerBytes) == 0) &&
+		(dataBytes == 0 || std::memcmp(latest_.data() + headerBytes, data, dataBytes) == 0)) {
+		return false;
+	}
+	latest_.resize(bytes);
+	if (headerBytes > 0) {
+		std::memcpy(latest_.data(), header, headerBytes);
+	}
+	if (dataBytes > 0) {
+		std::memcpy(latest_.data() + headerBytes, data, dataBytes);
+	}
+
+	// Everything that could read the latest region has been issued by now.
+	fences_[current_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	current_ = (current_ + 1) % fences_.size();
+	waitFor(current_);
+	if (bytes > 0) {
+		std::memcpy(mapped_ + current_ * stride_, latest_.data(), bytes);
+	}
+	RenderStats::recordUpload(bytes);
+	return true;
+}
+
+void MappedStorageBuffer::waitFor(size_t region)
+{
+	GLsync &fence = fences_[region];
+	if (fence == nullptr) {
+		return;
+	}
+	GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	for (;;) {
+		GLenum result = glClientWaitSync(fence, flags, fenceWaitNs);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+			break;
+		}
+		if (result == GL_WAIT_FAILED) {
+			throw std::runtime_error("MappedStorageBuffer: waiting for the GPU failed.");
+		}
+		flags = 0;
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+namespace glhelper {
+
+//!\brief A shader storage buffer the CPU writes through a pointer mapped once for its
+//!       lifetime (GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT), for small data that
+//!       changes from frame to frame, such as the attractors the ring particles fall towards.
+//!
+//!       Each update goes to the next of a few regions in turn, so the CPU never writes
+//!       to one the GPU may still be reading. A fence is placed when a region stops being
+//!       the latest, and waited on before it's written again, which only blocks if the GPU
+//!       is more than regions - 1 updates behind. Updates with the same contents as the
+//!       latest are skipped, so data that doesn't change is never copied again.
+//!
+//!       updateArray writes a count followed by an array, for a std430 block like:
+//!           layout(std430, binding=2) readonly buffer Attractors {
+//!               uint attractorCount;
+//!               vec4 attractors[];
+//!           };
+//!\note Must be used on the thread owning the GL context.
+class MappedStorageBuffer final
+{
+public:
+	//!\param sizeBytes Size of each region: the most one update can write.
+	explicit MappedStorageBuffer(size_t sizeBytes, size_t regions = 3);
+	MappedStorageBuffer(MappedStorageBuffer &&tmp);
+	~MappedStorageBuffer() throw();
+
+	size_t sizeBytes() const;
+
+	//!\brief Makes data the latest contents, unless it already is.
+	//!\return Whether anything was written.
+	bool update(const void *data, size_t sizeBytes);
+	//!\brief Makes the latest contents items.size() as a uint, then items from 16 bytes
+	//!       in, where a std430 array of a 16 byte aligned type (e.g. vec4) starts.
+	template<typename T>
+	bool updateArray(const std::vector<T> &items)
+	{
+		const GLuint header[4] = { GLuint(items.size()), 0, 0, 0 };
+		return write(header, sizeof(header), items.data(), items.size() * sizeof(T));
+	}
+
+	//!\brief Binds the latest contents.
+	void bindBase(GLuint index);
+
+private:
+	MappedStorageBuffer(const MappedStorageBuffer&);
+	MappedStorageBuffer &operator=(const MappedStorageBuffer&);
+
+	bool write(const void *header, size_t headerBytes, const void *data, size_t dataBytes);
+	//!\brief Blocks until the GPU has finished with region.
+	void waitFor(size_t region);
+
+	GLuint buf_;
+	size_t sizeBytes_, stride_;
+	unsigned char *mapped_;
+	std::vector<GLsync> fences_;
+	size_t current_;
+	//!\brief What the latest region holds.
+	std::vector<unsigned char> latest_;
+};
+
+}
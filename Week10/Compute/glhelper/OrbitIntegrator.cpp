@@ -0,0 +1,116 @@
+#include "OrbitIntegrator.hpp"
+#include "Trace.hpp"
+#include <cmath>
+
+namespace glhelper {
+
+namespace {
+
+// Bodies whose accelerations each job works out; each one sums over every body.
+const size_t bodiesPerJob = 64;
+
+}
+
+OrbitIntegrator::OrbitIntegrator(JobSystem &jobs, float gravitationalConstant, float softening)
+	:jobs_(&jobs), gravitationalConstant_(gravitationalConstant),
+	softening2_(double(softening) * double(softening)), accelerationsCurrent_(false)
+{}
+
+size_t OrbitIntegrator::add(const Eigen::Vector3f &position, const Eigen::Vector3f &velocity, float mass)
+{
+	position_.push_back(position.cast<double>());
+	velocity_.push_back(velocity.cast<double>());
+	acceleration_.push_back(Eigen::Vector3d::Zero());
+	mass_.push_back(double(mass));
+	attractors_.push_back({ position, mass });
+	accelerationsCurrent_ = false;
+	return mass_.size() - 1;
+}
+
+size_t OrbitIntegrator::addOrbiting(size_t centre, const Eigen::Vector3f &position, float mass, const Eigen::Vector3f &axis)
+{
+	Eigen::Vector3d offset = position.cast<double>() - position_[centre];
+	double total = mass_[centre] + double(mass);
+	// Relative speed of a circular two-body orbit, shared out so the momenta cancel.
+	double speed = std::sqrt(gravitationalConstant_ * total / offset.norm());
+	Eigen::Vector3d direction = axis.cast<double>().cross(offset).normalized();
+	Eigen::Vector3d relative = direction * speed;
+	Eigen::Vector3d velocity = velocity_[centre] + relative * (mass_[centre] / total);
+	velocity_[centre] -= relative * (double(mass) / total);
+	return add(position, velocity.cast<float>(), mass);
+}
+
+size_t OrbitIntegrator::size() const
+{
+	return mass_.size();
+}
+
+Eigen::Vector3f OrbitIntegrator::position(size_t i) const
+{
+	return position_[i].cast<float>();
+}
+
+Eigen::Vector3f OrbitIntegrator::velocity(size_t i) const
+{
+	return velocity_[i].cast<float>();
+}
+
+float OrbitIntegrator::mass(size_t i) const
+{
+	return float(mass_[i]);
+}
+
+void OrbitIntegrator::step(double timeStep, size_t substeps)
+{
+	TraceZone zone("OrbitIntegrator::step");
+	if (size() < 2) {
+		// A lone body feels no force, so just drifts.
+		for (size_t i = 0; i < size(); ++i) {
+			position_[i] += velocity_[i] * timeStep * double(substeps);
+		}
+	} else {
+		for (size_t s = 0; s < substeps; ++s) {
+			if (!accelerationsCurrent_) {
+				updateAccelerations();
+			}
+			for (size_t i = 0; i < size(); ++i) {
+				velocity_[i] += acceleration_[i] * (0.5 * timeStep);
+				position_[i] += velocity_[i] * timeStep;
+			}
+			updateAccelerations();
+			for (size_t i = 0; i < size(); ++i) {
+				velocity_[i] += acceleration_[i] * (0.5 * timeStep);
+			}
+		}
+	}
+	for (size_t i = 0; i < size(); ++i) {
+		attractors_[i].position = position_[i].cast<float>();
+	}
+}
+
+const std::vector<PointMass> &OrbitIntegrator::attractors() const
+{
+	return attractors_;
+}
+
+void OrbitIntegrator::updateAccelerations()
+{
+	size_t n = size();
+	jobs_->parallelFor(0, n, bodiesPerJob, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			Eigen::Vector3d acc = Eigen::Vector3d::Zero();
+			for (size_t j = 0; j < n; ++j) {
+				if (j == i) {
+					continue;
+				}
+				Eigen::Vector3d d = position_[j] - position_[i];
+				double r2 = d.squaredNorm() + softening2_;
+				acc += d * (gravitationalConstant_ * mass_[j] / (r2 * std::sqrt(r2)));
+			}
+			acceleration_[i] = acc;
+		}
+	});
+	accelerationsCurrent_ = true;
+}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <vector>
+#include "GravityIntegrator.hpp"
+#include "JobSystem.hpp"
+
+namespace glhelper {
+
+//!\brief Moves planets and moons under each other's gravity on the CPU, for the ring
+//!       particles to fall towards (the attractors of ParticlePhysics.comp).
+//!
+//!       State is kept in double precision and stepped with leapfrog (kick, drift,
+//!       kick), which unlike Euler keeps orbits closed over many steps for the same
+//!       cost: one evaluation of the forces per step. Every body pulls on every
+//!       other, so a step is O(n^2) in the bodies, split over the JobSystem by body.
+//!       The ring particles are taken to be too light to pull on anything.
+class OrbitIntegrator final
+{
+public:
+	//!\param softening Length added to every distance as in NBody.comp, so close
+	//!       passes don't fling bodies away; 0 for plain Newtonian gravity.
+	OrbitIntegrator(JobSystem &jobs, float gravitationalConstant, float softening = 0.f);
+
+	//!\return The new body's index.
+	size_t add(const Eigen::Vector3f &position, const Eigen::Vector3f &velocity, float mass);
+	//!\brief Adds a body on a circular orbit around body centre, about axis, and gives
+	//!       centre the opposite momentum so the pair's centre of mass doesn't move.
+	//!\return The new body's index.
+	size_t addOrbiting(size_t centre, const Eigen::Vector3f &position, float mass,
+		const Eigen::Vector3f &axis = Eigen::Vector3f::UnitY());
+
+	size_t size() const;
+	Eigen::Vector3f position(size_t i) const;
+	Eigen::Vector3f velocity(size_t i) const;
+	float mass(size_t i) const;
+
+	//!\brief Runs substeps steps of timeStep each.
+	void step(double timeStep, size_t substeps = 1);
+
+	//!\brief Every body's position and mass, laid out for MappedStorageBuffer::updateArray
+	//!       (as vec4s) or GravityIntegrator::step.
+	const std::vector<PointMass> &attractors() const;
+
+private:
+	OrbitIntegrator(const OrbitIntegrator&);
+	OrbitIntegrator &operator=(const OrbitIntegrator&);
+
+	void updateAccelerations();
+
+	JobSystem *jobs_;
+	double gravitationalConstant_, softening2_;
+	std::vector<Eigen::Vector3d> position_, velocity_, acceleration_;
+	std::vector<double> mass_;
+	std::vector<PointMass> attractors_;
+	//!\brief Whether acceleration_ is for the current positions and bodies.
+	bool accelerationsCurrent_;
+};
+
+}
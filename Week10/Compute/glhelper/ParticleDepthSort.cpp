@@ -0,0 +1,60 @@
+#include "ParticleDepthSort.hpp"
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+// Must match ParticleDepthKeys.comp.
+const unsigned keyBits = 16;
+
+ShaderDefines keyDefines(const ParticleSystem &particles, size_t positionOffset, const ComputeDispatch &dispatch)
+{
+	if (particles.particleBytes() % 16 != 0 || positionOffset % 16 != 0) {
+		throw std::runtime_error("ParticleDepthSort: particles must be made of vec4s, with the position one of them.");
+	}
+	ShaderDefines defines = dispatch.defines();
+	defines["PARTICLE_VEC4S"] = std::to_string(particles.particleBytes() / 16);
+	defines["POSITION_VEC4"] = std::to_string(positionOffset / 16);
+	return defines;
+}
+
+}
+
+ParticleDepthSort::ParticleDepthSort(ParticleSystem &particles, size_t positionOffset, const ComputeDispatch &dispatch,
+	const std::string &shaderDir)
+	:particles_(&particles),
+	dispatch_(dispatch),
+	keyShader_({ shaderDir + "ParticleDepthKeys.comp" }, keyDefines(particles, positionOffset, dispatch)),
+	sorter_(particles.capacity(), shaderDir),
+	keys_(particles.capacity() * sizeof(GLuint)),
+	order_(particles.capacity() * sizeof(GLuint))
+{
+	glProgramUniform1ui(keyShader_.get(), keyShader_.uniformLoc("capacity"), GLuint(particles.capacity()));
+}
+
+void ParticleDepthSort::sort(const Eigen::Vector3f &cameraPosition, float maxDistance)
+{
+	// Reads the latest positions and live count as storage buffers.
+	particles_->barrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	glProgramUniform3fv(keyShader_.get(), keyShader_.uniformLoc("cameraPosition"), 1, cameraPosition.data());
+	glProgramUniform1f(keyShader_.get(), keyShader_.uniformLoc("maxDistance"), maxDistance);
+	keyShader_.use();
+	particles_->front().bindBase(0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, particles_->frontCount().get());
+	keys_.bindBase(2);
+	order_.bindBase(3);
+	dispatch_.dispatch(particles_->capacity());
+	keyShader_.unuse();
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// The CPU doesn't know the live count, so the whole pool is sorted, the empty slots last.
+	sorter_.sort(keys_, order_, particles_->capacity(), keyBits);
+}
+
+ShaderStorageBuffer &ParticleDepthSort::order()
+{
+	return order_;
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <Eigen/Dense>
+#include <cstddef>
+#include <string>
+#include "ComputeDispatch.hpp"
+#include "GLBuffer.hpp"
+#include "ParticleSystem.hpp"
+#include "RadixSort.hpp"
+#include "ShaderProgram.hpp"
+
+namespace glhelper {
+
+//!\brief Sorts the live particles of a ParticleSystem back to front on the GPU, for
+//!       blending them in the right order with BillboardQuads::draw.
+//!
+//!       Each particle's distance from the camera is quantised to a 16 bit key
+//!       (ParticleDepthKeys.comp), inverted so the farthest sorts first, and the particle
+//!       indices are sorted by it with a RadixSort. 16 bits over the distances seen in a
+//!       frame is finer than a particle, and takes half the passes of a float key. Slots
+//!       past the live count get the largest key, so the live particles are always the
+//!       first count of the order. Nothing is moved: only the order is written.
+//!
+//!       Usage:
+//!           ParticleDepthSort depthSort(particles, offsetof(Particle, position), dispatch);
+//!           depthSort.sort(viewer.position(), farPlane);
+//!           quads.draw(sortedShader, mode, &depthSort.order());
+//!\note Must be used on the thread owning the GL context.
+class ParticleDepthSort final
+{
+public:
+	//!\param positionOffset Byte offset of each particle's vec4 position, as for BillboardQuads.
+	ParticleDepthSort(ParticleSystem &particles, size_t positionOffset, const ComputeDispatch &dispatch,
+		const std::string &shaderDir = "../shaders/");
+
+	//!\brief Sorts the particles' latest state by distance from cameraPosition, farthest
+	//!       first. Distances beyond maxDistance all sort as maxDistance.
+	void sort(const Eigen::Vector3f &cameraPosition, float maxDistance);
+
+	//!\brief Indices of the particles, farthest first, as of the last sort.
+	ShaderStorageBuffer &order();
+
+private:
+	ParticleDepthSort(const ParticleDepthSort&);
+	ParticleDepthSort &operator=(const ParticleDepthSort&);
+
+	ParticleSystem *particles_;
+	ComputeDispatch dispatch_;
+	ShaderProgram keyShader_;
+	RadixSort sorter_;
+	ShaderStorageBuffer keys_, order_;
+};
+
+}
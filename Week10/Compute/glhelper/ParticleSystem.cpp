@@ -0,0 +1,184 @@
+#include "ParticleSystem.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+// A DrawArraysIndirectCommand: count, instanceCount, first, baseInstance.
+const size_t drawCommandWords = 4;
+
+// Everything a step or emit writes can be read by the next of them or by the draw.
+const GLbitfield writtenBarriers = GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT |
+	GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT;
+
+}
+
+ParticleSystem::ParticleSystem(size_t capacity, size_t particleBytes, ShaderProgram &stepShader, const ComputeDispatch &dispatch)
+	:capacity_(capacity), particleBytes_(particleBytes),
+	stepShader_(&stepShader), dispatch_(dispatch),
+	front_(0), steps_(0), pendingBarriers_(0)
+{
+	const GLuint command[drawCommandWords] = { 0, 1, 0, 0 };
+	buffers_.reserve(2);
+	counts_.reserve(2);
+	for (size_t i = 0; i < 2; ++i) {
+		buffers_.emplace_back(capacity_ * particleBytes_);
+		counts_.emplace_back(drawCommandWords);
+		counts_.back().update(command);
+	}
+	glGenVertexArrays(2, vaos_);
+	for (GLuint vao : vaos_) {
+		GpuMemory::track(GpuResourceType::VERTEX_ARRAY, vao, 0, "ParticleSystem");
+	}
+}
+
+ParticleSystem::ParticleSystem(ParticleSystem &&tmp)
+	:capacity_(tmp.capacity_), particleBytes_(tmp.particleBytes_),
+	stepShader_(tmp.stepShader_), dispatch_(tmp.dispatch_),
+	buffers_(std::move(tmp.buffers_)), counts_(std::move(tmp.counts_)),
+	front_(tmp.front_), steps_(tmp.steps_), pendingBarriers_(tmp.pendingBarriers_)
+{
+	vaos_[0] = tmp.vaos_[0];
+	vaos_[1] = tmp.vaos_[1];
+	tmp.vaos_[0] = tmp.vaos_[1] = 0;
+}
+
+ParticleSystem::~ParticleSystem() throw()
+{
+	for (GLuint vao : vaos_) {
+		if (vao != 0) {
+			GpuMemory::untrack(GpuResourceType::VERTEX_ARRAY, vao);
+			glDeleteVertexArrays(1, &vao);
+		}
+	}
+}
+
+size_t ParticleSystem::capacity() const
+{
+	return capacity_;
+}
+
+size_t ParticleSystem::particleBytes() const
+{
+	return particleBytes_;
+}
+
+void ParticleSystem::upload(const void *state, size_t sizeBytes)
+{
+	if (sizeBytes % particleBytes_ != 0 || sizeBytes > capacity_ * particleBytes_) {
+		throw std::runtime_error("ParticleSystem: uploaded state isn't a whole number of particles within the capacity.");
+	}
+	// Earlier steps may still be reading or writing these.
+	barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	buffers_[front_].update(state, sizeBytes);
+	counts_[front_].clear(0, GLuint(sizeBytes / particleBytes_));
+	// Updates from the CPU are ordered with later commands without a barrier.
+	pendingBarriers_ = 0;
+}
+
+void ParticleSystem::vertexAttribute(GLuint index, GLint components, size_t offset)
+{
+	for (size_t i = 0; i < 2; ++i) {
+		glBindVertexArray(vaos_[i]);
+		glBindBuffer(GL_ARRAY_BUFFER, buffers_[i].get());
+		glEnableVertexAttribArray(index);
+		glVertexAttribPointer(index, components, GL_FLOAT, GL_FALSE, GLsizei(particleBytes_), (void*)offset);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+void ParticleSystem::step(size_t substeps)
+{
+	step(substeps, StepPrepare());
+}
+
+void ParticleSystem::step(size_t substeps, const StepPrepare &prepare)
+{
+	for (size_t i = 0; i < substeps; ++i) {
+		size_t back = 1 - front_;
+		// Each substep reads what the one before wrote, and the clear mustn't overtake the
+		// increments two substeps back.
+		barrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+		if (prepare) {
+			prepare(buffers_[front_]);
+		}
+		counts_[back].clear();
+		stepShader_->use();
+		buffers_[front_].bindBase(0);
+		buffers_[back].bindBase(1);
+		counts_[front_].bindBase(0);
+		counts_[back].bindBase(1);
+		dispatch_.dispatch(capacity_);
+		front_ = back;
+		++steps_;
+		pendingBarriers_ = writtenBarriers;
+		stepShader_->unuse();
+	}
+}
+
+size_t ParticleSystem::steps() const
+{
+	return steps_;
+}
+
+void ParticleSystem::emit(ShaderProgram &emitShader, size_t count)
+{
+	if (count == 0) {
+		return;
+	}
+	// Appends after the latest step's particles, so must see its writes and count.
+	barrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
+	glProgramUniform1ui(emitShader.get(), emitShader.uniformLoc("emitCount"), GLuint(count));
+	emitShader.use();
+	buffers_[front_].bindBase(1);
+	counts_[front_].bindBase(1);
+	dispatch_.dispatch(count);
+	emitShader.unuse();
+	pendingBarriers_ = writtenBarriers;
+}
+
+void ParticleSystem::bindForDraw()
+{
+	barrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	glBindVertexArray(vaos_[front_]);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, counts_[front_].get());
+	RenderStats::recordStateChange();
+}
+
+void ParticleSystem::draw(GLenum mode)
+{
+	glDrawArraysIndirect(mode, nullptr);
+	// Only the GPU knows the count, so this records the most it could be.
+	RenderStats::recordDraw(mode, capacity_);
+}
+
+void ParticleSystem::unbindForDraw()
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+void ParticleSystem::barrier(GLbitfield bits)
+{
+	GLbitfield needed = pendingBarriers_ & bits;
+	if (needed != 0) {
+		glMemoryBarrier(needed);
+		pendingBarriers_ &= ~needed;
+	}
+}
+
+ShaderStorageBuffer &ParticleSystem::front()
+{
+	return buffers_[front_];
+}
+
+AtomicCounterBuffer &ParticleSystem::frontCount()
+{
+	return counts_[front_];
+}
+
+}
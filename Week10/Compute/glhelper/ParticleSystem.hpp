@@ -0,0 +1,125 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "ComputeDispatch.hpp"
+#include "GLBuffer.hpp"
+#include "ShaderProgram.hpp"
+
+namespace glhelper {
+
+//!\brief A pool of particles stepped, spawned and killed by compute shaders, in two
+//!       buffers used in turn, without the CPU ever reading how many are alive.
+//!
+//!       Each substep reads every live particle from one buffer (binding 0) and
+//!       appends the survivors to the other (binding 1), so no invocation ever reads
+//!       a particle another has already moved this step, and the state being drawn
+//!       is never the one being written. Appending through an atomic counter also
+//!       compacts the pool as it goes: the live particles are always the first
+//!       count of their buffer and the free slots all the rest, so a particle is
+//!       killed just by not writing it, and there are no holes to draw or step over.
+//!       The step shader declares:
+//!           layout(std430, binding=0) readonly buffer ParticlesIn { Particle particles[]; } source;
+//!           layout(std430, binding=1) writeonly buffer ParticlesOut { Particle particles[]; } target;
+//!           layout(binding=0, offset=0) uniform atomic_uint sourceCount;
+//!           layout(binding=1, offset=0) uniform atomic_uint targetCount;
+//!       and for each i below atomicCounter(sourceCount) that survives:
+//!           target.particles[atomicCounterIncrement(targetCount)] = particle;
+//!
+//!       Each buffer's counter is the count field of a DrawArraysIndirectCommand, so
+//!       draw passes it straight to glDrawArraysIndirect. The CPU doesn't know the
+//!       count, so steps are dispatched over the whole capacity and invocations past
+//!       the count return straight away.
+//!
+//!       Barriers are only issued where the results are next used, and only for
+//!       that use: shader storage and atomic counter barriers between substeps, and
+//!       GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT in bindForDraw.
+//!       Calling step after the frame's draw, rather than before it, means the draw
+//!       reads what the last frame's step wrote, which the GPU has usually finished,
+//!       so the barrier seldom has anything to wait for.
+//!
+//!       Usage:
+//!           ParticleSystem particles(capacity, sizeof(Particle), stepShader, dispatch);
+//!           particles.upload(initialParticles);
+//!           particles.vertexAttribute(0, 4, offsetof(Particle, position));
+//!           while (...) {
+//!               particles.bindForDraw();
+//!               particles.draw(GL_POINTS);
+//!               particles.unbindForDraw();
+//!               particles.step(substeps);
+//!           }
+//!\note Must be used on the thread owning the GL context.
+class ParticleSystem final
+{
+public:
+	//!\param stepShader Compute shader run for each substep, compiled with dispatch.defines().
+	ParticleSystem(size_t capacity, size_t particleBytes, ShaderProgram &stepShader, const ComputeDispatch &dispatch);
+	ParticleSystem(ParticleSystem &&tmp);
+	~ParticleSystem() throw();
+
+	//!\brief The most particles that can be alive at once.
+	size_t capacity() const;
+	size_t particleBytes() const;
+
+	//!\brief Replaces the pool with state, which may hold up to capacity() particles.
+	template<typename T>
+	void upload(const std::vector<T> &state)
+	{
+		upload(state.data(), state.size() * sizeof(T));
+	}
+	void upload(const void *state, size_t sizeBytes);
+
+	//!\brief Draws the particles with a float attribute of each particle as vertex attribute index.
+	void vertexAttribute(GLuint index, GLint components, size_t offset);
+
+	//!\brief Runs the step shader substeps times, swapping buffers after each.
+	//!       The shader's uniforms (e.g. a time step divided by substeps) should be set first.
+	void step(size_t substeps = 1);
+	//!\brief Work to do on the latest state before each substep reads it, e.g. building an
+	//!       acceleration structure over it. Runs after the substep's barrier, so it can read
+	//!       the state straight away, and before the step shader's buffers are bound.
+	typedef std::function<void(ShaderStorageBuffer &latest)> StepPrepare;
+	void step(size_t substeps, const StepPrepare &prepare);
+	size_t steps() const;
+
+	//!\brief Runs emitShader for count invocations to append new particles to the latest state.
+	//!       It is compiled with the same dispatch.defines() as the step shader, writes to target
+	//!       and targetCount as the step shader does, and gets count as the uniform uint emitCount.
+	//!       Particles that don't fit are dropped: an invocation whose slot is past the end
+	//!       should give it back with atomicCounterDecrement and return.
+	void emit(ShaderProgram &emitShader, size_t count);
+
+	//!\brief Waits for the latest writes to be visible to vertex fetching and indirect
+	//!       draws, and binds the vertex array and draw command for the latest state.
+	void bindForDraw();
+	//!\brief Draws every live particle with glDrawArraysIndirect. Call between bindForDraw
+	//!       and unbindForDraw.
+	void draw(GLenum mode);
+	void unbindForDraw();
+
+	//!\brief Issues a barrier for whichever of bits the latest writes still need,
+	//!       e.g. GL_BUFFER_UPDATE_BARRIER_BIT before copying front() somewhere.
+	void barrier(GLbitfield bits);
+
+	//!\brief Buffer holding the latest state, e.g. to read back.
+	ShaderStorageBuffer &front();
+	//!\brief The latest state's DrawArraysIndirectCommand, which starts with the live count.
+	AtomicCounterBuffer &frontCount();
+
+private:
+	ParticleSystem(const ParticleSystem&);
+	ParticleSystem &operator=(const ParticleSystem&);
+
+	size_t capacity_, particleBytes_;
+	ShaderProgram *stepShader_;
+	ComputeDispatch dispatch_;
+	std::vector<ShaderStorageBuffer> buffers_;
+	std::vector<AtomicCounterBuffer> counts_;
+	GLuint vaos_[2];
+	size_t front_, steps_;
+	GLbitfield pendingBarriers_;
+};
+
+}
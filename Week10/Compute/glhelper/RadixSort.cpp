@@ -0,0 +1,138 @@
+#include "RadixSort.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+// Must match RadixSort.glsl.
+const GLuint radixBits = 4, radix = 16;
+const GLuint sortWorkgroup = 256, blockKeys = sortWorkgroup * 8, scanBlock = sortWorkgroup * 4;
+
+size_t keyBytes(RadixSort::KeyType keyType)
+{
+	return keyType == RadixSort::KeyType::UINT64 ? 2 * sizeof(GLuint) : sizeof(GLuint);
+}
+
+// The histogram and scatter shaders read the keys; the scan only sees counts.
+ShaderDefines keyDefines(RadixSort::KeyType keyType)
+{
+	return ShaderDefines{ { "KEY_WORDS", std::to_string(keyBytes(keyType) / sizeof(GLuint)) } };
+}
+
+size_t blocksFor(size_t items, size_t blockSize)
+{
+	return (items + blockSize - 1) / blockSize;
+}
+
+}
+
+RadixSort::RadixSort(size_t maxItems, const std::string &shaderDir, KeyType keyType)
+	:maxItems_(std::max(maxItems, size_t(1))),
+	keyType_(keyType),
+	dispatch_(sortWorkgroup),
+	histogramShader_({ shaderDir + "RadixHistogram.comp" }, keyDefines(keyType)),
+	scanShader_({ shaderDir + "RadixScan.comp" }),
+	scanAddShader_({ shaderDir + "RadixScanAdd.comp" }),
+	scatterShader_({ shaderDir + "RadixScatter.comp" }, keyDefines(keyType)),
+	keysTemp_(maxItems_ * keyBytes(keyType)),
+	valuesTemp_(maxItems_ * sizeof(GLuint)),
+	histogram_(radix * blocksFor(maxItems_, blockKeys) * sizeof(GLuint))
+{
+	size_t items = radix * blocksFor(maxItems_, blockKeys);
+	do {
+		items = blocksFor(items, scanBlock);
+		scanSums_.emplace_back(items * sizeof(GLuint));
+	} while (items > 1);
+}
+
+size_t RadixSort::maxItems() const
+{
+	return maxItems_;
+}
+
+RadixSort::KeyType RadixSort::keyType() const
+{
+	return keyType_;
+}
+
+void RadixSort::sort(ShaderStorageBuffer &keys, ShaderStorageBuffer &values, size_t count, unsigned keyBits)
+{
+	if (count > maxItems_) {
+		throw std::runtime_error("RadixSort: asked to sort more keys than it was made for.");
+	}
+	if (count < 2) {
+		return;
+	}
+	GLuint blocks = GLuint(blocksFor(count, blockKeys));
+	for (ShaderProgram *program : { &histogramShader_, &scatterShader_ }) {
+		glProgramUniform1ui(program->get(), program->uniformLoc("count"), GLuint(count));
+		glProgramUniform1ui(program->get(), program->uniformLoc("blocks"), blocks);
+	}
+
+	ShaderStorageBuffer *keysIn = &keys, *valuesIn = &values, *keysOut = &keysTemp_, *valuesOut = &valuesTemp_;
+	unsigned passes = (std::min(keyBits, unsigned(8 * keyBytes(keyType_))) + radixBits - 1) / radixBits;
+	for (unsigned pass = 0; pass < passes; ++pass) {
+		GLuint shift = pass * radixBits;
+
+		glProgramUniform1ui(histogramShader_.get(), histogramShader_.uniformLoc("shift"), shift);
+		histogramShader_.use();
+		keysIn->bindBase(0);
+		histogram_.bindBase(2);
+		dispatch_.dispatch(size_t(blocks) * sortWorkgroup);
+		histogramShader_.unuse();
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		scan(histogram_, size_t(radix) * blocks, 0);
+
+		glProgramUniform1ui(scatterShader_.get(), scatterShader_.uniformLoc("shift"), shift);
+		scatterShader_.use();
+		keysIn->bindBase(0);
+		valuesIn->bindBase(1);
+		histogram_.bindBase(2);
+		keysOut->bindBase(3);
+		valuesOut->bindBase(4);
+		dispatch_.dispatch(size_t(blocks) * sortWorkgroup);
+		scatterShader_.unuse();
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		std::swap(keysIn, keysOut);
+		std::swap(valuesIn, valuesOut);
+	}
+
+	// An odd number of passes leaves the results in the temporary buffers.
+	if (keysIn != &keys) {
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		keys.copyFrom(*keysIn, count * keyBytes(keyType_));
+		values.copyFrom(*valuesIn, count * sizeof(GLuint));
+	}
+}
+
+void RadixSort::scan(ShaderStorageBuffer &data, size_t count, size_t level)
+{
+	size_t blocks = blocksFor(count, scanBlock);
+	ShaderStorageBuffer &sums = scanSums_[level];
+
+	glProgramUniform1ui(scanShader_.get(), scanShader_.uniformLoc("count"), GLuint(count));
+	scanShader_.use();
+	data.bindBase(0);
+	sums.bindBase(1);
+	dispatch_.dispatch(blocks * sortWorkgroup);
+	scanShader_.unuse();
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	if (blocks > 1) {
+		scan(sums, blocks, level + 1);
+
+		glProgramUniform1ui(scanAddShader_.get(), scanAddShader_.uniformLoc("count"), GLuint(count));
+		scanAddShader_.use();
+		data.bindBase(0);
+		sums.bindBase(1);
+		dispatch_.dispatch(count);
+		scanAddShader_.unuse();
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+}
+
+}
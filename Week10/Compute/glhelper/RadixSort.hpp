@@ -0,0 +1,75 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "ComputeDispatch.hpp"
+#include "GLBuffer.hpp"
+#include "ShaderProgram.hpp"
+
+namespace glhelper {
+
+//!\brief Sorts 32 or 64 bit unsigned keys on the GPU, moving a uint value with each, e.g.
+//!       to put particle indices in the order of their Morton codes or depths.
+//!
+//!       An LSD radix sort: each pass sorts stably on the next 4 bits of the keys,
+//!       in three steps.
+//!       1. Each block of keys counts the keys it has with each digit (RadixHistogram.comp).
+//!       2. Those counts are scanned, with a scan-then-propagate over as many levels
+//!          as needed: each block is scanned in place and its total saved, the totals
+//!          are scanned the same way, and then added back onto their blocks
+//!          (RadixScan.comp and RadixScanAdd.comp). A reduce-then-scan would only sum
+//!          the blocks in its first pass, saving one write of the counts, but they're
+//!          small next to the keys, so the simpler scheme is kept.
+//!       3. Each key is written to the slot that gives it (RadixScatter.comp).
+//!       Keys only sorted on their low bits (e.g. 30 bit Morton codes) take fewer passes.
+//!       64 bit keys take twice the passes of 32 bit ones, each moving half as many keys
+//!       again, so only use them for keys that need the bits (e.g. a draw key packing a
+//!       depth with a material). radix_sort_bench measures the keys per second of both.
+//!
+//!       The shaders are loaded from shaderDir, by default ../shaders/ as the labs
+//!       are run from their build directory.
+//!\note Must be used on the thread owning the GL context.
+class RadixSort final
+{
+public:
+	enum class KeyType {
+		//!\brief uint keys.
+		UINT32,
+		//!\brief uint64_t keys; a uvec2 in shaders, the low word first.
+		UINT64
+	};
+
+	//!\param maxItems The most keys any one sort will be given.
+	//!\param keyType The keys every sort will be given.
+	explicit RadixSort(size_t maxItems, const std::string &shaderDir = "../shaders/",
+		KeyType keyType = KeyType::UINT32);
+
+	size_t maxItems() const;
+	KeyType keyType() const;
+
+	//!\brief Sorts the first count keys, by their lowest keyBits bits (all of them, by
+	//!       default), and values with them. The keys are of keyType(), the values uints, and
+	//!       both must have been written before any barrier this needs (e.g.
+	//!       GL_SHADER_STORAGE_BARRIER_BIT if they were written by a shader).
+	//!       The results can be read by shaders afterwards without another barrier.
+	void sort(ShaderStorageBuffer &keys, ShaderStorageBuffer &values, size_t count, unsigned keyBits = 64);
+
+private:
+	RadixSort(const RadixSort&);
+	RadixSort &operator=(const RadixSort&);
+
+	//!\brief Exclusive prefix sum of the first count uints of data, in place.
+	void scan(ShaderStorageBuffer &data, size_t count, size_t level);
+
+	size_t maxItems_;
+	KeyType keyType_;
+	ComputeDispatch dispatch_;
+	ShaderProgram histogramShader_, scanShader_, scanAddShader_, scatterShader_;
+	ShaderStorageBuffer keysTemp_, valuesTemp_, histogram_;
+	//!\brief Block totals for each level of the scan.
+	std::vector<ShaderStorageBuffer> scanSums_;
+};
+
+}
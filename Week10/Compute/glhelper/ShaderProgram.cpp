@@ -1,4 +1,6 @@
 #include "ShaderProgram.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
 #include <Eigen/Dense>
 #ifdef _WIN32
 #include <Windows.h>
@@ -51,7 +53,8 @@ std::string glErrToString(GLenum err)
 ShaderProgram::ShaderProgram(
 	const std::vector<std::string> &sources,
 	const std::vector<std::string> *transformFeedbackVaryings,
-	TFMode tfMode)
+	TFMode tfMode,
+	const ShaderDefines &defines)
 	:program_(0)
 {
 	std::vector<GLenum> types;
@@ -59,24 +62,45 @@ ShaderProgram::ShaderProgram(
 	for(const std::string &s : sources) {
 		types.push_back(shaderTypeFromFilename(s));
 	}
-	program_ = makeShaderProgram(sources, types, transformFeedbackVaryings, tfMode);
+	program_ = makeShaderProgram(sources, types, transformFeedbackVaryings, tfMode, defines);
 
 	filenames << "\"" << sources[0] << "\"";
 	for (size_t i = 1; i < sources.size(); ++i) {
 		filenames << ", \"" << sources[i] << "\"";
 	}
 	filenames_ = filenames.str();
+
+	GLint binaryLength = 0;
+	glGetProgramiv(program_, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	GpuMemory::track(GpuResourceType::PROGRAM, program_, size_t(binaryLength), "program " + filenames_);
 }
 
+ShaderProgram::ShaderProgram(const std::vector<std::string> &sources, const ShaderDefines &defines)
+	:ShaderProgram(sources, nullptr, TFMode::INTERLEAVED_ATTRIBS, defines)
+{}
+
 ShaderProgram::ShaderProgram(ShaderProgram &&other)
+	:uniforms_(std::move(other.uniforms_)),
+	notfound_(std::move(other.notfound_)),
+	program_(other.program_),
+	filenames_(std::move(other.filenames_))
 {
-	this->program_ = other.program_;
 	other.program_ = 0;
 }
 
 ShaderProgram & ShaderProgram::operator=(ShaderProgram &&other)
 {
-	this->program_ = other.program_;
+	if (this == &other) {
+		return *this;
+	}
+	if (program_ != 0) {
+		GpuMemory::untrack(GpuResourceType::PROGRAM, program_);
+		glDeleteProgram(program_);
+	}
+	uniforms_ = std::move(other.uniforms_);
+	notfound_ = std::move(other.notfound_);
+	program_ = other.program_;
+	filenames_ = std::move(other.filenames_);
 	other.program_ = 0;
 	return *this;
 }
@@ -84,6 +108,7 @@ ShaderProgram & ShaderProgram::operator=(ShaderProgram &&other)
 ShaderProgram::~ShaderProgram() throw()
 {
 	if (program_ != 0) {
+		GpuMemory::untrack(GpuResourceType::PROGRAM, program_);
 		glDeleteProgram(program_);
 	}
 }
@@ -91,6 +116,7 @@ ShaderProgram::~ShaderProgram() throw()
 void ShaderProgram::use()
 {
 	glUseProgram(program_);
+	RenderStats::recordStateChange();
 }
 
 void ShaderProgram::unuse()
@@ -153,11 +179,11 @@ GLint ShaderProgram::uniformLoc(const std::string &name)
 	return loc;
 }
 
-GLuint ShaderProgram::compileShader(const std::string &filename, GLenum type)
+GLuint ShaderProgram::compileShader(const std::string &filename, GLenum type, const ShaderDefines &defines)
 {
 	GLuint shader = glCreateShader(type);
 	std::string source = getFileContents(filename);
-	std::string preprocessedSource = ShaderProgram::preprocessSource(source, filename);
+	std::string preprocessedSource = addDefines(ShaderProgram::preprocessSource(source, filename), defines);
 	const char* cSource = preprocessedSource.c_str();
 	glShaderSource(shader, 1, &cSource, 0);
 	glCompileShader(shader);
@@ -242,7 +268,8 @@ GLuint ShaderProgram::makeShaderProgram(
 	const std::vector<std::string> &files,
 	const std::vector<GLenum> &types,
 	const std::vector<std::string> *tfFeedbackVaryings,
-	TFMode tfMode)
+	TFMode tfMode,
+	const ShaderDefines &defines)
 {
 	if (files.size() != types.size()) {
 		throw std::runtime_error(
@@ -251,7 +278,7 @@ GLuint ShaderProgram::makeShaderProgram(
 	
 	std::vector<GLuint> shaders(files.size());
 	for (size_t i = 0; i < files.size(); ++i) {
-		shaders[i] = compileShader(files[i], types[i]);
+		shaders[i] = compileShader(files[i], types[i], defines);
 		checkForGLError("Error encountered compiling shaders.");
 	}
 	
@@ -407,4 +434,25 @@ std::string ShaderProgram::preprocessSource(const std::string &source, const std
 	return processedSource.str();
 }
 
+std::string ShaderProgram::addDefines(const std::string &source, const ShaderDefines &defines)
+{
+	if (defines.empty()) {
+		return source;
+	}
+	std::string lines;
+	for (const std::pair<const std::string, std::string> &d : defines) {
+		lines += "#define " + d.first + " " + d.second + "\n";
+	}
+	// #version has to come first, so the defines go on the line after it.
+	size_t version = source.find("#version");
+	if (version == std::string::npos) {
+		return lines + source;
+	}
+	size_t lineEnd = source.find('\n', version);
+	if (lineEnd == std::string::npos) {
+		return source + "\n" + lines;
+	}
+	return source.substr(0, lineEnd + 1) + lines + source.substr(lineEnd + 1);
+}
+
 }
@@ -12,6 +12,9 @@ void checkForGLError(const std::string &exception = "OpenGL error encountered!")
 
 std::string glErrToString(GLenum err);
 
+//!\brief Macros defined at the top of every shader in a program, by name.
+typedef std::map<std::string, std::string> ShaderDefines;
+
 //!\brief Class representing a compiled and linked OpenGL shader program.
 class ShaderProgram final
 {
@@ -20,7 +23,11 @@ public:
 
 	ShaderProgram(const std::vector<std::string> &sources,
 		const std::vector<std::string> *transformFeedbackVaryings = nullptr,
-		TFMode tfMode = TFMode::INTERLEAVED_ATTRIBS);
+		TFMode tfMode = TFMode::INTERLEAVED_ATTRIBS,
+		const ShaderDefines &defines = ShaderDefines());
+	//!\brief Compiles each shader with a #define for each of defines, straight after its
+	//!       #version line, e.g. to set a compute shader's workgroup size at run time.
+	ShaderProgram(const std::vector<std::string> &sources, const ShaderDefines &defines);
 	ShaderProgram(ShaderProgram &&);
 	ShaderProgram &operator=(ShaderProgram &&);
 	~ShaderProgram() throw();
@@ -48,7 +55,8 @@ private:
 	GLuint program_;
 
 	static std::string preprocessSource(const std::string &source, const std::string &sourcePath);
-	static GLuint compileShader(const std::string &filename, GLenum type);
+	static std::string addDefines(const std::string &source, const ShaderDefines &defines);
+	static GLuint compileShader(const std::string &filename, GLenum type, const ShaderDefines &defines);
 	static GLuint makeShaderProgram(
 		const std::vector<GLuint> &shaders,
 		const std::vector<std::string> *tfFeedbackVaryings,
@@ -57,7 +65,8 @@ private:
 		const std::vector<std::string> &files,
 		const std::vector<GLenum> &types,
 		const std::vector<std::string> *tfFeedbackVaryings,
-		TFMode tfMode);
+		TFMode tfMode,
+		const ShaderDefines &defines);
 	static bool setupUniformBlock(
 		GLuint shaderProgram, const std::string &name, GLuint index);
 	static void setupCameraBlock(GLuint shaderProgram);
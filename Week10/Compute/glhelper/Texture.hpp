@@ -31,6 +31,8 @@ public:
 	void getData(void *data, size_t mipmapLevel, size_t buffSize);
 	void saveToFile(const std::string &filepath);
 
+	GLenum format() const;
+	GLenum type() const;
 	size_t width() const;
 	size_t height() const;
 	size_t maxLevels() const;
@@ -0,0 +1,150 @@
+#include "WeightedBlendedOit.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+GLuint makeTarget(GLenum internalFormat, GLsizei width, GLsizei height, const char *description)
+{
+	GLuint tex = 0;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GpuMemory::track(GpuResourceType::TEXTURE, tex, size_t(width) * size_t(height) * GpuMemory::texelBytes(internalFormat),
+		description);
+	return tex;
+}
+
+void deleteTarget(GLuint tex)
+{
+	if (tex != 0) {
+		GpuMemory::untrack(GpuResourceType::TEXTURE, tex);
+		glDeleteTextures(1, &tex);
+	}
+}
+
+}
+
+WeightedBlendedOit::WeightedBlendedOit(GLsizei width, GLsizei height, const std::string &shaderDir)
+	:width_(width), height_(height),
+	compositeShader_({ shaderDir + "OitComposite.vert", shaderDir + "OitComposite.frag" }),
+	accumulation_(makeTarget(GL_RGBA16F, width, height, "OIT accumulation")),
+	revealage_(makeTarget(GL_R16F, width, height, "OIT revealage")),
+	depth_(makeTarget(GL_DEPTH24_STENCIL8, width, height, "OIT depth")),
+	framebuffer_(0), vao_(0)
+{
+	// Leaves whatever framebuffer is being drawn to bound.
+	GLint previous = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	glGenFramebuffers(1, &framebuffer_);
+	GpuMemory::track(GpuResourceType::FRAMEBUFFER, framebuffer_, 0, "WeightedBlendedOit");
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulation_, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealage_, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth_, 0);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previous));
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		GpuMemory::untrack(GpuResourceType::FRAMEBUFFER, framebuffer_);
+		glDeleteFramebuffers(1, &framebuffer_);
+		deleteTarget(accumulation_);
+		deleteTarget(revealage_);
+		deleteTarget(depth_);
+		throw std::runtime_error("WeightedBlendedOit: the targets don't make a complete framebuffer.");
+	}
+	// The composite's triangle has no attributes, but core profile draws need a vertex array.
+	glGenVertexArrays(1, &vao_);
+	GpuMemory::track(GpuResourceType::VERTEX_ARRAY, vao_, 0, "WeightedBlendedOit");
+}
+
+WeightedBlendedOit::WeightedBlendedOit(WeightedBlendedOit &&tmp)
+	:width_(tmp.width_), height_(tmp.height_),
+	compositeShader_(std::move(tmp.compositeShader_)),
+	accumulation_(tmp.accumulation_), revealage_(tmp.revealage_), depth_(tmp.depth_),
+	framebuffer_(tmp.framebuffer_), vao_(tmp.vao_)
+{
+	tmp.accumulation_ = 0;
+	tmp.revealage_ = 0;
+	tmp.depth_ = 0;
+	tmp.framebuffer_ = 0;
+	tmp.vao_ = 0;
+}
+
+WeightedBlendedOit::~WeightedBlendedOit() throw()
+{
+	if (vao_ != 0) {
+		GpuMemory::untrack(GpuResourceType::VERTEX_ARRAY, vao_);
+		glDeleteVertexArrays(1, &vao_);
+	}
+	if (framebuffer_ != 0) {
+		GpuMemory::untrack(GpuResourceType::FRAMEBUFFER, framebuffer_);
+		glDeleteFramebuffers(1, &framebuffer_);
+	}
+	deleteTarget(accumulation_);
+	deleteTarget(revealage_);
+	deleteTarget(depth_);
+}
+
+void WeightedBlendedOit::begin(GLuint opaqueFramebuffer)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, opaqueFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer_);
+	glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+
+	// Nothing accumulated, and everything behind revealed.
+	const GLfloat noColour[4] = { 0.f, 0.f, 0.f, 0.f }, revealed[4] = { 1.f, 0.f, 0.f, 0.f };
+	glClearBufferfv(GL_COLOR, 0, noColour);
+	glClearBufferfv(GL_COLOR, 1, revealed);
+
+	glEnable(GL_BLEND);
+	glBlendFunci(0, GL_ONE, GL_ONE);
+	glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+	RenderStats::recordStateChange();
+}
+
+void WeightedBlendedOit::end(GLuint targetFramebuffer)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+	glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+	// The triangle covers everything: the depth test would only compare it with itself.
+	glDisable(GL_DEPTH_TEST);
+	compositeShader_.use();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, accumulation_);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, revealage_);
+	glBindVertexArray(vao_);
+	RenderStats::recordStateChange();
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	RenderStats::recordDraw(GL_TRIANGLES, 3, 1);
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	compositeShader_.unuse();
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+}
+
+GLsizei WeightedBlendedOit::width() const
+{
+	return width_;
+}
+
+GLsizei WeightedBlendedOit::height() const
+{
+	return height_;
+}
+
+}
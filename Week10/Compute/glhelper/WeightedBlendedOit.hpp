@@ -0,0 +1,58 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+#include "ShaderProgram.hpp"
+
+namespace glhelper {
+
+//!\brief Weighted blended order-independent transparency (McGuire and Bavoil, 2013): draws
+//!       transparent surfaces in any order, without sorting them, into two targets, then
+//!       composites them over the opaque image.
+//!
+//!       Each fragment adds its premultiplied colour, weighted by a function of depth, to an
+//!       RGBA16F accumulation target, and multiplies its transparency into an R16F revealage
+//!       target (see shaders/BillboardParticleOit.frag). The composite (OitComposite.frag)
+//!       divides the summed colour by the summed coverage and lets the opaque image through
+//!       as much as the revealage says. The result is an approximation: the colours are
+//!       averaged with the nearer ones favoured, rather than layered, so it's closest to the
+//!       sorted result where the layers are similar or faint.
+//!
+//!       Depth testing against the opaque surfaces works by copying their depth in; the
+//!       transparent surfaces don't write depth.
+//!
+//!       Usage:
+//!           oit.begin(0);                        // after the opaque pass into framebuffer 0
+//!           quads.draw(oitShader, mode);         // with BillboardParticleOit.frag
+//!           oit.end(0);
+//!\note Must be used on the thread owning the GL context.
+class WeightedBlendedOit final
+{
+public:
+	WeightedBlendedOit(GLsizei width, GLsizei height, const std::string &shaderDir = "../shaders/");
+	WeightedBlendedOit(WeightedBlendedOit &&tmp);
+	~WeightedBlendedOit() throw();
+
+	//!\brief Clears the targets, copies depth from the opaque pass and leaves them bound, with
+	//!       the blending the transparent pass needs.
+	//!\param opaqueFramebuffer Where the opaque surfaces were drawn, the same size as the
+	//!       targets, with a GL_DEPTH24_STENCIL8 depth buffer (multisampled or not).
+	void begin(GLuint opaqueFramebuffer);
+
+	//!\brief Composites the transparent pass over targetFramebuffer, leaving it bound with
+	//!       depth testing and depth writes on. The blend function is left for the caller to set.
+	void end(GLuint targetFramebuffer);
+
+	GLsizei width() const;
+	GLsizei height() const;
+
+private:
+	WeightedBlendedOit(const WeightedBlendedOit&);
+	WeightedBlendedOit &operator=(const WeightedBlendedOit&);
+
+	GLsizei width_, height_;
+	ShaderProgram compositeShader_;
+	GLuint accumulation_, revealage_, depth_, framebuffer_, vao_;
+};
+
+}
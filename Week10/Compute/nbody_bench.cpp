@@ -0,0 +1,179 @@
+#include <GL/glew.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "glhelper/ComputeDispatch.hpp"
+#include "glhelper/JobSystem.hpp"
+#include "glhelper/ParticleSystem.hpp"
+#include "glhelper/ShaderProgram.hpp"
+#include "HeadlessContext.hpp"
+#include "ToolArgs.hpp"
+#include "NBodyBodies.hpp"
+
+/* Times the tiled N-body compute shader (NBody.comp), in which every body attracts every other, and checks it
+* conserves energy as well as the same integration done on the CPU in double precision.
+*
+* Throughput is given as body-body interactions per second, and as GFLOP/s counting 20 floating point
+* operations per interaction (the usual convention, with the reciprocal square root counted as 4), so it can be
+* compared with the device's peak. Like ring_sweep, it runs headless through EGL and times steps on the GPU with
+* GL_TIMESTAMP queries.
+*
+* The bodies start spread evenly through a sphere, with random velocities scaled so the system is in virial
+* equilibrium (twice the kinetic energy equals minus the potential energy) and so doesn't collapse. Units have
+* G = 1, a total mass of 1 and a radius of 1.
+*
+* Usage:
+*     nbody_bench [--bodies N,N,...] [--workgroups N,N,...] [--steps N] [--softening E] [--time-step T]
+*                 [--validate N] [--validate-steps N] [--tolerance T] [--csv FILE]
+* The validation runs --validate bodies (default 2048) for --validate-steps steps (default 200) on both, and fails
+* (exit code 1) if the GPU's relative energy error is more than --tolerance (default 1e-3) worse than the CPU's.
+* Results also go to nbody_bench.csv. Run from the build directory so the ../shaders path resolves.
+*/
+
+const double flopsPerInteraction = 20.0;
+const size_t warmupSteps = 2;
+
+void setUniforms(glhelper::ShaderProgram &program, float softening, float timeStep)
+{
+	glProgramUniform1f(program.get(), program.uniformLoc("gravitationalConstant"), 1.f);
+	glProgramUniform1f(program.get(), program.uniformLoc("timeStep"), timeStep);
+	glProgramUniform1f(program.get(), program.uniformLoc("softening"), softening);
+}
+
+//!\brief GPU time of one step, in milliseconds, averaged over steps.
+double timeSteps(glhelper::ParticleSystem &bodies, size_t steps)
+{
+	bodies.step(warmupSteps);
+	GLuint queries[2];
+	glGenQueries(2, queries);
+	glQueryCounter(queries[0], GL_TIMESTAMP);
+	bodies.step(steps);
+	bodies.barrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	glQueryCounter(queries[1], GL_TIMESTAMP);
+	GLuint64 start = 0, end = 0;
+	glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+	glDeleteQueries(2, queries);
+	return double(end - start) * 1e-6 / double(steps);
+}
+
+int main(int argc, char *argv[])
+{
+	try {
+		HeadlessContext context;
+		std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+
+		std::vector<double> defaultWorkgroups;
+		for (GLuint w = 64; w <= glhelper::ComputeDispatch::maxWorkgroupSize() && w <= 512; w *= 2) {
+			defaultWorkgroups.push_back(double(w));
+		}
+		std::vector<double> counts = numberListArg(argc, argv, "--bodies", { 1024, 4096, 16384, 65536 });
+		std::vector<double> workgroups = numberListArg(argc, argv, "--workgroups", defaultWorkgroups);
+		size_t steps = size_t(numberArg(argc, argv, "--steps", 10));
+		float softening = float(numberArg(argc, argv, "--softening", 0.05));
+		float timeStep = float(numberArg(argc, argv, "--time-step", 1e-3));
+		size_t validateBodies = size_t(numberArg(argc, argv, "--validate", 2048));
+		size_t validateSteps = size_t(numberArg(argc, argv, "--validate-steps", 200));
+		double tolerance = numberArg(argc, argv, "--tolerance", 1e-3);
+		std::string csvPath = "nbody_bench.csv";
+		for (int i = 1; i + 1 < argc; ++i) {
+			if (std::string(argv[i]) == "--csv") {
+				csvPath = argv[i + 1];
+			}
+		}
+		if (!(softening > 0.f)) {
+			throw std::runtime_error("The softening length must be above zero.");
+		}
+
+		std::vector<glhelper::ComputeDispatch> dispatches;
+		std::vector<std::unique_ptr<glhelper::ShaderProgram>> programs;
+		for (double w : workgroups) {
+			dispatches.emplace_back(GLuint(w));
+			programs.emplace_back(new glhelper::ShaderProgram({ "../shaders/NBody.comp" }, dispatches.back().defines()));
+			setUniforms(*programs.back(), softening, timeStep);
+		}
+
+		std::ofstream csv(csvPath);
+		if (!csv) {
+			throw std::runtime_error("Couldn't open " + csvPath + " for writing.");
+		}
+		csv << "bodies,workgroup,step_ms,interactions_per_s,gflops\n";
+
+		char line[320];
+		snprintf(line, sizeof(line), "%8s %9s %10s %14s %8s\n", "bodies", "workgroup", "step ms", "Ginteract/s", "GFLOP/s");
+		std::cout << line;
+		glhelper::JobSystem jobs;
+		for (double count : counts) {
+			size_t n = size_t(count);
+			std::vector<Body> bodies = makeBodies(jobs, n, softening);
+			double best = 0.0;
+			size_t bestWorkgroup = 0;
+			for (size_t i = 0; i < workgroups.size(); ++i) {
+				glhelper::ParticleSystem system(n, sizeof(Body), *programs[i], dispatches[i]);
+				system.upload(bodies);
+				double ms = timeSteps(system, steps);
+				// Each body's pull on itself is worked out too (and comes to nothing), so it's n * n.
+				double interactions = ms > 0.0 ? double(n) * double(n) / (ms * 1e-3) : 0.0;
+				double gflops = interactions * flopsPerInteraction * 1e-9;
+				snprintf(line, sizeof(line), "%8zu %9zu %10.3f %14.3f %8.1f\n", n, size_t(workgroups[i]), ms, interactions * 1e-9, gflops);
+				std::cout << line;
+				snprintf(line, sizeof(line), "%zu,%zu,%.5f,%.0f,%.3f\n", n, size_t(workgroups[i]), ms, interactions, gflops);
+				csv << line;
+				if (interactions > best) {
+					best = interactions;
+					bestWorkgroup = size_t(workgroups[i]);
+				}
+			}
+			std::cout << "  fastest: workgroups of " << bestWorkgroup << "\n";
+		}
+		std::cout << "Wrote " << csvPath << "\n\n";
+
+		if (validateBodies == 0) {
+			return 0;
+		}
+		// Validate with the device's preferred workgroup size.
+		glhelper::ComputeDispatch dispatch;
+		glhelper::ShaderProgram program({ "../shaders/NBody.comp" }, dispatch.defines());
+		setUniforms(program, softening, timeStep);
+		std::vector<Body> initial = makeBodies(jobs, validateBodies, softening);
+		glhelper::ParticleSystem system(validateBodies, sizeof(Body), program, dispatch);
+		system.upload(initial);
+		system.step(validateSteps);
+		system.barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		std::vector<Body> gpu(validateBodies);
+		system.front().getData(gpu.data());
+
+		BodiesD start = toDouble(initial), cpu = start, gpuD = toDouble(gpu);
+		for (size_t s = 0; s < validateSteps; ++s) {
+			cpuStep(jobs, cpu, softening, timeStep);
+		}
+		double e0 = kineticEnergy(start) + potentialEnergy(jobs, start, softening);
+		double eCpu = kineticEnergy(cpu) + potentialEnergy(jobs, cpu, softening);
+		double eGpu = kineticEnergy(gpuD) + potentialEnergy(jobs, gpuD, softening);
+		double cpuError = std::abs((eCpu - e0) / e0), gpuError = std::abs((eGpu - e0) / e0);
+		double sumSq = 0.0;
+		for (size_t i = 0; i < validateBodies; ++i) {
+			sumSq += (gpuD.position[i] - cpu.position[i]).squaredNorm();
+		}
+		bool passed = gpuError <= cpuError + tolerance;
+		snprintf(line, sizeof(line),
+			"Energy after %zu steps of %zu bodies: start %.8f, CPU (double) %.8f (error %.2e), GPU %.8f (error %.2e)\n"
+			"RMS position difference from the CPU: %.2e\n%s\n",
+			validateSteps, validateBodies, e0, eCpu, cpuError, eGpu, gpuError,
+			std::sqrt(sumSq / double(validateBodies)), passed ? "Validation passed." : "Validation FAILED.");
+		std::cout << line;
+		return passed ? 0 : 1;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
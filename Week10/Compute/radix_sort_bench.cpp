@@ -0,0 +1,133 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "glhelper/GLBuffer.hpp"
+#include "glhelper/RadixSort.hpp"
+#include "HeadlessContext.hpp"
+#include "ToolArgs.hpp"
+
+/* Times glhelper::RadixSort on random 32 and 64 bit keys, each with a uint value (its starting index), over a range
+* of sizes, and checks every result against std::stable_sort on the CPU.
+*
+* Throughput is given in keys sorted per second. Each sort starts from the same unsorted keys, copied in before the
+* clock starts, and is timed from one glFinish to the next: the sort is a chain of dependent dispatches, so that is
+* what a caller waiting on it sees. A radix sort's cost is linear in the keys and the passes, so keys per second
+* should level off once there are enough blocks of keys to fill the GPU; below that the fixed cost of each pass's
+* dispatches and barriers dominates.
+*
+* Usage:
+*     radix_sort_bench [--keys N,N,...] [--bits 32,64] [--runs N] [--csv FILE]
+* By default it sorts 10k, 100k and 1M keys of both sizes, 5 runs each. The run fails (exit code 1) if any sort
+* differs from the CPU's. Results also go to radix_sort_bench.csv. Run from the build directory so the ../shaders
+* path resolves.
+*/
+
+const size_t warmupRuns = 1;
+
+//!\brief Sorts n random keys of type Key runs times on the GPU, returning the mean time of a sort in milliseconds,
+//!       and sets matches to whether the last sort's keys and values are those of std::stable_sort.
+template<typename Key>
+double timeSorts(size_t n, size_t runs, bool &matches)
+{
+	const glhelper::RadixSort::KeyType keyType = sizeof(Key) == 8 ? glhelper::RadixSort::KeyType::UINT64
+		: glhelper::RadixSort::KeyType::UINT32;
+	std::mt19937_64 rng(n);
+	std::vector<Key> keys(n);
+	for (Key &key : keys) {
+		key = Key(rng());
+	}
+	std::vector<GLuint> values(n);
+	std::iota(values.begin(), values.end(), 0u);
+
+	glhelper::RadixSort sorter(n, "../shaders/", keyType);
+	glhelper::ShaderStorageBuffer unsortedKeys(n * sizeof(Key)), unsortedValues(n * sizeof(GLuint));
+	glhelper::ShaderStorageBuffer keyBuffer(n * sizeof(Key)), valueBuffer(n * sizeof(GLuint));
+	unsortedKeys.update(keys);
+	unsortedValues.update(values);
+
+	double totalMs = 0.0;
+	for (size_t run = 0; run < warmupRuns + runs; ++run) {
+		keyBuffer.copyFrom(unsortedKeys, n * sizeof(Key));
+		valueBuffer.copyFrom(unsortedValues, n * sizeof(GLuint));
+		glFinish();
+		auto start = std::chrono::steady_clock::now();
+		sorter.sort(keyBuffer, valueBuffer, n);
+		glFinish();
+		if (run >= warmupRuns) {
+			totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	// The indices in the order of their keys, equal keys staying in index order.
+	std::vector<GLuint> expectedValues(values);
+	std::stable_sort(expectedValues.begin(), expectedValues.end(), [&keys](GLuint a, GLuint b) {
+		return keys[a] < keys[b];
+	});
+	std::vector<Key> sortedKeys(n);
+	std::vector<GLuint> sortedValues(n);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glGetNamedBufferSubData(keyBuffer.get(), 0, GLsizeiptr(n * sizeof(Key)), sortedKeys.data());
+	glGetNamedBufferSubData(valueBuffer.get(), 0, GLsizeiptr(n * sizeof(GLuint)), sortedValues.data());
+	matches = sortedValues == expectedValues;
+	for (size_t i = 0; i < n && matches; ++i) {
+		matches = sortedKeys[i] == keys[expectedValues[i]];
+	}
+	return totalMs / double(runs);
+}
+
+int main(int argc, char *argv[])
+{
+	try {
+		HeadlessContext context;
+		std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+
+		std::vector<size_t> counts = listArg(argc, argv, "--keys", { 10000, 100000, 1000000 });
+		std::vector<size_t> bits = listArg(argc, argv, "--bits", { 32, 64 });
+		size_t runs = std::max(listArg(argc, argv, "--runs", { 5 })[0], size_t(1));
+		std::string csvPath = stringArg(argc, argv, "--csv", "radix_sort_bench.csv");
+
+		std::ofstream csv(csvPath);
+		if (!csv) {
+			throw std::runtime_error("Couldn't open " + csvPath + " for writing.");
+		}
+		csv << "keys,key_bits,sort_ms,keys_per_s,matches\n";
+
+		char line[256];
+		snprintf(line, sizeof(line), "%10s %8s %10s %10s %8s\n", "keys", "key bits", "sort ms", "Mkeys/s", "matches");
+		std::cout << line;
+		bool passed = true;
+		for (size_t keyBits : bits) {
+			if (keyBits != 32 && keyBits != 64) {
+				throw std::runtime_error("--bits should be 32 or 64.");
+			}
+			for (size_t n : counts) {
+				bool matches = false;
+				double ms = keyBits == 64 ? timeSorts<uint64_t>(std::max(n, size_t(1)), runs, matches)
+					: timeSorts<uint32_t>(std::max(n, size_t(1)), runs, matches);
+				passed = passed && matches;
+				double perSecond = ms > 0.0 ? double(n) / (ms * 1e-3) : 0.0;
+				snprintf(line, sizeof(line), "%10zu %8zu %10.3f %10.2f %8s\n",
+					n, keyBits, ms, perSecond * 1e-6, matches ? "yes" : "NO");
+				std::cout << line;
+				snprintf(line, sizeof(line), "%zu,%zu,%.5f,%.0f,%d\n", n, keyBits, ms, perSecond, matches ? 1 : 0);
+				csv << line;
+			}
+		}
+		std::cout << "Wrote " << csvPath << "\n" << (passed ? "All sorts match." : "Sorts DIFFER.") << "\n";
+		return passed ? 0 : 1;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,138 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glhelper/GravityIntegrator.hpp"
+#include "glhelper/JobSystem.hpp"
+#include "RingParticles.hpp"
+#include "ToolArgs.hpp"
+
+/* Checks and times glhelper::GravityIntegrator, the CPU version of the ring particle physics. Needs no GL at all.
+*
+* First it steps the same rings at every SIMD level this CPU supports, and checks they all give bitwise the same
+* particles as the scalar code. The count checked isn't a multiple of any SIMD width, so the scalar tails are
+* checked too. Any difference fails the run (exit code 1).
+*
+* Then it times each level for each number of worker threads, and reports particle steps per second. Compare
+* with ring_sweep's numbers for the compute shader; ring_sweep --validate checks the two agree.
+*
+* Usage:
+*     ring_cpu_bench [--particles N,N,...] [--workers N,N,...] [--masses N] [--steps N] [--check N] [--csv FILE]
+* --masses adds moons to Saturn (see benchmarkAttractors). --workers defaults to powers of two up to one fewer
+* than the number of cores (the main thread works too). Results also go to ring_cpu_bench.csv.
+*/
+
+// Same scene as ring_sweep.
+const float ringMinRadius = 5.f, ringMaxRadius = 6.f, particleInitialVelocity = 0.5f, particleMass = 0.1f;
+const float gravitationalConstant = 1e-2f, timeStep = 1.f / 33.3f;
+const size_t checkSteps = 100;
+
+std::vector<glhelper::GravityIntegrator::SimdLevel> supportedLevels()
+{
+	std::vector<glhelper::GravityIntegrator::SimdLevel> levels;
+	for (glhelper::GravityIntegrator::SimdLevel level : { glhelper::GravityIntegrator::SimdLevel::SCALAR,
+		glhelper::GravityIntegrator::SimdLevel::AVX2, glhelper::GravityIntegrator::SimdLevel::AVX512 }) {
+		if (glhelper::GravityIntegrator::supported(level)) {
+			levels.push_back(level);
+		}
+	}
+	return levels;
+}
+
+int main(int argc, char *argv[])
+{
+	try {
+		unsigned cores = std::max(std::thread::hardware_concurrency(), 2u);
+		std::vector<size_t> defaultWorkers;
+		for (size_t w = 1; w < cores - 1; w *= 2) {
+			defaultWorkers.push_back(w);
+		}
+		defaultWorkers.push_back(cores - 1);
+		std::vector<size_t> counts = listArg(argc, argv, "--particles", { 100000, 1000000, 4000000 });
+		std::vector<size_t> workers = listArg(argc, argv, "--workers", defaultWorkers);
+		size_t massCount = std::max(listArg(argc, argv, "--masses", { 1 })[0], size_t(1));
+		size_t steps = listArg(argc, argv, "--steps", { 20 })[0];
+		size_t checkCount = listArg(argc, argv, "--check", { 100003 })[0];
+		std::string csvPath = "ring_cpu_bench.csv";
+		for (int i = 1; i + 1 < argc; ++i) {
+			if (std::string(argv[i]) == "--csv") {
+				csvPath = argv[i + 1];
+			}
+		}
+		std::vector<glhelper::PointMass> masses = benchmarkAttractors(massCount);
+		std::vector<glhelper::GravityIntegrator::SimdLevel> levels = supportedLevels();
+
+		bool passed = true;
+		{
+			glhelper::JobSystem jobs;
+			std::vector<RingParticle> initial(checkCount), scalar, result;
+			initRingParticles(jobs, initial, ringMinRadius, ringMaxRadius, particleInitialVelocity);
+			glhelper::GravityIntegrator integrator(jobs);
+			for (glhelper::GravityIntegrator::SimdLevel level : levels) {
+				integrator.setSimdLevel(level);
+				integrator.upload(initial);
+				integrator.step(masses, particleMass, gravitationalConstant, timeStep, checkSteps);
+				integrator.download(level == glhelper::GravityIntegrator::SimdLevel::SCALAR ? scalar : result);
+				if (level == glhelper::GravityIntegrator::SimdLevel::SCALAR) {
+					continue;
+				}
+				RingDifference d = compareRingParticles(result, scalar);
+				std::cout << glhelper::GravityIntegrator::name(level) << " after " << checkSteps << " steps of " << checkCount
+					<< " particles: " << d.differing << " differ from scalar (at most " << d.maxUlps << " ULPs)\n";
+				passed = passed && d.differing == 0;
+			}
+			std::cout << (passed ? "Check passed." : "Check FAILED.") << "\n\n";
+		}
+
+		std::ofstream csv(csvPath);
+		if (!csv) {
+			throw std::runtime_error("Couldn't open " + csvPath + " for writing.");
+		}
+		csv << "particles,masses,workers,simd,step_ms,particles_per_s\n";
+
+		char line[160];
+		snprintf(line, sizeof(line), "%10s %7s %8s %10s %12s %8s\n", "particles", "workers", "SIMD", "step ms", "Mparticles/s", "speedup");
+		std::cout << line;
+		for (size_t w : workers) {
+			glhelper::JobSystem jobs(std::max(w, size_t(1)));
+			for (size_t n : counts) {
+				std::vector<RingParticle> particles(n);
+				initRingParticles(jobs, particles, ringMinRadius, ringMaxRadius, particleInitialVelocity);
+				glhelper::GravityIntegrator integrator(jobs);
+				double scalarMs = 0.0;
+				for (glhelper::GravityIntegrator::SimdLevel level : levels) {
+					integrator.setSimdLevel(level);
+					integrator.upload(particles);
+					// One step first, to fault in the pages and wake the workers.
+					integrator.step(masses, particleMass, gravitationalConstant, timeStep);
+					auto start = std::chrono::steady_clock::now();
+					for (size_t s = 0; s < steps; ++s) {
+						integrator.step(masses, particleMass, gravitationalConstant, timeStep);
+					}
+					double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / double(steps);
+					if (level == glhelper::GravityIntegrator::SimdLevel::SCALAR) {
+						scalarMs = ms;
+					}
+					double perSecond = ms > 0.0 ? double(n) / (ms * 1e-3) : 0.0;
+					snprintf(line, sizeof(line), "%10zu %7zu %8s %10.3f %12.1f %8.2f\n", n, w,
+						glhelper::GravityIntegrator::name(level), ms, perSecond * 1e-6, ms > 0.0 ? scalarMs / ms : 0.0);
+					std::cout << line;
+					snprintf(line, sizeof(line), "%zu,%zu,%zu,%s,%.5f,%.0f\n", n, massCount, w,
+						glhelper::GravityIntegrator::name(level), ms, perSecond);
+					csv << line;
+				}
+			}
+		}
+		std::cout << "Wrote " << csvPath << std::endl;
+		return passed ? 0 : 1;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,219 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "glhelper/ComputeDispatch.hpp"
+#include "glhelper/GravityIntegrator.hpp"
+#include "glhelper/JobSystem.hpp"
+#include "glhelper/MappedStorageBuffer.hpp"
+#include "glhelper/ParticleSystem.hpp"
+#include "glhelper/ShaderProgram.hpp"
+#include "HeadlessContext.hpp"
+#include "ToolArgs.hpp"
+#include "RingParticles.hpp"
+
+/* Times the ring particle compute shader (ParticlePhysics.comp) on its own, for a range of particle counts and
+* workgroup sizes, and reports how many particles it updates per second.
+*
+* Runs in a headless context created through EGL, so it needs no window or display - on Linux, Mesa's surfaceless
+* platform (llvmpipe if there's no GPU). Steps are run by a glhelper::ParticleSystem as in the exercise, so
+* they ping-pong between two buffers with a shader storage barrier between them, and are timed on the GPU
+* with GL_TIMESTAMP queries.
+*
+* Usage:
+*     ring_sweep [--particles N,N,...] [--workgroups N,N,...] [--steps N] [--attractors N] [--csv FILE]
+*                [--validate N] [--ulps N]
+* By default it tries 10k to 4M particles, and every power of two workgroup size from 32 up to the device's
+* limit. --attractors adds moons to Saturn (see benchmarkAttractors), to time the shader's tiling of them
+* through shared memory; they go to the shader in a glhelper::MappedStorageBuffer, as in the exercise. Results also go to ring_sweep.csv. Run from the build directory, like the exercise, so the ../shaders
+* path resolves.
+*
+* The shader is timed as written in ParticlePhysics.comp, so the numbers only mean something once the
+* exercise is done.
+*
+* Afterwards it checks the shader against glhelper::GravityIntegrator, the same physics on the CPU: --validate
+* particles (default 100000) are stepped once on both, and the run fails (exit code 1) if any position or
+* velocity component is more than --ulps (default 16) units in the last place of its vector's length apart.
+* The GPU's inversesqrt and division aren't correctly rounded, so they can't agree exactly. The difference after
+* more steps is reported too, but as it grows with every step it isn't checked. Survivors are appended in
+* whatever order they finish, so each particle's index goes in its velocity's w, which the shader must keep.
+* --validate 0 skips the check.
+*/
+
+// Same scene as the exercise: Saturn, by default alone, with the rings at their starting size.
+const float ringMinRadius = 5.f, ringMaxRadius = 6.f, particleInitialVelocity = 0.5f, particleMass = 0.1f;
+const float gravitationalConstant = 1e-2f, timeStep = 1.f / 33.3f;
+const size_t warmupSteps = 5;
+const size_t driftSteps = 100;
+
+void setUniforms(glhelper::ShaderProgram &program)
+{
+	glProgramUniform1f(program.get(), program.uniformLoc("gravitationalConstant"), gravitationalConstant);
+	glProgramUniform1f(program.get(), program.uniformLoc("timeStep"), timeStep);
+	glProgramUniform1f(program.get(), program.uniformLoc("particleMass"), particleMass);
+}
+
+//!\brief GPU time of one step, in milliseconds, averaged over steps.
+double timeSteps(glhelper::ParticleSystem &particles, size_t steps)
+{
+	particles.step(warmupSteps);
+	GLuint queries[2];
+	glGenQueries(2, queries);
+	glQueryCounter(queries[0], GL_TIMESTAMP);
+	particles.step(steps);
+	// Only the substeps are being timed, so wait for the last one here rather than in a later draw.
+	particles.barrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	glQueryCounter(queries[1], GL_TIMESTAMP);
+	GLuint64 start = 0, end = 0;
+	glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+	glDeleteQueries(2, queries);
+	return double(end - start) * 1e-6 / double(steps);
+}
+
+//!\brief Runs steps steps of initial, with velocity w its index, on the GPU and the CPU, and compares them.
+RingDifference compareWithCpu(glhelper::ShaderProgram &program, const glhelper::ComputeDispatch &dispatch,
+	glhelper::JobSystem &jobs, const std::vector<glhelper::PointMass> &attractors, const std::vector<RingParticle> &initial,
+	size_t steps)
+{
+	glhelper::ParticleSystem system(initial.size(), sizeof(RingParticle), program, dispatch);
+	system.upload(initial);
+	system.step(steps);
+	system.barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	GLuint count = 0;
+	system.frontCount().getData(&count, sizeof(count));
+	std::vector<RingParticle> gpu(count);
+	system.front().getData(gpu.data(), count * sizeof(RingParticle));
+
+	glhelper::GravityIntegrator integrator(jobs);
+	integrator.upload(initial);
+	integrator.step(attractors, particleMass, gravitationalConstant, timeStep, steps);
+	std::vector<RingParticle> cpu, matched;
+	integrator.download(cpu);
+
+	// Line up the survivors with the CPU's particles by their index. Particles the shader removed aren't compared.
+	for (const RingParticle &p : gpu) {
+		float id = p.velocity.w();
+		if (!(id >= 0.f && id < float(cpu.size()) && id == std::floor(id))) {
+			throw std::runtime_error("The shader didn't keep each particle's velocity.w, so they can't be matched up.");
+		}
+		matched.push_back(cpu[size_t(id)]);
+	}
+	if (count != initial.size()) {
+		std::cout << "  (" << initial.size() - count << " particles were removed by the shader, and aren't compared)\n";
+	}
+	return compareRingParticles(gpu, matched);
+}
+
+int main(int argc, char *argv[])
+{
+	try {
+		HeadlessContext context;
+		std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+
+		GLuint maxWorkgroup = glhelper::ComputeDispatch::maxWorkgroupSize();
+		std::vector<size_t> defaultWorkgroups;
+		for (size_t w = 32; w <= maxWorkgroup; w *= 2) {
+			defaultWorkgroups.push_back(w);
+		}
+		std::vector<size_t> counts = listArg(argc, argv, "--particles", { 10000, 100000, 1000000, 4000000 });
+		std::vector<size_t> workgroups = listArg(argc, argv, "--workgroups", defaultWorkgroups);
+		size_t steps = listArg(argc, argv, "--steps", { 50 })[0];
+		size_t attractorCount = std::max(listArg(argc, argv, "--attractors", { 1 })[0], size_t(1));
+		// Particle indices are stored as floats, which are exact up to 2^24.
+		size_t validateCount = std::min(listArg(argc, argv, "--validate", { 100000 })[0], size_t(1) << 24);
+		size_t ulpTolerance = listArg(argc, argv, "--ulps", { 16 })[0];
+		std::string csvPath = "ring_sweep.csv";
+		for (int i = 1; i + 1 < argc; ++i) {
+			if (std::string(argv[i]) == "--csv") {
+				csvPath = argv[i + 1];
+			}
+		}
+
+		// The attractors don't move here, so are uploaded once, and stay bound for every run.
+		std::vector<glhelper::PointMass> attractors = benchmarkAttractors(attractorCount);
+		glhelper::MappedStorageBuffer attractorBuffer(4 * sizeof(GLuint) + attractors.size() * sizeof(glhelper::PointMass));
+		attractorBuffer.updateArray(attractors);
+		attractorBuffer.bindBase(2);
+
+		// Compile every workgroup size up front.
+		std::vector<glhelper::ComputeDispatch> dispatches;
+		std::vector<std::unique_ptr<glhelper::ShaderProgram>> programs;
+		for (size_t w : workgroups) {
+			dispatches.emplace_back(GLuint(w));
+			programs.emplace_back(new glhelper::ShaderProgram({ "../shaders/ParticlePhysics.comp" }, dispatches.back().defines()));
+		}
+		std::cout << "Preferred workgroup size: " << glhelper::ComputeDispatch::preferredWorkgroupSize() << "\n\n";
+
+		std::ofstream csv(csvPath);
+		if (!csv) {
+			throw std::runtime_error("Couldn't open " + csvPath + " for writing.");
+		}
+		csv << "particles,attractors,workgroup,step_ms,particles_per_s,gb_per_s\n";
+
+		char line[400];
+		snprintf(line, sizeof(line), "%10s %9s %10s %12s %8s\n", "particles", "workgroup", "step ms", "Mparticles/s", "GB/s");
+		std::cout << line;
+		glhelper::JobSystem jobs;
+		for (size_t n : counts) {
+			std::vector<RingParticle> particles(n);
+			initRingParticles(jobs, particles, ringMinRadius, ringMaxRadius, particleInitialVelocity);
+
+			double best = 0.0;
+			size_t bestWorkgroup = 0;
+			for (size_t i = 0; i < workgroups.size(); ++i) {
+				glhelper::ParticleSystem system(n, sizeof(RingParticle), *programs[i], dispatches[i]);
+				system.upload(particles);
+				setUniforms(*programs[i]);
+				double ms = timeSteps(system, steps);
+				double perSecond = ms > 0.0 ? double(n) / (ms * 1e-3) : 0.0;
+				// Each particle is read and written once.
+				double gbPerSecond = perSecond * 2.0 * sizeof(RingParticle) * 1e-9;
+				snprintf(line, sizeof(line), "%10zu %9zu %10.3f %12.1f %8.1f\n", n, workgroups[i], ms, perSecond * 1e-6, gbPerSecond);
+				std::cout << line;
+				snprintf(line, sizeof(line), "%zu,%zu,%zu,%.5f,%.0f,%.3f\n", n, attractorCount, workgroups[i], ms, perSecond, gbPerSecond);
+				csv << line;
+				if (perSecond > best) {
+					best = perSecond;
+					bestWorkgroup = workgroups[i];
+				}
+			}
+			std::cout << "  fastest: workgroups of " << bestWorkgroup << "\n";
+		}
+		std::cout << "Wrote " << csvPath << "\n\n";
+
+		if (validateCount == 0) {
+			return 0;
+		}
+		glhelper::ComputeDispatch dispatch;
+		glhelper::ShaderProgram program({ "../shaders/ParticlePhysics.comp" }, dispatch.defines());
+		setUniforms(program);
+		std::vector<RingParticle> initial(validateCount);
+		initRingParticles(jobs, initial, ringMinRadius, ringMaxRadius, particleInitialVelocity);
+		for (size_t i = 0; i < initial.size(); ++i) {
+			initial[i].velocity.w() = float(i);
+		}
+		RingDifference one = compareWithCpu(program, dispatch, jobs, attractors, initial, 1);
+		RingDifference drift = compareWithCpu(program, dispatch, jobs, attractors, initial, driftSteps);
+		bool passed = one.maxUlps <= double(ulpTolerance);
+		snprintf(line, sizeof(line), "Shader against the CPU (%s), %zu particles:\n"
+			"  after 1 step:    %zu differ, by at most %.1f ULPs (RMS %.2f)\n"
+			"  after %zu steps: %zu differ, by at most %.1f ULPs (RMS %.2f)\n%s\n",
+			glhelper::GravityIntegrator::name(glhelper::GravityIntegrator::bestSimdLevel()), validateCount,
+			one.differing, one.maxUlps, one.rmsUlps, driftSteps, drift.differing, drift.maxUlps, drift.rmsUlps,
+			passed ? "Validation passed." : "Validation FAILED.");
+		std::cout << line;
+		return passed ? 0 : 1;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,39 @@
+// Shared by the BarnesHut*.comp shaders (see glhelper::BarnesHut).
+//
+// The tree is a binary radix tree over the bodies sorted by Morton code: n - 1 internal nodes,
+// numbered 0 to n - 2 with the root at 0, then n leaves, numbered n - 1 to 2n - 2 in sorted order.
+
+#ifndef WORKGROUP_SIZE
+#define WORKGROUP_SIZE 256
+#endif
+
+layout(local_size_x = WORKGROUP_SIZE) in;
+
+// As in NBody.comp.
+struct Body {
+    // xyz position, w mass.
+    vec4 posMass;
+    vec4 vel;
+};
+
+uint invocationIndex()
+{
+    return gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x + gl_GlobalInvocationID.x;
+}
+
+uint leafNode(uint sortedIndex, uint bodies)
+{
+    return bodies - 1u + sortedIndex;
+}
+
+// Maps floats to uints in the same order, so the bounds can be found with atomicMin and atomicMax.
+uint orderedFromFloat(float f)
+{
+    uint bits = floatBitsToUint(f);
+    return (bits & 0x80000000u) != 0u ? ~bits : bits | 0x80000000u;
+}
+
+float floatFromOrdered(uint u)
+{
+    return uintBitsToFloat((u & 0x80000000u) != 0u ? u & 0x7FFFFFFFu : ~u);
+}
@@ -1,6 +1,7 @@
-
 #version 410
 
+#pragma include ParticleColour.glsl
+
 in vec2 texCoords;
 
 uniform vec3 particleColor;
@@ -11,6 +12,5 @@ void main()
 {
 	float radialFalloff = 1 - 2*length(texCoords - vec2(0.5, 0.5));
 
-	fragColor = vec4(particleColor, radialFalloff);
+	fragColor = vec4(particleColour(particleColor), radialFalloff);
 }
-
@@ -0,0 +1,27 @@
+#version 430
+
+#pragma include ParticleColour.glsl
+
+// BillboardParticle.frag for weighted blended order-independent transparency (McGuire and
+// Bavoil 2013), drawn into a glhelper::WeightedBlendedOit's targets: the particle's
+// premultiplied colour, weighted by its depth, is summed into accumulation, and its
+// transparency multiplied into revealage.
+
+in vec2 texCoords;
+in float viewDepth;
+
+uniform vec3 particleColor;
+
+layout(location = 0) out vec4 accumulation;
+layout(location = 1) out float revealage;
+
+void main()
+{
+	float alpha = clamp(1 - 2*length(texCoords - vec2(0.5, 0.5)), 0.0, 1.0);
+
+	// The paper's equation 8 (made for view depths of 0.1 to 500), so nearer particles count
+	// for more. The clamp keeps the sum of a pixel's weights well inside half float range.
+	float weight = alpha * clamp(10.0 / (1e-5 + pow(viewDepth / 5.0, 2.0) + pow(viewDepth / 200.0, 6.0)), 1e-2, 3e3);
+	accumulation = vec4(particleColour(particleColor) * alpha, alpha) * weight;
+	revealage = alpha;
+}
@@ -0,0 +1,75 @@
+#version 430
+
+// Builds a camera-facing quad per particle, as BillboardParticle.geom does, but here in the
+// vertex shader: there are no vertex attributes, and each vertex reads its particle from the
+// storage buffer. glhelper::BillboardQuads draws 4 vertices per particle, either an instance
+// per particle or a batch of quadsPerInstance of them per instance, and if PARTICLE_ORDER is
+// defined draws the particles in the order given at binding 3 (e.g. sorted by depth).
+
+// Set by glhelper::BillboardQuads::defines(): the particle's size and where its position is,
+// both in vec4s.
+#ifndef PARTICLE_VEC4S
+#define PARTICLE_VEC4S 2
+#endif
+#ifndef POSITION_VEC4
+#define POSITION_VEC4 0
+#endif
+
+layout(std430, binding=0) readonly buffer Particles {
+    vec4 particleData[];
+};
+
+layout(std430, binding=1) readonly buffer LiveCount {
+    uint liveCount;
+};
+
+#ifdef PARTICLE_ORDER
+layout(std430, binding=3) readonly buffer Order {
+    uint particleOrder[];
+};
+#endif
+
+layout(std140) uniform cameraBlock
+{
+	mat4 worldToClip;
+	vec4 cameraPos;
+	vec4 cameraDir;
+};
+
+uniform float particleSize;
+uniform uint quadsPerInstance;
+
+out vec2 texCoords;
+// For fragment shaders that need them, e.g. BillboardParticleOit.frag.
+out float viewDepth;
+flat out uint particleIndex;
+
+void main()
+{
+	uint particle = uint(gl_InstanceID) * quadsPerInstance + uint(gl_VertexID) / 4u;
+	uint corner = uint(gl_VertexID) & 3u;
+	// Corners in strip order: bottom left, top left, bottom right, top right.
+	texCoords = vec2(corner >> 1u, corner & 1u);
+	viewDepth = 0.0;
+	particleIndex = particle;
+	if (particle >= liveCount) {
+		// Past the end of the last batch: every vertex lands on the same point, so nothing is drawn.
+		gl_Position = vec4(0.0);
+		return;
+	}
+#ifdef PARTICLE_ORDER
+	particle = particleOrder[particle];
+	particleIndex = particle;
+#endif
+
+	vec3 pointPos = particleData[particle * PARTICLE_VEC4S + POSITION_VEC4].xyz;
+	vec3 toCamera = normalize(vec3(cameraPos) - vec3(pointPos));
+
+	vec3 across = normalize(cross(toCamera, vec3(0.0, -1.0, 0.0)));
+	vec3 up = normalize(cross(toCamera, across));
+
+	vec2 side = texCoords * 2.0 - 1.0;
+	gl_Position = worldToClip * vec4(pointPos + ((across * side.x + up * side.y)*particleSize), 1.0);
+	// A perspective projection's w is the distance in front of the camera.
+	viewDepth = gl_Position.w;
+}
@@ -0,0 +1,26 @@
+#version 430
+
+// Resolves a glhelper::WeightedBlendedOit's targets over the opaque image: the weighted mean
+// of the transparent colours, blended with (ONE_MINUS_SRC_ALPHA, SRC_ALPHA) so that the
+// opaque image shows through as much as the revealage lets it.
+
+layout(binding = 0) uniform sampler2D accumulationTexture;
+layout(binding = 1) uniform sampler2D revealageTexture;
+
+out vec4 fragColor;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	float revealage = texelFetch(revealageTexture, texel, 0).r;
+	if (revealage >= 1.0) {
+		// Nothing transparent here.
+		discard;
+	}
+	vec4 accumulation = texelFetch(accumulationTexture, texel, 0);
+	// So many bright layers the sum overflowed: fall back on their coverage.
+	if (isinf(max(max(abs(accumulation.r), abs(accumulation.g)), abs(accumulation.b)))) {
+		accumulation.rgb = vec3(accumulation.a);
+	}
+	fragColor = vec4(accumulation.rgb / max(accumulation.a, 1e-5), revealage);
+}
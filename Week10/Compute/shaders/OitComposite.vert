@@ -0,0 +1,10 @@
+#version 430
+
+// A triangle covering the viewport, with no vertex buffer: glhelper::WeightedBlendedOit draws
+// its 3 vertices from an empty vertex array.
+
+void main()
+{
+	vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,22 @@
+// Shared by the billboard fragment shaders: a colour for each particle, if INDEX_COLOURS is
+// defined, so the order the particles are blended in shows. With a single colour, blending
+// gives the same result in any order.
+
+#ifdef INDEX_COLOURS
+flat in uint particleIndex;
+
+// A hash of the particle's index, so neighbouring particles get unrelated colours, tinted
+// towards the base colour.
+vec3 particleColour(vec3 baseColour)
+{
+	uint h = particleIndex * 747796405u + 2891336453u;
+	h = ((h >> ((h >> 28u) + 4u)) ^ h) * 277803737u;
+	h = (h >> 22u) ^ h;
+	return mix(baseColour, vec3(uvec3(h, h >> 8u, h >> 16u) & 255u) / 255.0, 0.75);
+}
+#else
+vec3 particleColour(vec3 baseColour)
+{
+	return baseColour;
+}
+#endif
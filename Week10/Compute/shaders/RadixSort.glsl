@@ -0,0 +1,42 @@
+// Shared by the RadixSort*.comp shaders (see glhelper::RadixSort). Each pass sorts on one
+// RADIX_BITS digit of the keys, and each workgroup handles a block of BLOCK_KEYS keys.
+
+#define RADIX_BITS 4
+#define RADIX 16
+#define SORT_WORKGROUP 256
+#define KEYS_PER_INVOCATION 8
+#define BLOCK_KEYS (SORT_WORKGROUP * KEYS_PER_INVOCATION)
+// Values each workgroup of RadixScan.comp scans.
+#define SCAN_ITEMS 4
+#define SCAN_BLOCK (SORT_WORKGROUP * SCAN_ITEMS)
+
+// Set by glhelper::RadixSort: 2 for 64 bit keys, each a uvec2 with its low word first (as a
+// little-endian uint64_t is laid out).
+#ifndef KEY_WORDS
+#define KEY_WORDS 1
+#endif
+#if KEY_WORDS == 2
+#define KEY_TYPE uvec2
+#else
+#define KEY_TYPE uint
+#endif
+
+layout(local_size_x = SORT_WORKGROUP) in;
+
+// Large dispatches are spread over y as well as x.
+uint workgroupIndex()
+{
+    return gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+}
+
+// The digit of key starting at bit shift. Digits never straddle the two words of a 64 bit key,
+// as 32 is a multiple of RADIX_BITS.
+uint digitOf(KEY_TYPE key, uint shift)
+{
+#if KEY_WORDS == 2
+    uint word = shift < 32u ? key.x >> shift : key.y >> (shift - 32u);
+#else
+    uint word = key >> shift;
+#endif
+    return word & (RADIX - 1u);
+}
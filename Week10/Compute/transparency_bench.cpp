@@ -0,0 +1,252 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "glhelper/BillboardQuads.hpp"
+#include "glhelper/ComputeDispatch.hpp"
+#include "glhelper/JobSystem.hpp"
+#include "glhelper/ParticleDepthSort.hpp"
+#include "glhelper/ParticleSystem.hpp"
+#include "glhelper/RotateViewer.hpp"
+#include "glhelper/ShaderProgram.hpp"
+#include "glhelper/WeightedBlendedOit.hpp"
+#include "HeadlessContext.hpp"
+#include "ToolArgs.hpp"
+#include "RingParticles.hpp"
+
+/* Compares three ways of blending the ring particles, each drawn as glhelper::BillboardQuads (indexed):
+* - unsorted: in the order they're stored, as the exercise draws them;
+* - sorted: back to front, after a GPU radix sort by distance (glhelper::ParticleDepthSort), which is what
+*   "over" blending needs to be right, so it's the reference for the others;
+* - oit: unsorted, with weighted blended order-independent transparency (glhelper::WeightedBlendedOit).
+* The particles are coloured by index (INDEX_COLOURS), as with a single colour blending gives the same image in
+* any order.
+*
+* Each is drawn into an offscreen framebuffer with a depth buffer (which the OIT pass copies, as it would after an
+* opaque pass) and timed from one glFinish to another, as in billboard_bench; the sort is also timed alone. The
+* unsorted and OIT images are compared with the sorted one: the RMS difference of the colour channels (0-255), and
+* the percentage of pixels where a channel differs by more than 8.
+*
+* Before timing, the sorted order is read back and checked: a permutation of the particles, with the live ones
+* first and farthest first. The run fails (exit code 1) if it isn't.
+*
+* Usage:
+*     transparency_bench [--particles N,N,...] [--frames N] [--size WxH] [--csv FILE]
+* By default it draws 100k and 1M particles, 10 frames each, at 1280x720. Results also go to
+* transparency_bench.csv. Run from the build directory so the ../shaders path resolves.
+*/
+
+// Same scene as the exercise.
+const float ringMinRadius = 5.f, ringMaxRadius = 6.f, particleInitialVelocity = 0.5f, ringParticleSize = 0.03f;
+// Distances are quantised over this range for the sort: RotateViewer's far plane.
+const float maxDistance = 50.f;
+const size_t warmupFrames = 2;
+// Channel difference from the sorted image counted as visible.
+const int visibleDifference = 8;
+
+void setUniforms(glhelper::ShaderProgram &program)
+{
+	glProgramUniform1f(program.get(), program.uniformLoc("particleSize"), ringParticleSize);
+	glProgramUniform3f(program.get(), program.uniformLoc("particleColor"), 0.6f, 0.2f, 0.1f);
+}
+
+//!\brief Time of one frame drawn by draw, in milliseconds, averaged over frames, from glFinish to glFinish
+//!       (see billboard_bench for why not GL_TIMESTAMP queries).
+template<typename Draw>
+double timeFrames(size_t frames, Draw draw)
+{
+	auto frame = [&] {
+		glDepthMask(GL_TRUE);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		draw();
+	};
+	for (size_t i = 0; i < warmupFrames; ++i) {
+		frame();
+	}
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < frames; ++i) {
+		frame();
+	}
+	glFinish();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / double(frames);
+}
+
+//!\brief Whether order holds every particle once, the live ones first and farthest from camera first, to within
+//!       the sort's quantisation.
+bool checkOrder(glhelper::ShaderStorageBuffer &order, const std::vector<RingParticle> &particles, size_t capacity,
+	const Eigen::Vector3f &camera)
+{
+	std::vector<GLuint> indices(capacity);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glGetNamedBufferSubData(order.get(), 0, GLsizeiptr(capacity * sizeof(GLuint)), indices.data());
+	std::vector<bool> seen(capacity, false);
+	const float step = maxDistance / 65535.f;
+	float lastDistance = maxDistance;
+	for (size_t i = 0; i < capacity; ++i) {
+		GLuint index = indices[i];
+		if (index >= capacity || seen[index] || (i < particles.size()) != (index < particles.size())) {
+			return false;
+		}
+		seen[index] = true;
+		if (i < particles.size()) {
+			float distance = (particles[index].position.head<3>() - camera).norm();
+			if (distance > lastDistance + step) {
+				return false;
+			}
+			lastDistance = std::min(lastDistance, distance);
+		}
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	try {
+		HeadlessContext context;
+		std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+
+		std::vector<size_t> counts = listArg(argc, argv, "--particles", { 100000, 1000000 });
+		size_t frames = std::max(listArg(argc, argv, "--frames", { 10 })[0], size_t(1));
+		std::string size = stringArg(argc, argv, "--size", "1280x720");
+		std::string csvPath = stringArg(argc, argv, "--csv", "transparency_bench.csv");
+		int width = 0, height = 0;
+		if (std::sscanf(size.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+			throw std::runtime_error("--size should be like 1280x720.");
+		}
+
+		// The depth format WeightedBlendedOit copies from.
+		GLuint colour = 0, depth = 0, framebuffer = 0;
+		glGenRenderbuffers(1, &colour);
+		glBindRenderbuffer(GL_RENDERBUFFER, colour);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenRenderbuffers(1, &depth);
+		glBindRenderbuffer(GL_RENDERBUFFER, depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			throw std::runtime_error("Couldn't make the offscreen framebuffer.");
+		}
+
+		glhelper::RotateViewer viewer(width, height);
+		viewer.pose(glhelper::CameraPose{ Eigen::Vector3f(0.f, 0.f, 15.f), 0.f, 0.6f });
+		viewer.resize(size_t(width), size_t(height));
+		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+		glEnable(GL_DEPTH_TEST);
+
+		glhelper::ComputeDispatch dispatch;
+		glhelper::ShaderProgram stepShader({ "../shaders/ParticlePhysics.comp" }, dispatch.defines());
+		glhelper::WeightedBlendedOit oit(width, height);
+
+		std::ofstream csv(csvPath);
+		if (!csv) {
+			throw std::runtime_error("Couldn't open " + csvPath + " for writing.");
+		}
+		csv << "particles,method,frame_ms,sort_ms,rms_error,visible_pixels_percent\n";
+
+		char line[320];
+		snprintf(line, sizeof(line), "%10s %10s %10s %10s %10s %10s\n",
+			"particles", "method", "frame ms", "sort ms", "RMS error", "visible %");
+		std::cout << line;
+		glhelper::JobSystem jobs;
+		bool passed = true;
+		std::vector<unsigned char> reference(size_t(width) * size_t(height) * 4), image(reference.size());
+		for (size_t n : counts) {
+			std::vector<RingParticle> particles(n);
+			initRingParticles(jobs, particles, ringMinRadius, ringMaxRadius, particleInitialVelocity);
+			// Room for more than are alive, as in the exercise, so the empty slots are sorted too.
+			glhelper::ParticleSystem rings(std::max(2 * n, size_t(1)), sizeof(RingParticle), stepShader, dispatch);
+			rings.upload(particles);
+			glhelper::BillboardQuads quads(rings, offsetof(RingParticle, position));
+			glhelper::ParticleDepthSort depthSort(rings, offsetof(RingParticle, position), dispatch);
+
+			glhelper::ShaderDefines unorderedDefines = quads.defines(), orderedDefines = quads.defines(true);
+			unorderedDefines["INDEX_COLOURS"] = "1";
+			orderedDefines["INDEX_COLOURS"] = "1";
+			glhelper::ShaderProgram unsortedShader({ "../shaders/BillboardQuad.vert", "../shaders/BillboardParticle.frag" },
+				unorderedDefines);
+			glhelper::ShaderProgram sortedShader({ "../shaders/BillboardQuad.vert", "../shaders/BillboardParticle.frag" },
+				orderedDefines);
+			glhelper::ShaderProgram oitShader({ "../shaders/BillboardQuad.vert", "../shaders/BillboardParticleOit.frag" },
+				unorderedDefines);
+			setUniforms(unsortedShader);
+			setUniforms(sortedShader);
+			setUniforms(oitShader);
+
+			depthSort.sort(viewer.position(), maxDistance);
+			if (!checkOrder(depthSort.order(), particles, rings.capacity(), viewer.position())) {
+				std::cout << "The depth sort of " << n << " particles is WRONG.\n";
+				passed = false;
+			}
+			double sortMs = timeFrames(frames, [&] { depthSort.sort(viewer.position(), maxDistance); });
+
+			const glhelper::BillboardQuads::Mode mode = glhelper::BillboardQuads::Mode::INDEXED;
+			const char *methods[3] = { "sorted", "unsorted", "oit" };
+			for (size_t method = 0; method < 3; ++method) {
+				double ms = timeFrames(frames, [&] {
+					if (method == 0) {
+						glEnable(GL_BLEND);
+						glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+						glDepthMask(GL_FALSE);
+						depthSort.sort(viewer.position(), maxDistance);
+						quads.draw(sortedShader, mode, &depthSort.order());
+					} else if (method == 1) {
+						glEnable(GL_BLEND);
+						glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+						glDepthMask(GL_FALSE);
+						quads.draw(unsortedShader, mode);
+					} else {
+						oit.begin(framebuffer);
+						quads.draw(oitShader, mode);
+						oit.end(framebuffer);
+					}
+				});
+				glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, method == 0 ? reference.data() : image.data());
+				double squaredError = 0.0;
+				size_t visible = 0;
+				if (method != 0) {
+					for (size_t p = 0; p < image.size(); p += 4) {
+						int pixelDifference = 0;
+						for (size_t c = 0; c < 3; ++c) {
+							int difference = std::abs(int(image[p + c]) - int(reference[p + c]));
+							squaredError += double(difference * difference);
+							pixelDifference = std::max(pixelDifference, difference);
+						}
+						visible += pixelDifference > visibleDifference ? 1 : 0;
+					}
+				}
+				double rms = std::sqrt(squaredError / (3.0 * double(width) * double(height)));
+				double visiblePercent = 100.0 * double(visible) / (double(width) * double(height));
+				double methodSortMs = method == 0 ? sortMs : 0.0;
+				snprintf(line, sizeof(line), "%10zu %10s %10.3f %10.3f %10.3f %10.3f\n",
+					n, methods[method], ms, methodSortMs, rms, visiblePercent);
+				std::cout << line;
+				snprintf(line, sizeof(line), "%zu,%s,%.5f,%.5f,%.4f,%.4f\n",
+					n, methods[method], ms, methodSortMs, rms, visiblePercent);
+				csv << line;
+			}
+		}
+		std::cout << "Wrote " << csvPath << "\n";
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colour);
+		glDeleteRenderbuffers(1, &depth);
+		return passed ? 0 : 1;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -11,7 +11,15 @@
 #include "glhelper/FlyViewer.hpp"
 #include "glhelper/Mesh.hpp"
 #include "glhelper/Texture.hpp"
+#include "glhelper/TextureArray.hpp"
+#include "glhelper/MaterialTable.hpp"
 #include "glhelper/Matrices.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/HudText.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/mesh.h"
@@ -25,8 +33,27 @@
 
 const int winWidth = 1280, winHeight = 720;
 
+// Per-instance data for TexturedMeshArray.vert and TexturedMeshBindless.vert (std430 layout).
+struct ModelInstance {
+	Eigen::Matrix4f modelToWorld;
+	Eigen::Vector4f uvTransform;
+	Eigen::Vector4i textureIndex; // x: texture array layer, y: material table entry, z: 1 if packed in an atlas
+};
+
+// Models sharing a mesh, shader and texture array, drawn with a single instanced call.
+// With bindless textures, models sharing a mesh, shader and material: the handle must be the
+// same for the whole draw.
+struct ModelBatch {
+	std::string mesh, shader;
+	size_t textureArray;
+	int material;
+	std::vector<ModelInstance> instances;
+	std::unique_ptr<glhelper::ShaderStorageBuffer> instanceBuffer;
+};
+
 void loadMesh(glhelper::Mesh* mesh, const std::string& filename)
 {
+	glhelper::TraceZone zone("loadMesh");
 	Assimp::Importer importer;
 	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
 	const aiScene* aiscene = importer.GetScene();
@@ -54,8 +81,13 @@ void loadMesh(glhelper::Mesh* mesh, const std::string& filename)
 	mesh->tex(uvs);
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
@@ -83,11 +115,12 @@ int main()
 	}
 
 	gltInit();
-	GLTtext* text = gltCreateText();
-	gltSetText(text, (std::string("Animation demo")).c_str());
 	glEnable(GL_MULTISAMPLE);
 
 	{
+		// Line 0 is the animation time, line 1 the GPU memory budget, line 2 the GpuProfiler report.
+		glhelper::HudText hud(3, 512);
+		size_t gpuMemoryGeneration = 0;
 		nlohmann::json data;
 		try {
 			std::ifstream jsonFile("../config/config.json");
@@ -107,8 +140,13 @@ int main()
 			loadMesh(&(meshes[mesh["name"]]), mesh["filename"]);
 		}
 
+		// Use bindless textures where the driver supports them, otherwise fall back to texture arrays.
+		const bool useBindless = glhelper::Texture::bindlessSupported();
+		std::cout << (useBindless ? "Using bindless textures." : "Bindless textures unsupported, using texture arrays.") << std::endl;
+
 		// Load all the shaders
 		std::map<std::string, glhelper::ShaderProgram> shaders;
+		std::map<std::string, std::string> bindlessVariants;
 		for (auto& shader : data["shaders"]) {
 			std::vector<std::string> sourceFilenames;
 			for (auto& filename : shader["filenames"]) {
@@ -116,85 +154,164 @@ int main()
 			}
 
 			std::string shaderName = shader["name"];
-			shaders.emplace(shaderName, sourceFilenames);
+			glhelper::ShaderProgram &program = shaders.emplace(shaderName, sourceFilenames).first->second;
+			// Every model is drawn instanced, reading its transform and texture from the instance buffer.
+			if (glGetProgramResourceIndex(program.get(), GL_SHADER_STORAGE_BLOCK, "modelInstances") == GL_INVALID_INDEX) {
+				std::cout << "Shader \"" << shaderName << "\" has no modelInstances block, so can't draw the models." << std::endl;
+				exit(1);
+			}
 
+			if (shader.contains("bindlessVariant")) {
+				bindlessVariants[shaderName] = shader["bindlessVariant"].get<std::string>();
+			}
 		}
 
-		// Load all the textures
-		std::map<std::string, glhelper::Texture> textures;
+		// Load all the textures. In the fallback path they're combined into as few array textures
+		// as possible: large textures become layers of an array, small ones are packed into atlas pages.
+		// In the bindless path each is a separate texture, referenced by handle from a material table.
+		glhelper::TextureArrayBuilder textures;
+		std::map<std::string, glhelper::Texture> bindlessTextures;
+		std::map<std::string, size_t> materialIndices;
+		glhelper::MaterialTable materials;
 		for (auto& texture : data["textures"]) {
 			std::string textureName = texture["name"];
 			cv::Mat image = cv::imread(texture["filename"]);
-			textures.emplace(textureName, glhelper::Texture{ GL_TEXTURE_2D, GL_RGB8, (size_t)image.cols, (size_t)image.rows, 0, GL_BGR, GL_UNSIGNED_BYTE, image.data });
+			if (useBindless) {
+				glhelper::Texture& t = bindlessTextures.emplace(textureName, glhelper::Texture{ GL_TEXTURE_2D, GL_RGB8, (size_t)image.cols, (size_t)image.rows, 0, GL_BGR, GL_UNSIGNED_BYTE, image.data, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR }).first->second;
+				t.genMipmap();
+				materialIndices[textureName] = materials.add(t);
+			} else {
+				textures.add(textureName, image);
+			}
+		}
+		if (useBindless) {
+			materials.upload();
+		} else {
+			textures.build();
 		}
 
 		nlohmann::json models = data["models"];
 
+		// Group models that can share a draw call. Each model picks its layer and
+		// UV transform through its instance data, so no per-model texture binds are needed.
+		std::vector<ModelBatch> batches;
+		for (auto& model : models) {
+			std::string meshName = model["mesh"], shaderName = model["shader"], textureName = model["texture"];
+			Eigen::Vector3f position(model["position"][0], model["position"][1], model["position"][2]);
+			ModelInstance instance{ makeTranslationMatrix(position), Eigen::Vector4f(0.f, 0.f, 1.f, 1.f), Eigen::Vector4i::Zero() };
+			size_t textureArray = 0;
+			int material = -1;
+			if (useBindless) {
+				if (bindlessVariants.count(shaderName)) {
+					shaderName = bindlessVariants.at(shaderName);
+				}
+				material = int(materialIndices.at(textureName));
+				instance.textureIndex[1] = material;
+			} else {
+				const glhelper::TextureSlot& slot = textures.slot(textureName);
+				instance.uvTransform = slot.uvTransform;
+				instance.textureIndex[0] = slot.layer;
+				instance.textureIndex[2] = slot.atlas ? 1 : 0;
+				textureArray = slot.array;
+			}
+			auto batch = std::find_if(batches.begin(), batches.end(), [&](const ModelBatch& b) {
+				return b.mesh == meshName && b.shader == shaderName && b.textureArray == textureArray && b.material == material;
+			});
+			if (batch == batches.end()) {
+				batches.push_back(ModelBatch{ meshName, shaderName, textureArray, material });
+				batch = batches.end() - 1;
+			}
+			batch->instances.push_back(instance);
+		}
+		for (ModelBatch& batch : batches) {
+			batch.instanceBuffer = std::make_unique<glhelper::ShaderStorageBuffer>(batch.instances.size() * sizeof(ModelInstance), GL_STATIC_DRAW);
+			batch.instanceBuffer->update(batch.instances);
+			glhelper::ShaderProgram& shader = shaders.at(batch.shader);
+			if (!useBindless) {
+				glProgramUniform1i(shader.get(), shader.uniformLoc("tex"), 0);
+			}
+		}
+		std::cout << models.size() << " models in " << batches.size() << " draw calls, using "
+			<< (useBindless ? materials.size() : textures.arrays().size())
+			<< (useBindless ? " bindless textures." : " texture arrays.") << std::endl;
+
 
 		glhelper::RotateViewer viewer(winWidth, winHeight);
 		viewer.distance(20.f);
 
-		glhelper::Mesh sphereMesh;
-		loadMesh(&sphereMesh, "../models/sphere.obj");
-		sphereMesh.shaderProgram(&(shaders.at("texturedMesh")));
-
-		glProgramUniform1i(shaders.at("texturedMesh").get(), shaders.at("texturedMesh").uniformLoc("tex"), 0);
-
 		bool shouldQuit = false;
 		SDL_Event event;
 
 		glEnable(GL_DEPTH_TEST);
 
-		auto startTime = std::chrono::steady_clock::now();
+		glhelper::FramePacer framePacer(0.0);
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-			float animTimeSeconds = 1e-6f * (float)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
 
-			viewer.update();
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+			float animTimeSeconds = float(benchmark.seconds());
+
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 			}
 			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
 
 
-			for (auto& model : models) {
-				glhelper::Mesh& mesh = meshes.at(model["mesh"]);
-				glhelper::ShaderProgram& shader = shaders.at(model["shader"]);
-				glhelper::Texture& texture = textures.at(model["texture"]);
-				texture.bindToImageUnit(0);
-				glProgramUniform1i(shader.get(), shader.uniformLoc("tex"), 0);
-				mesh.shaderProgram(&shader);
-
-				Eigen::Vector3f position(model["position"][0], model["position"][1], model["position"][2]);
-				mesh.modelToWorld(makeTranslationMatrix(position));
-				mesh.render();
+			if (useBindless) {
+				materials.bindBase(1);
+			}
+			for (ModelBatch& batch : batches) {
+				glhelper::ShaderProgram& shader = shaders.at(batch.shader);
+				if (useBindless) {
+					glProgramUniform1i(shader.get(), shader.uniformLoc("materialIndex"), batch.material);
+				} else {
+					textures.arrays()[batch.textureArray].bindToImageUnit(0);
+				}
+				batch.instanceBuffer->bindBase(0);
+				meshes.at(batch.mesh).renderInstanced(shader, batch.instances.size());
 			}
 
-			std::string textStr = std::string("Animation Time: ") + std::to_string(animTimeSeconds) + std::string(" seconds.");
-			gltSetText(text, textStr.c_str());
-			gltBeginDraw();
-			gltColor(1.f, 1.f, 1.f, 1.f);
-			gltDrawText2D(text, 10.f, 10.f, 1.f);
-			gltEndDraw();
+			profiler.end("scene");
+
+			// Only regenerates the text when the displayed time changes.
+			hud.format(0, "Animation Time: %.1f seconds.", animTimeSeconds);
+			if (gpuMemoryGeneration != glhelper::GpuMemory::generation()) {
+				gpuMemoryGeneration = glhelper::GpuMemory::generation();
+				hud.line(1, glhelper::GpuMemory::budget().c_str());
+			}
+			if (profiler.reportUpdated()) {
+				hud.line(2, profiler.report().c_str());
+			}
+			hud.draw(10.f, 10.f);
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
+			framePacer.endFrame();
 		}
+		benchmark.finish();
 
 	}
 
-	gltDeleteText(text);
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
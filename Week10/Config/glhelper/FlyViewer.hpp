@@ -21,6 +21,8 @@ public:
 
 	virtual void resize(size_t width, size_t height);
 	virtual Eigen::Matrix4f worldToCam() const;
+	virtual CameraPose pose() const;
+	virtual void pose(const CameraPose &p);
 private:
 	float theta_, phi_, thetaSpeed_, phiSpeed_;
 	Eigen::Vector3f translation_;
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+struct GLTtext;
+
+namespace glhelper {
+
+//!\brief Overlay text made of a fixed number of lines, drawn with glText.
+//!
+//!       Each line is formatted into its own fixed size buffer, so updating a
+//!       line never allocates, and is only marked changed if its text differs
+//!       from last time. All the lines are joined into a single GLTtext, so the
+//!       whole HUD is one glyph-atlas draw, and its vertices are regenerated only
+//!       on frames where some line actually changed (rather than every frame, as
+//!       calling gltSetText with a freshly built string does).
+//!
+//!       Usage:
+//!           glhelper::HudText hud(2);
+//!           ...
+//!           hud.format(0, "Animation time: %.1f s", t);
+//!           if (RenderStats::tableUpdated()) hud.line(1, RenderStats::table().c_str());
+//!           hud.draw(10.f, 10.f);
+//!\note Must be created after gltInit, and used and destroyed on the thread owning
+//!      the GL context, before gltTerminate.
+class HudText final
+{
+public:
+	//!\brief lineCapacity is the longest line kept, in characters; longer lines are cut short.
+	//!       A line may contain '\n' to hold a small block of text such as RenderStats::table.
+	explicit HudText(size_t nLines, size_t lineCapacity = 128);
+	~HudText() throw();
+
+	//!\brief Sets a line to a fixed string.
+	//!\return true if the line changed.
+	bool line(size_t index, const char *text);
+	//!\brief Sets a line with printf-style formatting, without any heap allocation.
+	//!\return true if the line changed.
+	bool format(size_t index, const char *fmt, ...);
+
+	const char *line(size_t index) const;
+	size_t lines() const;
+
+	//!\brief Regenerates the text if any line has changed, then draws it in one draw call.
+	void draw(float x, float y, float scale = 1.f);
+
+	//!\brief Times the glText vertices have been regenerated, to check the caching is working.
+	size_t rebuilds() const;
+
+private:
+	HudText(const HudText&);
+	HudText &operator=(const HudText&);
+
+	size_t lineOffset(size_t index) const;
+	bool store(size_t index, const char *text);
+	void rebuild();
+
+	size_t nLines_, lineCapacity_;
+	//!\brief nLines_ buffers of lineCapacity_ + 1 characters.
+	std::vector<char> lineBuffers_;
+	//!\brief Scratch space for format, so unchanged lines aren't touched.
+	std::vector<char> scratch_;
+	//!\brief All the lines joined by newlines, as passed to gltSetText.
+	std::vector<char> joined_;
+	GLTtext *text_;
+	bool dirty_;
+	size_t rebuilds_;
+};
+
+}
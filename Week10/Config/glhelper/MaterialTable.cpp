@@ -0,0 +1,41 @@
+#include "MaterialTable.hpp"
+#include "Texture.hpp"
+#include <stdexcept>
+
+namespace glhelper {
+
+MaterialTable::MaterialTable()
+{}
+
+MaterialTable::~MaterialTable() throw()
+{}
+
+size_t MaterialTable::add(Texture &texture)
+{
+	handles_.push_back(texture.bindlessHandle());
+	return handles_.size() - 1;
+}
+
+void MaterialTable::upload()
+{
+	if (handles_.empty()) {
+		throw std::runtime_error("MaterialTable::upload called with no textures added.");
+	}
+	size_t bytes = handles_.size() * sizeof(GLuint64);
+	if (!buffer_ || buffer_->sizeBytes() < bytes) {
+		buffer_ = std::make_unique<ShaderStorageBuffer>(bytes, GL_STATIC_DRAW);
+	}
+	buffer_->update(handles_.data(), bytes);
+}
+
+void MaterialTable::bindBase(GLuint index)
+{
+	buffer_->bindBase(index);
+}
+
+size_t MaterialTable::size() const
+{
+	return handles_.size();
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "GLBuffer.hpp"
+#include <GL/glew.h>
+#include <memory>
+#include <vector>
+
+namespace glhelper {
+
+class Texture;
+
+//!\brief A shader storage buffer of bindless texture handles, so shaders can
+//!       pick a texture per draw without any binding calls.
+//!
+//!       In GLSL, declare the table as a std430 buffer of uvec2 and sample with
+//!       texture(sampler2D(textureHandles[i]), uv). GL_ARB_bindless_texture only defines
+//!       the result when i is dynamically uniform, the same for the whole draw (e.g. a
+//!       uniform); a per-instance or per-vertex i needs GL_NV_gpu_shader5 as well.
+//!\note Needs GL_ARB_bindless_texture, check Texture::bindlessSupported() first.
+class MaterialTable final
+{
+public:
+	MaterialTable();
+	~MaterialTable() throw();
+
+	//!\brief Make the texture resident and append its handle. Returns its index.
+	size_t add(Texture &texture);
+	//!\brief Upload the handles added so far. Call again after adding more.
+	void upload();
+
+	void bindBase(GLuint index);
+
+	size_t size() const;
+private:
+	MaterialTable(const MaterialTable&);
+	MaterialTable &operator=(const MaterialTable&);
+
+	std::vector<GLuint64> handles_;
+	std::unique_ptr<ShaderStorageBuffer> buffer_;
+};
+
+}
@@ -2,6 +2,8 @@
 #include "Mesh.hpp"
 #include "Constants.hpp"
 #include "Exception.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
 
 namespace glhelper {
 
@@ -12,10 +14,12 @@ Mesh::Mesh(const Eigen::Matrix4f &modelToWorld)
 	drawMode_(GL_TRIANGLES)
 {
 	glGenVertexArrays(1, &vao_);
+	GpuMemory::track(GpuResourceType::VERTEX_ARRAY, vao_, 0, "Mesh");
 }
 
 Mesh::~Mesh() throw()
 {
+	GpuMemory::untrack(GpuResourceType::VERTEX_ARRAY, vao_);
 	glDeleteVertexArrays(1, &vao_);
 }
 
@@ -124,10 +128,12 @@ void Mesh::render()
 		throw std::runtime_error("Attempted to render mesh without supplying shader program.");
 	}
 	glBindVertexArray(vao_);
+	RenderStats::recordStateChange();
 	shaderProgram_->use();
 	glProgramUniformMatrix4fv(shaderProgram_->get(), shaderProgram_->uniformLoc("modelToWorld"), 1, GL_FALSE, modelToWorld().data());
 	glProgramUniformMatrix3fv(shaderProgram_->get(), shaderProgram_->uniformLoc("normToWorld"), 1, GL_FALSE, normToWorld().data());
 	shaderProgram_->setupCameraBlock();
+	RenderStats::recordDraw(drawMode_, nElems_ != 0 ? nElems_ : nVerts_);
 	if(nElems_ != 0) {
     	glDrawElements(drawMode_, GLsizei(nElems_), GL_UNSIGNED_INT, 0);
 	} else {
@@ -140,10 +146,12 @@ void Mesh::render()
 void Mesh::render(ShaderProgram& program)
 {
 	glBindVertexArray(vao_);
+	RenderStats::recordStateChange();
 	program.use();
 	glProgramUniformMatrix4fv(program.get(), program.uniformLoc("modelToWorld"), 1, GL_FALSE, modelToWorld().data());
 	glProgramUniformMatrix3fv(program.get(), program.uniformLoc("normToWorld"), 1, GL_FALSE, normToWorld().data());
 	program.setupCameraBlock();
+	RenderStats::recordDraw(drawMode_, nElems_ != 0 ? nElems_ : nVerts_);
 	if(nElems_ != 0) {
     	glDrawElements(drawMode_, GLsizei(nElems_), GL_UNSIGNED_INT, 0);
 	} else {
@@ -153,6 +161,22 @@ void Mesh::render(ShaderProgram& program)
 	glBindVertexArray(0);
 }
 
+void Mesh::renderInstanced(ShaderProgram& program, size_t nInstances)
+{
+	glBindVertexArray(vao_);
+	RenderStats::recordStateChange();
+	program.use();
+	program.setupCameraBlock();
+	RenderStats::recordDraw(drawMode_, nElems_ != 0 ? nElems_ : nVerts_, nInstances);
+	if(nElems_ != 0) {
+		glDrawElementsInstanced(drawMode_, GLsizei(nElems_), GL_UNSIGNED_INT, 0, GLsizei(nInstances));
+	} else {
+		glDrawArraysInstanced(drawMode_, 0, GLsizei(nVerts_), GLsizei(nInstances));
+	}
+	program.unuse();
+	glBindVertexArray(0);
+}
+
 ShaderProgram *Mesh::shaderProgram() const
 {
 	return shaderProgram_;
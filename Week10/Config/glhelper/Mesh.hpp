@@ -28,6 +28,9 @@ public:
 
 	virtual void render();
 	virtual void render(ShaderProgram &program);
+	//!\brief Draw nInstances copies in one call. Per-instance data (transforms etc.)
+	//!       is up to the shader, e.g. indexed by gl_InstanceID from a storage buffer.
+	void renderInstanced(ShaderProgram &program, size_t nInstances);
 
 	Mesh& shaderProgram(ShaderProgram *p);
 	ShaderProgram* shaderProgram() const;
@@ -20,6 +20,9 @@ public:
 	void distance(float dist);
 	void resize(size_t width, size_t height);
 	Eigen::Matrix4f worldToCam() const;
+	CameraPose pose() const;
+	//!\brief Sets the rotation, and the distance from the origin to that of p.position.
+	void pose(const CameraPose &p);
 private:
 	float theta_, phi_, thetaSpeed_, phiSpeed_;
 	float delta_, deltaSpeed_;
@@ -1,5 +1,7 @@
 #include "Texture.hpp"
 #include "Exception.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
 #include <GL/glew.h>
 #include <string>
 #include <opencv2/opencv.hpp>
@@ -161,7 +163,8 @@ Texture::Texture(GLenum target, GLenum internalFormat,
 	internalFormat_(internalFormat),
 	format_(format),
 	type_(type),
-	border_(border)
+	border_(border),
+	handle_(0)
 {
 	if (!validFormat(format)) {
 		throw std::runtime_error("Invalid format supplied to Texture constructor");
@@ -184,6 +187,11 @@ void Texture::init(const void *data, GLenum minFilter, GLenum magFilter)
 	glBindTexture(target_, tex_);
 	glTexImage2D(target_, 0, internalFormat_, GLsizei(width_), GLsizei(height_),
 		border_, format_, type_, data);
+	GpuMemory::track(GpuResourceType::TEXTURE, tex_, width_ * height_ * GpuMemory::texelBytes(internalFormat_),
+		"texture " + std::to_string(width_) + "x" + std::to_string(height_));
+	if (data != nullptr) {
+		RenderStats::recordUpload(RenderStats::imageBytes(format_, type_, width_, height_));
+	}
 	throwOnGlError();
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
@@ -199,7 +207,11 @@ void Texture::init(const void *data, GLenum minFilter, GLenum magFilter)
 
 Texture::~Texture() throw()
 {
+	if (handle_ != 0) {
+		glMakeTextureHandleNonResidentARB(handle_);
+	}
 	if (tex_ != 0) {
+		GpuMemory::untrack(GpuResourceType::TEXTURE, tex_);
 		glDeleteTextures(1, &tex_);
 	}
 }
@@ -212,14 +224,26 @@ internalFormat_(other.internalFormat_),
 format_(other.format_),
 type_(other.type_),
 border_(other.border_),
-tex_(other.tex_)
+tex_(other.tex_),
+handle_(other.handle_)
 {
 	//Make sure tex_ isn't deleted.
 	other.tex_ = 0;
+	other.handle_ = 0;
 }
 
 Texture &Texture::operator=(Texture && other)
 {
+	if (this == &other) {
+		return *this;
+	}
+	if (handle_ != 0) {
+		glMakeTextureHandleNonResidentARB(handle_);
+	}
+	if (tex_ != 0) {
+		GpuMemory::untrack(GpuResourceType::TEXTURE, tex_);
+		glDeleteTextures(1, &tex_);
+	}
 	width_ = other.width_;
 	height_ = other.height_;
 	target_ = other.target_;
@@ -228,8 +252,10 @@ Texture &Texture::operator=(Texture && other)
 	type_ = other.type_;
 	border_ = other.border_;
 	tex_ = other.tex_;
+	handle_ = other.handle_;
 	//Make sure tex_ isn't deleted.
 	other.tex_ = 0;
+	other.handle_ = 0;
 	return *this;
 }
 
@@ -238,6 +264,7 @@ void Texture::update(const void *data)
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(target_, tex_);
 	glTexSubImage2D(target_, 0, 0, 0, width_, height_, format_, type_, data);
+	RenderStats::recordUpload(RenderStats::imageBytes(format_, type_, width_, height_));
 	glBindTexture(target_, 0);
 }
 
@@ -245,6 +272,7 @@ void Texture::update(const void *data, size_t mipmapLevel) {
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(target_, tex_);
 	glTexSubImage2D(target_, mipmapLevel, 0, 0, width_ >> mipmapLevel, height_ >> mipmapLevel, format_, type_, data);
+	RenderStats::recordUpload(RenderStats::imageBytes(format_, type_, width_ >> mipmapLevel, height_ >> mipmapLevel));
 	glBindTexture(target_, 0);
 }
 
@@ -252,6 +280,7 @@ void Texture::bindToImageUnit(GLuint unit)
 {
 	glActiveTexture(GL_TEXTURE0 + unit);
 	glBindTexture(target_, tex_);
+	RenderStats::recordStateChange();
 }
 
 void Texture::unbind()
@@ -369,6 +398,26 @@ void Texture::genMipmap()
 	glBindTexture(target_, tex_);
 	glGenerateMipmap(target_);
 	glBindTexture(target_, 0);
+	// A full mip chain adds a third to the size of the base level.
+	GpuMemory::resize(GpuResourceType::TEXTURE, tex_, width_ * height_ * GpuMemory::texelBytes(internalFormat_) * 4 / 3);
+}
+
+bool Texture::bindlessSupported()
+{
+	return GLEW_ARB_bindless_texture;
+}
+
+GLuint64 Texture::bindlessHandle()
+{
+	if (handle_ == 0) {
+		if (!bindlessSupported()) {
+			throw std::runtime_error("Bindless texture handle requested, but GL_ARB_bindless_texture isn't supported.");
+		}
+		handle_ = glGetTextureHandleARB(tex_);
+		glMakeTextureHandleResidentARB(handle_);
+		throwOnGlError();
+	}
+	return handle_;
 }
 
 size_t Texture::numChannels() const
@@ -42,6 +42,14 @@ public:
 
 	void genMipmap();
 
+	//!\brief True if the driver supports GL_ARB_bindless_texture.
+	static bool bindlessSupported();
+	//!\brief Resident 64-bit handle for sampling this texture without binding it,
+	//!       e.g. from a MaterialTable. Created on first call.
+	//!\note The texture's parameters and storage can't change once a handle exists,
+	//!      so set filtering and generate mipmaps first. Throws if unsupported.
+	GLuint64 bindlessHandle();
+
 private:
 	Texture(const Texture&);
 	Texture& operator=(const Texture&);
@@ -51,6 +59,7 @@ private:
 	size_t width_, height_;
 	GLenum target_, internalFormat_, format_, type_, border_;
 	GLuint tex_;
+	GLuint64 handle_;
 	
 	friend class CubemapTexture;
 };
@@ -0,0 +1,328 @@
+#include "TextureArray.hpp"
+#include "Exception.hpp"
+#include "RenderStats.hpp"
+#include "GpuMemory.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+namespace glhelper {
+
+namespace {
+
+size_t mipLevelsFor(size_t width, size_t height)
+{
+	size_t levels = 1;
+	size_t size = std::max(width, height);
+	while (size > 1) {
+		size >>= 1;
+		++levels;
+	}
+	return levels;
+}
+
+size_t channelsInFormat(GLenum format)
+{
+	switch (format) {
+	case GL_RED:
+		return 1;
+	case GL_BGR:
+		return 3;
+	case GL_BGRA:
+		return 4;
+	default:
+		throw std::runtime_error("TextureArrayBuilder: unsupported format.");
+	}
+}
+
+}
+
+TextureArray::TextureArray(GLenum internalFormat,
+	size_t width, size_t height, size_t layers,
+	GLenum minFilter, GLenum magFilter)
+	:width_(width), height_(height), layers_(layers),
+	internalFormat_(internalFormat)
+{
+	throwOnGlError();
+	glGenTextures(1, &tex_);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, tex_);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, GLsizei(mipLevelsFor(width, height)), internalFormat,
+		GLsizei(width), GLsizei(height), GLsizei(layers));
+	throwOnGlError();
+	GpuMemory::track(GpuResourceType::TEXTURE, tex_, width * height * layers * GpuMemory::texelBytes(internalFormat) * 4 / 3,
+		"texture array " + std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(layers));
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, minFilter);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, magFilter);
+	// Whole-layer textures tile as a GL_TEXTURE_2D would; atlas entries wrap in the shader.
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	throwOnGlError();
+}
+
+TextureArray::~TextureArray() throw()
+{
+	if (tex_ != 0) {
+		GpuMemory::untrack(GpuResourceType::TEXTURE, tex_);
+		glDeleteTextures(1, &tex_);
+	}
+}
+
+TextureArray::TextureArray(TextureArray &&other)
+	:width_(other.width_),
+	height_(other.height_),
+	layers_(other.layers_),
+	internalFormat_(other.internalFormat_),
+	tex_(other.tex_)
+{
+	other.tex_ = 0;
+}
+
+TextureArray &TextureArray::operator=(TextureArray &&other)
+{
+	if (tex_ != 0) {
+		GpuMemory::untrack(GpuResourceType::TEXTURE, tex_);
+		glDeleteTextures(1, &tex_);
+	}
+	width_ = other.width_;
+	height_ = other.height_;
+	layers_ = other.layers_;
+	internalFormat_ = other.internalFormat_;
+	tex_ = other.tex_;
+	other.tex_ = 0;
+	return *this;
+}
+
+void TextureArray::update(size_t layer, GLenum format, GLenum type, const void *data)
+{
+	update(layer, 0, 0, width_, height_, format, type, data);
+}
+
+void TextureArray::update(size_t layer, size_t x, size_t y, size_t width, size_t height,
+	GLenum format, GLenum type, const void *data)
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, tex_);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, GLint(x), GLint(y), GLint(layer),
+		GLsizei(width), GLsizei(height), 1, format, type, data);
+	RenderStats::recordUpload(RenderStats::imageBytes(format, type, width, height));
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	throwOnGlError();
+}
+
+void TextureArray::bindToImageUnit(GLuint unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, tex_);
+	RenderStats::recordStateChange();
+}
+
+void TextureArray::unbind()
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+GLuint TextureArray::tex()
+{
+	return tex_;
+}
+
+size_t TextureArray::width() const
+{
+	return width_;
+}
+
+size_t TextureArray::height() const
+{
+	return height_;
+}
+
+size_t TextureArray::layers() const
+{
+	return layers_;
+}
+
+GLenum TextureArray::internalFormat() const
+{
+	return internalFormat_;
+}
+
+void TextureArray::genMipmap()
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, tex_);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+TextureArrayBuilder::TextureArrayBuilder(size_t atlasSize, size_t smallTextureSize, size_t atlasPadding)
+	:atlasSize_(atlasSize),
+	smallTextureSize_(smallTextureSize),
+	atlasPadding_(atlasPadding)
+{
+	if (smallTextureSize_ + 2 * atlasPadding_ > atlasSize_) {
+		throw std::runtime_error("TextureArrayBuilder: small textures (plus padding) must fit in an atlas page.");
+	}
+}
+
+void TextureArrayBuilder::add(const std::string &name, const cv::Mat &image)
+{
+	if (image.empty() || image.depth() != CV_8U) {
+		throw std::runtime_error("TextureArrayBuilder: \"" + name + "\" is not an 8-bit image.");
+	}
+	Source s;
+	s.name = name;
+	s.width = image.cols;
+	s.height = image.rows;
+	switch (image.channels()) {
+	case 1:
+		s.internalFormat = GL_R8;
+		s.format = GL_RED;
+		break;
+	case 3:
+		s.internalFormat = GL_RGB8;
+		s.format = GL_BGR;
+		break;
+	case 4:
+		s.internalFormat = GL_RGBA8;
+		s.format = GL_BGRA;
+		break;
+	default:
+		throw std::runtime_error("TextureArrayBuilder: \"" + name + "\" must have 1, 3 or 4 channels.");
+	}
+	size_t rowBytes = s.width * image.channels();
+	s.pixels.resize(rowBytes * s.height);
+	for (size_t y = 0; y < s.height; ++y) {
+		memcpy(s.pixels.data() + y * rowBytes, image.ptr<unsigned char>(int(y)), rowBytes);
+	}
+	sources_.push_back(std::move(s));
+}
+
+void TextureArrayBuilder::packAtlases(const std::vector<Source*> &small, std::vector<ArrayDesc> &descs)
+{
+	// Group by format, then shelf-pack tallest first into atlasSize_ square pages.
+	std::map<GLenum, std::vector<Source*>> byFormat;
+	for (Source *s : small) {
+		byFormat[s->internalFormat].push_back(s);
+	}
+	for (auto &group : byFormat) {
+		std::vector<Source*> &srcs = group.second;
+		std::sort(srcs.begin(), srcs.end(), [](const Source *a, const Source *b) {
+			return a->height > b->height;
+		});
+
+		size_t arrayIndex = descs.size();
+		size_t page = 0, x = 0, y = 0, shelfHeight = 0;
+		for (Source *s : srcs) {
+			size_t w = s->width + 2 * atlasPadding_;
+			size_t h = s->height + 2 * atlasPadding_;
+			if (x + w > atlasSize_) {
+				x = 0;
+				y += shelfHeight;
+				shelfHeight = 0;
+			}
+			if (y + h > atlasSize_) {
+				++page;
+				x = y = shelfHeight = 0;
+			}
+			TextureSlot slot;
+			slot.array = arrayIndex;
+			slot.layer = GLint(page);
+			slot.uvTransform = Eigen::Vector4f(
+				float(x + atlasPadding_) / float(atlasSize_), float(y + atlasPadding_) / float(atlasSize_),
+				float(s->width) / float(atlasSize_), float(s->height) / float(atlasSize_));
+			slot.atlas = true;
+			slots_[s->name] = slot;
+			x += w;
+			shelfHeight = std::max(shelfHeight, h);
+		}
+		descs.push_back({ group.first, srcs[0]->format, atlasSize_, atlasSize_, page + 1, true });
+	}
+}
+
+void TextureArrayBuilder::build()
+{
+	arrays_.clear();
+	slots_.clear();
+
+	std::vector<ArrayDesc> descs;
+	std::vector<Source*> small;
+	// Large textures: one array per (format, size), one layer each.
+	std::map<std::tuple<GLenum, size_t, size_t>, size_t> largeArrays;
+	for (Source &s : sources_) {
+		if (std::max(s.width, s.height) <= smallTextureSize_) {
+			small.push_back(&s);
+			continue;
+		}
+		auto key = std::make_tuple(s.internalFormat, s.width, s.height);
+		auto it = largeArrays.find(key);
+		if (it == largeArrays.end()) {
+			it = largeArrays.emplace(key, descs.size()).first;
+			descs.push_back({ s.internalFormat, s.format, s.width, s.height, 0, false });
+		}
+		ArrayDesc &desc = descs[it->second];
+		slots_[s.name] = TextureSlot{ it->second, GLint(desc.layers), Eigen::Vector4f(0.f, 0.f, 1.f, 1.f), false };
+		++desc.layers;
+	}
+	packAtlases(small, descs);
+
+	for (const ArrayDesc &d : descs) {
+		arrays_.emplace_back(d.internalFormat, d.width, d.height, d.layers);
+		if (d.atlas) {
+			// Unused atlas space would otherwise be undefined.
+			std::vector<unsigned char> zeros(d.width * d.height * channelsInFormat(d.format), 0);
+			for (size_t layer = 0; layer < d.layers; ++layer) {
+				arrays_.back().update(layer, d.format, GL_UNSIGNED_BYTE, zeros.data());
+			}
+		}
+	}
+
+	GLint prevAlignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &prevAlignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (const Source &s : sources_) {
+		const TextureSlot &slot = slots_.at(s.name);
+		TextureArray &array = arrays_[slot.array];
+		if (!descs[slot.array].atlas) {
+			array.update(slot.layer, s.format, GL_UNSIGNED_BYTE, s.pixels.data());
+			continue;
+		}
+		// Copy into the page with the opposite edges wrapped into the padding, as GL_REPEAT
+		// would sample them, so bilinear filtering and the first few mip levels neither
+		// bleed in neighbours nor show a seam where tiling UVs wrap.
+		size_t c = channelsInFormat(s.format);
+		size_t pw = s.width + 2 * atlasPadding_, ph = s.height + 2 * atlasPadding_;
+		std::vector<unsigned char> padded(pw * ph * c);
+		for (size_t y = 0; y < ph; ++y) {
+			size_t sy = (y + s.height * atlasPadding_ - atlasPadding_) % s.height;
+			for (size_t x = 0; x < pw; ++x) {
+				size_t sx = (x + s.width * atlasPadding_ - atlasPadding_) % s.width;
+				memcpy(&padded[(y * pw + x) * c], &s.pixels[(sy * s.width + sx) * c], c);
+			}
+		}
+		size_t px = size_t(std::lround(slot.uvTransform[0] * atlasSize_)) - atlasPadding_;
+		size_t py = size_t(std::lround(slot.uvTransform[1] * atlasSize_)) - atlasPadding_;
+		array.update(slot.layer, px, py, pw, ph, s.format, GL_UNSIGNED_BYTE, padded.data());
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, prevAlignment);
+
+	for (TextureArray &array : arrays_) {
+		array.genMipmap();
+	}
+}
+
+std::vector<TextureArray> &TextureArrayBuilder::arrays()
+{
+	return arrays_;
+}
+
+const TextureSlot &TextureArrayBuilder::slot(const std::string &name) const
+{
+	auto it = slots_.find(name);
+	if (it == slots_.end()) {
+		throw std::runtime_error("TextureArrayBuilder: no texture named \"" + name + "\".");
+	}
+	return it->second;
+}
+
+}
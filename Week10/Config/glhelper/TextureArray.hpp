@@ -0,0 +1,111 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <Eigen/Dense>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cv {
+class Mat;
+}
+
+namespace glhelper {
+
+//!\brief Class encapsulating an OpenGL 2D array texture (GL_TEXTURE_2D_ARRAY).
+//!       Every layer has the same size and format.
+class TextureArray final
+{
+public:
+	explicit TextureArray(GLenum internalFormat,
+		size_t width, size_t height, size_t layers,
+		GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR,
+		GLenum magFilter = GL_LINEAR);
+	~TextureArray() throw();
+	TextureArray(TextureArray &&);
+	TextureArray &operator=(TextureArray &&);
+
+	//!\brief Replace the whole of one layer.
+	void update(size_t layer, GLenum format, GLenum type, const void *data);
+	//!\brief Replace a rectangle of one layer.
+	void update(size_t layer, size_t x, size_t y, size_t width, size_t height,
+		GLenum format, GLenum type, const void *data);
+
+	void bindToImageUnit(GLuint unit);
+	void unbind();
+
+	GLuint tex();
+
+	size_t width() const;
+	size_t height() const;
+	size_t layers() const;
+	GLenum internalFormat() const;
+
+	void genMipmap();
+
+private:
+	TextureArray(const TextureArray&);
+	TextureArray &operator=(const TextureArray&);
+
+	size_t width_, height_, layers_;
+	GLenum internalFormat_;
+	GLuint tex_;
+};
+
+//!\brief Location of one source texture inside the arrays built by TextureArrayBuilder.
+struct TextureSlot {
+	size_t array;  //!< Index into TextureArrayBuilder::arrays().
+	GLint layer;   //!< Layer within that array.
+	//!\brief Maps the texture's own UVs into the layer: uv' = uvTransform.xy + uv * uvTransform.zw.
+	//!       Identity (0, 0, 1, 1) unless the texture was packed into an atlas.
+	Eigen::Vector4f uvTransform;
+	//!\brief Whether the texture shares its layer in an atlas, so UVs outside [0,1] have to
+	//!       be wrapped into its rectangle in the shader (see TexturedMeshArray.frag) rather
+	//!       than by GL_REPEAT.
+	bool atlas;
+};
+
+//!\brief Combines many individual textures into a few array textures, so that
+//!       draws using different textures can share one binding.
+//!
+//!       Large textures are grouped by format and size, one layer each. Textures
+//!       no bigger than smallTextureSize are rectangle-packed into atlas pages of
+//!       atlasSize x atlasSize, with their UVs remapped via TextureSlot::uvTransform.
+//!\note Whole layers repeat with the sampler. Atlas entries must have their UVs wrapped
+//!      into their rectangle per fragment, as TexturedMeshArray.frag does.
+class TextureArrayBuilder final
+{
+public:
+	explicit TextureArrayBuilder(size_t atlasSize = 2048, size_t smallTextureSize = 512, size_t atlasPadding = 8);
+
+	//!\brief Add an 8-bit image with 1, 3 or 4 channels (BGR(A) order, as from cv::imread).
+	void add(const std::string &name, const cv::Mat &image);
+
+	//!\brief Create and fill the array textures. Needs an active GL context.
+	void build();
+
+	std::vector<TextureArray> &arrays();
+	const TextureSlot &slot(const std::string &name) const;
+
+private:
+	struct Source {
+		std::string name;
+		size_t width, height;
+		GLenum internalFormat, format;
+		std::vector<unsigned char> pixels; //!< Tightly packed rows.
+	};
+	struct ArrayDesc {
+		GLenum internalFormat, format;
+		size_t width, height, layers;
+		bool atlas;
+	};
+
+	void packAtlases(const std::vector<Source*> &small, std::vector<ArrayDesc> &descs);
+
+	size_t atlasSize_, smallTextureSize_, atlasPadding_;
+	std::vector<Source> sources_;
+	std::vector<TextureArray> arrays_;
+	std::map<std::string, TextureSlot> slots_;
+};
+
+}
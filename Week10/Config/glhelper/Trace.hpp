@@ -0,0 +1,65 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+namespace glhelper {
+
+//!\brief Records CPU and GPU timing events from any thread onto one timeline,
+//!       and streams them to a Chrome trace JSON file.
+//!
+//!       Open the file in chrome://tracing or https://ui.perfetto.dev. Each thread
+//!       appears as its own track, and GPU work (see gpuEvent, and
+//!       GpuProfiler::onResult) on a separate "GPU" track.
+//!
+//!       Recording an event only writes to a buffer owned by the calling thread,
+//!       with no locks. A background thread collects and writes out the buffers
+//!       every flushIntervalMs, and a thread's buffer is written out and freed when
+//!       the thread exits. While no trace is running, recording costs one atomic
+//!       load.
+class Trace final
+{
+public:
+	static void start(const std::string &path, unsigned flushIntervalMs = 500);
+	//!\brief Writes any remaining events and closes the file.
+	static void stop();
+	static bool active();
+
+	//!\brief Name shown for the calling thread's track.
+	static void setThreadName(const std::string &name);
+
+	//!\brief Nanoseconds on the trace clock (std::chrono::steady_clock).
+	static uint64_t now();
+	//!\brief Records a CPU event on the calling thread.
+	//!\note name must outlive the trace, e.g. a string literal.
+	static void cpuEvent(const char *name, uint64_t startNs, uint64_t endNs);
+
+	//!\brief Measures the offset between GL_TIMESTAMP and the trace clock. Call on
+	//!       the GL thread after start(), and every so often after that, since the
+	//!       two clocks drift.
+	static void calibrateGpu();
+	//!\brief Records a GPU event, given GL_TIMESTAMP values.
+	static void gpuEvent(const std::string &name, GLuint64 gpuStartNs, GLuint64 gpuEndNs);
+
+private:
+	Trace();
+};
+
+//!\brief Records the time between its construction and destruction as a CPU event.
+//!\note name must outlive the trace, e.g. a string literal.
+class TraceZone final
+{
+public:
+	explicit TraceZone(const char *name);
+	~TraceZone() throw();
+
+private:
+	TraceZone(const TraceZone&);
+	TraceZone &operator=(const TraceZone&);
+
+	const char *name_;
+	uint64_t start_;
+};
+
+}
@@ -0,0 +1,24 @@
+#version 430
+
+smooth in vec2 texCoord;
+flat in int texLayer;
+flat in vec4 uvTransform;
+flat in int atlas;
+
+uniform sampler2DArray tex;
+
+out vec4 color;
+
+void main()
+{
+	if (atlas != 0) {
+		// Tiling UVs wrap inside the texture's rectangle of the page, as GL_REPEAT would on a
+		// texture of its own. The gradients come from the unwrapped UVs, so the mip level
+		// doesn't jump where fract() does.
+		vec2 uv = uvTransform.xy + fract(texCoord) * uvTransform.zw;
+		color = textureGrad(tex, vec3(uv, texLayer), dFdx(texCoord) * uvTransform.zw, dFdy(texCoord) * uvTransform.zw);
+	} else {
+		color = texture(tex, vec3(texCoord, texLayer));
+	}
+	color.a = 1.0;
+}
@@ -0,0 +1,41 @@
+#version 430
+
+layout(location = 0) in vec3 vPos;
+layout(location = 2) in vec2 vTex;
+
+layout(std140) uniform cameraBlock
+{
+	mat4 worldToClip;
+	vec4 cameraPos;
+	vec4 cameraDir;
+};
+
+// One entry per instance, so many models can be drawn with one call.
+// uvTransform maps the model's own UVs into its layer (offset in xy, scale in zw).
+struct ModelInstance
+{
+	mat4 modelToWorld;
+	vec4 uvTransform;
+	ivec4 textureIndex; // x: array layer, y: material table entry, z: 1 if packed in an atlas
+};
+
+layout(std430, binding = 0) readonly buffer modelInstances
+{
+	ModelInstance instances[];
+};
+
+smooth out vec2 texCoord;
+flat out int texLayer;
+flat out vec4 uvTransform;
+flat out int atlas;
+
+void main()
+{
+	ModelInstance instance = instances[gl_InstanceID];
+	// Left in the model's own UV space: atlas entries are wrapped into their rectangle per fragment.
+	texCoord = vTex;
+	texLayer = instance.textureIndex.x;
+	uvTransform = instance.uvTransform;
+	atlas = instance.textureIndex.z;
+	gl_Position = worldToClip * instance.modelToWorld * vec4(vPos, 1.0f);
+}
@@ -0,0 +1,29 @@
+#version 430
+#extension GL_ARB_bindless_texture : enable
+
+smooth in vec2 texCoord;
+
+// The draw's entry in the material table. A uniform, so the sampler built from the handle is
+// dynamically uniform, which GL_ARB_bindless_texture needs without GL_NV_gpu_shader5:
+// config_scene draws the models of each material separately.
+uniform int materialIndex;
+
+// Resident texture handles written by glhelper::MaterialTable, stored as uvec2
+// so the block layout doesn't depend on 64-bit integer support.
+layout(std430, binding = 1) readonly buffer materialTable
+{
+	uvec2 textureHandles[];
+};
+
+out vec4 color;
+
+void main()
+{
+#ifdef GL_ARB_bindless_texture
+	color = texture(sampler2D(textureHandles[materialIndex]), texCoord);
+#else
+	// Only loaded when bindless textures are supported, but keep it compiling elsewhere.
+	color = vec4(1.0, 0.0, 1.0, 1.0);
+#endif
+	color.a = 1.0;
+}
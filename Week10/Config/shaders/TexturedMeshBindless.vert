@@ -0,0 +1,35 @@
+#version 430
+
+layout(location = 0) in vec3 vPos;
+layout(location = 2) in vec2 vTex;
+
+layout(std140) uniform cameraBlock
+{
+	mat4 worldToClip;
+	vec4 cameraPos;
+	vec4 cameraDir;
+};
+
+// One entry per instance, so many models can be drawn with one call.
+// Only the transform is used here: the material comes from a uniform, as it must be the same
+// for the whole draw (see TexturedMeshBindless.frag).
+struct ModelInstance
+{
+	mat4 modelToWorld;
+	vec4 uvTransform;
+	ivec4 textureIndex; // x: array layer, y: material table entry, z: 1 if packed in an atlas
+};
+
+layout(std430, binding = 0) readonly buffer modelInstances
+{
+	ModelInstance instances[];
+};
+
+smooth out vec2 texCoord;
+
+void main()
+{
+	ModelInstance instance = instances[gl_InstanceID];
+	texCoord = vTex;
+	gl_Position = worldToClip * instance.modelToWorld * vec4(vPos, 1.0f);
+}
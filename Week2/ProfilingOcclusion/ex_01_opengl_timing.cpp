@@ -8,6 +8,10 @@
 #include "glhelper/RotateViewer.hpp"
 #include "glhelper/FlyViewer.hpp"
 #include "glhelper/Mesh.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/Trace.hpp"
 #define GLT_IMPLEMENTATION
 #include <gltext.h>
 #include "assimp/Importer.hpp"
@@ -32,6 +36,7 @@ const Uint64 desiredFrametime = 33;
 
 void loadMesh(glhelper::Mesh* mesh, const std::string &filename) 
 {
+	glhelper::TraceZone zone("loadMesh");
 	Assimp::Importer importer;
 	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
 	const aiScene* aiscene = importer.GetScene();
@@ -66,8 +71,13 @@ Eigen::Matrix4f makeTranslationMatrix(const Eigen::Vector3f& translate)
 	return matrix;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
@@ -123,16 +133,21 @@ int main()
 
 		unsigned long long frameIdx = 0;
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-			viewer.update();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 
@@ -165,15 +180,14 @@ int main()
 			gltDrawText2D(text, 10.f, 10.f, 1.f);
 			gltEndDraw();
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 
 			++frameIdx;
 		}
+		benchmark.finish();
 
 		// -- Your code here --
 		// Destroy your GL query objects
@@ -182,9 +196,10 @@ int main()
 	gltDestroyText(text);
 	gltTerminate();
 
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
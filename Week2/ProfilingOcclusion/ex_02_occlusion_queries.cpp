@@ -8,6 +8,11 @@
 #include "glhelper/RotateViewer.hpp"
 #include "glhelper/FlyViewer.hpp"
 #include "glhelper/Mesh.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/mesh.h"
@@ -46,6 +51,7 @@ Mode mode = Mode::SHOW_VISIBILITY;
 
 void loadMesh(glhelper::Mesh* mesh, const std::string& filename)
 {
+	glhelper::TraceZone zone("loadMesh");
 	Assimp::Importer importer;
 	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
 	const aiScene* aiscene = importer.GetScene();
@@ -72,8 +78,13 @@ void loadMesh(glhelper::Mesh* mesh, const std::string& filename)
 	mesh->elems(elems);
 	mesh->tex(uvs);
 }
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
@@ -100,6 +111,7 @@ int main()
 	gltInit();
 	GLTtext* text = gltCreateText();
 	gltSetText(text, "REPLACE ME WITH PERFORMANCE TIMINGS");
+	GLTtext* profilerText = gltCreateText();
 
 	{
 		glhelper::ShaderProgram fixedColorShader({ "../shaders/FixedColor.vert", "../shaders/FixedColor.frag" });
@@ -136,16 +148,25 @@ int main()
 		// --- Your Code Here ---
 		// Generate your query objects (for sample count, and for visibility)
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-			viewer.update();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 				if (event.key.keysym.sym == SDLK_SPACE) {
@@ -155,6 +176,7 @@ int main()
 			}
 			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
 
 			glDisable(GL_CULL_FACE);
 
@@ -177,18 +199,23 @@ int main()
 			// Get the results from the query object (based on mode) and
 			// use them to update the text displayed.
 
+			profiler.end("scene");
+			if (profiler.reportUpdated()) {
+				gltSetText(profilerText, profiler.report().c_str());
+			}
+
 			gltBeginDraw();
 			gltColor(1.f, 1.f, 1.f, 1.f);
 			gltDrawText2D(text, 10.f, 10.f, 1.f);
+			gltDrawText2DAligned(profilerText, 10.f, float(winHeight) - 10.f, 1.f, GLT_LEFT, GLT_BOTTOM);
 			gltEndDraw();
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		benchmark.finish();
 
 		// --- Your Code Here ---
 		// Remember to delete your query objects
@@ -197,10 +224,12 @@ int main()
 
 
 	gltDestroyText(text);
+	gltDestroyText(profilerText);
 	gltTerminate();
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
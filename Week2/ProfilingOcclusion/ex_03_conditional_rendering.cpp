@@ -8,6 +8,11 @@
 #include "glhelper/RotateViewer.hpp"
 #include "glhelper/FlyViewer.hpp"
 #include "glhelper/Mesh.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/mesh.h"
@@ -51,6 +56,7 @@ bool moonRotating = true;
 
 void loadMesh(glhelper::Mesh* mesh, const std::string& filename)
 {
+	glhelper::TraceZone zone("loadMesh");
 	Assimp::Importer importer;
 	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
 	const aiScene* aiscene = importer.GetScene();
@@ -97,8 +103,13 @@ GLuint createTexture(const cv::Mat& image)
 	return texture;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
@@ -125,6 +136,7 @@ int main()
 	gltInit();
 	GLTtext* text = gltCreateText();
 	gltSetText(text, "REPLACE ME WITH PERFORMANCE TIMINGS");
+	GLTtext* profilerText = gltCreateText();
 
 	{
 		glhelper::ShaderProgram fixedColorShader({ "../shaders/FixedColor.vert", "../shaders/FixedColor.frag" });
@@ -169,16 +181,25 @@ int main()
 		// --- Your Code Here ---
 		// Make the query objects you need for timing and visibility
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-			viewer.update();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 
@@ -193,6 +214,7 @@ int main()
 			}
 			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
 
 			glDisable(GL_CULL_FACE);
 
@@ -233,18 +255,23 @@ int main()
 			// Is conditional rendering on or off?
 			// How long did it take to render the nice textured moon?
 
+			profiler.end("scene");
+			if (profiler.reportUpdated()) {
+				gltSetText(profilerText, profiler.report().c_str());
+			}
+
 			gltBeginDraw();
 			gltColor(1.f, 1.f, 1.f, 1.f);
 			gltDrawText2D(text, 10.f, 10.f, 1.f);
+			gltDrawText2DAligned(profilerText, 10.f, float(winHeight) - 10.f, 1.f, GLT_LEFT, GLT_BOTTOM);
 			gltEndDraw();
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		benchmark.finish();
 
 		// --- Your Code Here ---
 		// Delete your query objects.
@@ -256,10 +283,12 @@ int main()
 
 
 	gltDestroyText(text);
+	gltDestroyText(profilerText);
 	gltTerminate();
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
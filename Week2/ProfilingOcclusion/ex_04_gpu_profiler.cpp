@@ -0,0 +1,218 @@
+#define SDL_MAIN_HANDLED
+#include <GL/glew.h>
+#include <SDL.h>
+#include <iostream>
+#include <exception>
+#include <cmath>
+#include "glhelper/ShaderProgram.hpp"
+#include "glhelper/RotateViewer.hpp"
+#include "glhelper/FlyViewer.hpp"
+#include "glhelper/Mesh.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/RenderStats.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/Trace.hpp"
+#define GLT_IMPLEMENTATION
+#include <gltext.h>
+#include "assimp/Importer.hpp"
+#include "assimp/postprocess.h"
+#include "assimp/mesh.h"
+#include "assimp/scene.h"
+#include <opencv2/opencv.hpp>
+
+/* This program times the same two spheres as ex_01_opengl_timing, using glhelper::GpuProfiler.
+* Rather than waiting for each query's result straight away (which stalls the CPU until the GPU catches up),
+* the profiler keeps a ring of timestamp queries and reads each frame's results a few frames later, once
+* they're available. It keeps a rolling history per scope and reports min/avg/max/99th percentile times.
+* You can move around the meshes using the WASD keys, QE keys and mouse.
+* 1/2 turn MSAA on/off - compare how much each sphere's time changes.
+* The table on the right is glhelper::RenderStats: draw calls, state changes and uploads counted by glhelper,
+* and vertex/primitive/fragment shader invocations from GL_ARB_pipeline_statistics_query.
+* Watch the fragment shader invocations when you toggle MSAA, or move a sphere to fill the screen.
+*/
+
+const int winWidth = 1024, winHeight = 768;
+
+const Uint64 desiredFrametime = 33;
+
+void loadMesh(glhelper::Mesh* mesh, const std::string &filename) 
+{
+	glhelper::TraceZone zone("loadMesh");
+	Assimp::Importer importer;
+	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
+	const aiScene* aiscene = importer.GetScene();
+	const aiMesh* aimesh = aiscene->mMeshes[0];
+
+	std::vector<Eigen::Vector3f> verts(aimesh->mNumVertices);
+	std::vector<Eigen::Vector3f> norms(aimesh->mNumVertices);
+	std::vector<Eigen::Vector2f> uvs(aimesh->mNumVertices);
+	std::vector<GLuint> elems(aimesh->mNumFaces*3);
+	memcpy(verts.data(), aimesh->mVertices, aimesh->mNumVertices * sizeof(aiVector3D));
+	memcpy(norms.data(), aimesh->mNormals, aimesh->mNumVertices * sizeof(aiVector3D));
+	for (size_t v = 0; v < aimesh->mNumVertices; ++v) {
+		uvs[v][0] = aimesh->mTextureCoords[0][v].x;
+		uvs[v][1] = 1.f-aimesh->mTextureCoords[0][v].y;
+	}
+	for (size_t f = 0; f < aimesh->mNumFaces; ++f) {
+		for (size_t i = 0; i < 3; ++i) {
+			elems[f * 3 + i] = aimesh->mFaces[f].mIndices[i];
+		}
+	}
+
+	mesh->vert(verts);
+	mesh->norm(norms);
+	mesh->elems(elems);
+	mesh->tex(uvs);
+}
+
+Eigen::Matrix4f makeTranslationMatrix(const Eigen::Vector3f& translate)
+{
+	Eigen::Matrix4f matrix = Eigen::Matrix4f::Identity();
+	matrix.block<3, 1>(0, 3) = translate;
+	return matrix;
+}
+
+int main(int argc, char *argv[])
+{
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
+	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
+
+	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 1);
+	// Turns on 4x MSAA
+	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
+	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
+
+	// Prepare window
+	SDL_Window* window = SDL_CreateWindow("A test window", 50, 50, winWidth, winHeight, SDL_WINDOW_OPENGL);
+	SDL_GLContext context = SDL_GL_CreateContext(window);
+
+	GLenum result = glewInit();
+	if (result != GLEW_OK) {
+		throw std::runtime_error("GLEW couldn't initialize.");
+	}
+
+	glEnable(GL_MULTISAMPLE);
+
+	gltInit();
+	GLTtext* text = gltCreateText();
+	gltSetText(text, "Waiting for GPU timings...");
+	GLTtext* statsText = gltCreateText();
+	gltSetText(statsText, glhelper::RenderStats::table().c_str());
+	glhelper::RenderStats::enablePipelineStatistics(true);
+
+	{
+		glhelper::ShaderProgram fixedColorShader({ "../shaders/FixedColor.vert", "../shaders/FixedColor.frag" });
+		glProgramUniform4f(fixedColorShader.get(), fixedColorShader.uniformLoc("color"), 0.1f, 0.8f, 0.8f, 1.0f);
+		//glhelper::RotateViewer viewer(winWidth, winHeight);
+		glhelper::FlyViewer viewer(winWidth, winHeight);
+		viewer.position(Eigen::Vector3f(0.f, 0.f, -10.f));
+		glhelper::Mesh lowPolyMesh, highPolyMesh;
+
+        loadMesh(&lowPolyMesh, "../models/lowPolySphere.obj");
+        loadMesh(&highPolyMesh, "../models/highPolySphere.obj");
+		lowPolyMesh.shaderProgram(&fixedColorShader);
+		highPolyMesh.shaderProgram(&fixedColorShader);
+		lowPolyMesh.modelToWorld(makeTranslationMatrix(Eigen::Vector3f(-3.f, 0.f, 0.f)));
+		highPolyMesh.modelToWorld(makeTranslationMatrix(Eigen::Vector3f(3.f, 0.f, 0.f)));
+
+		bool shouldQuit = false;
+		SDL_Event event;
+
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		glhelper::GpuProfiler profiler;
+
+		unsigned long long frameIdx = 0;
+
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (!benchmark.active()) {
+				viewer.update();
+			}
+			profiler.beginFrame();
+
+			while (SDL_PollEvent(&event)) {
+				// Check for X of window being clicked, or ALT+F4
+				if (event.type == SDL_QUIT) {
+					shouldQuit = true;
+				}
+				else if (!benchmark.active()) {
+					viewer.processEvent(event);
+				}
+
+				if (event.type == SDL_KEYDOWN) {
+					if (event.key.keysym.sym == SDLK_1) {
+						glEnable(GL_MULTISAMPLE);
+					}
+					else if (event.key.keysym.sym == SDLK_2) {
+						glDisable(GL_MULTISAMPLE);
+					}
+				}
+			}
+			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			{
+				glhelper::GpuScope scope(profiler, "low poly");
+				lowPolyMesh.render();
+			}
+			{
+				glhelper::GpuScope scope(profiler, "high poly");
+				highPolyMesh.render();
+			}
+
+			// Updating the text every frame makes it unreadable.
+			if ((frameIdx + 1) % 30 == 0) {
+				gltSetText(text, profiler.report().c_str());
+			}
+			if (glhelper::RenderStats::tableUpdated()) {
+				gltSetText(statsText, glhelper::RenderStats::table().c_str());
+			}
+
+			{
+				glhelper::GpuScope scope(profiler, "hud");
+				gltBeginDraw();
+				gltColor(1.f, 1.f, 1.f, 1.f);
+				gltDrawText2D(text, 10.f, 10.f, 1.f);
+				gltDrawText2D(statsText, float(winWidth) - 280.f, 10.f, 1.f);
+				gltEndDraw();
+			}
+
+			benchmark.endFrame();
+			SDL_GL_SwapWindow(window);
+
+			framePacer.endFrame();
+
+			++frameIdx;
+		}
+		benchmark.finish();
+	}
+
+	gltDestroyText(statsText);
+	gltDestroyText(text);
+	gltTerminate();
+
+	glhelper::GpuMemory::reportLeaks(std::cerr);
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+
+	return benchmark.exitCode();
+}
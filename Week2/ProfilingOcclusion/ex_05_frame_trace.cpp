@@ -0,0 +1,279 @@
+#define SDL_MAIN_HANDLED
+#include <GL/glew.h>
+#include <SDL.h>
+#include <iostream>
+#include <exception>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include "glhelper/ShaderProgram.hpp"
+#include "glhelper/RotateViewer.hpp"
+#include "glhelper/FlyViewer.hpp"
+#include "glhelper/Mesh.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#define GLT_IMPLEMENTATION
+#include <gltext.h>
+#include "assimp/Importer.hpp"
+#include "assimp/postprocess.h"
+#include "assimp/mesh.h"
+#include "assimp/scene.h"
+#include <opencv2/opencv.hpp>
+
+/* This program records a trace of everything happening in a frame - on the CPU, across threads, and on the GPU -
+* using glhelper::Trace, and writes it to ../trace.json. Open that in chrome://tracing or https://ui.perfetto.dev
+* after closing the window.
+*
+* The scene is a grid of low- and high-poly spheres. Each frame the main thread animates them ("simulate"), skips
+* any behind the camera ("cull") and draws the rest, with GPU times collected by GpuProfiler. Meanwhile a worker
+* thread repeatedly denoises an image with the three OpenCV filters from ex_00_cpp_timing, so you can see how
+* the threads and the GPU overlap.
+* You can move around using the WASD keys, QE keys and mouse.
+*/
+
+const int winWidth = 1024, winHeight = 768;
+
+const Uint64 desiredFrametime = 33;
+
+const int gridSize = 8;
+const float gridSpacing = 3.f;
+
+void loadMesh(glhelper::Mesh* mesh, const std::string &filename) 
+{
+	glhelper::TraceZone zone("loadMesh");
+	Assimp::Importer importer;
+	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
+	const aiScene* aiscene = importer.GetScene();
+	const aiMesh* aimesh = aiscene->mMeshes[0];
+
+	std::vector<Eigen::Vector3f> verts(aimesh->mNumVertices);
+	std::vector<Eigen::Vector3f> norms(aimesh->mNumVertices);
+	std::vector<Eigen::Vector2f> uvs(aimesh->mNumVertices);
+	std::vector<GLuint> elems(aimesh->mNumFaces*3);
+	memcpy(verts.data(), aimesh->mVertices, aimesh->mNumVertices * sizeof(aiVector3D));
+	memcpy(norms.data(), aimesh->mNormals, aimesh->mNumVertices * sizeof(aiVector3D));
+	for (size_t v = 0; v < aimesh->mNumVertices; ++v) {
+		uvs[v][0] = aimesh->mTextureCoords[0][v].x;
+		uvs[v][1] = 1.f-aimesh->mTextureCoords[0][v].y;
+	}
+	for (size_t f = 0; f < aimesh->mNumFaces; ++f) {
+		for (size_t i = 0; i < 3; ++i) {
+			elems[f * 3 + i] = aimesh->mFaces[f].mIndices[i];
+		}
+	}
+
+	mesh->vert(verts);
+	mesh->norm(norms);
+	mesh->elems(elems);
+	mesh->tex(uvs);
+}
+
+Eigen::Matrix4f makeTranslationMatrix(const Eigen::Vector3f& translate)
+{
+	Eigen::Matrix4f matrix = Eigen::Matrix4f::Identity();
+	matrix.block<3, 1>(0, 3) = translate;
+	return matrix;
+}
+
+int main(int argc, char *argv[])
+{
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
+	glhelper::Trace::start("../trace.json");
+	glhelper::Trace::setThreadName("Main thread");
+
+	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
+
+	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 1);
+	// Turns on 4x MSAA
+	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
+	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
+
+	// Prepare window
+	SDL_Window* window = SDL_CreateWindow("Frame trace", 50, 50, winWidth, winHeight, SDL_WINDOW_OPENGL);
+	SDL_GLContext context = SDL_GL_CreateContext(window);
+
+	GLenum result = glewInit();
+	if (result != GLEW_OK) {
+		throw std::runtime_error("GLEW couldn't initialize.");
+	}
+
+	glEnable(GL_MULTISAMPLE);
+
+	gltInit();
+	GLTtext* text = gltCreateText();
+	gltSetText(text, "Recording trace to ../trace.json");
+
+	// Background image processing, traced on its own track.
+	std::atomic<bool> stopWorker(false);
+	std::thread worker([&stopWorker]() {
+		glhelper::Trace::setThreadName("Denoise worker");
+		cv::Mat noisyImage;
+		{
+			glhelper::TraceZone zone("loadImage");
+			noisyImage = cv::imread("../images/car_noisy.jpg");
+		}
+		cv::Mat filtered;
+		while (!stopWorker) {
+			{
+				glhelper::TraceZone zone("GaussianBlur");
+				cv::GaussianBlur(noisyImage, filtered, cv::Size(9, 9), 4.f, 4.f);
+			}
+			{
+				glhelper::TraceZone zone("bilateralFilter");
+				cv::bilateralFilter(noisyImage, filtered, 9, 100.f, 5.f);
+			}
+			{
+				glhelper::TraceZone zone("medianBlur");
+				cv::medianBlur(noisyImage, filtered, 5);
+			}
+		}
+	});
+
+	{
+		glhelper::ShaderProgram fixedColorShader({ "../shaders/FixedColor.vert", "../shaders/FixedColor.frag" });
+		glProgramUniform4f(fixedColorShader.get(), fixedColorShader.uniformLoc("color"), 0.1f, 0.8f, 0.8f, 1.0f);
+		glhelper::FlyViewer viewer(winWidth, winHeight);
+		viewer.position(Eigen::Vector3f(0.f, 0.f, -20.f));
+		glhelper::Mesh lowPolyMesh, highPolyMesh;
+
+		loadMesh(&lowPolyMesh, "../models/lowPolySphere.obj");
+		loadMesh(&highPolyMesh, "../models/highPolySphere.obj");
+		lowPolyMesh.shaderProgram(&fixedColorShader);
+		highPolyMesh.shaderProgram(&fixedColorShader);
+
+		std::vector<Eigen::Vector3f> spherePositions(gridSize * gridSize);
+		std::vector<bool> sphereVisible(spherePositions.size());
+
+		bool shouldQuit = false;
+		SDL_Event event;
+
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		glhelper::GpuProfiler profiler;
+		glhelper::Trace::calibrateGpu();
+		profiler.onResult(glhelper::Trace::gpuEvent);
+
+		unsigned long long frameIdx = 0;
+
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		while (!shouldQuit && !benchmark.finished()) {
+			glhelper::TraceZone frameZone("frame");
+			framePacer.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (!benchmark.active()) {
+				viewer.update();
+			}
+			profiler.beginFrame();
+			// GL_TIMESTAMP and the CPU clock drift apart slowly, so re-measure the offset now and then.
+			if (frameIdx % 60 == 0) {
+				glhelper::Trace::calibrateGpu();
+			}
+
+			{
+				glhelper::TraceZone zone("events");
+				while (SDL_PollEvent(&event)) {
+					// Check for X of window being clicked, or ALT+F4
+					if (event.type == SDL_QUIT) {
+						shouldQuit = true;
+					}
+					else if (!benchmark.active()) {
+						viewer.processEvent(event);
+					}
+				}
+			}
+
+			{
+				glhelper::TraceZone zone("simulate");
+				float t = float(frameIdx) * 0.05f;
+				for (int y = 0; y < gridSize; ++y) {
+					for (int x = 0; x < gridSize; ++x) {
+						spherePositions[y * gridSize + x] = Eigen::Vector3f(
+							gridSpacing * (float(x) - 0.5f * float(gridSize - 1)),
+							std::sin(t + 0.5f * float(x + y)),
+							gridSpacing * (float(y) - 0.5f * float(gridSize - 1)));
+					}
+				}
+			}
+
+			{
+				glhelper::TraceZone zone("cull");
+				// Skip spheres entirely behind the camera (camera looks down -z).
+				Eigen::Matrix4f worldToCam = viewer.worldToCam();
+				for (size_t i = 0; i < spherePositions.size(); ++i) {
+					Eigen::Vector4f p = worldToCam * spherePositions[i].homogeneous();
+					sphereVisible[i] = p.z() < 1.f;
+				}
+			}
+
+			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			{
+				glhelper::TraceZone zone("draw spheres");
+				glhelper::GpuScope scope(profiler, "spheres");
+				for (size_t i = 0; i < spherePositions.size(); ++i) {
+					if (!sphereVisible[i]) {
+						continue;
+					}
+					glhelper::Mesh &mesh = (i % 2) ? highPolyMesh : lowPolyMesh;
+					mesh.modelToWorld(makeTranslationMatrix(spherePositions[i]));
+					mesh.render();
+				}
+			}
+
+			{
+				glhelper::TraceZone zone("draw hud");
+				glhelper::GpuScope scope(profiler, "hud");
+				gltBeginDraw();
+				gltColor(1.f, 1.f, 1.f, 1.f);
+				gltDrawText2D(text, 10.f, 10.f, 1.f);
+				gltEndDraw();
+			}
+
+			benchmark.endFrame();
+
+			{
+				glhelper::TraceZone zone("swap");
+				SDL_GL_SwapWindow(window);
+			}
+
+			{
+				glhelper::TraceZone zone("pace");
+				framePacer.endFrame();
+			}
+
+			++frameIdx;
+		}
+		benchmark.finish();
+	}
+
+	stopWorker = true;
+	worker.join();
+	glhelper::Trace::stop();
+
+	gltDestroyText(text);
+	gltTerminate();
+
+	glhelper::GpuMemory::reportLeaks(std::cerr);
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+
+	return benchmark.exitCode();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+namespace glhelper {
+
+//!\brief Histogram of durations in milliseconds, with fixed-width bins, for
+//!       cheap percentile queries over long runs.
+class FrameTimeHistogram final
+{
+public:
+	explicit FrameTimeHistogram(double binWidthMs = 0.05, double rangeMs = 250.0);
+
+	void add(double ms);
+
+	size_t count() const;
+	double mean() const;
+	double max() const;
+	//!\brief Value below which fraction p (0-1) of samples lie, to within a bin width.
+	double percentile(double p) const;
+	size_t countAbove(double ms) const;
+
+private:
+	double binWidthMs_;
+	std::vector<size_t> bins_;
+	size_t overflow_, count_;
+	double sum_, max_;
+};
+
+//!\brief Paces a main loop to a target frame time, and records how long frames
+//!       really take.
+//!
+//!       Replaces SDL_GetTicks64/SDL_Delay pacing, which only has millisecond
+//!       resolution and often oversleeps. Waits use a steady high-resolution clock:
+//!       they sleep while plenty of time is left, then spin for the last couple of
+//!       milliseconds. Deadlines advance by exactly one period per frame, so small
+//!       errors don't accumulate.
+//!
+//!       Records CPU frame time (beginFrame to endFrame), GPU frame time (from
+//!       GL_TIMESTAMP queries, read a few frames later without stalling) and the
+//!       interval between presents. The destructor prints percentiles of each,
+//!       plus a count of stutters.
+//!
+//!       Usage:
+//!           FramePacer pacer(33.0);
+//!           while (...) {
+//!               pacer.beginFrame();
+//!               ...
+//!               SDL_GL_SwapWindow(window);
+//!               pacer.endFrame();
+//!           }
+//!\note Must be created, used and destroyed on the thread owning the GL context.
+class FramePacer final
+{
+public:
+	//!\param targetFrameMs Frame period to pace to, or 0 to only measure (e.g. with vsync).
+	explicit FramePacer(double targetFrameMs, bool measureGpu = true);
+	~FramePacer() throw();
+
+	void beginFrame();
+	//!\brief Call after swapping buffers. Waits until the next frame is due.
+	void endFrame();
+
+	const FrameTimeHistogram &cpuFrameTimes() const;
+	const FrameTimeHistogram &gpuFrameTimes() const;
+	const FrameTimeHistogram &presentIntervals() const;
+	//!\brief Presents that took longer than 1.5x the target (or the median, if not pacing).
+	size_t stutters() const;
+
+	void report(std::ostream &out) const;
+
+private:
+	FramePacer(const FramePacer&);
+	FramePacer &operator=(const FramePacer&);
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct GpuFrame {
+		GLuint startQuery, endQuery;
+		bool pending;
+	};
+
+	void collectGpuTimes();
+	void waitUntil(Clock::time_point deadline);
+
+	double targetFrameMs_;
+	bool measureGpu_;
+	Clock::time_point frameStart_, deadline_, lastPresent_;
+	bool started_;
+	std::vector<GpuFrame> gpuFrames_;
+	size_t currentGpuFrame_;
+	bool gpuFrameOpen_;
+	FrameTimeHistogram cpu_, gpu_, present_;
+};
+
+}
@@ -0,0 +1,253 @@
+#include "GpuMemory.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <utility>
+
+namespace glhelper {
+
+namespace {
+
+// GL_NVX_gpu_memory_info and GL_ATI_meminfo enums, which not every GLEW declares.
+const GLenum gpuMemoryTotalAvailableNvx = 0x9048;
+const GLenum gpuMemoryCurrentAvailableNvx = 0x9049;
+const GLenum textureFreeMemoryAti = 0x87FC;
+
+const size_t nTypes = 6;
+const char *const typeNames[nTypes] = { "buffer", "texture", "program", "vertex array", "framebuffer", "renderbuffer" };
+
+typedef std::pair<GpuResourceType, GLuint> Key;
+
+struct State {
+	std::map<Key, GpuAllocation> allocations;
+	size_t bytes[nTypes] = {};
+	size_t count[nTypes] = {};
+	size_t generation = 0;
+	std::vector<std::string> scopes;
+	size_t budget = 0;
+	bool budgetSet = false;
+};
+
+State state;
+
+size_t typeIndex(GpuResourceType type)
+{
+	return size_t(type);
+}
+
+void formatBytes(char *buf, size_t size, double bytes)
+{
+	if (bytes >= 1024.0 * 1024.0 * 1024.0) {
+		snprintf(buf, size, "%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+	} else if (bytes >= 1024.0 * 1024.0) {
+		snprintf(buf, size, "%.1f MB", bytes / (1024.0 * 1024.0));
+	} else {
+		snprintf(buf, size, "%.1f KB", bytes / 1024.0);
+	}
+}
+
+size_t driverTotalBytes()
+{
+	if (!GLEW_NVX_gpu_memory_info) {
+		return 0;
+	}
+	GLint kb = 0;
+	glGetIntegerv(gpuMemoryTotalAvailableNvx, &kb);
+	return size_t(kb) * 1024;
+}
+
+}
+
+void GpuMemory::track(GpuResourceType type, GLuint id, size_t bytes, const std::string &description)
+{
+	std::string site;
+	for (const std::string &s : state.scopes) {
+		site += s + "/";
+	}
+	site += description;
+	// GL names are reused once deleted, so replace anything left under the same name.
+	untrack(type, id);
+	state.allocations[Key(type, id)] = GpuAllocation{ type, id, bytes, site };
+	state.bytes[typeIndex(type)] += bytes;
+	++state.count[typeIndex(type)];
+	++state.generation;
+}
+
+void GpuMemory::resize(GpuResourceType type, GLuint id, size_t bytes)
+{
+	std::map<Key, GpuAllocation>::iterator it = state.allocations.find(Key(type, id));
+	if (it == state.allocations.end()) {
+		return;
+	}
+	state.bytes[typeIndex(type)] += bytes;
+	state.bytes[typeIndex(type)] -= it->second.bytes;
+	it->second.bytes = bytes;
+	++state.generation;
+}
+
+void GpuMemory::untrack(GpuResourceType type, GLuint id)
+{
+	std::map<Key, GpuAllocation>::iterator it = state.allocations.find(Key(type, id));
+	if (it == state.allocations.end()) {
+		return;
+	}
+	state.bytes[typeIndex(type)] -= it->second.bytes;
+	--state.count[typeIndex(type)];
+	state.allocations.erase(it);
+	++state.generation;
+}
+
+size_t GpuMemory::totalBytes()
+{
+	size_t total = 0;
+	for (size_t b : state.bytes) {
+		total += b;
+	}
+	return total;
+}
+
+size_t GpuMemory::bytes(GpuResourceType type)
+{
+	return state.bytes[typeIndex(type)];
+}
+
+size_t GpuMemory::count(GpuResourceType type)
+{
+	return state.count[typeIndex(type)];
+}
+
+std::vector<GpuAllocation> GpuMemory::allocations()
+{
+	std::vector<GpuAllocation> all;
+	all.reserve(state.allocations.size());
+	for (const std::pair<const Key, GpuAllocation> &a : state.allocations) {
+		all.push_back(a.second);
+	}
+	std::stable_sort(all.begin(), all.end(), [](const GpuAllocation &a, const GpuAllocation &b) {
+		return a.bytes > b.bytes;
+	});
+	return all;
+}
+
+size_t GpuMemory::generation()
+{
+	return state.generation;
+}
+
+void GpuMemory::setBudget(size_t bytes)
+{
+	state.budget = bytes;
+	state.budgetSet = true;
+}
+
+size_t GpuMemory::driverFreeBytes()
+{
+	if (GLEW_NVX_gpu_memory_info) {
+		GLint kb = 0;
+		glGetIntegerv(gpuMemoryCurrentAvailableNvx, &kb);
+		return size_t(kb) * 1024;
+	}
+	if (GLEW_ATI_meminfo) {
+		// Total free, largest free block, total auxiliary free, largest auxiliary block.
+		GLint kb[4] = {};
+		glGetIntegerv(textureFreeMemoryAti, kb);
+		return size_t(kb[0]) * 1024;
+	}
+	return 0;
+}
+
+std::string GpuMemory::budget(size_t largest)
+{
+	if (!state.budgetSet) {
+		state.budget = driverTotalBytes();
+		state.budgetSet = true;
+	}
+	std::string text;
+	char line[128], used[32], limit[32];
+	size_t total = totalBytes();
+	formatBytes(used, sizeof(used), double(total));
+	if (state.budget > 0) {
+		formatBytes(limit, sizeof(limit), double(state.budget));
+		snprintf(line, sizeof(line), "GPU memory %s / %s (%.0f%%)%s\n", used, limit,
+			100.0 * double(total) / double(state.budget), total > state.budget ? " OVER BUDGET" : "");
+	} else {
+		snprintf(line, sizeof(line), "GPU memory %s\n", used);
+	}
+	text += line;
+	for (size_t t = 0; t < nTypes; ++t) {
+		formatBytes(used, sizeof(used), double(state.bytes[t]));
+		snprintf(line, sizeof(line), "  %-13s %5zu %11s\n", typeNames[t], state.count[t], used);
+		text += line;
+	}
+	size_t driverFree = driverFreeBytes();
+	if (driverFree > 0) {
+		formatBytes(used, sizeof(used), double(driverFree));
+		snprintf(line, sizeof(line), "  driver free %s\n", used);
+		text += line;
+	}
+	std::vector<GpuAllocation> all = allocations();
+	for (size_t i = 0; i < std::min(largest, all.size()); ++i) {
+		formatBytes(used, sizeof(used), double(all[i].bytes));
+		snprintf(line, sizeof(line), "  %10s %.48s\n", used, all[i].site.c_str());
+		text += line;
+	}
+	return text;
+}
+
+size_t GpuMemory::reportLeaks(std::ostream &out)
+{
+	if (state.allocations.empty()) {
+		return 0;
+	}
+	std::vector<GpuAllocation> all = allocations();
+	char line[64];
+	formatBytes(line, sizeof(line), double(totalBytes()));
+	out << "GpuMemory: " << all.size() << " GL objects (" << line << ") were never destroyed:\n";
+	for (const GpuAllocation &a : all) {
+		formatBytes(line, sizeof(line), double(a.bytes));
+		out << "  " << typeNames[typeIndex(a.type)] << " " << a.id << ", " << line << ", " << a.site << "\n";
+	}
+	out.flush();
+	return all.size();
+}
+
+size_t GpuMemory::texelBytes(GLenum internalFormat)
+{
+	switch (internalFormat) {
+	case GL_R8: case GL_R8UI: case GL_R8I: case GL_R8_SNORM: case GL_RED: case GL_STENCIL_INDEX8:
+		return 1;
+	case GL_RG8: case GL_RG8UI: case GL_RG8I: case GL_R16: case GL_R16F: case GL_R16UI: case GL_R16I:
+	case GL_RG: case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RG16: case GL_RG16F: case GL_RG16UI: case GL_RG16I: case GL_R32F: case GL_R32UI: case GL_R32I:
+	case GL_RGB10_A2: case GL_R11F_G11F_B10F: case GL_RGB9_E5:
+	case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32: case GL_DEPTH_COMPONENT32F:
+	case GL_DEPTH24_STENCIL8: case GL_DEPTH_COMPONENT:
+		return 4;
+	case GL_RGBA16: case GL_RGBA16F: case GL_RGBA16UI: case GL_RGBA16I: case GL_RG32F: case GL_RG32UI: case GL_RG32I:
+	case GL_DEPTH32F_STENCIL8:
+		return 8;
+	case GL_RGB16: case GL_RGB16F:
+		// Usually padded to four channels.
+		return 8;
+	case GL_RGB32F: case GL_RGB32UI: case GL_RGB32I:
+		return 12;
+	case GL_RGBA32F: case GL_RGBA32UI: case GL_RGBA32I:
+		return 16;
+	default:
+		// 8 bit RGB(A), sRGB and anything unusual. RGB8 is usually padded to 4 bytes.
+		return 4;
+	}
+}
+
+GpuMemoryScope::GpuMemoryScope(const std::string &label)
+{
+	state.scopes.push_back(label);
+}
+
+GpuMemoryScope::~GpuMemoryScope() throw()
+{
+	state.scopes.pop_back();
+}
+
+}
@@ -1,4 +1,6 @@
 #include "ShaderProgram.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
 #include <Eigen/Dense>
 #ifdef _WIN32
 #include <Windows.h>
@@ -66,17 +68,34 @@ ShaderProgram::ShaderProgram(
 		filenames << ", \"" << sources[i] << "\"";
 	}
 	filenames_ = filenames.str();
+
+	GLint binaryLength = 0;
+	glGetProgramiv(program_, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	GpuMemory::track(GpuResourceType::PROGRAM, program_, size_t(binaryLength), "program " + filenames_);
 }
 
 ShaderProgram::ShaderProgram(ShaderProgram &&other)
+	:uniforms_(std::move(other.uniforms_)),
+	notfound_(std::move(other.notfound_)),
+	program_(other.program_),
+	filenames_(std::move(other.filenames_))
 {
-	this->program_ = other.program_;
 	other.program_ = 0;
 }
 
 ShaderProgram & ShaderProgram::operator=(ShaderProgram &&other)
 {
-	this->program_ = other.program_;
+	if (this == &other) {
+		return *this;
+	}
+	if (program_ != 0) {
+		GpuMemory::untrack(GpuResourceType::PROGRAM, program_);
+		glDeleteProgram(program_);
+	}
+	uniforms_ = std::move(other.uniforms_);
+	notfound_ = std::move(other.notfound_);
+	program_ = other.program_;
+	filenames_ = std::move(other.filenames_);
 	other.program_ = 0;
 	return *this;
 }
@@ -84,6 +103,7 @@ ShaderProgram & ShaderProgram::operator=(ShaderProgram &&other)
 ShaderProgram::~ShaderProgram() throw()
 {
 	if (program_ != 0) {
+		GpuMemory::untrack(GpuResourceType::PROGRAM, program_);
 		glDeleteProgram(program_);
 	}
 }
@@ -91,6 +111,7 @@ ShaderProgram::~ShaderProgram() throw()
 void ShaderProgram::use()
 {
 	glUseProgram(program_);
+	RenderStats::recordStateChange();
 }
 
 void ShaderProgram::unuse()
@@ -8,6 +8,11 @@
 #include "glhelper/RotateViewer.hpp"
 #include "glhelper/FlyViewer.hpp"
 #include "glhelper/Mesh.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
 #include <opencv2/opencv.hpp>
 #define GLT_IMPLEMENTATION
 #include <gltext.h>
@@ -41,8 +46,13 @@ MessageCallback(GLenum source,
 }
 
 
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -67,6 +77,7 @@ int main()
 	gltInit();
 	GLTtext* text = gltCreateText();
 	gltSetText(text, "NEAREST");
+	GLTtext* profilerText = gltCreateText();
 
 	{
 		glhelper::ShaderProgram texturedMeshShader({ "../shaders/TexturedMesh.vert", "../shaders/TexturedMesh.frag" });
@@ -122,9 +133,18 @@ int main()
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-			viewer.update();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
@@ -155,10 +175,13 @@ int main()
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				viewer.processEvent(event);
+				if (!benchmark.active()) {
+					viewer.processEvent(event);
+				}
 			}
 			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
 
 			glDisable(GL_CULL_FACE);
 			glActiveTexture(GL_TEXTURE0 + 0);
@@ -166,26 +189,35 @@ int main()
 
 			bigPlaneMesh.render();
 
+			profiler.end("scene");
+			if (profiler.reportUpdated()) {
+				gltSetText(profilerText, profiler.report().c_str());
+			}
+
 			gltBeginDraw();
 			gltColor(1.f, 1.f, 1.f, 1.f);
 			gltDrawText2D(text, 10.f, 10.f, 1.f);
+			gltDrawText2DAligned(profilerText, 10.f, float(winHeight) - 10.f, 1.f, GLT_LEFT, GLT_BOTTOM);
 			gltEndDraw();
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		benchmark.finish();
+
+		glDeleteTextures(1, &texture);
 	}
 
 	gltDeleteText(text);
+	gltDeleteText(profilerText);
 	gltTerminate();
 
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
@@ -8,6 +8,10 @@
 #include "glhelper/RotateViewer.hpp"
 #include "glhelper/FlyViewer.hpp"
 #include "glhelper/Mesh.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/Trace.hpp"
 #include <opencv2/opencv.hpp>
 #define GLT_IMPLEMENTATION
 #include <gltext.h>
@@ -48,6 +52,7 @@ float specularity = 10.f;
 
 void loadSpotMesh(glhelper::Mesh* mesh) 
 {
+	glhelper::TraceZone zone("loadSpotMesh");
 	// ----- Your code here -----
 	// Change the code here to generate tangents and bitangents when loading the mesh, and add
 	// them to the glhelper::Mesh instance.
@@ -83,6 +88,7 @@ void loadSpotMesh(glhelper::Mesh* mesh)
 
 void loadSphereMesh(glhelper::Mesh* mesh) 
 {
+	glhelper::TraceZone zone("loadSphereMesh");
 	Assimp::Importer importer;
 	importer.ReadFile("../models/sphere.obj", aiProcess_Triangulate);
 	const aiScene* aiscene = importer.GetScene();
@@ -126,8 +132,13 @@ Eigen::Matrix4f makeTranslationMatrix(const Eigen::Vector3f& translate)
 	return matrix;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -186,16 +197,23 @@ int main()
 
 		glEnable(GL_DEPTH_TEST);
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-			viewer.update();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				viewer.processEvent(event);
+				if (!benchmark.active()) {
+					viewer.processEvent(event);
+				}
 				if (event.type == SDL_KEYDOWN) {
 					if (event.key.keysym.sym == SDLK_SPACE) {
 						lightRotating = !lightRotating;
@@ -224,13 +242,12 @@ int main()
 			spotMesh.render();
 			sphereMesh.render();
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		benchmark.finish();
 
 		glDeleteTextures(1, &albedoTexture);
 		// --- Your code here ---
@@ -238,9 +255,10 @@ int main()
 	}
 
 
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
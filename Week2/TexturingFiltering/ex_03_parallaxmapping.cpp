@@ -8,6 +8,11 @@
 #include "glhelper/RotateViewer.hpp"
 #include "glhelper/FlyViewer.hpp"
 #include "glhelper/Mesh.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
 #include <opencv2/opencv.hpp>
 #define GLT_IMPLEMENTATION
 #include <gltext.h>
@@ -119,6 +124,7 @@ void updateText(GLTtext* text)
 
 void loadSphereMesh(glhelper::Mesh* mesh) 
 {
+	glhelper::TraceZone zone("loadSphereMesh");
 	Assimp::Importer importer;
 	importer.ReadFile("../models/sphere.obj", aiProcess_Triangulate);
 	const aiScene* aiscene = importer.GetScene();
@@ -137,8 +143,13 @@ void loadSphereMesh(glhelper::Mesh* mesh)
 	mesh->elems(elems);
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -164,6 +175,7 @@ int main()
 
 	gltInit();
 	GLTtext* text = gltCreateText();
+	GLTtext* profilerText = gltCreateText();
 	updateText(text);
 
 	{
@@ -254,9 +266,18 @@ int main()
 
 		glEnable(GL_DEPTH_TEST);
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-			viewer.update();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
@@ -287,7 +308,9 @@ int main()
 						updateText(text);
 					}
 				}
-				viewer.processEvent(event);
+				if (!benchmark.active()) {
+					viewer.processEvent(event);
+				}
 			}
 
 			//theta += 0.01f;
@@ -297,6 +320,7 @@ int main()
 			planeMesh.modelToWorld(currModelToWorld);
 			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
 
 			glDisable(GL_CULL_FACE);
 			glActiveTexture(GL_TEXTURE0 + 0);
@@ -309,30 +333,38 @@ int main()
 			planeMesh.render();
 			lightMesh.render();
 
+			profiler.end("scene");
+			if (profiler.reportUpdated()) {
+				gltSetText(profilerText, profiler.report().c_str());
+			}
+
 			gltBeginDraw();
 			gltColor(1.f, 1.f, 1.f, 1.f);
 			gltDrawText2D(text, 10.f, 10.f, 1.f);
+			gltDrawText2DAligned(profilerText, 10.f, float(winHeight) - 10.f, 1.f, GLT_LEFT, GLT_BOTTOM);
 			gltEndDraw();
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		benchmark.finish();
 
 		glDeleteTextures(1, &albedoTexture);
 		glDeleteTextures(1, &depthTexture);
+		glDeleteTextures(1, &normalTexture);
 	}
 
 
 	gltDeleteText(text);
+	gltDeleteText(profilerText);
 	gltTerminate();
 
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
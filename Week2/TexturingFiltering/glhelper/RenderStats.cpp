@@ -0,0 +1,311 @@
+#include "RenderStats.hpp"
+#include <chrono>
+#include <cstdio>
+
+namespace glhelper {
+
+namespace {
+
+// Frames of pipeline statistics queries in flight. The GPU usually runs two or
+// three frames behind, so with four sets the results are normally ready by the
+// time a set comes round again, and reading them never stalls.
+const size_t latencyFrames = 4;
+const double tableIntervalSeconds = 0.5;
+
+const GLenum pipelineTargets[] = {
+	GL_VERTICES_SUBMITTED_ARB,
+	GL_PRIMITIVES_SUBMITTED_ARB,
+	GL_VERTEX_SHADER_INVOCATIONS_ARB,
+	GL_CLIPPING_OUTPUT_PRIMITIVES_ARB,
+	GL_FRAGMENT_SHADER_INVOCATIONS_ARB,
+	GL_COMPUTE_SHADER_INVOCATIONS_ARB,
+};
+const size_t nPipelineTargets = sizeof(pipelineTargets) / sizeof(pipelineTargets[0]);
+
+struct PipelineFrame {
+	GLuint queries[nPipelineTargets];
+	bool pending;
+};
+
+struct State {
+	RenderCounters counters = { 0, 0, 0, 0 };
+
+	bool pipelineEnabled = false;
+	bool pipelineRecording = false;
+	bool pipelineCreated = false;
+	PipelineFrame pipelineFrames[latencyFrames];
+	size_t pipelineCurrent = 0;
+	PipelineCounters pipeline = { 0, 0, 0, 0, 0, 0 };
+
+	// Sums since the table was last refreshed.
+	RenderCounters counterSums = { 0, 0, 0, 0 };
+	size_t counterFrames = 0;
+	PipelineCounters pipelineSums = { 0, 0, 0, 0, 0, 0 };
+	size_t pipelineFramesSummed = 0;
+	std::chrono::steady_clock::time_point tableTime = std::chrono::steady_clock::now();
+	std::string table = "Collecting stats...";
+	bool tableUpdated = false;
+};
+
+State state;
+
+size_t trianglesIn(GLenum mode, size_t count)
+{
+	switch (mode) {
+	case GL_TRIANGLES:
+		return count / 3;
+	case GL_TRIANGLE_STRIP:
+	case GL_TRIANGLE_FAN:
+		return count >= 3 ? count - 2 : 0;
+	case GL_TRIANGLES_ADJACENCY:
+		return count / 6;
+	case GL_TRIANGLE_STRIP_ADJACENCY:
+		return count >= 6 ? count / 2 - 2 : 0;
+	default:
+		return 0;
+	}
+}
+
+size_t componentsIn(GLenum format)
+{
+	switch (format) {
+	case GL_RED: case GL_GREEN: case GL_BLUE: case GL_RED_INTEGER:
+	case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+		return 1;
+	case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL:
+		return 2;
+	case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: case GL_BGR_INTEGER:
+		return 3;
+	default:
+		return 4;
+	}
+}
+
+size_t texelBytes(GLenum format, GLenum type)
+{
+	switch (type) {
+	case GL_UNSIGNED_BYTE: case GL_BYTE:
+		return componentsIn(format);
+	case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+		return componentsIn(format) * 2;
+	case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+		return componentsIn(format) * 4;
+	case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+		return 8;
+	default:
+		// Packed types such as GL_UNSIGNED_INT_24_8 and GL_UNSIGNED_INT_2_10_10_10_REV.
+		return 4;
+	}
+}
+
+bool pipelineSupported()
+{
+	return GLEW_ARB_pipeline_statistics_query;
+}
+
+bool collect(PipelineFrame &f)
+{
+	GLint available = 0;
+	glGetQueryObjectiv(f.queries[nPipelineTargets - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return false;
+	}
+	GLuint64 r[nPipelineTargets];
+	for (size_t i = 0; i < nPipelineTargets; ++i) {
+		glGetQueryObjectui64v(f.queries[i], GL_QUERY_RESULT, &r[i]);
+	}
+	state.pipeline = PipelineCounters{ r[0], r[1], r[2], r[3], r[4], r[5] };
+	PipelineCounters &s = state.pipelineSums;
+	s.verticesSubmitted += r[0];
+	s.primitivesSubmitted += r[1];
+	s.vertexInvocations += r[2];
+	s.clippingOutputPrimitives += r[3];
+	s.fragmentInvocations += r[4];
+	s.computeInvocations += r[5];
+	++state.pipelineFramesSummed;
+	f.pending = false;
+	return true;
+}
+
+//!\brief Short human readable count, e.g. 1.25M.
+void formatCount(char *buf, size_t size, double n)
+{
+	if (n >= 1e9) {
+		snprintf(buf, size, "%.2fG", n * 1e-9);
+	} else if (n >= 1e6) {
+		snprintf(buf, size, "%.2fM", n * 1e-6);
+	} else if (n >= 1e4) {
+		snprintf(buf, size, "%.1fk", n * 1e-3);
+	} else {
+		snprintf(buf, size, "%.0f", n);
+	}
+}
+
+void appendRow(std::string &table, const char *name, double value, const char *unit = "")
+{
+	char number[32], line[80];
+	formatCount(number, sizeof(number), value);
+	snprintf(line, sizeof(line), "%-16s %9s%s\n", name, number, unit);
+	table += line;
+}
+
+void refreshTable()
+{
+	double n = double(state.counterFrames);
+	const RenderCounters &c = state.counterSums;
+	std::string &table = state.table;
+	table.clear();
+	table += "Per frame\n";
+	appendRow(table, "Draw calls", double(c.drawCalls) / n);
+	appendRow(table, "Triangles", double(c.triangles) / n);
+	appendRow(table, "State changes", double(c.stateChanges) / n);
+	appendRow(table, "Uploads", double(c.uploadBytes) / n, "B");
+	if (state.pipelineFramesSummed > 0) {
+		double p = double(state.pipelineFramesSummed);
+		const PipelineCounters &s = state.pipelineSums;
+		appendRow(table, "Vertices", double(s.verticesSubmitted) / p);
+		appendRow(table, "Primitives", double(s.primitivesSubmitted) / p);
+		appendRow(table, "VS invocations", double(s.vertexInvocations) / p);
+		appendRow(table, "Clipped prims", double(s.clippingOutputPrimitives) / p);
+		appendRow(table, "FS invocations", double(s.fragmentInvocations) / p);
+		appendRow(table, "CS invocations", double(s.computeInvocations) / p);
+	} else if (state.pipelineEnabled && !pipelineSupported()) {
+		table += "(no pipeline statistics queries)\n";
+	}
+
+	state.counterSums = RenderCounters{ 0, 0, 0, 0 };
+	state.counterFrames = 0;
+	state.pipelineSums = PipelineCounters{ 0, 0, 0, 0, 0, 0 };
+	state.pipelineFramesSummed = 0;
+	state.tableUpdated = true;
+}
+
+}
+
+void RenderStats::beginFrame()
+{
+	state.counters = RenderCounters{ 0, 0, 0, 0 };
+
+	if (!pipelineStatisticsActive()) {
+		return;
+	}
+	if (!state.pipelineCreated) {
+		for (PipelineFrame &f : state.pipelineFrames) {
+			glGenQueries(GLsizei(nPipelineTargets), f.queries);
+			f.pending = false;
+		}
+		state.pipelineCreated = true;
+	}
+	// Oldest first, stopping at the first frame the GPU hasn't finished.
+	for (size_t i = 1; i <= latencyFrames; ++i) {
+		PipelineFrame &f = state.pipelineFrames[(state.pipelineCurrent + i) % latencyFrames];
+		if (f.pending && !collect(f)) {
+			break;
+		}
+	}
+	PipelineFrame &f = state.pipelineFrames[state.pipelineCurrent];
+	if (f.pending) {
+		// The GPU is too far behind; skip this frame rather than wait.
+		return;
+	}
+	for (size_t i = 0; i < nPipelineTargets; ++i) {
+		glBeginQuery(pipelineTargets[i], f.queries[i]);
+	}
+	state.pipelineRecording = true;
+}
+
+void RenderStats::endFrame()
+{
+	if (state.pipelineRecording) {
+		for (size_t i = 0; i < nPipelineTargets; ++i) {
+			glEndQuery(pipelineTargets[i]);
+		}
+		state.pipelineFrames[state.pipelineCurrent].pending = true;
+		state.pipelineCurrent = (state.pipelineCurrent + 1) % latencyFrames;
+		state.pipelineRecording = false;
+	}
+
+	RenderCounters &s = state.counterSums;
+	s.drawCalls += state.counters.drawCalls;
+	s.triangles += state.counters.triangles;
+	s.stateChanges += state.counters.stateChanges;
+	s.uploadBytes += state.counters.uploadBytes;
+	++state.counterFrames;
+
+	state.tableUpdated = false;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (std::chrono::duration<double>(now - state.tableTime).count() >= tableIntervalSeconds) {
+		state.tableTime = now;
+		refreshTable();
+	}
+}
+
+void RenderStats::release()
+{
+	if (state.pipelineRecording) {
+		for (size_t i = 0; i < nPipelineTargets; ++i) {
+			glEndQuery(pipelineTargets[i]);
+		}
+		state.pipelineRecording = false;
+	}
+	if (state.pipelineCreated) {
+		for (PipelineFrame &f : state.pipelineFrames) {
+			glDeleteQueries(GLsizei(nPipelineTargets), f.queries);
+			f.pending = false;
+		}
+		state.pipelineCreated = false;
+	}
+}
+
+void RenderStats::recordDraw(GLenum mode, size_t count, size_t instances)
+{
+	++state.counters.drawCalls;
+	state.counters.triangles += trianglesIn(mode, count) * instances;
+}
+
+void RenderStats::recordStateChange()
+{
+	++state.counters.stateChanges;
+}
+
+void RenderStats::recordUpload(size_t bytes)
+{
+	state.counters.uploadBytes += bytes;
+}
+
+size_t RenderStats::imageBytes(GLenum format, GLenum type, size_t width, size_t height)
+{
+	return texelBytes(format, type) * width * height;
+}
+
+const RenderCounters &RenderStats::frame()
+{
+	return state.counters;
+}
+
+void RenderStats::enablePipelineStatistics(bool enable)
+{
+	state.pipelineEnabled = enable;
+}
+
+bool RenderStats::pipelineStatisticsActive()
+{
+	return state.pipelineEnabled && pipelineSupported();
+}
+
+const PipelineCounters &RenderStats::pipeline()
+{
+	return state.pipeline;
+}
+
+const std::string &RenderStats::table()
+{
+	return state.table;
+}
+
+bool RenderStats::tableUpdated()
+{
+	return state.tableUpdated;
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <string>
+
+namespace glhelper {
+
+//!\brief Rendering work submitted since RenderStats::beginFrame.
+struct RenderCounters {
+	size_t drawCalls;
+	//!\brief Triangles submitted by draw calls, before any tessellation or geometry shader.
+	size_t triangles;
+	//!\brief Program, vertex array and texture binds.
+	size_t stateChanges;
+	//!\brief Bytes sent to buffers and textures.
+	size_t uploadBytes;
+};
+
+//!\brief GL_ARB_pipeline_statistics_query results for one frame.
+struct PipelineCounters {
+	GLuint64 verticesSubmitted;
+	GLuint64 primitivesSubmitted;
+	GLuint64 vertexInvocations;
+	GLuint64 clippingOutputPrimitives;
+	GLuint64 fragmentInvocations;
+	GLuint64 computeInvocations;
+};
+
+//!\brief Counts the work submitted through glhelper (e.g. by Mesh::render, BufferObject::update
+//!       and Texture::bindToImageUnit) each frame.
+//!
+//!       Draws issued directly with glDraw* should be counted with recordDraw, and other
+//!       direct uploads with recordUpload.
+//!
+//!       If enablePipelineStatistics is called and GL_ARB_pipeline_statistics_query is
+//!       supported, each frame is also wrapped in pipeline statistics queries. Like
+//!       GpuProfiler, they're read a few frames later once available, so never stall.
+//!
+//!       table() averages everything over about half a second, for a HUD:
+//!           if (RenderStats::tableUpdated()) gltSetText(text, RenderStats::table().c_str());
+//!\note Benchmark::beginFrame, endFrame and finish call beginFrame, endFrame and release, so
+//!      labs using Benchmark get the counters for free. Programs without a Benchmark must
+//!      call beginFrame and endFrame around each frame, and release before destroying the
+//!      context, themselves; otherwise frame() just keeps accumulating and table() never
+//!      updates. Must be used on the thread owning the GL context.
+class RenderStats final
+{
+public:
+	//!\brief Resets frame() and starts the frame's pipeline statistics queries.
+	static void beginFrame();
+	//!\brief Ends the frame's queries and folds frame() into the table() averages.
+	static void endFrame();
+	//!\brief Deletes the pipeline statistics queries. Call before destroying the context.
+	static void release();
+
+	static void recordDraw(GLenum mode, size_t count, size_t instances = 1);
+	static void recordStateChange();
+	static void recordUpload(size_t bytes);
+	//!\brief Bytes in a width x height image of the given glTexImage2D format and type.
+	static size_t imageBytes(GLenum format, GLenum type, size_t width, size_t height);
+
+	static const RenderCounters &frame();
+
+	//!\brief Turns the pipeline statistics queries on or off from the next frame.
+	static void enablePipelineStatistics(bool enable);
+	//!\brief True if pipeline statistics are enabled and supported by the driver.
+	static bool pipelineStatisticsActive();
+	//!\brief Latest frame of pipeline statistics to become available.
+	static const PipelineCounters &pipeline();
+
+	//!\brief Per-frame averages of the counters, as text lines ready for gltSetText.
+	static const std::string &table();
+	//!\brief True from the endFrame that refreshed table() until the next endFrame.
+	static bool tableUpdated();
+
+private:
+	RenderStats();
+};
+
+}
@@ -9,6 +9,11 @@
 #include "glhelper/FlyViewer.hpp"
 #include "glhelper/Mesh.hpp"
 #include "glhelper/Texture.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/mesh.h"
@@ -66,6 +71,7 @@ float specularExponent = 60.f, specularIntensity = 1.0f;
 
 void loadMesh(glhelper::Mesh* mesh, const std::string &filename) 
 {
+	glhelper::TraceZone zone("loadMesh");
 	Assimp::Importer importer;
 	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
 	const aiScene* aiscene = importer.GetScene();
@@ -115,8 +121,13 @@ void updateText(GLTtext* text)
 	gltSetText(text, textStream.str().c_str());
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
@@ -141,6 +152,7 @@ int main()
 
 	gltInit();
 	GLTtext* text = gltCreateText();
+	GLTtext* profilerText = gltCreateText();
 	updateText(text);
 	glEnable(GL_MULTISAMPLE);
 
@@ -179,16 +191,25 @@ int main()
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-			viewer.update();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 
@@ -232,6 +253,7 @@ int main()
 			}
 			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
 
 			if (lightRotating) {
 				theta += 0.01f;
@@ -247,24 +269,31 @@ int main()
 
 			glDisable(GL_CULL_FACE);
 
+			profiler.end("scene");
+			if (profiler.reportUpdated()) {
+				gltSetText(profilerText, profiler.report().c_str());
+			}
+
 			gltBeginDraw();
 			gltColor(1.f, 1.f, 1.f, 1.f);
 			gltDrawText2D(text, 10.f, 10.f, 1.f);
+			gltDrawText2DAligned(profilerText, 10.f, float(winHeight) - 10.f, 1.f, GLT_LEFT, GLT_BOTTOM);
 			gltEndDraw();
 
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		benchmark.finish();
 	}
 
 	gltDeleteText(text);
+	gltDeleteText(profilerText);
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
@@ -0,0 +1,114 @@
+#include "CameraPath.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+template<typename T>
+T catmullRom(const T &p0, const T &p1, const T &p2, const T &p3, float t)
+{
+	float t2 = t * t, t3 = t2 * t;
+	return 0.5f * ((2.f * p1) + (p2 - p0) * t + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 +
+		(3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+}
+
+}
+
+CameraPath::CameraPath()
+{}
+
+CameraPath::CameraPath(const std::string &filename)
+{
+	std::ifstream file(filename);
+	if (!file) {
+		throw std::runtime_error("CameraPath: couldn't open " + filename);
+	}
+	std::string line;
+	for (size_t lineNo = 1; std::getline(file, line); ++lineNo) {
+		size_t first = line.find_first_not_of(" \t\r");
+		if (first == std::string::npos || line[first] == '#') {
+			continue;
+		}
+		std::istringstream in(line);
+		float time;
+		CameraPose pose;
+		if (!(in >> time >> pose.position.x() >> pose.position.y() >> pose.position.z() >> pose.theta >> pose.phi)) {
+			throw std::runtime_error("CameraPath: " + filename + " line " + std::to_string(lineNo) +
+				": expected \"time x y z theta phi\".");
+		}
+		add(time, pose);
+	}
+	if (keyframes_.empty()) {
+		throw std::runtime_error("CameraPath: " + filename + " has no keyframes.");
+	}
+}
+
+void CameraPath::add(float time, const CameraPose &pose)
+{
+	if (!keyframes_.empty() && time <= keyframes_.back().time) {
+		throw std::runtime_error("CameraPath::add: keyframe times must increase.");
+	}
+	keyframes_.push_back(Keyframe{ time, pose });
+}
+
+void CameraPath::save(const std::string &filename) const
+{
+	std::ofstream file(filename);
+	if (!file) {
+		throw std::runtime_error("CameraPath: couldn't open " + filename + " for writing.");
+	}
+	file << "# time x y z theta phi\n";
+	for (const Keyframe &k : keyframes_) {
+		file << k.time << " " << k.pose.position.x() << " " << k.pose.position.y() << " " << k.pose.position.z()
+			<< " " << k.pose.theta << " " << k.pose.phi << "\n";
+	}
+}
+
+bool CameraPath::empty() const
+{
+	return keyframes_.empty();
+}
+
+float CameraPath::duration() const
+{
+	return keyframes_.empty() ? 0.f : keyframes_.back().time;
+}
+
+const std::vector<CameraPath::Keyframe> &CameraPath::keyframes() const
+{
+	return keyframes_;
+}
+
+CameraPose CameraPath::evaluate(float time) const
+{
+	if (keyframes_.empty()) {
+		throw std::runtime_error("CameraPath::evaluate: path is empty.");
+	}
+	if (time <= keyframes_.front().time) {
+		return keyframes_.front().pose;
+	}
+	if (time >= keyframes_.back().time) {
+		return keyframes_.back().pose;
+	}
+	auto next = std::upper_bound(keyframes_.begin(), keyframes_.end(), time,
+		[](float t, const Keyframe &k) { return t < k.time; });
+	size_t i2 = size_t(next - keyframes_.begin());
+	size_t i1 = i2 - 1;
+	// The end keyframes are repeated to give the spline its outer control points.
+	size_t i0 = i1 == 0 ? 0 : i1 - 1;
+	size_t i3 = std::min(i2 + 1, keyframes_.size() - 1);
+	const Keyframe &k0 = keyframes_[i0], &k1 = keyframes_[i1], &k2 = keyframes_[i2], &k3 = keyframes_[i3];
+	float t = (time - k1.time) / (k2.time - k1.time);
+
+	CameraPose pose;
+	pose.position = catmullRom<Eigen::Vector3f>(k0.pose.position, k1.pose.position, k2.pose.position, k3.pose.position, t);
+	pose.theta = catmullRom(k0.pose.theta, k1.pose.theta, k2.pose.theta, k3.pose.theta, t);
+	pose.phi = catmullRom(k0.pose.phi, k1.pose.phi, k2.pose.phi, k3.pose.phi, t);
+	return pose;
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+
+namespace glhelper {
+
+//!\brief Where a viewer's camera is and which way it faces. theta is the rotation
+//!       about the y axis and phi about the x axis, as used by the viewers.
+struct CameraPose {
+	Eigen::Vector3f position;
+	float theta, phi;
+};
+
+//!\brief A camera path through a sequence of timed keyframes, smoothly
+//!       interpolated with a Catmull-Rom spline.
+//!
+//!       Files are plain text, with one keyframe per line:
+//!           time_seconds x y z theta phi
+//!       Blank lines and lines starting with # are ignored.
+class CameraPath final
+{
+public:
+	struct Keyframe {
+		float time;
+		CameraPose pose;
+	};
+
+	CameraPath();
+	//!\brief Loads keyframes from a file, throwing std::runtime_error on failure.
+	explicit CameraPath(const std::string &filename);
+
+	//!\brief Adds a keyframe. Keyframes must be added in increasing time order.
+	void add(float time, const CameraPose &pose);
+	void save(const std::string &filename) const;
+
+	bool empty() const;
+	//!\brief Time of the last keyframe.
+	float duration() const;
+	const std::vector<Keyframe> &keyframes() const;
+
+	//!\brief Pose at the given time, clamped to the ends of the path.
+	CameraPose evaluate(float time) const;
+
+private:
+	std::vector<Keyframe> keyframes_;
+};
+
+}
@@ -0,0 +1,318 @@
+#include "Trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace glhelper {
+
+namespace {
+
+struct TraceEvent {
+	const char *name;
+	uint64_t startNs, endNs;
+	bool gpu;
+};
+
+const size_t eventsPerChunk = 4096;
+
+struct Chunk {
+	TraceEvent events[eventsPerChunk];
+	//!\brief Written only by the owning thread, read by the flusher.
+	std::atomic<size_t> count{ 0 };
+	//!\brief Used only by the flusher.
+	size_t flushed = 0;
+};
+
+//!\brief Events recorded by one thread. The owning thread appends to the last chunk
+//!       without locking; chunkMutex is only taken to add a chunk, or by the flusher.
+struct ThreadBuffer {
+	uint32_t tid;
+	std::string name;
+	std::mutex chunkMutex;
+	std::vector<std::unique_ptr<Chunk>> chunks;
+	Chunk *current;
+};
+
+struct TraceState {
+	std::atomic<bool> active{ false };
+	std::atomic<int64_t> gpuOffsetNs{ 0 };
+	uint64_t startNs = 0;
+
+	std::mutex registryMutex;
+	std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+	uint32_t nextTid = 1;
+	std::set<std::string> gpuNames;
+
+	std::mutex fileMutex;
+	std::ofstream file;
+	bool firstEvent = true;
+
+	std::mutex flusherMutex;
+	std::condition_variable flusherCv;
+	bool stopFlusher = false;
+	std::thread flusher;
+};
+
+TraceState &state()
+{
+	static TraceState s;
+	return s;
+}
+
+void writeEscaped(std::ofstream &file, const char *s)
+{
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') {
+			file << '\\';
+		}
+		file << *s;
+	}
+}
+
+void writeEvent(TraceState &s, uint32_t tid, const TraceEvent &e)
+{
+	char times[96];
+	snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+		double(int64_t(e.startNs - s.startNs)) * 1e-3, double(e.endNs - e.startNs) * 1e-3);
+	s.file << (s.firstEvent ? "" : ",\n") << "{\"name\":\"";
+	writeEscaped(s.file, e.name);
+	s.file << "\",\"cat\":\"" << (e.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+		<< (e.gpu ? 0 : tid) << "," << times << "}";
+	s.firstEvent = false;
+}
+
+void writeThreadName(TraceState &s, uint32_t tid, const std::string &name)
+{
+	s.file << (s.firstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+		<< ",\"args\":{\"name\":\"";
+	writeEscaped(s.file, name.c_str());
+	s.file << "\"}}";
+	s.firstEvent = false;
+}
+
+//!\brief Writes out the events not yet written. Call with fileMutex held.
+void writeBuffer(TraceState &s, ThreadBuffer &b)
+{
+	std::lock_guard<std::mutex> lock(b.chunkMutex);
+	for (std::unique_ptr<Chunk> &c : b.chunks) {
+		size_t n = c->count.load(std::memory_order_acquire);
+		for (; c->flushed < n; ++c->flushed) {
+			writeEvent(s, b.tid, c->events[c->flushed]);
+		}
+	}
+	// Free every full, written chunk except the one the thread is appending to.
+	while (b.chunks.size() > 1 && b.chunks.front()->flushed == eventsPerChunk) {
+		b.chunks.erase(b.chunks.begin());
+	}
+}
+
+//!\brief Owns the calling thread's buffer, and takes it out of the registry when the
+//!       thread exits, so threads that come and go don't accumulate buffers.
+struct ThreadBufferOwner {
+	std::shared_ptr<ThreadBuffer> buffer;
+
+	~ThreadBufferOwner()
+	{
+		if (!buffer) {
+			return;
+		}
+		TraceState &s = state();
+		{
+			std::lock_guard<std::mutex> lock(s.registryMutex);
+			s.buffers.erase(std::find(s.buffers.begin(), s.buffers.end(), buffer));
+		}
+		// Trace::stop no longer sees this thread, so write what it recorded and its name now.
+		std::lock_guard<std::mutex> fileLock(s.fileMutex);
+		if (s.file.is_open()) {
+			writeBuffer(s, *buffer);
+			writeThreadName(s, buffer->tid, buffer->name);
+		}
+	}
+};
+
+ThreadBuffer &threadBuffer()
+{
+	thread_local ThreadBufferOwner owner;
+	if (!owner.buffer) {
+		std::shared_ptr<ThreadBuffer> buffer = std::make_shared<ThreadBuffer>();
+		buffer->chunks.emplace_back(new Chunk());
+		buffer->current = buffer->chunks.back().get();
+		TraceState &s = state();
+		std::lock_guard<std::mutex> lock(s.registryMutex);
+		// tid 0 is the GPU track.
+		buffer->tid = s.nextTid++;
+		buffer->name = "Thread " + std::to_string(buffer->tid);
+		s.buffers.push_back(buffer);
+		owner.buffer = buffer;
+	}
+	return *owner.buffer;
+}
+
+void record(const char *name, uint64_t startNs, uint64_t endNs, bool gpu)
+{
+	ThreadBuffer &b = threadBuffer();
+	Chunk *c = b.current;
+	size_t n = c->count.load(std::memory_order_relaxed);
+	if (n == eventsPerChunk) {
+		std::unique_ptr<Chunk> next(new Chunk());
+		c = next.get();
+		{
+			std::lock_guard<std::mutex> lock(b.chunkMutex);
+			b.chunks.push_back(std::move(next));
+		}
+		b.current = c;
+		n = 0;
+	}
+	c->events[n] = TraceEvent{ name, startNs, endNs, gpu };
+	c->count.store(n + 1, std::memory_order_release);
+}
+
+void flush(TraceState &s)
+{
+	std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+	{
+		std::lock_guard<std::mutex> lock(s.registryMutex);
+		buffers = s.buffers;
+	}
+	std::lock_guard<std::mutex> fileLock(s.fileMutex);
+	if (!s.file.is_open()) {
+		return;
+	}
+	for (const std::shared_ptr<ThreadBuffer> &b : buffers) {
+		writeBuffer(s, *b);
+	}
+	s.file.flush();
+}
+
+void flusherLoop(unsigned intervalMs)
+{
+	TraceState &s = state();
+	std::unique_lock<std::mutex> lock(s.flusherMutex);
+	while (!s.stopFlusher) {
+		s.flusherCv.wait_for(lock, std::chrono::milliseconds(intervalMs));
+		lock.unlock();
+		flush(s);
+		lock.lock();
+	}
+}
+
+}
+
+void Trace::start(const std::string &path, unsigned flushIntervalMs)
+{
+	TraceState &s = state();
+	if (s.active) {
+		throw std::runtime_error("Trace::start: a trace is already running.");
+	}
+	{
+		std::lock_guard<std::mutex> lock(s.fileMutex);
+		s.file.open(path);
+		if (!s.file) {
+			throw std::runtime_error("Trace::start: couldn't open " + path + " for writing.");
+		}
+		s.file << "[\n";
+		s.firstEvent = true;
+	}
+	s.startNs = now();
+	s.stopFlusher = false;
+	s.active = true;
+	s.flusher = std::thread(flusherLoop, flushIntervalMs);
+}
+
+void Trace::stop()
+{
+	TraceState &s = state();
+	if (!s.active) {
+		return;
+	}
+	s.active = false;
+	{
+		std::lock_guard<std::mutex> lock(s.flusherMutex);
+		s.stopFlusher = true;
+	}
+	s.flusherCv.notify_all();
+	s.flusher.join();
+	flush(s);
+
+	std::lock_guard<std::mutex> registryLock(s.registryMutex);
+	std::lock_guard<std::mutex> fileLock(s.fileMutex);
+	writeThreadName(s, 0, "GPU");
+	for (const std::shared_ptr<ThreadBuffer> &b : s.buffers) {
+		writeThreadName(s, b->tid, b->name);
+	}
+	s.file << "\n]\n";
+	s.file.close();
+}
+
+bool Trace::active()
+{
+	return state().active.load(std::memory_order_relaxed);
+}
+
+void Trace::setThreadName(const std::string &name)
+{
+	ThreadBuffer &b = threadBuffer();
+	std::lock_guard<std::mutex> lock(state().registryMutex);
+	b.name = name;
+}
+
+uint64_t Trace::now()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Trace::cpuEvent(const char *name, uint64_t startNs, uint64_t endNs)
+{
+	if (!active()) {
+		return;
+	}
+	record(name, startNs, endNs, false);
+}
+
+void Trace::calibrateGpu()
+{
+	// Take the CPU time either side of the query and use the midpoint.
+	uint64_t before = now();
+	GLint64 gpu;
+	glGetInteger64v(GL_TIMESTAMP, &gpu);
+	uint64_t after = now();
+	state().gpuOffsetNs = int64_t(before + (after - before) / 2) - int64_t(gpu);
+}
+
+void Trace::gpuEvent(const std::string &name, GLuint64 gpuStartNs, GLuint64 gpuEndNs)
+{
+	if (!active()) {
+		return;
+	}
+	TraceState &s = state();
+	const char *interned;
+	{
+		std::lock_guard<std::mutex> lock(s.registryMutex);
+		interned = s.gpuNames.insert(name).first->c_str();
+	}
+	int64_t offset = s.gpuOffsetNs.load(std::memory_order_relaxed);
+	record(interned, uint64_t(int64_t(gpuStartNs) + offset), uint64_t(int64_t(gpuEndNs) + offset), true);
+}
+
+TraceZone::TraceZone(const char *name)
+	:name_(name), start_(Trace::active() ? Trace::now() : 0)
+{}
+
+TraceZone::~TraceZone() throw()
+{
+	if (start_ != 0) {
+		Trace::cpuEvent(name_, start_, Trace::now());
+	}
+}
+
+}
@@ -10,6 +10,13 @@
 #include "glhelper/Mesh.hpp"
 #include "glhelper/Texture.hpp"
 #include "glhelper/Matrices.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
+#include "glhelper/HudText.hpp"
+#include "glhelper/SimulationThread.hpp"
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/mesh.h"
@@ -30,6 +37,8 @@
 const int winWidth = 1280, winHeight = 720;
 
 const Uint64 desiredFrametime = 33;
+// The simulation runs at its own fixed rate, whatever the frame rate.
+const double physicsStepSeconds = 1.0 / 120.0;
 
 float groundWidth = 20.f;
 float groundHeight = 5.f;
@@ -53,6 +62,7 @@ float cube2Mass = 2.f;
 
 void loadMesh(glhelper::Mesh* mesh, const std::string &filename) 
 {
+	glhelper::TraceZone zone("loadMesh");
 	Assimp::Importer importer;
 	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
 	const aiScene* aiscene = importer.GetScene();
@@ -98,7 +108,7 @@ void addBoxShape(btAlignedObjectArray<btCollisionShape*>& shapes, btDiscreteDyna
 
 }
 
-Eigen::Matrix4f getRigidBodyTransform(btDynamicsWorld* world, int idx) {
+glhelper::BodyTransform getRigidBodyTransform(btDynamicsWorld* world, int idx) {
 	btCollisionObject* obj = world->getCollisionObjectArray()[idx];
 	btRigidBody* body = btRigidBody::upcast(obj);
 	btTransform trans;
@@ -108,14 +118,27 @@ Eigen::Matrix4f getRigidBodyTransform(btDynamicsWorld* world, int idx) {
 	else {
 		trans = obj->getWorldTransform();
 	}
-	Eigen::Quaternionf rot(trans.getRotation().w(), trans.getRotation().x(), trans.getRotation().y(), trans.getRotation().z());
-	Eigen::Matrix4f rotMat = Eigen::Matrix4f::Identity();
-	rotMat.block<3, 3>(0, 0) = rot.matrix();
-	return makeTranslationMatrix(Eigen::Vector3f(trans.getOrigin().x(), trans.getOrigin().y(), trans.getOrigin().z())) * rotMat;
+	glhelper::BodyTransform t;
+	t.position = Eigen::Vector3f(trans.getOrigin().x(), trans.getOrigin().y(), trans.getOrigin().z());
+	t.rotation = Eigen::Quaternionf(trans.getRotation().w(), trans.getRotation().x(), trans.getRotation().y(), trans.getRotation().z());
+	return t;
 }
 
-int main()
+// Called on the simulation thread after each step.
+void publishBodies(btDynamicsWorld* world, std::vector<glhelper::BodyTransform> &bodies) {
+	bodies.resize(world->getNumCollisionObjects());
+	for (int i = 0; i < world->getNumCollisionObjects(); ++i) {
+		bodies[i] = getRigidBodyTransform(world, i);
+	}
+}
+
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
@@ -139,8 +162,6 @@ int main()
 	}
 
 	gltInit();
-	GLTtext* text = gltCreateText();
-	gltSetText(text, (std::string("Physics demo")).c_str());
 	glEnable(GL_MULTISAMPLE);
 
 	{
@@ -205,20 +226,41 @@ int main()
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+		glhelper::HudText hud(3);
 
-			world->stepSimulation(desiredFrametime / 1000.f, 10);
+		// From here on only the simulation thread may touch the world; anything
+		// else (e.g. applying an impulse on a key press) should go through physics.post.
+		glhelper::SimulationThread physics(physicsStepSeconds,
+			[&](double dt) { world->stepSimulation(btScalar(dt), 1, btScalar(dt)); },
+			[&](std::vector<glhelper::BodyTransform> &bodies) { publishBodies(world.get(), bodies); });
+		if (!benchmark.active()) {
+			physics.start();
+		}
 
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
 
-			viewer.update();
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (benchmark.active()) {
+				physics.advanceTo(benchmark.seconds());
+			}
+			physics.beginFrame();
+
+
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 
@@ -228,6 +270,7 @@ int main()
 			}
 			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
 
 			glDisable(GL_CULL_FACE);
 			glProgramUniform4f(lambertianShader.get(), lambertianShader.uniformLoc("color"), 0.f, 1.0f, 0.1f, 1.f);
@@ -237,36 +280,44 @@ int main()
 			cubeMesh.modelToWorld(pivotModelToWorld);
 			cubeMesh.render();
 			glProgramUniform4f(lambertianShader.get(), lambertianShader.uniformLoc("color"), 0.8f, 0.2f, 0.2f, 1.f);
-			cubeMesh.modelToWorld(getRigidBodyTransform(world.get(), 2) * seesawScale);
+			cubeMesh.modelToWorld(physics.transform(2) * seesawScale);
 			cubeMesh.render();
 			glProgramUniform4f(lambertianShader.get(), lambertianShader.uniformLoc("color"), 0.f, 0.8f, 0.8f, 1.f);
-			cubeMesh.modelToWorld(getRigidBodyTransform(world.get(), 3) * cubeScale);
+			cubeMesh.modelToWorld(physics.transform(3) * cubeScale);
 			cubeMesh.render();
 			glProgramUniform4f(lambertianShader.get(), lambertianShader.uniformLoc("color"), 0.f, 0.8f, 0.8f, 1.f);
-			cubeMesh.modelToWorld(getRigidBodyTransform(world.get(), 4) * cubeScale);
+			cubeMesh.modelToWorld(physics.transform(4) * cubeScale);
 			cubeMesh.render();
 
-			gltBeginDraw();
-			gltColor(1.f, 1.f, 1.f, 1.f);
-			gltDrawText2D(text, 10.f, 10.f, 1.f);
-			gltEndDraw();
+			profiler.end("scene");
 
+			glhelper::SimulationStats simStats = physics.stats();
+			hud.format(0, "Physics: %.0f steps/s, step %.2f ms (max %.2f ms), %zu dropped",
+				simStats.stepsPerSecond, simStats.stepMeanMs, simStats.stepMaxMs, simStats.droppedSteps);
+			hud.format(1, "Render: CPU %.2f ms, GPU %.2f ms per frame",
+				framePacer.cpuFrameTimes().mean(), framePacer.gpuFrameTimes().mean());
+			if (profiler.reportUpdated()) {
+				hud.line(2, profiler.report().c_str());
+			}
+			hud.draw(10.f, 10.f);
+
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		physics.stop();
+		physics.report(std::cout);
+		benchmark.finish();
 		for (int i = 0; i < collisionShapes.size(); ++i) {
 			delete collisionShapes[i];
 		}
 	}
 
-	gltDeleteText(text);
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
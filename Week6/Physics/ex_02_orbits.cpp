@@ -10,6 +10,13 @@
 #include "glhelper/Mesh.hpp"
 #include "glhelper/Texture.hpp"
 #include "glhelper/Matrices.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
+#include "glhelper/HudText.hpp"
+#include "glhelper/SimulationThread.hpp"
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/mesh.h"
@@ -46,6 +53,8 @@
 const int winWidth = 1280, winHeight = 720;
 
 const Uint64 desiredFrametime = 33;
+// The simulation runs at its own fixed rate, whatever the frame rate.
+const double physicsStepSeconds = 1.0 / 120.0;
 
 float planetMass = 100.f;
 float moonMass = 1.f;
@@ -53,6 +62,7 @@ float moonMass = 1.f;
 
 void loadMesh(glhelper::Mesh* mesh, const std::string &filename) 
 {
+	glhelper::TraceZone zone("loadMesh");
 	Assimp::Importer importer;
 	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
 	const aiScene* aiscene = importer.GetScene();
@@ -99,7 +109,7 @@ void addSphereShape(btAlignedObjectArray<btCollisionShape*>& shapes, btDiscreteD
 
 }
 
-Eigen::Matrix4f getRigidBodyTransform(btDynamicsWorld* world, int idx) {
+glhelper::BodyTransform getRigidBodyTransform(btDynamicsWorld* world, int idx) {
 	btCollisionObject* obj = world->getCollisionObjectArray()[idx];
 	btRigidBody* body = btRigidBody::upcast(obj);
 	btTransform trans;
@@ -109,14 +119,27 @@ Eigen::Matrix4f getRigidBodyTransform(btDynamicsWorld* world, int idx) {
 	else {
 		trans = obj->getWorldTransform();
 	}
-	Eigen::Quaternionf rot(trans.getRotation().w(), trans.getRotation().x(), trans.getRotation().y(), trans.getRotation().z());
-	Eigen::Matrix4f rotMat = Eigen::Matrix4f::Identity();
-	rotMat.block<3, 3>(0, 0) = rot.matrix();
-	return makeTranslationMatrix(Eigen::Vector3f(trans.getOrigin().x(), trans.getOrigin().y(), trans.getOrigin().z())) * rotMat;
+	glhelper::BodyTransform t;
+	t.position = Eigen::Vector3f(trans.getOrigin().x(), trans.getOrigin().y(), trans.getOrigin().z());
+	t.rotation = Eigen::Quaternionf(trans.getRotation().w(), trans.getRotation().x(), trans.getRotation().y(), trans.getRotation().z());
+	return t;
 }
 
-int main()
+// Called on the simulation thread after each step.
+void publishBodies(btDynamicsWorld* world, std::vector<glhelper::BodyTransform> &bodies) {
+	bodies.resize(world->getNumCollisionObjects());
+	for (int i = 0; i < world->getNumCollisionObjects(); ++i) {
+		bodies[i] = getRigidBodyTransform(world, i);
+	}
+}
+
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
@@ -140,8 +163,6 @@ int main()
 	}
 
 	gltInit();
-	GLTtext* text = gltCreateText();
-	gltSetText(text, (std::string("Physics demo")).c_str());
 	glEnable(GL_MULTISAMPLE);
 
 	{
@@ -194,34 +215,54 @@ int main()
 
 		// Add an impulse to your moon here to get it into orbit!
 		
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-
-			world->stepSimulation(desiredFrametime / 1000.f, 10);
-
-			// Calculate gravity here.
-			// Find the position of your moon and planet using getWorldTransform
-			// Use this to get a direction vector for your gravity force.
-			// To get the magnitude use the gravity formula above.
-			// If you add this first, you can check the moon falls in towards the planet.
-			// It should accelerate faster and faster as it goes, due to the inverse
-			// square law.
-
-			// Optional extra task - make the planet a dynamic object (set its mass to planetMass)
-			// and apply the gravitational force to it too. The moon and planet should now rotate
-			// around their common centre of mass. Does the planet orbit as well?
-
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+		glhelper::HudText hud(3);
+
+		// From here on only the simulation thread may touch the world; anything
+		// else (e.g. applying an impulse on a key press) should go through physics.post.
+		glhelper::SimulationThread physics(physicsStepSeconds,
+			[&](double dt) {
+				// Calculate gravity here.
+				// Find the position of your moon and planet using getWorldTransform
+				// Use this to get a direction vector for your gravity force.
+				// To get the magnitude use the gravity formula above.
+				// If you add this first, you can check the moon falls in towards the planet.
+				// It should accelerate faster and faster as it goes, due to the inverse
+				// square law.
+
+				// Optional extra task - make the planet a dynamic object (set its mass to planetMass)
+				// and apply the gravitational force to it too. The moon and planet should now rotate
+				// around their common centre of mass. Does the planet orbit as well?
+
+				world->stepSimulation(btScalar(dt), 1, btScalar(dt));
+			},
+			[&](std::vector<glhelper::BodyTransform> &bodies) { publishBodies(world.get(), bodies); });
+		if (!benchmark.active()) {
+			physics.start();
+		}
 
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
 
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+			if (benchmark.active()) {
+				physics.advanceTo(benchmark.seconds());
+			}
+			physics.beginFrame();
 
-			viewer.update();
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 
@@ -231,36 +272,45 @@ int main()
 			}
 			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
 
 			glDisable(GL_CULL_FACE);
 			glProgramUniform4f(lambertianShader.get(), lambertianShader.uniformLoc("color"), 0.f, 1.0f, 0.1f, 1.f);
-			sphereMesh.modelToWorld(getRigidBodyTransform(world.get(), 0) * planetScale);
+			sphereMesh.modelToWorld(physics.transform(0) * planetScale);
 			sphereMesh.render();
 			glProgramUniform4f(lambertianShader.get(), lambertianShader.uniformLoc("color"), 0.8f, 0.2f, 0.2f, 1.f);
-			sphereMesh.modelToWorld(getRigidBodyTransform(world.get(), 1) * moonScale);
+			sphereMesh.modelToWorld(physics.transform(1) * moonScale);
 			sphereMesh.render();
 
-			gltBeginDraw();
-			gltColor(1.f, 1.f, 1.f, 1.f);
-			gltDrawText2D(text, 10.f, 10.f, 1.f);
-			gltEndDraw();
+			profiler.end("scene");
 
+			glhelper::SimulationStats simStats = physics.stats();
+			hud.format(0, "Physics: %.0f steps/s, step %.2f ms (max %.2f ms), %zu dropped",
+				simStats.stepsPerSecond, simStats.stepMeanMs, simStats.stepMaxMs, simStats.droppedSteps);
+			hud.format(1, "Render: CPU %.2f ms, GPU %.2f ms per frame",
+				framePacer.cpuFrameTimes().mean(), framePacer.gpuFrameTimes().mean());
+			if (profiler.reportUpdated()) {
+				hud.line(2, profiler.report().c_str());
+			}
+			hud.draw(10.f, 10.f);
+
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		physics.stop();
+		physics.report(std::cout);
+		benchmark.finish();
 		for (int i = 0; i < collisionShapes.size(); ++i) {
 			delete collisionShapes[i];
 		}
 	}
 
-	gltDeleteText(text);
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
@@ -137,9 +137,26 @@ Eigen::Matrix4f FlyViewer::worldToCam() const
 	return rotate_ * translate_;
 }
 
+CameraPose FlyViewer::pose() const
+{
+	return CameraPose{ position(), theta_, phi_ };
+}
+
+void FlyViewer::pose(const CameraPose &p)
+{
+	theta_ = p.theta;
+	phi_ = p.phi;
+	// translation_ moves the world, so is the negated camera position.
+	translation_ = -p.position;
+	updateRotation();
+	updateTranslation();
+	updateBuffer();
+}
+
 void FlyViewer::updateRotation()
 {
-	auto rotate3 =
+	// Not auto: the product expression would refer to the AngleAxis temporaries after they're gone.
+	Eigen::Matrix3f rotate3 =
 		Eigen::AngleAxisf(phi_, Eigen::Vector3f(1.f, 0.f, 0.f)).matrix() *
 		Eigen::AngleAxisf(theta_, Eigen::Vector3f(0.f, 1.f, 0.f)).matrix();
 	rotate_.block<3, 3>(0, 0) = rotate3;
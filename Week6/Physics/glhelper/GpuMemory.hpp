@@ -0,0 +1,83 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace glhelper {
+
+enum class GpuResourceType { BUFFER, TEXTURE, PROGRAM, VERTEX_ARRAY, FRAMEBUFFER, RENDERBUFFER };
+
+//!\brief One GL object created through glhelper.
+struct GpuAllocation {
+	GpuResourceType type;
+	GLuint id;
+	//!\brief Estimated video memory used, or 0 if negligible (e.g. vertex arrays and framebuffers).
+	size_t bytes;
+	//!\brief What the object is, prefixed by any GpuMemoryScope labels active when it was created.
+	std::string site;
+};
+
+//!\brief Registry of the GL objects owned by glhelper classes (BufferObject, Texture,
+//!       ShaderProgram, Mesh...), for a live view of video memory use and for
+//!       finding leaks.
+//!
+//!       Sizes are estimates from the sizes requested (buffer sizes, texture
+//!       dimensions and internal formats, program binary lengths), not what the
+//!       driver actually allocates.
+//!
+//!       Call reportLeaks just before destroying the GL context: anything still
+//!       registered then was never destroyed.
+//!\note Not thread safe; use on the thread owning the GL context.
+class GpuMemory final
+{
+public:
+	static void track(GpuResourceType type, GLuint id, size_t bytes, const std::string &description);
+	//!\brief Updates the size of an object, e.g. when mipmaps are generated.
+	static void resize(GpuResourceType type, GLuint id, size_t bytes);
+	static void untrack(GpuResourceType type, GLuint id);
+
+	static size_t totalBytes();
+	static size_t bytes(GpuResourceType type);
+	static size_t count(GpuResourceType type);
+	//!\brief Everything currently registered, largest first.
+	static std::vector<GpuAllocation> allocations();
+	//!\brief Incremented whenever anything is tracked, resized or untracked.
+	static size_t generation();
+
+	//!\brief Budget shown by budget(). Defaults to the driver's total video memory if
+	//!       it reports it (GL_NVX_gpu_memory_info), otherwise no budget.
+	static void setBudget(size_t bytes);
+	//!\brief Free video memory reported by the driver (GL_NVX_gpu_memory_info or
+	//!       GL_ATI_meminfo), or 0 if it doesn't say.
+	static size_t driverFreeBytes();
+	//!\brief Usage per type against the budget, and the largest objects, ready for a HUD.
+	static std::string budget(size_t largest = 3);
+
+	//!\brief Prints everything still registered, largest first.
+	//!\return The number of leaked objects.
+	static size_t reportLeaks(std::ostream &out);
+
+	//!\brief Estimated bytes per texel of a texture with the given internal format.
+	static size_t texelBytes(GLenum internalFormat);
+
+private:
+	GpuMemory();
+};
+
+//!\brief Labels the GL objects created during its lifetime, e.g. "skybox", to show
+//!       where they came from in GpuMemory reports. Scopes may nest.
+class GpuMemoryScope final
+{
+public:
+	explicit GpuMemoryScope(const std::string &label);
+	~GpuMemoryScope() throw();
+
+private:
+	GpuMemoryScope(const GpuMemoryScope&);
+	GpuMemoryScope &operator=(const GpuMemoryScope&);
+};
+
+}
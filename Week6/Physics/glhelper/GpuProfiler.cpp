@@ -0,0 +1,215 @@
+#include "GpuProfiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+const double reportIntervalSeconds = 0.5;
+
+}
+
+GpuProfiler::GpuProfiler(size_t latencyFrames, size_t historySize)
+	:frames_(std::max<size_t>(2, latencyFrames)),
+	current_(0),
+	recording_(false),
+	historySize_(historySize),
+	skippedFrames_(0),
+	reportUpdated_(false)
+{
+	for (Frame &f : frames_) {
+		f.queriesUsed = 0;
+		f.pending = false;
+	}
+}
+
+GpuProfiler::~GpuProfiler() throw()
+{
+	for (Frame &f : frames_) {
+		if (!f.queries.empty()) {
+			glDeleteQueries(GLsizei(f.queries.size()), f.queries.data());
+		}
+	}
+}
+
+GLuint GpuProfiler::nextQuery(Frame &frame)
+{
+	if (frame.queriesUsed == frame.queries.size()) {
+		GLuint q;
+		glGenQueries(1, &q);
+		frame.queries.push_back(q);
+	}
+	return frame.queries[frame.queriesUsed++];
+}
+
+bool GpuProfiler::collect(Frame &frame)
+{
+	// Queries complete in order, so the last one being available means they all are.
+	if (!frame.intervals.empty()) {
+		GLint available = 0;
+		glGetQueryObjectiv(frame.queries[frame.queriesUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			return false;
+		}
+	}
+	for (const Interval &i : frame.intervals) {
+		if (i.endQuery == 0) {
+			continue; // Never closed.
+		}
+		GLuint64 start, end;
+		glGetQueryObjectui64v(i.startQuery, GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(i.endQuery, GL_QUERY_RESULT, &end);
+		if (onResult_) {
+			onResult_(scopes_[i.scope].name, start, end);
+		}
+		std::deque<double> &history = scopes_[i.scope].history;
+		history.push_back(double(end - start) * 1e-6);
+		if (history.size() > historySize_) {
+			history.pop_front();
+		}
+	}
+	frame.intervals.clear();
+	frame.queriesUsed = 0;
+	frame.pending = false;
+	return true;
+}
+
+void GpuProfiler::beginFrame()
+{
+	if (recording_) {
+		frames_[current_].pending = true;
+		for (Scope &s : scopes_) {
+			s.openIntervals.clear();
+		}
+	}
+	// Oldest first, so history stays in frame order.
+	bool collected = false;
+	for (size_t i = 1; i <= frames_.size(); ++i) {
+		Frame &f = frames_[(current_ + i) % frames_.size()];
+		if (f.pending) {
+			if (!collect(f)) {
+				break;
+			}
+			collected = true;
+		}
+	}
+	reportUpdated_ = false;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (collected && std::chrono::duration<double>(now - reportTime_).count() >= reportIntervalSeconds) {
+		reportTime_ = now;
+		reportUpdated_ = true;
+	}
+	current_ = (current_ + 1) % frames_.size();
+	recording_ = !frames_[current_].pending;
+	if (!recording_) {
+		++skippedFrames_;
+	}
+}
+
+size_t GpuProfiler::scopeIndex(const std::string &name)
+{
+	auto it = scopeIndices_.find(name);
+	if (it != scopeIndices_.end()) {
+		return it->second;
+	}
+	scopes_.push_back(Scope{ name, {}, {} });
+	scopeIndices_[name] = scopes_.size() - 1;
+	return scopes_.size() - 1;
+}
+
+void GpuProfiler::begin(const std::string &scope)
+{
+	if (!recording_) {
+		return;
+	}
+	Frame &f = frames_[current_];
+	size_t s = scopeIndex(scope);
+	Interval i{ s, nextQuery(f), 0 };
+	glQueryCounter(i.startQuery, GL_TIMESTAMP);
+	scopes_[s].openIntervals.push_back(f.intervals.size());
+	f.intervals.push_back(i);
+}
+
+void GpuProfiler::end(const std::string &scope)
+{
+	if (!recording_) {
+		return;
+	}
+	Frame &f = frames_[current_];
+	Scope &s = scopes_[scopeIndex(scope)];
+	if (s.openIntervals.empty()) {
+		throw std::runtime_error("GpuProfiler::end: scope \"" + scope + "\" was not begun.");
+	}
+	Interval &i = f.intervals[s.openIntervals.back()];
+	s.openIntervals.pop_back();
+	i.endQuery = nextQuery(f);
+	glQueryCounter(i.endQuery, GL_TIMESTAMP);
+}
+
+std::vector<GpuScopeStats> GpuProfiler::stats() const
+{
+	std::vector<GpuScopeStats> result;
+	for (const Scope &s : scopes_) {
+		GpuScopeStats st{ s.name, 0.0, 0.0, 0.0, 0.0, 0.0, s.history.size() };
+		if (!s.history.empty()) {
+			std::vector<double> sorted(s.history.begin(), s.history.end());
+			std::sort(sorted.begin(), sorted.end());
+			st.minMs = sorted.front();
+			st.maxMs = sorted.back();
+			double sum = 0.0;
+			for (double d : sorted) {
+				sum += d;
+			}
+			st.avgMs = sum / double(sorted.size());
+			st.p99Ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+			st.lastMs = s.history.back();
+		}
+		result.push_back(st);
+	}
+	return result;
+}
+
+std::string GpuProfiler::report() const
+{
+	std::string text;
+	char line[128];
+	for (const GpuScopeStats &s : stats()) {
+		snprintf(line, sizeof(line), "%-12s min %6.3f  avg %6.3f  max %6.3f  p99 %6.3f ms\n",
+			s.name.c_str(), s.minMs, s.avgMs, s.maxMs, s.p99Ms);
+		text += line;
+	}
+	return text;
+}
+
+bool GpuProfiler::reportUpdated() const
+{
+	return reportUpdated_;
+}
+
+void GpuProfiler::onResult(ResultCallback callback)
+{
+	onResult_ = std::move(callback);
+}
+
+size_t GpuProfiler::skippedFrames() const
+{
+	return skippedFrames_;
+}
+
+GpuScope::GpuScope(GpuProfiler &profiler, const std::string &name)
+	:profiler_(profiler), name_(name)
+{
+	profiler_.begin(name_);
+}
+
+GpuScope::~GpuScope() throw()
+{
+	try {
+		profiler_.end(name_);
+	} catch (...) {
+	}
+}
+
+}
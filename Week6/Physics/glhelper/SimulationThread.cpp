@@ -0,0 +1,262 @@
+#include "SimulationThread.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+const unsigned slotMask = 3, freshBit = 4;
+const double statsIntervalSeconds = 1.0;
+
+}
+
+SimulationThread::SimulationThread(double stepSeconds, StepFunction step, PublishFunction publish,
+	size_t maxCatchUpSteps)
+	:stepSeconds_(stepSeconds), step_(step), publish_(publish),
+	maxCatchUpSteps_(std::max(maxCatchUpSteps, size_t(1))),
+	writeSlot_(0), readSlot_(2), middle_(1),
+	stepsTaken_(0), alpha_(0.0f), lockstep_(false), lockstepAlpha_(0.0),
+	running_(false), stopRequested_(false),
+	stats_{ 0.0, 0.0, 0.0, 0, 0 },
+	windowSteps_(0), windowSumMs_(0.0), windowMaxMs_(0.0)
+{
+	if (!(stepSeconds_ > 0.0)) {
+		throw std::runtime_error("SimulationThread: the step must be longer than zero seconds.");
+	}
+	publish_(simCurrent_);
+	simPrevious_ = simCurrent_;
+	Clock::time_point now = Clock::now();
+	for (Snapshot &s : snapshots_) {
+		s.previous = simCurrent_;
+		s.current = simCurrent_;
+		s.step = 0;
+		s.published = now;
+	}
+	interpolated_ = simCurrent_;
+	windowStart_ = now;
+}
+
+SimulationThread::~SimulationThread() throw()
+{
+	try {
+		stop();
+	} catch (...) {
+	}
+}
+
+void SimulationThread::start()
+{
+	if (running_) {
+		return;
+	}
+	if (lockstep_) {
+		throw std::runtime_error("SimulationThread: can't start after advanceTo has been used.");
+	}
+	stopRequested_ = false;
+	running_ = true;
+	thread_ = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopRequested_ = true;
+	}
+	wake_.notify_all();
+	if (thread_.joinable()) {
+		thread_.join();
+	}
+	running_ = false;
+}
+
+bool SimulationThread::running() const
+{
+	return running_;
+}
+
+void SimulationThread::post(std::function<void()> task)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	posted_.push_back(std::move(task));
+}
+
+void SimulationThread::advanceTo(double seconds)
+{
+	if (running_) {
+		throw std::runtime_error("SimulationThread: advanceTo can't be used while the thread is running.");
+	}
+	lockstep_ = true;
+	while (double(stepsTaken_ + 1) * stepSeconds_ <= seconds) {
+		takeStep(Clock::now());
+	}
+	lockstepAlpha_ = (seconds - double(stepsTaken_) * stepSeconds_) / stepSeconds_;
+}
+
+void SimulationThread::run()
+{
+	// Naming the thread allocates its trace buffer, which isn't wanted unless tracing.
+	if (Trace::active()) {
+		Trace::setThreadName("Simulation thread");
+	}
+	Clock::duration step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(stepSeconds_));
+	Clock::time_point due = Clock::now() + step;
+	try {
+		while (!stopRequested_) {
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wake_.wait_until(lock, due, [this] { return bool(stopRequested_); });
+			}
+			if (stopRequested_) {
+				break;
+			}
+			Clock::time_point now = Clock::now();
+			for (size_t n = 0; due <= now && n < maxCatchUpSteps_; ++n) {
+				takeStep(due);
+				due += step;
+			}
+			now = Clock::now();
+			if (due <= now) {
+				// Too far behind to catch up: let the simulation run slow rather than spiral.
+				size_t behind = size_t((now - due) / step) + 1;
+				due += step * behind;
+				std::lock_guard<std::mutex> lock(mutex_);
+				stats_.droppedSteps += behind;
+			}
+		}
+	} catch (...) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		error_ = std::current_exception();
+	}
+	running_ = false;
+}
+
+void SimulationThread::takeStep(Clock::time_point due)
+{
+	TraceZone zone("SimulationThread::takeStep");
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		postedRunning_.swap(posted_);
+	}
+	for (std::function<void()> &task : postedRunning_) {
+		task();
+	}
+	postedRunning_.clear();
+
+	Clock::time_point start = Clock::now();
+	step_(stepSeconds_);
+	record(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+	++stepsTaken_;
+
+	simPrevious_.swap(simCurrent_);
+	publish_(simCurrent_);
+	Snapshot &s = snapshots_[writeSlot_];
+	s.previous.assign(simPrevious_.begin(), simPrevious_.end());
+	s.current.assign(simCurrent_.begin(), simCurrent_.end());
+	s.step = stepsTaken_;
+	s.published = due;
+	writeSlot_ = middle_.exchange(unsigned(writeSlot_) | freshBit) & slotMask;
+}
+
+void SimulationThread::record(double ms)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	stepTimes_.add(ms);
+	++stats_.steps;
+	++windowSteps_;
+	windowSumMs_ += ms;
+	windowMaxMs_ = std::max(windowMaxMs_, ms);
+	Clock::time_point now = Clock::now();
+	double elapsed = std::chrono::duration<double>(now - windowStart_).count();
+	if (elapsed >= statsIntervalSeconds) {
+		stats_.stepsPerSecond = double(windowSteps_) / elapsed;
+		stats_.stepMeanMs = windowSumMs_ / double(windowSteps_);
+		stats_.stepMaxMs = windowMaxMs_;
+		windowSteps_ = 0;
+		windowSumMs_ = windowMaxMs_ = 0.0;
+		windowStart_ = now;
+	}
+}
+
+void SimulationThread::beginFrame()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (error_) {
+			std::exception_ptr e = error_;
+			error_ = nullptr;
+			std::rethrow_exception(e);
+		}
+	}
+	if (middle_.load() & freshBit) {
+		readSlot_ = middle_.exchange(unsigned(readSlot_)) & slotMask;
+	}
+	const Snapshot &s = snapshots_[readSlot_];
+
+	double a = lockstep_ ? lockstepAlpha_
+		: std::chrono::duration<double>(Clock::now() - s.published).count() / stepSeconds_;
+	alpha_ = float(std::min(std::max(a, 0.0), 1.0));
+
+	size_t n = std::min(s.previous.size(), s.current.size());
+	interpolated_.resize(s.current.size());
+	for (size_t i = 0; i < n; ++i) {
+		interpolated_[i].position = s.previous[i].position + alpha_ * (s.current[i].position - s.previous[i].position);
+		interpolated_[i].rotation = s.previous[i].rotation.slerp(alpha_, s.current[i].rotation);
+	}
+	// Bodies added by the last step have nothing to interpolate from.
+	std::copy(s.current.begin() + n, s.current.end(), interpolated_.begin() + n);
+}
+
+float SimulationThread::alpha() const
+{
+	return alpha_;
+}
+
+size_t SimulationThread::bodies() const
+{
+	return interpolated_.size();
+}
+
+Eigen::Matrix4f SimulationThread::transform(size_t body) const
+{
+	const BodyTransform &b = bodyTransform(body);
+	Eigen::Matrix4f m = Eigen::Matrix4f::Identity();
+	m.block<3, 3>(0, 0) = b.rotation.toRotationMatrix();
+	m.block<3, 1>(0, 3) = b.position;
+	return m;
+}
+
+const BodyTransform &SimulationThread::bodyTransform(size_t body) const
+{
+	if (body >= interpolated_.size()) {
+		throw std::runtime_error("SimulationThread: body " + std::to_string(body) + " doesn't exist.");
+	}
+	return interpolated_[body];
+}
+
+double SimulationThread::stepSeconds() const
+{
+	return stepSeconds_;
+}
+
+SimulationStats SimulationThread::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+void SimulationThread::report(std::ostream &out) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	char line[160];
+	snprintf(line, sizeof(line),
+		"Simulation: %zu steps of %.2f ms, step time mean %.3f ms, 95%% %.3f ms, max %.3f ms, %zu dropped\n",
+		stats_.steps, stepSeconds_ * 1e3, stepTimes_.mean(), stepTimes_.percentile(0.95), stepTimes_.max(),
+		stats_.droppedSteps);
+	out << line;
+}
+
+}
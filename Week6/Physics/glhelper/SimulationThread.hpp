@@ -0,0 +1,159 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include "FramePacer.hpp"
+
+namespace glhelper {
+
+//!\brief Pose of one rigid body in a simulation snapshot.
+struct BodyTransform {
+	Eigen::Vector3f position;
+	Eigen::Quaternionf rotation;
+};
+
+//!\brief Timing of the simulation thread, separate from the render thread's.
+struct SimulationStats {
+	//!\brief Steps actually taken per second over the last second.
+	double stepsPerSecond;
+	//!\brief CPU time of the step function over the last second, in milliseconds.
+	double stepMeanMs, stepMaxMs;
+	size_t steps;
+	//!\brief Steps skipped because the simulation fell too far behind real time.
+	size_t droppedSteps;
+};
+
+//!\brief Runs a physics simulation at a fixed rate on its own thread, so a slow
+//!       frame doesn't slow the physics, and slow physics doesn't slow rendering.
+//!
+//!       After each step, the publish function copies every body's transform into
+//!       a snapshot. Snapshots are passed to the render thread through a triple
+//!       buffer, so neither thread ever waits for the other. Each snapshot holds
+//!       the transforms after the last two steps, and beginFrame interpolates
+//!       between them by how far the render thread is through the current step
+//!       (alpha), so motion stays smooth whatever the two rates are. This shows
+//!       the state up to one step late.
+//!
+//!       The step and publish functions, and anything passed to post, run on the
+//!       simulation thread once start has been called. Nothing else may touch the
+//!       simulated world until stop.
+//!
+//!       For repeatable runs (e.g. under Benchmark), call advanceTo each frame
+//!       instead of start: steps then run on the calling thread, up to the given
+//!       simulated time.
+//!
+//!       Usage:
+//!           SimulationThread physics(1.0 / 120.0,
+//!               [&](double dt) { world->stepSimulation(btScalar(dt), 0); },
+//!               [&](std::vector<BodyTransform> &bodies) { ...copy each body's transform... });
+//!           physics.start();
+//!           while (...) {
+//!               physics.beginFrame();
+//!               mesh.modelToWorld(physics.transform(2) * scale);
+//!               ...
+//!           }
+//!           physics.stop();
+//!           physics.report(std::cout);
+class SimulationThread final
+{
+public:
+	typedef std::function<void(double stepSeconds)> StepFunction;
+	typedef std::function<void(std::vector<BodyTransform> &bodies)> PublishFunction;
+
+	//!\brief Calls publish straight away, so there are transforms to draw before the first step.
+	//!\param publish Resizes bodies to the number of bodies and fills in their transforms.
+	//!\param maxCatchUpSteps Steps run back to back to catch up after a stall, before
+	//!       the rest are dropped.
+	SimulationThread(double stepSeconds, StepFunction step, PublishFunction publish,
+		size_t maxCatchUpSteps = 5);
+	//!\brief Stops the thread.
+	~SimulationThread() throw();
+
+	void start();
+	//!\brief Waits for the current step to finish and stops the thread.
+	void stop();
+	bool running() const;
+
+	//!\brief Runs task on the simulation thread before its next step, e.g. to apply an impulse.
+	//!       If the thread isn't running, it runs before the next step taken by advanceTo.
+	void post(std::function<void()> task);
+
+	//!\brief Steps on the calling thread until simulated time reaches seconds.
+	//!       Use instead of start for deterministic runs.
+	void advanceTo(double seconds);
+
+	//!\brief Takes the latest snapshot and interpolates the body transforms for this frame.
+	//!       Rethrows any exception thrown on the simulation thread.
+	void beginFrame();
+	//!\brief How far this frame is between the snapshot's two steps, 0 to 1.
+	float alpha() const;
+	size_t bodies() const;
+	//!\brief Interpolated modelToWorld of a body this frame.
+	Eigen::Matrix4f transform(size_t body) const;
+	const BodyTransform &bodyTransform(size_t body) const;
+
+	double stepSeconds() const;
+	SimulationStats stats() const;
+	void report(std::ostream &out) const;
+
+private:
+	SimulationThread(const SimulationThread&);
+	SimulationThread &operator=(const SimulationThread&);
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct Snapshot {
+		std::vector<BodyTransform> previous, current;
+		size_t step;
+		Clock::time_point published;
+	};
+
+	void run();
+	//!\brief Runs posted tasks and one step, then publishes a snapshot due at the given time.
+	void takeStep(Clock::time_point due);
+	void record(double ms);
+
+	double stepSeconds_;
+	StepFunction step_;
+	PublishFunction publish_;
+	size_t maxCatchUpSteps_;
+
+	// Triple buffer: the simulation writes snapshots_[writeSlot_], the render thread
+	// reads snapshots_[readSlot_], and the third slot is exchanged through middle_.
+	Snapshot snapshots_[3];
+	size_t writeSlot_, readSlot_;
+	std::atomic<unsigned> middle_;
+
+	// Owned by whichever thread is stepping.
+	std::vector<BodyTransform> simPrevious_, simCurrent_;
+	size_t stepsTaken_;
+
+	// Owned by the render thread.
+	std::vector<BodyTransform> interpolated_;
+	float alpha_;
+	bool lockstep_;
+	double lockstepAlpha_;
+
+	std::thread thread_;
+	std::atomic<bool> running_, stopRequested_;
+	std::exception_ptr error_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable wake_;
+	std::vector<std::function<void()>> posted_, postedRunning_;
+	FrameTimeHistogram stepTimes_;
+	SimulationStats stats_;
+	size_t windowSteps_;
+	double windowSumMs_, windowMaxMs_;
+	Clock::time_point windowStart_;
+};
+
+}
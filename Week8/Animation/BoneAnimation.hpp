@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <vector>
+
+// This is the class I suggest you use to store the skeletal animation for a single bone in the mesh.
+struct BoneAnimation {
+	// The duration is the total length of the animation (for rotation, position and scale keys).
+	float duration;
+
+	// These arrays contain keys for rotation, position and scale, and times to display them.
+	// Be careful - the number and timings of the keys may not match up
+	// For example it's fine to have 10 rotation keys and 20 position keys, and for their
+	// display times to be different!
+	std::vector<Eigen::Quaternionf> rotationKeys;
+	std::vector<float> rotationTimes;
+	std::vector<Eigen::Vector3f> positionKeys;
+	std::vector<float> positionTimes;
+	std::vector<Eigen::Vector3f> scaleKeys;
+	std::vector<float> scaleTimes;
+
+	Eigen::Matrix4f evaluate(float time) {
+		// Your code here 
+		// Rather than the identity, return the matrix that scales, then rotates, then translates this bone.
+		return Eigen::Matrix4f::Identity();
+	}
+
+	// In the event that no keyframes are present, all the functions below
+	// should return identity matrices.
+	// E.g. if rotationKeys.length() == 0
+	// then findRotation should return the identity.
+
+	Eigen::Matrix4f findPosition(float time) {
+		// Your code here.
+		// Linearly interpolate positionKeys based on positionTimes.
+		return Eigen::Matrix4f::Identity();
+	}
+
+	Eigen::Matrix4f findRotation(float time) {
+		// Your code here.
+		// Linearly interpolate rotationKeys based on rotationTimes.
+		// Convert the result to a 4x4 matrix
+		return Eigen::Matrix4f::Identity();
+	}
+
+	Eigen::Matrix4f findScale(float time) {
+		// Your code here.
+		// Linearly interpolate scaleKeys based on scaleTimes.
+		return Eigen::Matrix4f::Identity();
+	}
+};
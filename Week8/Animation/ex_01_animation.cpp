@@ -10,6 +10,13 @@
 #include "glhelper/Mesh.hpp"
 #include "glhelper/Texture.hpp"
 #include "glhelper/Matrices.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/HudText.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
+#include "BoneAnimation.hpp"
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/mesh.h"
@@ -50,52 +57,8 @@ const int MAX_BONES_PER_VERT = 4;
 // mesh.
 const int MAX_BONES = 40;
 
-// This is the class I suggest you use to store the skeletal animation for a single bone in the mesh.
-struct BoneAnimation {
-	// The duration is the total length of the animation (for rotation, position and scale keys).
-	float duration;
-
-	// These arrays contain keys for rotation, position and scale, and times to display them.
-	// Be careful - the number and timings of the keys may not match up
-	// For example it's fine to have 10 rotation keys and 20 position keys, and for their
-	// display times to be different!
-	std::vector<Eigen::Quaternionf> rotationKeys;
-	std::vector<float> rotationTimes;
-	std::vector<Eigen::Vector3f> positionKeys;
-	std::vector<float> positionTimes;
-	std::vector<Eigen::Vector3f> scaleKeys;
-	std::vector<float> scaleTimes;
-
-	Eigen::Matrix4f evaluate(float time) {
-		// Your code here 
-		// Rather than the identity, return the matrix that scales, then rotates, then translates this bone.
-		return Eigen::Matrix4f::Identity();
-	}
-
-	// In the event that no keyframes are present, all the functions below
-	// should return identity matrices.
-	// E.g. if rotationKeys.length() == 0
-	// then findRotation should return the identity.
-
-	Eigen::Matrix4f findPosition(float time) {
-		// Your code here.
-		// Linearly interpolate positionKeys based on positionTimes.
-		return Eigen::Matrix4f::Identity();
-	}
-
-	Eigen::Matrix4f findRotation(float time) {
-		// Your code here.
-		// Linearly interpolate rotationKeys based on rotationTimes.
-		// Convert the result to a 4x4 matrix
-		return Eigen::Matrix4f::Identity();
-	}
-
-	Eigen::Matrix4f findScale(float time) {
-		// Your code here.
-		// Linearly interpolate scaleKeys based on scaleTimes.
-		return Eigen::Matrix4f::Identity();
-	}
-};
+// BoneAnimation, the class I suggest you use to store the skeletal animation for a single bone,
+// is in BoneAnimation.hpp (so glhelper_bench can time it too). Fill in its functions there.
 
 // Here's the suggested struct to store info for a single bone in the mesh.
 // We have some new information this time, the indices of the parent to this bone
@@ -113,6 +76,7 @@ struct BoneInfo {
 
 void loadAnimatedMesh(glhelper::Mesh* mesh, const std::string &filename, std::vector<BoneInfo> &boneInfo) 
 {
+	glhelper::TraceZone zone("loadAnimatedMesh");
 	Assimp::Importer importer;
 	importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
 	const aiScene* aiscene = importer.GetScene();
@@ -194,8 +158,13 @@ void loadAnimatedMesh(glhelper::Mesh* mesh, const std::string &filename, std::ve
 	mesh->boneWeights(boneWeights);
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
 
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
@@ -219,11 +188,10 @@ int main()
 	}
 
 	gltInit();
-	GLTtext* text = gltCreateText();
-	gltSetText(text, (std::string("Animation demo")).c_str());
 	glEnable(GL_MULTISAMPLE);
 
 	{
+		glhelper::HudText hud(2);
 		glhelper::ShaderProgram animatedMeshShader({ "../shaders/AnimatedMesh.vert", "../shaders/AnimatedMesh.frag" });
 		glhelper::RotateViewer viewer(winWidth, winHeight);
 		viewer.distance(20.f);
@@ -258,20 +226,27 @@ int main()
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		auto startTime = std::chrono::steady_clock::now();
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
 
-		while (!shouldQuit) {
-			Uint64 frameStartTime = SDL_GetTicks64();
-			float animTimeSeconds = 1e-6f * (float)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
 
-			viewer.update();
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+			float animTimeSeconds = float(benchmark.seconds());
+
+			if (!benchmark.active()) {
+				viewer.update();
+			}
 
 			while (SDL_PollEvent(&event)) {
 				// Check for X of window being clicked, or ALT+F4
 				if (event.type == SDL_QUIT) {
 					shouldQuit = true;
 				}
-				else {
+				else if (!benchmark.active()) {
 					viewer.processEvent(event);
 				}
 
@@ -282,6 +257,7 @@ int main()
 			}
 			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
 
 			// Your code here !
 			// Now let's use the animation!
@@ -312,26 +288,29 @@ int main()
 			chickMesh.render();
 			glBindTexture(GL_TEXTURE_2D, 0);
 
-			std::string textStr = std::string("Animation Time: ") + std::to_string(animTimeSeconds) + std::string(" seconds.");
-			gltSetText(text, textStr.c_str());
-			gltBeginDraw();
-			gltColor(1.f, 1.f, 1.f, 1.f);
-			gltDrawText2D(text, 10.f, 10.f, 1.f);
-			gltEndDraw();
+			profiler.end("scene");
 
+			// Only regenerates the text when the displayed time changes.
+			hud.format(0, "Animation Time: %.1f seconds.", animTimeSeconds);
+			if (profiler.reportUpdated()) {
+				hud.line(1, profiler.report().c_str());
+			}
+			hud.draw(10.f, 10.f);
+
+			benchmark.endFrame();
 			SDL_GL_SwapWindow(window);
 
-			Uint64 elapsedFrameTime = SDL_GetTicks64() - frameStartTime;
-			if (elapsedFrameTime < desiredFrametime) {
-				SDL_Delay(desiredFrametime - elapsedFrameTime);
-			}
+			framePacer.endFrame();
 		}
+		benchmark.finish();
+
+		glDeleteTextures(1, &texture);
 	}
 
-	gltDeleteText(text);
+	glhelper::GpuMemory::reportLeaks(std::cerr);
 	SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return 0;
+	return benchmark.exitCode();
 }
@@ -3,6 +3,7 @@
 #include <GL/glew.h>
 #include <vector>
 #include <Eigen/Dense>
+#include "RenderStats.hpp"
 
 namespace glhelper {
 
@@ -19,6 +20,7 @@ public:
 	{
     	glBindBuffer(GL_ARRAY_BUFFER, buf_);
     	glBufferSubData(GL_ARRAY_BUFFER, 0, v.size() * sizeof(T), v.data());
+		RenderStats::recordUpload(v.size() * sizeof(T));
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
@@ -27,6 +29,7 @@ public:
 	{
     	glBindBuffer(GL_ARRAY_BUFFER, buf_);
     	glBufferSubData(GL_ARRAY_BUFFER, offset*sizeof(T), v.size() * sizeof(T), v.data());
+		RenderStats::recordUpload(v.size() * sizeof(T));
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
@@ -0,0 +1,109 @@
+#include "HudText.hpp"
+#include <gltext.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace glhelper {
+
+HudText::HudText(size_t nLines, size_t lineCapacity)
+	:nLines_(nLines), lineCapacity_(lineCapacity),
+	lineBuffers_(nLines * (lineCapacity + 1), '\0'),
+	scratch_(lineCapacity + 1, '\0'),
+	// Each line plus its newline, and the terminator.
+	joined_(nLines * (lineCapacity + 1) + 1, '\0'),
+	text_(gltCreateText()),
+	dirty_(true),
+	rebuilds_(0)
+{
+	if (text_ == nullptr) {
+		throw std::runtime_error("HudText: gltCreateText failed. Has gltInit been called?");
+	}
+}
+
+HudText::~HudText() throw()
+{
+	gltDeleteText(text_);
+}
+
+size_t HudText::lineOffset(size_t index) const
+{
+	if (index >= nLines_) {
+		throw std::runtime_error("HudText: line index out of range.");
+	}
+	return index * (lineCapacity_ + 1);
+}
+
+bool HudText::store(size_t index, const char *text)
+{
+	char *buf = &lineBuffers_[lineOffset(index)];
+	if (std::strncmp(buf, text, lineCapacity_) == 0) {
+		return false;
+	}
+	std::strncpy(buf, text, lineCapacity_);
+	buf[lineCapacity_] = '\0';
+	dirty_ = true;
+	return true;
+}
+
+bool HudText::line(size_t index, const char *text)
+{
+	return store(index, text);
+}
+
+bool HudText::format(size_t index, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(scratch_.data(), scratch_.size(), fmt, args);
+	va_end(args);
+	return store(index, scratch_.data());
+}
+
+const char *HudText::line(size_t index) const
+{
+	return &lineBuffers_[lineOffset(index)];
+}
+
+size_t HudText::lines() const
+{
+	return nLines_;
+}
+
+void HudText::rebuild()
+{
+	char *out = joined_.data();
+	for (size_t i = 0; i < nLines_; ++i) {
+		const char *buf = &lineBuffers_[lineOffset(i)];
+		size_t length = std::strlen(buf);
+		std::memcpy(out, buf, length);
+		out += length;
+		// Block lines (e.g. tables) usually end in a newline already.
+		if (i + 1 < nLines_ && (length == 0 || buf[length - 1] != '\n')) {
+			*out++ = '\n';
+		}
+	}
+	*out = '\0';
+	gltSetText(text_, joined_.data());
+	dirty_ = false;
+	++rebuilds_;
+}
+
+void HudText::draw(float x, float y, float scale)
+{
+	if (dirty_) {
+		rebuild();
+	}
+	gltBeginDraw();
+	gltColor(1.f, 1.f, 1.f, 1.f);
+	gltDrawText2D(text_, x, y, scale);
+	gltEndDraw();
+}
+
+size_t HudText::rebuilds() const
+{
+	return rebuilds_;
+}
+
+}
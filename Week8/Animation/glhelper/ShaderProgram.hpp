@@ -39,6 +39,10 @@ public:
 	void validate();
 
 	GLuint get() const { return program_; }
+
+	//!\brief Replaces each "#pragma include file" line with the contents of that file,
+	//!       found relative to sourcePath.
+	static std::string preprocessSource(const std::string &source, const std::string &sourcePath);
 private:
 	ShaderProgram(const ShaderProgram &);
 	ShaderProgram &operator=(const ShaderProgram &);
@@ -47,7 +51,6 @@ private:
 	std::set<std::string> notfound_;
 	GLuint program_;
 
-	static std::string preprocessSource(const std::string &source, const std::string &sourcePath);
 	static GLuint compileShader(const std::string &filename, GLenum type);
 	static GLuint makeShaderProgram(
 		const std::vector<GLuint> &shaders,
@@ -4,6 +4,7 @@
 #include <Eigen/Dense>
 #include "Constants.hpp"
 #include "GLBuffer.hpp"
+#include "CameraPath.hpp"
 
 namespace glhelper {
 
@@ -23,6 +24,11 @@ namespace glhelper {
 		virtual void resize(size_t width, size_t height) = 0;
 
 		virtual Eigen::Matrix4f worldToCam() const = 0;
+
+		//!\brief Current camera pose, e.g. to record a CameraPath.
+		virtual CameraPose pose() const = 0;
+		//!\brief Moves the camera, e.g. along a CameraPath.
+		virtual void pose(const CameraPose &p) = 0;
 	protected:
 		void updateBuffer();
 
@@ -0,0 +1,145 @@
+#define SDL_MAIN_HANDLED
+#include <GL/glew.h>
+#include <SDL.h>
+#include <iostream>
+#include <iomanip>
+#include <exception>
+#include <chrono>
+#include <cmath>
+#include "glhelper/Texture.hpp"
+#include "glhelper/MipGenerator.hpp"
+#include "glhelper/GpuMemory.hpp"
+
+#include <opencv2/opencv.hpp>
+/* This program compares the driver's glGenerateMipmap with glhelper's CPU mip generator (generateMipChain)
+* on the cobblestone textures used by the heightfield exercise.
+*
+* For each texture it reports how long each path takes, and the PSNR of each CPU-generated level against the
+* level the driver produced. Levels with very high PSNR are near-identical; lower values show where the filters
+* differ (expected with the Kaiser filter, which is deliberately sharper than the driver's box filter).
+*
+* The CPU path needs no GL context, so in your own code you can run it on a loading thread and only call
+* Texture::setMipChain on the GL thread.
+*/
+
+const int winWidth = 64, winHeight = 64;
+
+struct TestTexture {
+	std::string name;
+	cv::Mat image;
+	GLenum internalFormat, format;
+	glhelper::MipMode mode;
+};
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return 1e-3 * (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<cv::Mat> driverMipChain(const TestTexture &t, double *milliseconds)
+{
+	glhelper::Texture texture(GL_TEXTURE_2D, t.internalFormat, t.image.cols, t.image.rows,
+		0, t.format, GL_UNSIGNED_BYTE, t.image.data, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	texture.genMipmap();
+	glFinish();
+	*milliseconds = millisecondsSince(start);
+
+	std::vector<cv::Mat> levels;
+	int w = t.image.cols, h = t.image.rows;
+	for (size_t level = 0; ; ++level) {
+		cv::Mat m(h, w, t.image.type());
+		texture.getData(m.data, level, m.total() * m.elemSize());
+		levels.push_back(m);
+		if (w == 1 && h == 1) break;
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+	}
+	return levels;
+}
+
+int main()
+{
+	SDL_Init(SDL_INIT_VIDEO);
+
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
+
+	// We never draw to this window, it's only needed for a GL context.
+	SDL_Window* window = SDL_CreateWindow("Mip Generation Comparison", 50, 50, winWidth, winHeight, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	SDL_GLContext context = SDL_GL_CreateContext(window);
+
+	GLenum result = glewInit();
+	if (result != GLEW_OK) {
+		throw std::runtime_error("GLEW couldn't initialize.");
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	{
+		std::vector<TestTexture> textures;
+		{
+			cv::Mat depthImage = cv::imread("../images/cobblestone_depth.png");
+			cv::cvtColor(depthImage, depthImage, cv::COLOR_BGR2GRAY);
+			textures.push_back({ "depth", depthImage, GL_R8, GL_RED, glhelper::MipMode::LINEAR });
+			textures.push_back({ "albedo", cv::imread("../images/cobblestone_albedo.png"), GL_SRGB8, GL_BGR, glhelper::MipMode::SRGB });
+			textures.push_back({ "normal", cv::imread("../images/cobblestone_normal.png"), GL_RGB8, GL_BGR, glhelper::MipMode::NORMAL_MAP });
+		}
+
+		std::cout << "CPU mip generator using " << glhelper::mipSimdPath() << "\n\n";
+		std::cout << std::fixed << std::setprecision(2);
+
+		for (const TestTexture &t : textures) {
+			if (t.image.empty()) {
+				std::cout << "Couldn't load " << t.name << " texture, skipping.\n";
+				continue;
+			}
+			double driverMs;
+			std::vector<cv::Mat> driverLevels = driverMipChain(t, &driverMs);
+
+			for (glhelper::MipFilter filter : { glhelper::MipFilter::BOX, glhelper::MipFilter::KAISER }) {
+				glhelper::MipSettings settings;
+				settings.filter = filter;
+				settings.mode = t.mode;
+
+				auto start = std::chrono::steady_clock::now();
+				std::vector<cv::Mat> cpuLevels = glhelper::generateMipChain(t.image, settings);
+				double cpuMs = millisecondsSince(start);
+
+				std::cout << t.name << " (" << t.image.cols << "x" << t.image.rows << ") "
+					<< (filter == glhelper::MipFilter::BOX ? "box" : "kaiser")
+					<< ": driver " << driverMs << " ms, CPU " << cpuMs << " ms\n";
+				std::cout << "\tPSNR vs driver by level (dB):";
+				for (size_t level = 1; level < std::min(cpuLevels.size(), driverLevels.size()); ++level) {
+					double psnr = glhelper::mipPsnr(cpuLevels[level], driverLevels[level]);
+					if (std::isinf(psnr)) {
+						std::cout << " exact";
+					} else {
+						std::cout << " " << psnr;
+					}
+				}
+				std::cout << "\n";
+			}
+
+			// Upload path, to show how long the GL thread is actually busy with the CPU chain.
+			glhelper::Texture texture(GL_TEXTURE_2D, t.internalFormat, t.image.cols, t.image.rows,
+				0, t.format, GL_UNSIGNED_BYTE, nullptr, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+			std::vector<cv::Mat> cpuLevels = glhelper::generateMipChain(t.image, glhelper::MipSettings{ glhelper::MipFilter::BOX, t.mode });
+			glFinish();
+			auto start = std::chrono::steady_clock::now();
+			texture.setMipChain(cpuLevels);
+			glFinish();
+			std::cout << "\tUploading CPU chain: " << millisecondsSince(start) << " ms\n\n";
+		}
+	}
+
+	glhelper::GpuMemory::reportLeaks(std::cerr);
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+
+	return 0;
+}
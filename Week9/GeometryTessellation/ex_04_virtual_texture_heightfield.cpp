@@ -0,0 +1,288 @@
+#define SDL_MAIN_HANDLED
+#include <GL/glew.h>
+#include <SDL.h>
+#include <iostream>
+#include <exception>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "glhelper/ShaderProgram.hpp"
+#include "glhelper/FlyViewer.hpp"
+#include "glhelper/Mesh.hpp"
+#include "glhelper/MipGenerator.hpp"
+#include "glhelper/TileFile.hpp"
+#include "glhelper/VirtualTexture.hpp"
+#include "glhelper/FramePacer.hpp"
+#include "glhelper/Benchmark.hpp"
+#include "glhelper/GpuMemory.hpp"
+#include "glhelper/GpuProfiler.hpp"
+#include "glhelper/Trace.hpp"
+
+#include <opencv2/opencv.hpp>
+#define GLT_IMPLEMENTATION
+#include <gltext.h>
+/* This program renders a tessellated heightfield whose height, colour and normal maps are far larger than
+* would comfortably fit in GPU memory, using virtual texturing (glhelper::VirtualTexture).
+*
+* The maps are stored on disk as tile files. Each frame the terrain is also rendered into a small feedback
+* buffer recording which tiles (and which mip levels) are visible. That buffer is read back asynchronously,
+* and worker threads stream any missing tiles from disk into fixed-size cache textures. Until a tile arrives,
+* the shaders fall back to the nearest coarser tile that is resident, so the view sharpens progressively as
+* you fly in rather than stalling.
+*
+* By default this builds a demo data set by repeating the 512x512 cobblestone textures 8 times in each
+* direction (4096^2 texels per layer, written to ../images/virtual/8/ on first run). That is deliberately
+* small so the first run is quick; pass --virtual-repeat 64 to build the full gigapixel version instead
+* (32768^2 texels per layer, roughly 11GB of tile files, built once and streamed exactly the same way).
+* Pass three tile files (height, albedo, normals) on the command line (before any benchmark options) to
+* use your own data instead - TileFile::write can build them from any image.
+*
+* Controls: fly with the mouse and WASD. UP/DOWN change tessellation, SHIFT+UP/DOWN change height scale.
+*/
+
+const int winWidth = 1280, winHeight = 720;
+
+const Uint64 desiredFrametime = 33;
+
+// Control mesh quads along each side. Each is then tessellated into tessLevel x tessLevel quads.
+const int meshWidth = 33;
+const float terrainSize = 8.f;
+
+// The demo data set is (512 * repeat)^2 texels per layer: about 180MB of tile files at the default
+// repeat of 8, about 11GB at 64 (one gigapixel per layer). The repeat must be a power of two.
+const int defaultVirtualRepeat = 8;
+const size_t tileSize = 128, tileBorder = 4;
+
+float tessLevel = 32.f;
+float depthScaling = 0.05f;
+
+// Writes a tile file for an image repeated `repeat` times in each direction, without ever
+// holding the full-size image in memory: level L is just level L of the source, wrapped.
+void writeRepeatedTileFile(const std::string &path, const cv::Mat &image, int repeat, glhelper::MipMode mode)
+{
+	glhelper::MipSettings settings;
+	settings.mode = mode;
+	std::vector<cv::Mat> chain = glhelper::generateMipChain(image, settings);
+	glhelper::TileFile::write(path, size_t(image.cols * repeat), size_t(image.rows * repeat), size_t(image.channels()),
+		tileSize, tileBorder,
+		[&chain](size_t level, int x, int y, cv::Mat &out) {
+			const cv::Mat &src = chain[std::min(level, chain.size() - 1)];
+			size_t c = size_t(src.channels());
+			for (int row = 0; row < out.rows; ++row) {
+				int sy = ((y + row) % src.rows + src.rows) % src.rows;
+				for (int col = 0; col < out.cols; ++col) {
+					int sx = ((x + col) % src.cols + src.cols) % src.cols;
+					memcpy(out.ptr<unsigned char>(row) + col * c, src.ptr<unsigned char>(sy) + sx * c, c);
+				}
+			}
+		});
+}
+
+std::vector<std::string> demoTileFiles(int virtualRepeat)
+{
+	const std::string dir = "../images/virtual/" + std::to_string(virtualRepeat) + "/";
+	std::vector<std::string> files = { dir + "height.tiles", dir + "albedo.tiles", dir + "normal.tiles" };
+	if (std::filesystem::exists(files[0]) && std::filesystem::exists(files[1]) && std::filesystem::exists(files[2])) {
+		return files;
+	}
+	std::cout << "Building demo tile files in " << dir << " (first run only)..." << std::endl;
+	std::filesystem::create_directories(dir);
+	cv::Mat depthImage = cv::imread("../images/cobblestone_depth.png");
+	cv::cvtColor(depthImage, depthImage, cv::COLOR_BGR2GRAY);
+	writeRepeatedTileFile(files[0], depthImage, virtualRepeat, glhelper::MipMode::LINEAR);
+	writeRepeatedTileFile(files[1], cv::imread("../images/cobblestone_albedo.png"), virtualRepeat, glhelper::MipMode::SRGB);
+	writeRepeatedTileFile(files[2], cv::imread("../images/cobblestone_normal.png"), virtualRepeat, glhelper::MipMode::NORMAL_MAP);
+	return files;
+}
+
+int main(int argc, char *argv[])
+{
+	glhelper::Benchmark benchmark(argc, argv);
+	if (benchmark.compareOnly()) {
+		return benchmark.exitCode();
+	}
+
+	int virtualRepeat = defaultVirtualRepeat;
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (std::string(argv[i]) == "--virtual-repeat") {
+			virtualRepeat = std::stoi(argv[i + 1]);
+		}
+	}
+	if (virtualRepeat < 1 || (virtualRepeat & (virtualRepeat - 1)) != 0) {
+		throw std::runtime_error("--virtual-repeat must be a power of two.");
+	}
+
+	std::vector<std::string> tileFiles;
+	if (argc >= 4 && argv[1][0] != '-') {
+		tileFiles = { argv[1], argv[2], argv[3] };
+	} else {
+		tileFiles = demoTileFiles(virtualRepeat);
+	}
+
+	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
+
+	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 1);
+	// Turns on 4x MSAA
+	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
+	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
+
+	// Prepare window
+	SDL_Window* window = SDL_CreateWindow("Virtual Texture Heightfield Streaming", 50, 50, winWidth, winHeight, SDL_WINDOW_OPENGL);
+	SDL_GLContext context = SDL_GL_CreateContext(window);
+
+	GLenum result = glewInit();
+	if (result != GLEW_OK) {
+		throw std::runtime_error("GLEW couldn't initialize.");
+	}
+
+	gltInit();
+	GLTtext* text = gltCreateText();
+	GLTtext* profilerText = gltCreateText();
+	glEnable(GL_MULTISAMPLE);
+
+	{
+		glhelper::ShaderProgram heightfieldShader({
+			"../shaders/VirtualHeightfield.vert", "../shaders/VirtualHeightfield.tesc",
+			"../shaders/VirtualHeightfield.tese", "../shaders/VirtualHeightfield.frag" });
+		glhelper::ShaderProgram feedbackShader({
+			"../shaders/VirtualHeightfield.vert", "../shaders/VirtualHeightfield.tesc",
+			"../shaders/VirtualHeightfield.tese", "../shaders/VirtualHeightfieldFeedback.frag" });
+		glhelper::FlyViewer viewer(winWidth, winHeight);
+		viewer.position(Eigen::Vector3f(0.f, 0.5f, terrainSize));
+
+		glhelper::VirtualTexture virtualTexture({
+			{ tileFiles[0], "heightCache" },
+			{ tileFiles[1], "albedoCache" },
+			{ tileFiles[2], "normalCache" } });
+		std::cout << "Virtual texture: " << virtualTexture.levels() << " levels, "
+			<< virtualTexture.cacheBytes() / (1024 * 1024) << "MB resident on the GPU." << std::endl;
+
+		glPatchParameteri(GL_PATCH_VERTICES, 4);
+
+		glhelper::Mesh heightfieldControlMesh;
+		{
+			std::vector<Eigen::Vector3f> controlVertices;
+			std::vector<Eigen::Vector2f> controlTexCoords;
+			auto corner = [&](int x, int y) {
+				float u = (float)x / (float)(meshWidth - 1), v = (float)y / (float)(meshWidth - 1);
+				controlVertices.push_back(Eigen::Vector3f(terrainSize * (2.f * u - 1.f), 0.f, terrainSize * (2.f * v - 1.f)));
+				controlTexCoords.push_back(Eigen::Vector2f(u, v));
+			};
+			for (int y = 0; y < meshWidth - 1; ++y) {
+				for (int x = 0; x < meshWidth - 1; ++x) {
+					corner(x, y);
+					corner(x + 1, y);
+					corner(x + 1, y + 1);
+					corner(x, y + 1);
+				}
+			}
+			heightfieldControlMesh.vert(controlVertices);
+			heightfieldControlMesh.tex(controlTexCoords);
+		}
+		heightfieldControlMesh.drawMode(GL_PATCHES);
+
+		for (glhelper::ShaderProgram *program : { &heightfieldShader, &feedbackShader }) {
+			glProgramUniform1f(program->get(), program->uniformLoc("depthScaling"), depthScaling);
+			glProgramUniform1f(program->get(), program->uniformLoc("tessLevel"), tessLevel);
+		}
+
+		bool shouldQuit = false;
+		SDL_Event event;
+
+		glEnable(GL_DEPTH_TEST);
+		glDisable(GL_BLEND);
+		glEnable(GL_CULL_FACE);
+
+		glhelper::FramePacer framePacer(static_cast<double>(desiredFrametime));
+
+		glhelper::GpuProfiler profiler;
+		profiler.onResult(glhelper::Trace::gpuEvent);
+
+		while (!shouldQuit && !benchmark.finished()) {
+			framePacer.beginFrame();
+			profiler.beginFrame();
+			benchmark.beginFrame(viewer);
+
+			if (!benchmark.active()) {
+				viewer.update();
+			}
+
+			while (SDL_PollEvent(&event)) {
+				// Check for X of window being clicked, or ALT+F4
+				if (event.type == SDL_QUIT) {
+					shouldQuit = true;
+				}
+				else if (!benchmark.active()) {
+					viewer.processEvent(event);
+				}
+
+				if (event.type == SDL_KEYDOWN) {
+					if (event.key.keysym.sym == SDLK_DOWN || event.key.keysym.sym == SDLK_UP) {
+						float step = event.key.keysym.sym == SDLK_UP ? 1.f : -1.f;
+						if (event.key.keysym.mod & KMOD_LSHIFT) {
+							depthScaling = std::max(depthScaling + 0.01f * step, 0.f);
+						}
+						else {
+							tessLevel = std::clamp(tessLevel + 4.f * step, 1.f, 64.f);
+						}
+						for (glhelper::ShaderProgram *program : { &heightfieldShader, &feedbackShader }) {
+							glProgramUniform1f(program->get(), program->uniformLoc("depthScaling"), depthScaling);
+							glProgramUniform1f(program->get(), program->uniformLoc("tessLevel"), tessLevel);
+						}
+					}
+				}
+			}
+
+			// Streams in tiles requested by earlier frames' feedback.
+			virtualTexture.update();
+
+			virtualTexture.beginFeedback(feedbackShader, 0, winWidth);
+			heightfieldControlMesh.render(feedbackShader);
+			virtualTexture.endFeedback();
+
+			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler.begin("scene");
+
+			virtualTexture.bind(heightfieldShader, 0);
+			heightfieldControlMesh.render(heightfieldShader);
+
+			gltSetText(text, ("Tess level " + std::to_string(int(tessLevel))
+				+ "  Resident tiles " + std::to_string(virtualTexture.residentTiles())
+				+ "  Pending " + std::to_string(virtualTexture.pendingTiles())
+				+ "  Uploaded " + std::to_string(virtualTexture.uploadsLastUpdate())).c_str());
+			profiler.end("scene");
+			if (profiler.reportUpdated()) {
+				gltSetText(profilerText, profiler.report().c_str());
+			}
+
+			gltBeginDraw();
+			gltColor(1.f, 1.f, 1.f, 1.f);
+			gltDrawText2D(text, 10.f, 10.f, 1.f);
+			gltDrawText2DAligned(profilerText, 10.f, float(winHeight) - 10.f, 1.f, GLT_LEFT, GLT_BOTTOM);
+			gltEndDraw();
+
+			benchmark.endFrame();
+			SDL_GL_SwapWindow(window);
+
+			framePacer.endFrame();
+		}
+		benchmark.finish();
+	}
+
+	gltDeleteText(text);
+	gltDeleteText(profilerText);
+	glhelper::GpuMemory::reportLeaks(std::cerr);
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+
+	return benchmark.exitCode();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "CameraPath.hpp"
+#include "Viewer.hpp"
+
+namespace glhelper {
+
+//!\brief Command line options for Benchmark.
+struct BenchmarkSettings {
+	//!\brief Camera path to follow. If empty, the program runs interactively.
+	std::string cameraPath;
+	//!\brief If set, the live camera is recorded to this file as a camera path.
+	std::string recordPath;
+	std::string csvPath = "benchmark.csv";
+	//!\brief CSV from an earlier run to compare this one against.
+	std::string baselinePath;
+	//!\brief If set, csvPath is compared with baselinePath and nothing is rendered.
+	bool compareOnly = false;
+	//!\brief Simulated seconds per frame.
+	double timestep = 1.0 / 30.0;
+	//!\brief Frames to render, or 0 to cover the whole camera path.
+	size_t frames = 0;
+	//!\brief Frames rendered at the start of the path before any are recorded.
+	size_t warmupFrames = 30;
+	//!\brief Fractional slowdown allowed before a run counts as a regression.
+	double tolerance = 0.1;
+	//!\brief If set, a Trace of the run is written to this file, with each frame as an event.
+	std::string tracePath;
+};
+
+//!\brief Runs a lab as a repeatable benchmark.
+//!
+//!       Given --camera-path, the viewer follows the path for a fixed number of
+//!       frames, and time advances by a fixed step each frame, so every run renders
+//!       exactly the same images. For each frame the CPU time (beginFrame to
+//!       endFrame), GPU time, draw calls and primitives generated are written to a
+//!       CSV file. With --baseline, the run is then compared against an earlier
+//!       CSV, and slowdowns beyond the tolerance are reported and give a non-zero
+//!       exit code.
+//!
+//!       Options:
+//!           --camera-path FILE   follow this CameraPath
+//!           --record-path FILE   record the interactive camera to FILE
+//!           --frames N           frames to render (default: the whole path)
+//!           --timestep MS        simulated milliseconds per frame (default 33.3)
+//!           --warmup N           unrecorded frames at the start (default 30)
+//!           --csv FILE           per-frame results (default benchmark.csv)
+//!           --baseline FILE      compare the results against this CSV
+//!           --tolerance PERCENT  allowed slowdown (default 10)
+//!           --compare BASELINE CURRENT   only compare two existing CSVs
+//!           --trace FILE         record a Trace of the whole run to FILE
+//!
+//!       Usage:
+//!           Benchmark benchmark(argc, argv);
+//!           if (benchmark.compareOnly()) return benchmark.exitCode();
+//!           ...
+//!           while (!shouldQuit && !benchmark.finished()) {
+//!               benchmark.beginFrame(viewer);
+//!               if (!benchmark.active()) {
+//!                   viewer.update(); // and viewer.processEvent for each event
+//!               }
+//!               float t = float(benchmark.seconds());
+//!               ...
+//!               benchmark.endFrame();
+//!               SDL_GL_SwapWindow(window);
+//!           }
+//!           benchmark.finish();
+//!           ...
+//!           return benchmark.exitCode();
+//!\note Apart from the constructor, compareOnly and exitCode, must be used on the
+//!      thread owning the GL context, and finish must be called before the
+//!      context is destroyed.
+class Benchmark final
+{
+public:
+	//!\brief Parses the command line, throwing std::runtime_error on bad options.
+	Benchmark(int argc, char *argv[]);
+	explicit Benchmark(const BenchmarkSettings &settings);
+	~Benchmark() throw();
+
+	//!\brief True if following a camera path rather than running interactively.
+	bool active() const;
+	bool finished() const;
+	bool compareOnly() const;
+
+	//!\brief Seconds since the first frame: fixed steps when benchmarking, wall-clock otherwise.
+	double seconds() const;
+
+	//!\brief Moves the viewer along the camera path (or records it) and starts timing the frame.
+	//!       While active, don't also update the viewer from input, or it drifts off the path.
+	void beginFrame(Viewer &viewer);
+	//!\brief Stops timing the frame and ends the RenderStats frame. Call before swapping buffers.
+	void endFrame();
+	//!\brief Collects the GPU results, writes the CSV and compares it with the baseline.
+	//!       Also releases the RenderStats queries and stops the trace.
+	void finish();
+
+	//!\brief 1 if the comparison found a regression, otherwise 0.
+	int exitCode() const;
+
+	//!\brief Compares per-frame results, printing a summary to out.
+	//!\return false if current is slower than baseline by more than tolerance.
+	static bool compare(const std::string &baselineCsv, const std::string &currentCsv,
+		double tolerance, std::ostream &out);
+
+private:
+	Benchmark(const Benchmark&);
+	Benchmark &operator=(const Benchmark&);
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct FrameRecord {
+		double cpuMs;
+		size_t drawCalls;
+		GLuint startQuery, endQuery, primitivesQuery;
+	};
+
+	void start();
+
+	BenchmarkSettings settings_;
+	CameraPath path_, recorded_;
+	size_t frame_, totalFrames_;
+	bool started_, finished_, failed_;
+	Clock::time_point startTime_, frameStart_;
+	std::vector<FrameRecord> records_;
+	bool recordingFrame_;
+	bool tracing_;
+	uint64_t traceFrameStart_;
+	Clock::time_point traceCalibrated_;
+};
+
+}
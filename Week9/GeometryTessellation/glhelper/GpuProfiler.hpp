@@ -0,0 +1,117 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace glhelper {
+
+//!\brief Rolling GPU timing statistics for one named scope, in milliseconds.
+struct GpuScopeStats {
+	std::string name;
+	double minMs, avgMs, maxMs, p99Ms;
+	//!\brief Most recent measurement.
+	double lastMs;
+	size_t samples;
+};
+
+//!\brief Times GPU work with GL_TIMESTAMP queries without ever waiting for results.
+//!
+//!       Queries are kept in a ring of latencyFrames frames. Each frame's results
+//!       are only read once the GPU reports them available, usually a couple of
+//!       frames later, so the CPU never stalls on the GPU (unlike waiting for
+//!       GL_QUERY_RESULT straight after a draw). If the GPU falls so far behind
+//!       that the whole ring is still pending, that frame simply isn't timed.
+//!
+//!       Usage:
+//!           profiler.beginFrame();
+//!           { GpuScope scope(profiler, "shadow"); ...draw calls... }
+//!           { GpuScope scope(profiler, "main"); ...draw calls... }
+//!       Scopes may nest.
+//!\note Must be created, used and destroyed on the thread owning the GL context.
+class GpuProfiler final
+{
+public:
+	//!\brief Receives each measurement as raw GL_TIMESTAMP values (nanoseconds).
+	typedef std::function<void(const std::string &scope, GLuint64 startNs, GLuint64 endNs)> ResultCallback;
+
+	explicit GpuProfiler(size_t latencyFrames = 4, size_t historySize = 240);
+	~GpuProfiler() throw();
+
+	//!\brief Collects any results that are ready and starts a new frame. Never blocks.
+	void beginFrame();
+
+	void begin(const std::string &scope);
+	void end(const std::string &scope);
+
+	//!\brief Stats for every scope seen so far, in the order they were first used.
+	std::vector<GpuScopeStats> stats() const;
+	//!\brief One line per scope, ready for gltSetText.
+	std::string report() const;
+	//!\brief True from the beginFrame that collected new results, at most about twice a
+	//!       second, until the next beginFrame. Lets a HUD call gltSetText only then:
+	//!           if (profiler.reportUpdated()) gltSetText(text, profiler.report().c_str());
+	bool reportUpdated() const;
+
+	//!\brief Called for every measurement as it's collected, e.g. with Trace::gpuEvent.
+	void onResult(ResultCallback callback);
+
+	//!\brief Frames that couldn't be timed because the query ring was full.
+	size_t skippedFrames() const;
+
+private:
+	GpuProfiler(const GpuProfiler&);
+	GpuProfiler &operator=(const GpuProfiler&);
+
+	struct Interval {
+		size_t scope;
+		GLuint startQuery, endQuery;
+	};
+	struct Frame {
+		std::vector<GLuint> queries; //!< Pool, reused each time the frame comes round.
+		size_t queriesUsed;
+		std::vector<Interval> intervals;
+		bool pending;
+	};
+	struct Scope {
+		std::string name;
+		std::deque<double> history;
+		std::vector<size_t> openIntervals;
+	};
+
+	GLuint nextQuery(Frame &frame);
+	bool collect(Frame &frame);
+	size_t scopeIndex(const std::string &name);
+
+	std::vector<Frame> frames_;
+	size_t current_;
+	bool recording_;
+	size_t historySize_;
+	size_t skippedFrames_;
+	std::chrono::steady_clock::time_point reportTime_;
+	bool reportUpdated_;
+	std::vector<Scope> scopes_;
+	std::map<std::string, size_t> scopeIndices_;
+	ResultCallback onResult_;
+};
+
+//!\brief Times the GPU work issued during its lifetime as the named scope.
+class GpuScope final
+{
+public:
+	GpuScope(GpuProfiler &profiler, const std::string &name);
+	~GpuScope() throw();
+
+private:
+	GpuScope(const GpuScope&);
+	GpuScope &operator=(const GpuScope&);
+
+	GpuProfiler &profiler_;
+	std::string name_;
+};
+
+}
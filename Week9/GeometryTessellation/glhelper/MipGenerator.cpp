@@ -0,0 +1,419 @@
+#include "MipGenerator.hpp"
+#include "Constants.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MIP_USE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_USE_SSE2
+#endif
+
+namespace glhelper {
+
+namespace {
+
+//!\brief Interleaved floating point image used as the working format while filtering.
+struct FloatImage {
+	int width = 0, height = 0, channels = 0;
+	std::vector<float> data;
+
+	FloatImage() = default;
+	FloatImage(int w, int h, int c) :width(w), height(h), channels(c), data(size_t(w) * h * c) {}
+
+	float *row(int y) { return data.data() + size_t(y) * width * channels; }
+	const float *row(int y) const { return data.data() + size_t(y) * width * channels; }
+};
+
+size_t threadCount(const MipSettings &settings)
+{
+	if (settings.nThreads != 0) {
+		return settings.nThreads;
+	}
+	return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+//!\brief Runs fn(begin, end) over [0, nRows) split into contiguous blocks, one
+//!       per thread. Small jobs run on the calling thread.
+template<typename Fn>
+void parallelRows(int nRows, size_t nThreads, Fn fn)
+{
+	const int minRowsPerThread = 16;
+	size_t n = std::min<size_t>(nThreads, std::max(1, nRows / minRowsPerThread));
+	if (n <= 1) {
+		fn(0, nRows);
+		return;
+	}
+	std::vector<std::thread> threads;
+	threads.reserve(n - 1);
+	int rowsPerThread = (nRows + int(n) - 1) / int(n);
+	for (size_t t = 1; t < n; ++t) {
+		int begin = int(t) * rowsPerThread;
+		int end = std::min(nRows, begin + rowsPerThread);
+		if (begin < end) {
+			threads.emplace_back(fn, begin, end);
+		}
+	}
+	fn(0, std::min(nRows, rowsPerThread));
+	for (std::thread &t : threads) {
+		t.join();
+	}
+}
+
+// dst[i] = (a[i] + b[i]) * 0.5
+void averageRows(const float *a, const float *b, float *dst, size_t n)
+{
+	size_t i = 0;
+#if defined(MIP_USE_AVX2)
+	const __m256 half = _mm256_set1_ps(0.5f);
+	for (; i + 8 <= n; i += 8) {
+		__m256 s = _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(s, half));
+	}
+#elif defined(MIP_USE_SSE2)
+	const __m128 half = _mm_set1_ps(0.5f);
+	for (; i + 4 <= n; i += 4) {
+		__m128 s = _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+		_mm_storeu_ps(dst + i, _mm_mul_ps(s, half));
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] = (a[i] + b[i]) * 0.5f;
+	}
+}
+
+// dst[i] += w * src[i]
+void accumulateRow(float *dst, const float *src, float w, size_t n)
+{
+	size_t i = 0;
+#if defined(MIP_USE_AVX2)
+	const __m256 wv = _mm256_set1_ps(w);
+	for (; i + 8 <= n; i += 8) {
+		__m256 d = _mm256_loadu_ps(dst + i);
+		__m256 s = _mm256_loadu_ps(src + i);
+#if defined(__FMA__)
+		d = _mm256_fmadd_ps(s, wv, d);
+#else
+		d = _mm256_add_ps(d, _mm256_mul_ps(s, wv));
+#endif
+		_mm256_storeu_ps(dst + i, d);
+	}
+#elif defined(MIP_USE_SSE2)
+	const __m128 wv = _mm_set1_ps(w);
+	for (; i + 4 <= n; i += 4) {
+		__m128 d = _mm_loadu_ps(dst + i);
+		_mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(src + i), wv)));
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] += w * src[i];
+	}
+}
+
+// Averages horizontally adjacent pixels of an interleaved row into dst (outWidth pixels).
+void halveRow(const float *src, float *dst, int srcWidth, int outWidth, int channels)
+{
+	int x = 0;
+#if defined(MIP_USE_AVX2) || defined(MIP_USE_SSE2)
+	if (channels == 4) {
+		const __m128 half = _mm_set1_ps(0.5f);
+		for (; x < outWidth && 2 * x + 1 < srcWidth; ++x) {
+			__m128 p0 = _mm_loadu_ps(src + 8 * x);
+			__m128 p1 = _mm_loadu_ps(src + 8 * x + 4);
+			_mm_storeu_ps(dst + 4 * x, _mm_mul_ps(_mm_add_ps(p0, p1), half));
+		}
+	}
+#endif
+	for (; x < outWidth; ++x) {
+		int x0 = std::min(2 * x, srcWidth - 1);
+		int x1 = std::min(2 * x + 1, srcWidth - 1);
+		for (int c = 0; c < channels; ++c) {
+			dst[x * channels + c] = 0.5f * (src[x0 * channels + c] + src[x1 * channels + c]);
+		}
+	}
+}
+
+FloatImage downsampleBox(const FloatImage &src, size_t nThreads)
+{
+	FloatImage dst(std::max(1, src.width / 2), std::max(1, src.height / 2), src.channels);
+	parallelRows(dst.height, nThreads, [&](int begin, int end) {
+		std::vector<float> tmp(size_t(src.width) * src.channels);
+		for (int y = begin; y < end; ++y) {
+			int y0 = std::min(2 * y, src.height - 1);
+			int y1 = std::min(2 * y + 1, src.height - 1);
+			averageRows(src.row(y0), src.row(y1), tmp.data(), tmp.size());
+			halveRow(tmp.data(), dst.row(y), src.width, dst.width, src.channels);
+		}
+	});
+	return dst;
+}
+
+double besselI0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; ++k) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < 1e-12 * sum) break;
+	}
+	return sum;
+}
+
+struct FilterTaps {
+	std::vector<int> count;      //!< Number of taps per output sample.
+	std::vector<int> index;      //!< Clamped source indices, flattened.
+	std::vector<float> weight;   //!< Normalised weights, flattened.
+	std::vector<size_t> offset;  //!< Offset into index/weight per output sample.
+};
+
+//!\brief Precomputes Kaiser-windowed sinc weights for resampling srcSize texels to dstSize.
+FilterTaps kaiserTaps(int srcSize, int dstSize, float alpha, int radius)
+{
+	FilterTaps taps;
+	double ratio = double(srcSize) / double(dstSize);
+	double support = radius * std::max(1.0, ratio) * 0.5;
+	double i0Alpha = besselI0(alpha);
+	for (int o = 0; o < dstSize; ++o) {
+		double centre = (o + 0.5) * ratio - 0.5;
+		int lo = int(std::ceil(centre - support));
+		int hi = int(std::floor(centre + support));
+		taps.offset.push_back(taps.index.size());
+		double sum = 0.0;
+		std::vector<double> w;
+		for (int i = lo; i <= hi; ++i) {
+			double d = (i - centre) / std::max(1.0, ratio);
+			double t = (i - centre) / support;
+			double window = besselI0(alpha * std::sqrt(std::max(0.0, 1.0 - t * t))) / i0Alpha;
+			double sinc = (d == 0.0) ? 1.0 : std::sin(M_PI * d) / (M_PI * d);
+			w.push_back(sinc * window);
+			taps.index.push_back(std::clamp(i, 0, srcSize - 1));
+			sum += w.back();
+		}
+		for (double v : w) {
+			taps.weight.push_back(float(v / sum));
+		}
+		taps.count.push_back(hi - lo + 1);
+	}
+	return taps;
+}
+
+FloatImage downsampleKaiser(const FloatImage &src, const MipSettings &settings, size_t nThreads)
+{
+	int outW = std::max(1, src.width / 2), outH = std::max(1, src.height / 2);
+	int c = src.channels;
+	FilterTaps xTaps = kaiserTaps(src.width, outW, settings.kaiserAlpha, settings.kaiserRadius);
+	FilterTaps yTaps = kaiserTaps(src.height, outH, settings.kaiserAlpha, settings.kaiserRadius);
+
+	// Horizontal pass on every source row.
+	FloatImage horiz(outW, src.height, c);
+	parallelRows(src.height, nThreads, [&](int begin, int end) {
+		for (int y = begin; y < end; ++y) {
+			const float *in = src.row(y);
+			float *out = horiz.row(y);
+			for (int x = 0; x < outW; ++x) {
+				size_t off = xTaps.offset[x];
+				for (int ch = 0; ch < c; ++ch) {
+					float acc = 0.f;
+					for (int k = 0; k < xTaps.count[x]; ++k) {
+						acc += xTaps.weight[off + k] * in[xTaps.index[off + k] * c + ch];
+					}
+					out[x * c + ch] = acc;
+				}
+			}
+		}
+	});
+
+	// Vertical pass, a weighted sum of whole rows.
+	FloatImage dst(outW, outH, c);
+	parallelRows(outH, nThreads, [&](int begin, int end) {
+		for (int y = begin; y < end; ++y) {
+			float *out = dst.row(y);
+			std::fill(out, out + size_t(outW) * c, 0.f);
+			size_t off = yTaps.offset[y];
+			for (int k = 0; k < yTaps.count[y]; ++k) {
+				accumulateRow(out, horiz.row(yTaps.index[off + k]), yTaps.weight[off + k], size_t(outW) * c);
+			}
+		}
+	});
+	return dst;
+}
+
+bool isColourChannel(int channel, int channels)
+{
+	if (channels == 4) return channel < 3;
+	if (channels == 2) return channel == 0;
+	return true;
+}
+
+float srgbToLinear(float v)
+{
+	return (v <= 0.04045f) ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(float v)
+{
+	return (v <= 0.0031308f) ? v * 12.92f : 1.055f * std::pow(v, 1.f / 2.4f) - 0.055f;
+}
+
+const std::array<float, 256> &srgbDecodeTable()
+{
+	static const std::array<float, 256> table = [] {
+		std::array<float, 256> t;
+		for (int i = 0; i < 256; ++i) t[i] = srgbToLinear(i / 255.f);
+		return t;
+	}();
+	return table;
+}
+
+//!\brief Quantised linear->sRGB lookup, fine enough to round-trip all 8-bit values.
+const std::array<unsigned char, 4096> &srgbEncodeTable()
+{
+	static const std::array<unsigned char, 4096> table = [] {
+		std::array<unsigned char, 4096> t;
+		for (int i = 0; i < 4096; ++i) {
+			t[i] = (unsigned char)std::lround(255.f * linearToSrgb(i / 4095.f));
+		}
+		return t;
+	}();
+	return table;
+}
+
+void renormalise(FloatImage &image, size_t nThreads)
+{
+	int c = image.channels;
+	parallelRows(image.height, nThreads, [&](int begin, int end) {
+		for (int y = begin; y < end; ++y) {
+			float *p = image.row(y);
+			for (int x = 0; x < image.width; ++x, p += c) {
+				float len = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+				if (len > 1e-6f) {
+					p[0] /= len; p[1] /= len; p[2] /= len;
+				} else {
+					// Degenerate average (opposing normals), fall back to the unperturbed normal.
+					p[0] = 0.f; p[1] = 0.f; p[2] = 1.f;
+				}
+			}
+		}
+	});
+}
+
+FloatImage decode(const cv::Mat &image, MipMode mode, size_t nThreads)
+{
+	FloatImage out(image.cols, image.rows, image.channels());
+	const std::array<float, 256> &srgb = srgbDecodeTable();
+	int c = out.channels;
+	parallelRows(out.height, nThreads, [&](int begin, int end) {
+		for (int y = begin; y < end; ++y) {
+			const unsigned char *in = image.ptr<unsigned char>(y);
+			float *o = out.row(y);
+			for (int i = 0; i < out.width * c; ++i) {
+				int ch = i % c;
+				float v = in[i] / 255.f;
+				if (mode == MipMode::SRGB && isColourChannel(ch, c)) {
+					v = srgb[in[i]];
+				} else if (mode == MipMode::NORMAL_MAP && ch < 3) {
+					v = v * 2.f - 1.f;
+				}
+				o[i] = v;
+			}
+		}
+	});
+	return out;
+}
+
+cv::Mat encode(const FloatImage &image, MipMode mode, size_t nThreads)
+{
+	cv::Mat out(image.height, image.width, CV_8UC(image.channels));
+	const std::array<unsigned char, 4096> &srgb = srgbEncodeTable();
+	int c = image.channels;
+	parallelRows(image.height, nThreads, [&](int begin, int end) {
+		for (int y = begin; y < end; ++y) {
+			const float *in = image.row(y);
+			unsigned char *o = out.ptr<unsigned char>(y);
+			for (int i = 0; i < image.width * c; ++i) {
+				int ch = i % c;
+				float v = in[i];
+				if (mode == MipMode::SRGB && isColourChannel(ch, c)) {
+					o[i] = srgb[std::clamp(int(v * 4095.f + 0.5f), 0, 4095)];
+					continue;
+				}
+				if (mode == MipMode::NORMAL_MAP && ch < 3) {
+					v = v * 0.5f + 0.5f;
+				}
+				o[i] = (unsigned char)std::clamp(int(v * 255.f + 0.5f), 0, 255);
+			}
+		}
+	});
+	return out;
+}
+
+}
+
+std::vector<cv::Mat> generateMipChain(const cv::Mat &image, const MipSettings &settings)
+{
+	if (image.empty() || image.depth() != CV_8U || image.channels() > 4) {
+		throw std::runtime_error("generateMipChain expects a non-empty 8-bit image with 1-4 channels.");
+	}
+	if (settings.mode == MipMode::NORMAL_MAP && image.channels() < 3) {
+		throw std::runtime_error("generateMipChain normal map mode needs at least 3 channels.");
+	}
+	size_t nThreads = threadCount(settings);
+
+	std::vector<cv::Mat> chain;
+	chain.push_back(image.clone());
+
+	FloatImage level = decode(image, settings.mode, nThreads);
+	while (level.width > 1 || level.height > 1) {
+		if (settings.filter == MipFilter::KAISER) {
+			level = downsampleKaiser(level, settings, nThreads);
+		} else {
+			level = downsampleBox(level, nThreads);
+		}
+		if (settings.mode == MipMode::NORMAL_MAP) {
+			renormalise(level, nThreads);
+		}
+		chain.push_back(encode(level, settings.mode, nThreads));
+	}
+	return chain;
+}
+
+double mipPsnr(const cv::Mat &a, const cv::Mat &b)
+{
+	if (a.rows != b.rows || a.cols != b.cols || a.type() != b.type() || a.depth() != CV_8U) {
+		throw std::runtime_error("mipPsnr needs two 8-bit images of matching size and type.");
+	}
+	double sumSq = 0.0;
+	size_t rowLen = size_t(a.cols) * a.channels();
+	for (int y = 0; y < a.rows; ++y) {
+		const unsigned char *pa = a.ptr<unsigned char>(y);
+		const unsigned char *pb = b.ptr<unsigned char>(y);
+		for (size_t i = 0; i < rowLen; ++i) {
+			double d = double(pa[i]) - double(pb[i]);
+			sumSq += d * d;
+		}
+	}
+	double mse = sumSq / double(rowLen * a.rows);
+	if (mse == 0.0) {
+		return std::numeric_limits<double>::infinity();
+	}
+	return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+const char *mipSimdPath()
+{
+#if defined(MIP_USE_AVX2)
+	return "AVX2";
+#elif defined(MIP_USE_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace glhelper {
+
+//!\brief Reconstruction filter used when halving each mip level.
+enum class MipFilter {
+	BOX,   //!< 2x2 average, identical in footprint to most glGenerateMipmap implementations.
+	KAISER //!< Separable windowed sinc, sharper with less aliasing than BOX.
+};
+
+//!\brief How texel values should be interpreted while filtering.
+enum class MipMode {
+	LINEAR,    //!< Filter the stored values directly (depth, height, masks...).
+	SRGB,      //!< Decode sRGB to linear before filtering and re-encode afterwards.
+	NORMAL_MAP //!< Decode to [-1,1], filter, then renormalise each normal to unit length.
+};
+
+struct MipSettings {
+	MipFilter filter = MipFilter::BOX;
+	MipMode mode = MipMode::LINEAR;
+	//!\brief Number of worker threads, 0 to use std::thread::hardware_concurrency().
+	size_t nThreads = 0;
+	//!\brief Kaiser window shape parameter (larger is smoother, less ringing).
+	float kaiserAlpha = 4.f;
+	//!\brief Half-width of the Kaiser kernel in source texels.
+	int kaiserRadius = 3;
+};
+
+//!\brief Generates a full mip chain on the CPU from an 8-bit image (1-4 channels).
+//!       Element 0 is a copy of the input, and the chain ends at 1x1. Each
+//!       returned cv::Mat has the same type as the input, and can be uploaded
+//!       with Texture::setMipChain.
+//!\note Uses AVX2 or SSE2 for the inner loops when the compiler targets them.
+std::vector<cv::Mat> generateMipChain(const cv::Mat &image, const MipSettings &settings = MipSettings());
+
+//!\brief Peak signal-to-noise ratio in dB between two 8-bit images of the same
+//!       size and type. Returns infinity if they are identical.
+double mipPsnr(const cv::Mat &a, const cv::Mat &b);
+
+//!\brief Name of the instruction set generateMipChain was compiled to use.
+const char *mipSimdPath();
+
+}
@@ -1,5 +1,7 @@
 #include "Texture.hpp"
 #include "Exception.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
 #include <GL/glew.h>
 #include <string>
 #include <opencv2/opencv.hpp>
@@ -184,6 +186,11 @@ void Texture::init(const void *data, GLenum minFilter, GLenum magFilter)
 	glBindTexture(target_, tex_);
 	glTexImage2D(target_, 0, internalFormat_, GLsizei(width_), GLsizei(height_),
 		border_, format_, type_, data);
+	GpuMemory::track(GpuResourceType::TEXTURE, tex_, width_ * height_ * GpuMemory::texelBytes(internalFormat_),
+		"texture " + std::to_string(width_) + "x" + std::to_string(height_));
+	if (data != nullptr) {
+		RenderStats::recordUpload(RenderStats::imageBytes(format_, type_, width_, height_));
+	}
 	throwOnGlError();
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
@@ -200,6 +207,7 @@ void Texture::init(const void *data, GLenum minFilter, GLenum magFilter)
 Texture::~Texture() throw()
 {
 	if (tex_ != 0) {
+		GpuMemory::untrack(GpuResourceType::TEXTURE, tex_);
 		glDeleteTextures(1, &tex_);
 	}
 }
@@ -220,6 +228,13 @@ tex_(other.tex_)
 
 Texture &Texture::operator=(Texture && other)
 {
+	if (this == &other) {
+		return *this;
+	}
+	if (tex_ != 0) {
+		GpuMemory::untrack(GpuResourceType::TEXTURE, tex_);
+		glDeleteTextures(1, &tex_);
+	}
 	width_ = other.width_;
 	height_ = other.height_;
 	target_ = other.target_;
@@ -238,6 +253,7 @@ void Texture::update(const void *data)
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(target_, tex_);
 	glTexSubImage2D(target_, 0, 0, 0, width_, height_, format_, type_, data);
+	RenderStats::recordUpload(RenderStats::imageBytes(format_, type_, width_, height_));
 	glBindTexture(target_, 0);
 }
 
@@ -245,6 +261,7 @@ void Texture::update(const void *data, size_t mipmapLevel) {
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(target_, tex_);
 	glTexSubImage2D(target_, mipmapLevel, 0, 0, width_ >> mipmapLevel, height_ >> mipmapLevel, format_, type_, data);
+	RenderStats::recordUpload(RenderStats::imageBytes(format_, type_, width_ >> mipmapLevel, height_ >> mipmapLevel));
 	glBindTexture(target_, 0);
 }
 
@@ -252,6 +269,7 @@ void Texture::bindToImageUnit(GLuint unit)
 {
 	glActiveTexture(GL_TEXTURE0 + unit);
 	glBindTexture(target_, tex_);
+	RenderStats::recordStateChange();
 }
 
 void Texture::unbind()
@@ -369,6 +387,39 @@ void Texture::genMipmap()
 	glBindTexture(target_, tex_);
 	glGenerateMipmap(target_);
 	glBindTexture(target_, 0);
+	// A full mip chain adds a third to the size of the base level.
+	GpuMemory::resize(GpuResourceType::TEXTURE, tex_, width_ * height_ * GpuMemory::texelBytes(internalFormat_) * 4 / 3);
+}
+
+void Texture::setMipChain(const std::vector<cv::Mat> &levels)
+{
+	if (levels.empty()) {
+		throw std::runtime_error("setMipChain needs at least one level.");
+	}
+	GLint prevAlignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &prevAlignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glBindTexture(target_, tex_);
+	for (size_t level = 0; level < levels.size(); ++level) {
+		const cv::Mat &image = levels[level];
+		if (!image.isContinuous()) {
+			throw std::runtime_error("setMipChain needs continuous images.");
+		}
+		glTexImage2D(target_, GLint(level), internalFormat_, image.cols, image.rows,
+			border_, format_, type_, image.data);
+		RenderStats::recordUpload(image.total() * image.elemSize());
+	}
+	glTexParameteri(target_, GL_TEXTURE_MAX_LEVEL, GLint(levels.size() - 1));
+	glBindTexture(target_, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, prevAlignment);
+	width_ = levels[0].cols;
+	height_ = levels[0].rows;
+	size_t bytes = 0;
+	for (const cv::Mat &image : levels) {
+		bytes += image.total() * GpuMemory::texelBytes(internalFormat_);
+	}
+	GpuMemory::resize(GpuResourceType::TEXTURE, tex_, bytes);
+	throwOnGlError();
 }
 
 size_t Texture::numChannels() const
@@ -2,6 +2,11 @@
 
 #include <GL/glew.h>
 #include <string>
+#include <vector>
+
+namespace cv {
+class Mat;
+}
 
 namespace glhelper {
 
@@ -41,6 +46,9 @@ public:
 	size_t bytesPerChannel() const;
 
 	void genMipmap();
+	//!\brief Upload a precomputed mip chain (e.g. from generateMipChain), replacing
+	//!       all levels. Each image must match this texture's format and type.
+	void setMipChain(const std::vector<cv::Mat> &levels);
 
 private:
 	Texture(const Texture&);
@@ -0,0 +1,181 @@
+#include "TileFile.hpp"
+#include "MipGenerator.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+const char tileFileMagic[4] = { 'V', 'T', 'X', '1' };
+
+struct TileFileHeader {
+	char magic[4];
+	uint32_t width, height, channels, tileSize, border, levels;
+};
+
+bool isPowerOfTwo(size_t x)
+{
+	return x != 0 && (x & (x - 1)) == 0;
+}
+
+size_t levelsFor(size_t width, size_t height, size_t tileSize)
+{
+	size_t levels = 1;
+	size_t size = std::max(width, height);
+	while (size > tileSize) {
+		size >>= 1;
+		++levels;
+	}
+	return levels;
+}
+
+size_t tilesAlong(size_t size, size_t level, size_t tileSize)
+{
+	size_t levelSize = std::max<size_t>(1, size >> level);
+	return (levelSize + tileSize - 1) / tileSize;
+}
+
+}
+
+void TileFile::write(const std::string &path, size_t width, size_t height, size_t channels,
+	size_t tileSize, size_t border, const TileSource &source)
+{
+	if (!isPowerOfTwo(width) || !isPowerOfTwo(height) || !isPowerOfTwo(tileSize)) {
+		throw std::runtime_error("TileFile::write: width, height and tile size must be powers of two.");
+	}
+	if (channels < 1 || channels > 4) {
+		throw std::runtime_error("TileFile::write: images must have 1-4 channels.");
+	}
+	std::ofstream out(path, std::ios::binary);
+	if (!out) {
+		throw std::runtime_error("TileFile::write: couldn't open " + path + " for writing.");
+	}
+
+	TileFileHeader header;
+	memcpy(header.magic, tileFileMagic, 4);
+	header.width = uint32_t(width);
+	header.height = uint32_t(height);
+	header.channels = uint32_t(channels);
+	header.tileSize = uint32_t(tileSize);
+	header.border = uint32_t(border);
+	header.levels = uint32_t(levelsFor(width, height, tileSize));
+
+	size_t nTiles = 0;
+	for (size_t l = 0; l < header.levels; ++l) {
+		nTiles += tilesAlong(width, l, tileSize) * tilesAlong(height, l, tileSize);
+	}
+	size_t padded = tileSize + 2 * border;
+	size_t tileBytes = padded * padded * channels;
+	std::vector<uint64_t> offsets(nTiles);
+	uint64_t dataStart = sizeof(header) + nTiles * sizeof(uint64_t);
+	for (size_t i = 0; i < nTiles; ++i) {
+		offsets[i] = dataStart + i * tileBytes;
+	}
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+	cv::Mat tile(static_cast<int>(padded), static_cast<int>(padded), CV_8UC(int(channels)));
+	for (size_t l = 0; l < header.levels; ++l) {
+		size_t tx = tilesAlong(width, l, tileSize), ty = tilesAlong(height, l, tileSize);
+		for (size_t y = 0; y < ty; ++y) {
+			for (size_t x = 0; x < tx; ++x) {
+				source(l, int(x * tileSize) - int(border), int(y * tileSize) - int(border), tile);
+				if (tile.rows != int(padded) || tile.cols != int(padded) || tile.channels() != int(channels)
+					|| tile.depth() != CV_8U) {
+					throw std::runtime_error("TileFile::write: tile source returned the wrong size or type.");
+				}
+				for (int row = 0; row < tile.rows; ++row) {
+					out.write(reinterpret_cast<const char*>(tile.ptr<unsigned char>(row)), padded * channels);
+				}
+			}
+		}
+	}
+	if (!out) {
+		throw std::runtime_error("TileFile::write: error writing " + path + ".");
+	}
+}
+
+void TileFile::write(const std::string &path, const cv::Mat &image,
+	size_t tileSize, size_t border, const MipSettings &mipSettings)
+{
+	std::vector<cv::Mat> chain = generateMipChain(image, mipSettings);
+	write(path, size_t(image.cols), size_t(image.rows), size_t(image.channels()), tileSize, border,
+		[&chain](size_t level, int x, int y, cv::Mat &out) {
+			// Clamp to the edge of the image, replicating the outermost texels into the border.
+			const cv::Mat &src = chain[std::min(level, chain.size() - 1)];
+			size_t c = size_t(src.channels());
+			for (int row = 0; row < out.rows; ++row) {
+				int sy = std::clamp(y + row, 0, src.rows - 1);
+				unsigned char *dst = out.ptr<unsigned char>(row);
+				for (int col = 0; col < out.cols; ++col) {
+					int sx = std::clamp(x + col, 0, src.cols - 1);
+					memcpy(dst + col * c, src.ptr<unsigned char>(sy) + sx * c, c);
+				}
+			}
+		});
+}
+
+TileFile::TileFile(const std::string &path)
+	:file_(path, std::ios::binary)
+{
+	if (!file_) {
+		throw std::runtime_error("TileFile: couldn't open " + path + ".");
+	}
+	TileFileHeader header;
+	file_.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file_ || memcmp(header.magic, tileFileMagic, 4) != 0) {
+		throw std::runtime_error("TileFile: " + path + " is not a tile file.");
+	}
+	width_ = header.width;
+	height_ = header.height;
+	channels_ = header.channels;
+	tileSize_ = header.tileSize;
+	border_ = header.border;
+	levels_ = header.levels;
+
+	size_t nTiles = 0;
+	for (size_t l = 0; l < levels_; ++l) {
+		levelStart_.push_back(nTiles);
+		nTiles += tilesX(l) * tilesY(l);
+	}
+	offsets_.resize(nTiles);
+	file_.read(reinterpret_cast<char*>(offsets_.data()), nTiles * sizeof(uint64_t));
+	if (!file_) {
+		throw std::runtime_error("TileFile: " + path + " is truncated.");
+	}
+}
+
+size_t TileFile::tilesX(size_t level) const
+{
+	return tilesAlong(width_, level, tileSize_);
+}
+
+size_t TileFile::tilesY(size_t level) const
+{
+	return tilesAlong(height_, level, tileSize_);
+}
+
+size_t TileFile::tileIndex(size_t level, size_t tileX, size_t tileY) const
+{
+	if (level >= levels_ || tileX >= tilesX(level) || tileY >= tilesY(level)) {
+		throw std::runtime_error("TileFile: tile index out of range.");
+	}
+	return levelStart_[level] + tileY * tilesX(level) + tileX;
+}
+
+void TileFile::readTile(size_t level, size_t tileX, size_t tileY, unsigned char *out)
+{
+	uint64_t offset = offsets_[tileIndex(level, tileX, tileY)];
+	std::lock_guard<std::mutex> lock(fileMutex_);
+	file_.seekg(std::streamoff(offset));
+	file_.read(reinterpret_cast<char*>(out), std::streamsize(tileBytes()));
+	if (!file_) {
+		file_.clear();
+		throw std::runtime_error("TileFile: couldn't read tile.");
+	}
+}
+
+}
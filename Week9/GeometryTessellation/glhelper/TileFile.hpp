@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cv {
+class Mat;
+}
+
+namespace glhelper {
+
+struct MipSettings;
+
+//!\brief A large mip-mapped 8-bit image stored on disk as fixed-size tiles,
+//!       for streaming with VirtualTexture.
+//!
+//!       Each tile is stored with a border of duplicated neighbouring texels, so
+//!       it can be bilinearly filtered on its own once it's in a texture cache.
+//!       Level L is the image downsampled by 2^L; the last level fits in one tile.
+//!
+//!       File layout: a header, a table of 64-bit file offsets (one per tile,
+//!       level by level, row by row), then the raw tile data.
+class TileFile final
+{
+public:
+	//!\brief Supplies tile contents while writing. Must fill out (already sized
+	//!       paddedTileSize() x paddedTileSize(), with the file's channel count)
+	//!       with level `level` of the image, starting at texel (x, y) - which may
+	//!       be negative or beyond the edge, so the source decides how to clamp or wrap.
+	typedef std::function<void(size_t level, int x, int y, cv::Mat &out)> TileSource;
+
+	//!\brief Write a tile file for a width x height image, pulling tiles from source.
+	//!\note width, height and tileSize must be powers of two.
+	static void write(const std::string &path, size_t width, size_t height, size_t channels,
+		size_t tileSize, size_t border, const TileSource &source);
+	//!\brief Convenience overload tiling an in-memory image, with mips from generateMipChain.
+	static void write(const std::string &path, const cv::Mat &image,
+		size_t tileSize, size_t border, const MipSettings &mipSettings);
+
+	explicit TileFile(const std::string &path);
+
+	//!\brief Read one padded tile into out (paddedTileSize()^2 * channels() bytes).
+	//!       Safe to call from several threads at once.
+	void readTile(size_t level, size_t tileX, size_t tileY, unsigned char *out);
+
+	size_t width() const { return width_; }
+	size_t height() const { return height_; }
+	size_t channels() const { return channels_; }
+	size_t tileSize() const { return tileSize_; }
+	size_t border() const { return border_; }
+	size_t paddedTileSize() const { return tileSize_ + 2 * border_; }
+	size_t tileBytes() const { return paddedTileSize() * paddedTileSize() * channels_; }
+	size_t levels() const { return levels_; }
+	size_t tilesX(size_t level) const;
+	size_t tilesY(size_t level) const;
+
+private:
+	TileFile(const TileFile&);
+	TileFile &operator=(const TileFile&);
+
+	size_t tileIndex(size_t level, size_t tileX, size_t tileY) const;
+
+	std::ifstream file_;
+	std::mutex fileMutex_;
+	size_t width_, height_, channels_, tileSize_, border_, levels_;
+	std::vector<uint64_t> offsets_;
+	std::vector<size_t> levelStart_;
+};
+
+}
@@ -0,0 +1,568 @@
+#include "VirtualTexture.hpp"
+#include "ShaderProgram.hpp"
+#include "Exception.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace glhelper {
+
+namespace {
+
+void cacheFormats(size_t channels, GLenum &internalFormat, GLenum &format)
+{
+	switch (channels) {
+	case 1:
+		internalFormat = GL_R8;
+		format = GL_RED;
+		break;
+	case 2:
+		internalFormat = GL_RG8;
+		format = GL_RG;
+		break;
+	case 3:
+		internalFormat = GL_RGB8;
+		format = GL_BGR;
+		break;
+	default:
+		internalFormat = GL_RGBA8;
+		format = GL_BGRA;
+		break;
+	}
+}
+
+}
+
+VirtualTexture::TileKey VirtualTexture::makeKey(size_t level, size_t x, size_t y)
+{
+	return (TileKey(level) << 48) | (TileKey(y) << 24) | TileKey(x);
+}
+
+size_t VirtualTexture::keyLevel(TileKey key)
+{
+	return size_t(key >> 48);
+}
+
+size_t VirtualTexture::keyX(TileKey key)
+{
+	return size_t(key & 0xffffff);
+}
+
+size_t VirtualTexture::keyY(TileKey key)
+{
+	return size_t((key >> 24) & 0xffffff);
+}
+
+VirtualTexture::VirtualTexture(const std::vector<Layer> &layers, const VirtualTextureSettings &settings)
+	:settings_(settings),
+	pageTable_(0),
+	frame_(0),
+	uploadsLastUpdate_(0),
+	feedbackFbo_(0), feedbackColor_(0), feedbackDepth_(0),
+	nextFeedback_(0),
+	stopWorkers_(false)
+{
+	if (layers.empty()) {
+		throw std::runtime_error("VirtualTexture: need at least one layer.");
+	}
+	for (const Layer &layer : layers) {
+		files_.emplace_back(new TileFile(layer.tileFile));
+		samplerNames_.push_back(layer.samplerName);
+		const TileFile &f = *files_.back(), &first = *files_.front();
+		if (f.width() != first.width() || f.height() != first.height() || f.tileSize() != first.tileSize()
+			|| f.border() != first.border()) {
+			throw std::runtime_error("VirtualTexture: " + layer.tileFile + " doesn't match the layout of the first layer.");
+		}
+	}
+	const TileFile &layout = *files_.front();
+	size_t coarsestTiles = layout.tilesX(levels() - 1) * layout.tilesY(levels() - 1);
+	size_t nSlots = settings_.cacheTilesPerSide * settings_.cacheTilesPerSide;
+	if (settings_.cacheTilesPerSide > 256) {
+		throw std::runtime_error("VirtualTexture: page table entries can address at most 256x256 cache tiles.");
+	}
+	if (nSlots <= coarsestTiles) {
+		throw std::runtime_error("VirtualTexture: cache is too small to hold the coarsest level.");
+	}
+	slots_.resize(nSlots, Slot{ 0, 0, false, false });
+
+	throwOnGlError();
+	size_t cacheSize = settings_.cacheTilesPerSide * layout.paddedTileSize();
+	for (const std::unique_ptr<TileFile> &f : files_) {
+		GLenum internalFormat, format;
+		cacheFormats(f->channels(), internalFormat, format);
+		uploadFormats_.push_back(format);
+		GLuint tex;
+		glGenTextures(1, &tex);
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, GLsizei(cacheSize), GLsizei(cacheSize));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		GpuMemory::track(GpuResourceType::TEXTURE, tex, cacheSize * cacheSize * GpuMemory::texelBytes(internalFormat),
+			"virtual texture cache");
+		caches_.push_back(tex);
+	}
+
+	// One page table texel per tile, with a mip level per tile file level.
+	glGenTextures(1, &pageTable_);
+	glBindTexture(GL_TEXTURE_2D, pageTable_);
+	glTexStorage2D(GL_TEXTURE_2D, GLsizei(levels()), GL_RGBA8UI,
+		GLsizei(layout.tilesX(0)), GLsizei(layout.tilesY(0)));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	size_t pageTableBytes = 0;
+	for (size_t l = 0; l < levels(); ++l) {
+		pageTableLevels_.emplace_back(layout.tilesX(l) * layout.tilesY(l) * 4, 0);
+		pageTableBytes += pageTableLevels_.back().size();
+	}
+	GpuMemory::track(GpuResourceType::TEXTURE, pageTable_, pageTableBytes, "virtual texture page table");
+	pageTableDirty_.assign(levels(), true);
+	throwOnGlError();
+
+	size_t feedbackTexels = settings_.feedbackWidth * settings_.feedbackHeight;
+	glGenFramebuffers(1, &feedbackFbo_);
+	GpuMemory::track(GpuResourceType::FRAMEBUFFER, feedbackFbo_, 0, "virtual texture feedback");
+	glBindFramebuffer(GL_FRAMEBUFFER, feedbackFbo_);
+	glGenTextures(1, &feedbackColor_);
+	glBindTexture(GL_TEXTURE_2D, feedbackColor_);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16UI, GLsizei(settings_.feedbackWidth), GLsizei(settings_.feedbackHeight));
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GpuMemory::track(GpuResourceType::TEXTURE, feedbackColor_, feedbackTexels * GpuMemory::texelBytes(GL_RGBA16UI),
+		"virtual texture feedback");
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor_, 0);
+	glGenRenderbuffers(1, &feedbackDepth_);
+	glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth_);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
+		GLsizei(settings_.feedbackWidth), GLsizei(settings_.feedbackHeight));
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	GpuMemory::track(GpuResourceType::RENDERBUFFER, feedbackDepth_, feedbackTexels * GpuMemory::texelBytes(GL_DEPTH_COMPONENT24),
+		"virtual texture feedback depth");
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth_);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("VirtualTexture: feedback framebuffer is incomplete.");
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// A few readbacks in flight, so update() never has to wait for the newest one.
+	feedbackReadbacks_.resize(3);
+	for (FeedbackReadback &r : feedbackReadbacks_) {
+		glGenBuffers(1, &r.pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, feedbackTexels * 4 * sizeof(uint16_t), nullptr, GL_STREAM_READ);
+		GpuMemory::track(GpuResourceType::BUFFER, r.pbo, feedbackTexels * 4 * sizeof(uint16_t), "virtual texture feedback readback");
+		r.fence = 0;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	throwOnGlError();
+
+	// The coarsest level is loaded up front and never evicted, so every lookup has a fallback.
+	size_t top = levels() - 1;
+	for (size_t y = 0; y < layout.tilesY(top); ++y) {
+		for (size_t x = 0; x < layout.tilesX(top); ++x) {
+			LoadedTile tile = loadTile(makeKey(top, x, y));
+			upload(tile, true);
+		}
+	}
+	uploadPageTable();
+
+	for (size_t i = 0; i < std::max<size_t>(1, settings_.nWorkers); ++i) {
+		workers_.emplace_back(&VirtualTexture::workerLoop, this);
+	}
+}
+
+VirtualTexture::~VirtualTexture() throw()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex_);
+		stopWorkers_ = true;
+	}
+	queueCv_.notify_all();
+	for (std::thread &t : workers_) {
+		t.join();
+	}
+	for (FeedbackReadback &r : feedbackReadbacks_) {
+		if (r.fence) {
+			glDeleteSync(r.fence);
+		}
+		GpuMemory::untrack(GpuResourceType::BUFFER, r.pbo);
+		glDeleteBuffers(1, &r.pbo);
+	}
+	GpuMemory::untrack(GpuResourceType::RENDERBUFFER, feedbackDepth_);
+	glDeleteRenderbuffers(1, &feedbackDepth_);
+	GpuMemory::untrack(GpuResourceType::TEXTURE, feedbackColor_);
+	glDeleteTextures(1, &feedbackColor_);
+	GpuMemory::untrack(GpuResourceType::FRAMEBUFFER, feedbackFbo_);
+	glDeleteFramebuffers(1, &feedbackFbo_);
+	GpuMemory::untrack(GpuResourceType::TEXTURE, pageTable_);
+	glDeleteTextures(1, &pageTable_);
+	for (GLuint tex : caches_) {
+		GpuMemory::untrack(GpuResourceType::TEXTURE, tex);
+	}
+	glDeleteTextures(GLsizei(caches_.size()), caches_.data());
+}
+
+VirtualTexture::LoadedTile VirtualTexture::loadTile(TileKey key)
+{
+	TraceZone zone("VirtualTexture::loadTile");
+	LoadedTile tile;
+	tile.key = key;
+	for (const std::unique_ptr<TileFile> &f : files_) {
+		tile.layers.emplace_back(f->tileBytes());
+		f->readTile(keyLevel(key), keyX(key), keyY(key), tile.layers.back().data());
+	}
+	return tile;
+}
+
+void VirtualTexture::workerLoop()
+{
+	if (Trace::active()) {
+		Trace::setThreadName("Tile loader");
+	}
+	for (;;) {
+		TileKey key;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex_);
+			queueCv_.wait(lock, [this]() { return stopWorkers_ || !queue_.empty(); });
+			if (stopWorkers_) {
+				return;
+			}
+			key = queue_.front();
+			queue_.pop_front();
+		}
+		try {
+			LoadedTile tile = loadTile(key);
+			std::lock_guard<std::mutex> lock(queueMutex_);
+			loaded_.push_back(std::move(tile));
+		} catch (std::exception &e) {
+			std::lock_guard<std::mutex> lock(queueMutex_);
+			workerError_ = e.what();
+		}
+	}
+}
+
+void VirtualTexture::upload(LoadedTile &tile, bool pinned)
+{
+	// Take a free slot if there is one, otherwise evict the least recently used
+	// tile - but never one used this frame, as that would just thrash the cache.
+	size_t best = slots_.size();
+	for (size_t i = 0; i < slots_.size(); ++i) {
+		const Slot &s = slots_[i];
+		if (!s.occupied) {
+			best = i;
+			break;
+		}
+		if (!s.pinned && s.lastUsed < frame_ && (best == slots_.size() || s.lastUsed < slots_[best].lastUsed)) {
+			best = i;
+		}
+	}
+	if (best == slots_.size()) {
+		return;
+	}
+	Slot &slot = slots_[best];
+	if (slot.occupied) {
+		resident_.erase(slot.key);
+		setPageTableEntry(slot.key, best, false);
+	}
+
+	const TileFile &layout = *files_.front();
+	size_t padded = layout.paddedTileSize();
+	GLint x = GLint((best % settings_.cacheTilesPerSide) * padded);
+	GLint y = GLint((best / settings_.cacheTilesPerSide) * padded);
+	GLint prevAlignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &prevAlignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t i = 0; i < caches_.size(); ++i) {
+		glBindTexture(GL_TEXTURE_2D, caches_[i]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, GLsizei(padded), GLsizei(padded),
+			uploadFormats_[i], GL_UNSIGNED_BYTE, tile.layers[i].data());
+		RenderStats::recordUpload(tile.layers[i].size());
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, prevAlignment);
+
+	slot.key = tile.key;
+	slot.lastUsed = frame_;
+	slot.occupied = true;
+	slot.pinned = pinned;
+	resident_[tile.key] = best;
+	setPageTableEntry(tile.key, best, true);
+}
+
+void VirtualTexture::setPageTableEntry(TileKey key, size_t slot, bool valid)
+{
+	size_t level = keyLevel(key);
+	size_t index = (keyY(key) * files_.front()->tilesX(level) + keyX(key)) * 4;
+	unsigned char *entry = &pageTableLevels_[level][index];
+	entry[0] = valid ? (unsigned char)(slot % settings_.cacheTilesPerSide) : 0;
+	entry[1] = valid ? (unsigned char)(slot / settings_.cacheTilesPerSide) : 0;
+	entry[2] = (unsigned char)level;
+	entry[3] = valid ? 1 : 0;
+	pageTableDirty_[level] = true;
+}
+
+void VirtualTexture::uploadPageTable()
+{
+	const TileFile &layout = *files_.front();
+	glBindTexture(GL_TEXTURE_2D, pageTable_);
+	GLint prevAlignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &prevAlignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t l = 0; l < levels(); ++l) {
+		if (!pageTableDirty_[l]) {
+			continue;
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, GLint(l), 0, 0, GLsizei(layout.tilesX(l)), GLsizei(layout.tilesY(l)),
+			GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, pageTableLevels_[l].data());
+		RenderStats::recordUpload(pageTableLevels_[l].size());
+		pageTableDirty_[l] = false;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, prevAlignment);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void VirtualTexture::setUniforms(ShaderProgram &program, GLuint firstUnit, float lodBias)
+{
+	const TileFile &layout = *files_.front();
+	glActiveTexture(GL_TEXTURE0 + firstUnit);
+	glBindTexture(GL_TEXTURE_2D, pageTable_);
+	glProgramUniform1i(program.get(), program.uniformLoc("vtPageTable"), GLint(firstUnit));
+	for (size_t i = 0; i < caches_.size(); ++i) {
+		glActiveTexture(GL_TEXTURE0 + firstUnit + 1 + GLuint(i));
+		glBindTexture(GL_TEXTURE_2D, caches_[i]);
+		// Not every pass samples every layer, so look these up quietly.
+		GLint loc = glGetUniformLocation(program.get(), samplerNames_[i].c_str());
+		if (loc != -1) {
+			glProgramUniform1i(program.get(), loc, GLint(firstUnit + 1 + i));
+		}
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glProgramUniform2f(program.get(), program.uniformLoc("vtVirtualSize"), float(layout.width()), float(layout.height()));
+	glProgramUniform1f(program.get(), program.uniformLoc("vtTileSize"), float(layout.tileSize()));
+	glProgramUniform1f(program.get(), program.uniformLoc("vtBorder"), float(layout.border()));
+	glProgramUniform1f(program.get(), program.uniformLoc("vtCacheSize"),
+		float(settings_.cacheTilesPerSide * layout.paddedTileSize()));
+	glProgramUniform1i(program.get(), program.uniformLoc("vtMaxLevel"), GLint(levels() - 1));
+	glProgramUniform1f(program.get(), program.uniformLoc("vtLodBias"), lodBias);
+}
+
+void VirtualTexture::bind(ShaderProgram &program, GLuint firstUnit)
+{
+	setUniforms(program, firstUnit, 0.f);
+}
+
+void VirtualTexture::beginFeedback(ShaderProgram &program, GLuint firstUnit, size_t viewportWidth)
+{
+	// Texture coordinate derivatives are larger in the smaller feedback buffer,
+	// which would otherwise request coarser tiles than the main view needs.
+	float lodBias = -std::log2(float(viewportWidth) / float(settings_.feedbackWidth));
+	setUniforms(program, firstUnit, lodBias);
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFbo_);
+	glGetIntegerv(GL_VIEWPORT, prevViewport_);
+	glBindFramebuffer(GL_FRAMEBUFFER, feedbackFbo_);
+	glViewport(0, 0, GLsizei(settings_.feedbackWidth), GLsizei(settings_.feedbackHeight));
+	GLuint clear[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 0, clear);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::endFeedback()
+{
+	// If every readback buffer is still waiting, skip this frame's feedback.
+	FeedbackReadback &r = feedbackReadbacks_[nextFeedback_];
+	if (r.fence == 0) {
+		GLint prevAlignment;
+		glGetIntegerv(GL_PACK_ALIGNMENT, &prevAlignment);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+		glReadPixels(0, 0, GLsizei(settings_.feedbackWidth), GLsizei(settings_.feedbackHeight),
+			GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glPixelStorei(GL_PACK_ALIGNMENT, prevAlignment);
+		r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+		nextFeedback_ = (nextFeedback_ + 1) % feedbackReadbacks_.size();
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, GLuint(prevFbo_));
+	glViewport(prevViewport_[0], prevViewport_[1], prevViewport_[2], prevViewport_[3]);
+	throwOnGlError();
+}
+
+void VirtualTexture::request(size_t level, float u, float v)
+{
+	const TileFile &layout = *files_.front();
+	level = std::min(level, levels() - 1);
+	size_t tx = layout.tilesX(level), ty = layout.tilesY(level);
+	size_t x = std::min(size_t(std::max(u, 0.f) * tx), tx - 1);
+	size_t y = std::min(size_t(std::max(v, 0.f) * ty), ty - 1);
+	extraRequests_.push_back(makeKey(level, x, y));
+}
+
+void VirtualTexture::touch(TileKey key, std::unordered_set<TileKey> &needed)
+{
+	// Also keep every coarser ancestor, which is what's shown until this tile arrives.
+	size_t level = keyLevel(key), x = keyX(key), y = keyY(key);
+	while (level < levels() && needed.insert(makeKey(level, x, y)).second) {
+		++level;
+		x >>= 1;
+		y >>= 1;
+	}
+}
+
+void VirtualTexture::processFeedback(const uint16_t *texels, size_t count, std::unordered_set<TileKey> &needed)
+{
+	TraceZone zone("VirtualTexture::processFeedback");
+	const TileFile &layout = *files_.front();
+	// Neighbouring pixels almost always want the same tile, so skip repeats cheaply.
+	TileKey last = ~TileKey(0);
+	for (size_t i = 0; i < count; ++i) {
+		const uint16_t *t = texels + i * 4;
+		if (t[3] == 0) {
+			continue;
+		}
+		size_t level = std::min<size_t>(t[2], levels() - 1);
+		size_t tx = layout.tilesX(level), ty = layout.tilesY(level);
+		size_t x = std::min<size_t>(size_t(t[0]) * tx / 65536, tx - 1);
+		size_t y = std::min<size_t>(size_t(t[1]) * ty / 65536, ty - 1);
+		TileKey key = makeKey(level, x, y);
+		if (key != last) {
+			touch(key, needed);
+			last = key;
+		}
+	}
+}
+
+void VirtualTexture::queueLoads(const std::unordered_set<TileKey> &needed)
+{
+	std::lock_guard<std::mutex> lock(queueMutex_);
+	// Anything still queued from older feedback may no longer be visible; start over.
+	for (TileKey key : queue_) {
+		inFlight_.erase(key);
+	}
+	queue_.clear();
+
+	std::vector<TileKey> missing;
+	for (TileKey key : needed) {
+		if (!resident_.count(key) && !inFlight_.count(key)) {
+			missing.push_back(key);
+		}
+	}
+	// Coarse tiles first: they cover the most screen area and are needed as fallbacks.
+	std::sort(missing.begin(), missing.end(), [](TileKey a, TileKey b) {
+		return keyLevel(a) > keyLevel(b);
+	});
+	// Never ask for more than the cache could hold at once.
+	size_t pinned = std::count_if(slots_.begin(), slots_.end(), [](const Slot &s) { return s.pinned; });
+	missing.resize(std::min(missing.size(), slots_.size() - pinned));
+	for (TileKey key : missing) {
+		queue_.push_back(key);
+		inFlight_.insert(key);
+	}
+	queueCv_.notify_all();
+}
+
+void VirtualTexture::update()
+{
+	TraceZone zone("VirtualTexture::update");
+	++frame_;
+
+	std::unordered_set<TileKey> needed;
+	bool haveFeedback = false;
+	for (FeedbackReadback &r : feedbackReadbacks_) {
+		if (r.fence == 0) {
+			continue;
+		}
+		GLenum status = glClientWaitSync(r.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			continue;
+		}
+		glDeleteSync(r.fence);
+		r.fence = 0;
+		size_t count = settings_.feedbackWidth * settings_.feedbackHeight;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+		const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, count * 4 * sizeof(uint16_t), GL_MAP_READ_BIT);
+		if (mapped) {
+			processFeedback(static_cast<const uint16_t*>(mapped), count, needed);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			haveFeedback = true;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	for (TileKey key : extraRequests_) {
+		touch(key, needed);
+	}
+	if (!extraRequests_.empty()) {
+		haveFeedback = true;
+		extraRequests_.clear();
+	}
+
+	if (haveFeedback) {
+		for (TileKey key : needed) {
+			auto it = resident_.find(key);
+			if (it != resident_.end()) {
+				slots_[it->second].lastUsed = frame_;
+			}
+		}
+		queueLoads(needed);
+	}
+
+	std::vector<LoadedTile> toUpload;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex_);
+		if (!workerError_.empty()) {
+			std::string error = workerError_;
+			workerError_.clear();
+			throw std::runtime_error("VirtualTexture: tile load failed: " + error);
+		}
+		size_t n = std::min(loaded_.size(), settings_.maxUploadsPerFrame);
+		toUpload.assign(std::make_move_iterator(loaded_.begin()), std::make_move_iterator(loaded_.begin() + n));
+		loaded_.erase(loaded_.begin(), loaded_.begin() + n);
+	}
+	for (LoadedTile &tile : toUpload) {
+		upload(tile, false);
+		inFlight_.erase(tile.key);
+	}
+	uploadsLastUpdate_ = toUpload.size();
+	uploadPageTable();
+	throwOnGlError();
+}
+
+size_t VirtualTexture::levels() const
+{
+	return files_.front()->levels();
+}
+
+size_t VirtualTexture::residentTiles() const
+{
+	return resident_.size();
+}
+
+size_t VirtualTexture::pendingTiles() const
+{
+	return inFlight_.size();
+}
+
+size_t VirtualTexture::uploadsLastUpdate() const
+{
+	return uploadsLastUpdate_;
+}
+
+size_t VirtualTexture::cacheBytes() const
+{
+	size_t cacheSize = settings_.cacheTilesPerSide * files_.front()->paddedTileSize();
+	size_t bytes = 0;
+	for (const std::unique_ptr<TileFile> &f : files_) {
+		bytes += cacheSize * cacheSize * f->channels();
+	}
+	for (const std::vector<unsigned char> &level : pageTableLevels_) {
+		bytes += level.size();
+	}
+	return bytes;
+}
+
+}
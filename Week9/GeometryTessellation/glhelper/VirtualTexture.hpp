@@ -0,0 +1,148 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "TileFile.hpp"
+
+namespace glhelper {
+
+class ShaderProgram;
+
+struct VirtualTextureSettings {
+	//!\brief The cache for each layer holds this many tiles along each side.
+	size_t cacheTilesPerSide = 16;
+	size_t nWorkers = 2;
+	//!\brief Limits the stall from glTexSubImage2D calls in any one update().
+	size_t maxUploadsPerFrame = 16;
+	size_t feedbackWidth = 160, feedbackHeight = 90;
+};
+
+//!\brief Streams a texture far too large for GPU memory, one tile at a time.
+//!
+//!       The image lives on disk as one or more TileFiles with identical layouts
+//!       (e.g. height, albedo and normals of a terrain), which share one page table.
+//!       Only the tiles that are actually visible are kept in a fixed-size cache
+//!       texture per layer; everything else is represented by the nearest coarser
+//!       resident tile, and the coarsest level is always resident.
+//!
+//!       Each frame:
+//!        - render the scene into a small feedback buffer between beginFeedback()
+//!          and endFeedback(), writing the tiles needed (see shaders/VirtualTexture.glsl);
+//!        - call update(), which reads back earlier feedback without stalling, queues
+//!          missing tiles for the worker threads and uploads tiles they've finished;
+//!        - bind() before rendering with the virtual texture.
+//!\note Must be created, updated and destroyed on the thread owning the GL context.
+class VirtualTexture final
+{
+public:
+	struct Layer {
+		std::string tileFile;
+		//!\brief Name of the sampler2D uniform this layer's cache is bound to.
+		std::string samplerName;
+	};
+	explicit VirtualTexture(const std::vector<Layer> &layers, const VirtualTextureSettings &settings = VirtualTextureSettings());
+	~VirtualTexture() throw();
+
+	//!\brief Binds the page table and caches to texture units firstUnit onwards,
+	//!       and sets the vt* uniforms used by VirtualTexture.glsl.
+	void bind(ShaderProgram &program, GLuint firstUnit);
+	//!\brief Binds the feedback framebuffer and sets program up (as in bind()) to
+	//!       render into it. viewportWidth is the width of the main view, used to
+	//!       correct mip selection for the feedback buffer's lower resolution.
+	void beginFeedback(ShaderProgram &program, GLuint firstUnit, size_t viewportWidth);
+	//!\brief Restores the previous framebuffer and viewport, and starts an
+	//!       asynchronous readback of the feedback buffer.
+	void endFeedback();
+
+	//!\brief Request a tile by virtual texture coordinate, e.g. for lookups the
+	//!       feedback pass can't see. Takes effect at the next update().
+	void request(size_t level, float u, float v);
+	//!\brief Process finished feedback, queue loads and upload loaded tiles. Never blocks
+	//!       on the GPU or disk.
+	void update();
+
+	size_t levels() const;
+	size_t residentTiles() const;
+	//!\brief Tiles queued or being loaded by the workers.
+	size_t pendingTiles() const;
+	size_t uploadsLastUpdate() const;
+	//!\brief GPU memory used by the caches and page table.
+	size_t cacheBytes() const;
+
+private:
+	VirtualTexture(const VirtualTexture&);
+	VirtualTexture &operator=(const VirtualTexture&);
+
+	typedef uint64_t TileKey;
+	static TileKey makeKey(size_t level, size_t x, size_t y);
+	static size_t keyLevel(TileKey key);
+	static size_t keyX(TileKey key);
+	static size_t keyY(TileKey key);
+
+	struct LoadedTile {
+		TileKey key;
+		std::vector<std::vector<unsigned char>> layers;
+	};
+	struct Slot {
+		TileKey key;
+		uint64_t lastUsed;
+		bool occupied, pinned;
+	};
+	struct FeedbackReadback {
+		GLuint pbo;
+		GLsync fence;
+	};
+
+	void workerLoop();
+	LoadedTile loadTile(TileKey key);
+	void upload(LoadedTile &tile, bool pinned);
+	void touch(TileKey key, std::unordered_set<TileKey> &needed);
+	void processFeedback(const uint16_t *texels, size_t count, std::unordered_set<TileKey> &needed);
+	void queueLoads(const std::unordered_set<TileKey> &needed);
+	void setPageTableEntry(TileKey key, size_t slot, bool valid);
+	void uploadPageTable();
+	void setUniforms(ShaderProgram &program, GLuint firstUnit, float lodBias);
+
+	VirtualTextureSettings settings_;
+	std::vector<std::string> samplerNames_;
+	std::vector<std::unique_ptr<TileFile>> files_;
+	std::vector<GLenum> uploadFormats_;
+	std::vector<GLuint> caches_;
+	GLuint pageTable_;
+
+	// CPU copy of each page table level (RGBA8: slot x, slot y, level, valid).
+	std::vector<std::vector<unsigned char>> pageTableLevels_;
+	std::vector<bool> pageTableDirty_;
+
+	std::vector<Slot> slots_;
+	std::unordered_map<TileKey, size_t> resident_;
+	std::unordered_set<TileKey> inFlight_;
+	std::vector<TileKey> extraRequests_;
+	uint64_t frame_;
+	size_t uploadsLastUpdate_;
+
+	GLuint feedbackFbo_, feedbackColor_, feedbackDepth_;
+	GLint prevFbo_, prevViewport_[4];
+	std::vector<FeedbackReadback> feedbackReadbacks_;
+	size_t nextFeedback_;
+
+	// Shared with the worker threads.
+	mutable std::mutex queueMutex_;
+	std::condition_variable queueCv_;
+	std::deque<TileKey> queue_;
+	std::vector<LoadedTile> loaded_;
+	std::string workerError_;
+	bool stopWorkers_;
+	std::vector<std::thread> workers_;
+};
+
+}
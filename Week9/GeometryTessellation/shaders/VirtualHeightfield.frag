@@ -0,0 +1,23 @@
+#version 430
+
+#pragma include VirtualTexture.glsl
+
+in vec2 fTex;
+flat in float fHeightLod;
+
+uniform sampler2D albedoCache;
+uniform sampler2D normalCache;
+uniform mat4 modelToWorld;
+
+out vec4 color;
+
+void main()
+{
+	vec2 uv = vtCacheUv(fTex, vtLod(fTex));
+	vec3 albedo = textureLod(albedoCache, uv, 0.0).rgb;
+	// Tangent space normal map on a flat, y-up surface.
+	vec3 n = textureLod(normalCache, uv, 0.0).rgb * 2.0 - 1.0;
+	n = normalize(mat3(modelToWorld) * vec3(n.x, n.z, n.y));
+	float diffuse = max(dot(n, normalize(vec3(0.4, 1.0, 0.3))), 0.0);
+	color = vec4(albedo * (0.2 + 0.8 * diffuse), 1.0);
+}
@@ -0,0 +1,12 @@
+#version 430
+
+layout(location = 0) in vec3 vPos;
+layout(location = 2) in vec2 vTex;
+
+out vec2 cTex;
+
+void main()
+{
+	gl_Position = vec4(vPos, 1.0);
+	cTex = vTex;
+}
@@ -0,0 +1,15 @@
+#version 430
+
+#pragma include VirtualTexture.glsl
+
+in vec2 fTex;
+flat in float fHeightLod;
+
+out uvec4 feedback;
+
+void main()
+{
+	// One request covers every layer, so ask for whichever of the albedo and
+	// height lookups needs the finer level.
+	feedback = vtFeedback(fTex, min(vtLod(fTex), fHeightLod));
+}
@@ -0,0 +1,45 @@
+// Lookups into a glhelper::VirtualTexture. Include after the #version line;
+// the vt* uniforms are set by VirtualTexture::bind().
+
+uniform usampler2D vtPageTable;
+uniform vec2 vtVirtualSize;
+uniform float vtTileSize;
+uniform float vtBorder;
+uniform float vtCacheSize;
+uniform int vtMaxLevel;
+uniform float vtLodBias;
+
+// Mip level wanted for uv, from screen-space derivatives (fragment shaders only).
+float vtLod(vec2 uv)
+{
+	vec2 dx = dFdx(uv * vtVirtualSize);
+	vec2 dy = dFdy(uv * vtVirtualSize);
+	float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + vtLodBias;
+	return clamp(lod, 0.0, float(vtMaxLevel));
+}
+
+// Converts a virtual texture coordinate to a coordinate in the cache textures,
+// using the finest resident tile at or above the requested level.
+vec2 vtCacheUv(vec2 uv, float lod)
+{
+	uv = clamp(uv, 0.0, 1.0);
+	for (int level = int(lod); level <= vtMaxLevel; ++level) {
+		ivec2 tiles = textureSize(vtPageTable, level);
+		vec2 tileCoord = uv * vec2(tiles);
+		ivec2 tile = min(ivec2(tileCoord), tiles - 1);
+		uvec4 entry = texelFetch(vtPageTable, tile, level);
+		if (entry.w != 0u) {
+			vec2 inTile = tileCoord - vec2(tile);
+			vec2 texel = vec2(entry.xy) * (vtTileSize + 2.0 * vtBorder) + vtBorder + inTile * vtTileSize;
+			return texel / vtCacheSize;
+		}
+	}
+	return vec2(0.0);
+}
+
+// What the feedback pass writes for a lookup: which tile is wanted, encoded as
+// the texture coordinate and level. Alpha marks the texel as covered.
+uvec4 vtFeedback(vec2 uv, float lod)
+{
+	return uvec4(uvec2(clamp(uv, 0.0, 1.0) * 65535.0), uint(lod), 1u);
+}